@@ -218,6 +218,9 @@ void BytecodeAnalyze::BuildLoop( BytecodeIterator* itr ) {
   itr->GetOperand(&induct,&offset);
   lava_debug(NORMAL,lava_verify(IsLocalVar(induct)););
   Kill(induct);
+  // the foreach loop keeps the container in the induction register and the
+  // cursor in the one after it , FESTART writes both
+  if(itr->opcode() == BC_FESTART && IsLocalVar(induct+1)) Kill(induct+1);
 
   itr->Move();
 
@@ -226,7 +229,7 @@ void BytecodeAnalyze::BuildLoop( BytecodeIterator* itr ) {
 
     while(itr->HasNext()) {
       if(itr->opcode() == BC_FEND1 || itr->opcode() == BC_FEND2 ||
-                                      itr->opcode() == BC_FEEND)
+         itr->opcode() == BC_FEND2I|| itr->opcode() == BC_FEEND)
         break;
       else {
         BuildBytecode(itr);
@@ -238,9 +241,11 @@ void BytecodeAnalyze::BuildLoop( BytecodeIterator* itr ) {
 
     // If the loop opcode is BC_FEND1 or BC_FEEND, we skip the induction
     // variable as a loop bounded Phi. BC_FEND1 means no induction variable,
-    // as with BC_FEEND it means loop induction variable is actually an
-    // iterator object.
-    if(itr->opcode() != BC_FEND1 && itr->opcode() != BC_FEEND) {
+    // as with BC_FEEND the induction register holds the container which is
+    // not changed by the loop , but the cursor after it is advanced.
+    if(itr->opcode() == BC_FEEND) {
+      if(IsLocalVar(induct+1)) Kill(induct+1);
+    } else if(itr->opcode() != BC_FEND1) {
       Kill(induct);
     }
     itr->Move();
@@ -0,0 +1,74 @@
+#include "compiler.h"
+#include "hir.h"
+#include "schedule.h"
+#include "graph-builder.h"
+#include "pass/bce.h"
+#include "pass/dce.h"
+#include "pass/escape-analysis.h"
+#include "pass/gvn.h"
+#include "pass/loop-induction.h"
+#include "pass/loop-unswitch.h"
+#include "pass/representation-selection.h"
+
+#include "x64/lir.h"
+#include "x64/lower.h"
+#include "x64/register-allocator.h"
+#include "x64/codegen.h"
+#include "x64/code-arena.h"
+
+#include "src/runtime-trace.h"
+#include "src/perf-map.h"
+#include "src/trace.h"
+
+namespace lavascript {
+namespace cbase      {
+
+void* CompilePrototype( const Handle<Script>& script , const Handle<Prototype>& proto ,
+                                                       const RuntimeTrace& trace ,
+                                                       std::string* error ) {
+  hir::Graph graph;
+
+  if(!hir::BuildPrototype(script,proto,trace,&graph)) {
+    *error = "cannot build graph";
+    return NULL;
+  }
+
+  hir::LoopInduction().Perform(&graph,hir::HIRPass::NORMAL);
+  hir::GVN().Perform(&graph,hir::HIRPass::NORMAL);
+  hir::DCE().Perform(&graph,hir::HIRPass::NORMAL);
+  // pass/infer.cc is not part of the pipeline yet : it indexes its per node
+  // table out of bound and applies a branch condition to both the true and
+  // false successor , so running it would crash or mis-simplify the graph
+  hir::LoopUnswitch().Perform(&graph,hir::HIRPass::NORMAL);
+  hir::EscapeAnalysis().Perform(&graph,hir::HIRPass::NORMAL);
+  hir::BCE().Perform(&graph,hir::HIRPass::NORMAL);
+  hir::RepresentationSelection().Perform(&graph,hir::HIRPass::NORMAL);
+
+  zone::Zone zone;
+  hir::Schedule schedule(&zone,graph);
+
+  x64::Function func(&zone);
+  if(!x64::Lower(graph,schedule,&func,error)) return NULL;
+
+  x64::RegisterAllocator ra(&zone,func);
+  ra.Allocate();
+
+  x64::Assembler masm;
+  x64::CodeGenerator(func,ra,&masm).Generate();
+
+  void* code = x64::CodeArena::GetInstance()->Install(masm.buffer().data(),masm.size());
+  if(!code) {
+    *error = "out of code memory";
+    return NULL;
+  }
+
+  if(auto perf_map = PerfMap::GetInstance()) {
+    std::string name( proto->proto_string() ? proto->proto_string()->ToStdString() :
+                                              std::string("<main>") );
+    perf_map->AddCode(code,masm.size(),Format("lavascript::jit::%s",name.c_str()).c_str());
+  }
+  return code;
+}
+
+} // namespace cbase
+} // namespace lavascript
@@ -0,0 +1,30 @@
+#ifndef CBASE_COMPILER_H_
+#define CBASE_COMPILER_H_
+#include <string>
+
+#include "src/objects.h"
+#include "src/runtime-trace.h"
+
+namespace lavascript {
+namespace cbase      {
+
+// Compile a prototype into machine code with the cbase compiler and the x64
+// backend. The pipeline is
+//
+//   graph builder -> hir passes -> schedule -> lower -> register allocation
+//                 -> code generation
+//
+// The returned code has the signature documented in x64::CodeGenerator and is
+// owned by the process wide code arena. If the prototype uses any feature the
+// backend doesn't support , NULL is returned with the reason in error.
+//
+// The types recorded in the trace are speculated on , each speculation is
+// guarded and the code deopts back into the interpreter once it fails.
+void* CompilePrototype( const Handle<Script>& , const Handle<Prototype>& ,
+                                                const RuntimeTrace& ,
+                                                std::string* error );
+
+} // namespace cbase
+} // namespace lavascript
+
+#endif // CBASE_COMPILER_H_
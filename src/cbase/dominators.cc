@@ -83,6 +83,9 @@ void Dominators::Build( const Graph& graph ) {
       {
         temp.clear();
         lava_foreach( auto pn , n->backward_edge()->GetForwardIterator() ) {
+          // predecessor not reachable from start , ie dead code , doesn't
+          // constrain the dominators
+          if(ts[pn->id()] == 0) continue;
           if(temp.empty()) {
             temp = *GetDomSet(graph,all_cf,pn);
           } else {
@@ -161,7 +161,7 @@ Expr* ArithFolder::Float64Reassociate( Graph* graph , Binary::Operator op , Expr
     auto l = NewUnboxNode(graph,lhs->As<Unary>()->operand(),TPKIND_FLOAT64);
     auto r = NewUnboxNode(graph,rhs->As<Unary>()->operand(),TPKIND_FLOAT64);
     return NewBoxNode<Float64Arithmetic>(graph,TPKIND_FLOAT64,l,r,Binary::MUL);
-  } else if(lhs->Equal(rhs)) {
+  } else if(op == Binary::SUB && lhs->Equal(rhs)) {
     // 8. a - a => 0
     return Float64::New(graph,0);
   }
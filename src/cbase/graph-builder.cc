@@ -269,8 +269,11 @@ class GraphBuilder {
   // Add a type feedback with TypeKind into the stack slot pointed by index
   Expr* AddTypeFeedbackIfNeed( Expr* , TypeKind     , const BytecodeLocation& );
   Expr* AddTypeFeedbackIfNeed( Expr* , const Value& , const BytecodeLocation& );
-  // Create a guard node and linked it back to the current graph
-  Guard* NewGuard            ( Test* );
+  // Create a guard node and linked it back to the current graph , it deoptimizes
+  // to the interpreter state before the bytecode
+  Guard* NewGuard            ( Test* , const BytecodeLocation& );
+  // Guard the arguments with the type traced at the entry of the function
+  void NewArgumentGuard      ( const BytecodeLocation& );
   // Check whether a node's type is the needed type
   bool CheckType( Expr** , TypeKind     , std::size_t , const BytecodeLocation& );
  private: // Arithmetic
@@ -870,15 +873,15 @@ bool GraphBuilder::NewCall( BytecodeIterator* itr ) {
     return DoInline(proto,base,itr->opcode() == BC_TCALL,itr->NextPC());
   } else {
     // this is the general case inline when we don't know the type of our function.
-    // it mostly happened at cross file/module function inline
-    auto tt   = runtime_trace_.GetTrace( itr->pc() );
-    if(tt) {
-      auto &v = tt->data[0];
-      if(v.IsClosure()) {
-        auto proto = v.GetClosure()->prototype();
-        if(inliner_->ShouldInline(func_info_.size(),proto)) {
-          return SpeculativeInline(v.GetClosure()->prototype(),itr);
-        }
+    // it mostly happened at cross file/module function inline. The trace is fed
+    // by the call site cache , see CallSiteCache::FeedRuntimeTrace , which also
+    // records the callee's argument size ; a call with different argument number
+    // fails in the interpreter and is not inlined
+    auto ct = runtime_trace_.GetCallTrace( itr->pc() );
+    if(ct && ct->argument_size == arg) {
+      auto proto = ct->callee.GetClosure()->prototype();
+      if(inliner_->ShouldInline(func_info_.size(),proto)) {
+        return SpeculativeInline(proto,itr);
       }
     }
   }
@@ -889,8 +892,8 @@ bool GraphBuilder::NewCall( BytecodeIterator* itr ) {
 
 bool GraphBuilder::NewCallFallback( BytecodeIterator* itr ) {
   (void)itr;
-  // TODO:: add implementation
-  lava_die();
+  // TODO:: add implementation , until then a call that is not inlined stops
+  // the compilation
   return false;
 }
 
@@ -951,21 +954,34 @@ IRObject* GraphBuilder::NewIRObject( std::size_t size ) {
 }
 
 // Type Guard ---------------------------------------------------------------------
-Guard* GraphBuilder::NewGuard( Test* test ) {
-  // create a new guard
-  auto guard = Guard::New(graph_,test);
+Guard* GraphBuilder::NewGuard( Test* test , const BytecodeLocation& pc ) {
+  // create a new guard , if the test fails the bytecode is executed again by
+  // the interpreter since the checkpoint captures the state before it
+  auto guard = Guard::New(graph_,test,GenerateCheckpoint(pc));
   // add this guard back to the guard_list , later on we can patch the guard
   func_info().guard_list.push_back(guard);
   // return the newly created region node
   return guard;
 }
 
+void GraphBuilder::NewArgumentGuard( const BytecodeLocation& pc ) {
+  auto sz = func_info().prototype->argument_size();
+  for( std::size_t i = 0 ; i < sz ; ++i ) {
+    // only speculate on real number since the arithmetic and comparison can be
+    // specialized with it
+    auto v = runtime_trace_.GetArgumentTrace(i);
+    if(v && v->IsReal()) {
+      auto tt = TestType::New(graph_,TPKIND_FLOAT64,StackGet(i));
+      StackSet(i,NewGuard(tt,pc));
+    }
+  }
+}
+
 Expr* GraphBuilder::AddTypeFeedbackIfNeed( Expr* node , const Value& value , const BytecodeLocation& pc ) {
   return AddTypeFeedbackIfNeed(node,MapValueToTypeKind(value),pc);
 }
 
 Expr* GraphBuilder::AddTypeFeedbackIfNeed( Expr* n , TypeKind tp , const BytecodeLocation& pc ) {
-  (void)pc;
   lava_debug(NORMAL,lava_verify(TPKind::IsLeaf(tp)););
 
   auto stp = GetTypeInference(n);
@@ -985,7 +1001,7 @@ Expr* GraphBuilder::AddTypeFeedbackIfNeed( Expr* n , TypeKind tp , const Bytecod
   // generate type test node
   auto tt  = TestType::New(graph_,tp,n);
   // generate guard node
-  auto gd  = NewGuard(tt);
+  auto gd  = NewGuard(tt,pc);
   // return the new guarded node
   return gd;
 }
@@ -1008,7 +1024,7 @@ bool GraphBuilder::CheckType( Expr** object , TypeKind tp , std::size_t index ,
 
     if(res) {
       auto tt_node = TestType::New(graph_,vt,*object);
-      auto guard   = NewGuard(tt_node);
+      auto guard   = NewGuard(tt_node,pc);
       *object      = guard; // overwrite the old node with newly guarded node
       return true;
     }
@@ -1081,6 +1097,21 @@ Expr* GraphBuilder::NewBinary  ( Expr* lhs , Expr* rhs , Binary::Operator op , c
 
 Expr* GraphBuilder::TrySpeculativeBinary( Expr* lhs , Expr* rhs , Binary::Operator op,
                                                                   const BytecodeLocation& pc ) {
+  // both operands are already known to be real , ie the guarded argument , so
+  // no trace is needed. Modulo is left to the dynamic node since the backend
+  // doesn't support float64 modulo
+  if(GetTypeInference(lhs) == TPKIND_FLOAT64 && GetTypeInference(rhs) == TPKIND_FLOAT64) {
+    if(Binary::IsArithmeticOperator(op) && op != Binary::MOD) {
+      auto l = NewUnboxNode(graph_,lhs,TPKIND_FLOAT64);
+      auto r = NewUnboxNode(graph_,rhs,TPKIND_FLOAT64);
+      return NewBoxNode<Float64Arithmetic>(graph_,TPKIND_FLOAT64,l,r,op);
+    } else if(Binary::IsComparisonOperator(op)) {
+      auto l = NewUnboxNode(graph_,lhs,TPKIND_FLOAT64);
+      auto r = NewUnboxNode(graph_,rhs,TPKIND_FLOAT64);
+      return NewBoxNode<Float64Compare>(graph_,TPKIND_BOOLEAN,l,r,op);
+    }
+  }
+
   auto tt = runtime_trace_.GetTrace(pc.address());
   if(tt) {
     auto lhs_val = tt->data[1];
@@ -1266,8 +1297,12 @@ Expr* GraphBuilder::NewICall( std::uint8_t a1 , std::uint8_t a2 , std::uint8_t a
   else {
     if(auto ret = LowerICall(node,pc); ret)
       return ret;
-    else
+    else {
+      // the intrinsic call may mutate its argument , ie pop , so it is part of
+      // the effect chain
+      env()->effect()->UpdateWriteEffect(node);
       return node;
+    }
   }
 }
 
@@ -1809,7 +1844,7 @@ GraphBuilder::BuildLoopBlock( BytecodeIterator* itr ) {
     }
   }
 
-  lava_unreachF("%s","must be closed by BC_FEEND/BC_FEND1/BC_FEND2/BC_FEVREND");
+  lava_unreachF("%s","must be closed by BC_FEEND/BC_FEND1/BC_FEND2/BC_FEND2I/BC_FEVREND");
   return STOP_BAILOUT;
 }
 
@@ -1919,6 +1954,7 @@ Expr* GraphBuilder::BuildLoopEndCondition( BytecodeIterator* itr , ControlFlow*
         return NewBinary(StackGet(a1),StackGet(a2),Binary::LT,itr->bytecode_location());
       }
     case BC_FEND2:
+    case BC_FEND2I:
       {
         std::uint8_t a1,a2,a3; std::uint32_t a4;
         itr->GetOperand(&a1,&a2,&a3,&a4);
@@ -2034,6 +2070,11 @@ GraphBuilder::BuildLoopBody( BytecodeIterator* itr , ControlFlow* loop_header )
 
 GraphBuilder::StopReason GraphBuilder::BuildLoop( BytecodeIterator* itr ) {
   lava_debug(NORMAL,lava_verify(IsLoopStartBytecode(itr->opcode())););
+  // The interpreter keeps a foreach loop as the container plus a raw cursor in
+  // the register after it , while ItrNew/ItrNext/ItrDeref model a heap iterator
+  // in one register. The frame written back on deoptimization would not match
+  // what the interpreter expects , so foreach loop is not compiled for now.
+  if(itr->opcode() == BC_FESTART) return STOP_BAILOUT;
   // normal path for loop graph
   auto loop_header = LoopHeader::New(graph_,region());
   set_region(loop_header);
@@ -2292,7 +2333,7 @@ GraphBuilder::StopReason GraphBuilder::BuildBytecode( BytecodeIterator* itr ) {
 
     case BC_TCALL:
     case BC_CALL:
-      NewCall(itr);
+      if(!NewCall(itr)) return STOP_BAILOUT;
       break;
 
     case BC_JMPF:
@@ -2392,6 +2433,8 @@ bool GraphBuilder::Build( const Handle<Prototype>& entry , Graph* graph ) {
     auto itr = entry->GetBytecodeIterator();
     // set the current region
     set_region(region);
+    // guard the traced argument type before the first bytecode
+    NewArgumentGuard(itr.bytecode_location());
     // start to execute the build basic block
     if(BuildBasicBlock(&itr) == STOP_BAILOUT)
       return false;
@@ -2427,7 +2470,7 @@ void GraphBuilder::SetupOSRLoopCondition( BytecodeIterator* itr ) {
     itr->GetOperand(&a1,&a2,&a3,&a4);
     auto comparison = NewBinary(StackGet(a1), StackGet(a2), Binary::LT , itr->bytecode_location());
     StackSet(kAccRegisterIndex,comparison);
-  } else if(itr->opcode() == BC_FEND2) {
+  } else if(itr->opcode() == BC_FEND2 || itr->opcode() == BC_FEND2I) {
     std::uint8_t a1,a2,a3; std::uint32_t a4;
     itr->GetOperand(&a1,&a2,&a3,&a4);
     // the addition node will use the PHI node as its left hand side
@@ -2537,6 +2580,15 @@ GraphBuilder::BuildOSRStart( const Handle<Prototype>& entry ,  const std::uint32
   BACKUP_ENVIRONMENT(&root_env,this) {
     // set up the OSR scope
     OSRScope scope(this,entry,header,pc);
+    // foreach loop is not compiled , see BuildLoop , neither is a loop nested
+    // inside of it since the outer loops are peeled as well
+    {
+      BytecodeIterator end(entry->code_buffer(),entry->code_buffer_size());
+      for( auto loop = func_info().bc_analyze.LookUpLoopHeader(pc) ; loop ; loop = loop->prev ) {
+        end.BranchTo(loop->end);
+        if(end.opcode() == BC_FEEND) return STOP_BAILOUT;
+      }
+    }
     // set up OSR local variable
     BuildOSRLocalVariable();
     // craft a bytecode iterator *starts* at the OSR instruction entry
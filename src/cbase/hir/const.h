@@ -84,7 +84,7 @@ LAVA_CBASE_HIR_DEFINE(Tag=LONG_STRING;Name="lstring";Leaf=Leaf,
     value_    (value)
   {}
   virtual std::uint64_t GVNHash() const {
-    return GVNHash1(type_name(),reinterpret_cast<std::uint64_t>(value_));
+    return GVNHash1(type_name(),Hasher::Hash64(value_->data(),value_->size()));
   }
   virtual bool Equal( const Expr* that ) const {
     return that->Is<LString>() && (*(that->As<LString>()->value()) == *value_);
@@ -106,7 +106,7 @@ LAVA_CBASE_HIR_DEFINE(Tag=SMALL_STRING;Name="sstring";Leaf=Leaf,
     value_    (value)
   {}
   virtual std::uint64_t GVNHash() const {
-    return GVNHash1(type_name(),reinterpret_cast<std::uint64_t>(value_));
+    return GVNHash1(type_name(),Hasher::Hash64(value_->data(),value_->size()));
   }
   virtual bool Equal( const Expr* that ) const {
     return that->Is<SString>() && (*(that->As<SString>()->value()) == *value_);
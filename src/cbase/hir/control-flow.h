@@ -27,6 +27,11 @@ LAVA_CBASE_HIR_DEFINE(HIR_INTERNAL,ControlFlow,public Node) {
     AddBackwardEdgeImpl(edge);
     edge->AddForwardEdgeImpl(this);
   }
+  // add the edge on this side only , the other side must be added as well
+  void AddBackwardEdgeOnly( ControlFlow* edge ) { AddBackwardEdgeImpl(edge); }
+  // replace the backward edge |from| with |to| , the edge keeps its position
+  // in this node's backward edge list
+  void ReplaceBackwardEdge( ControlFlow* from , ControlFlow* to );
   void RemoveBackwardEdgeOnly( ControlFlow* );
   void RemoveBackwardEdge( ControlFlow* );
   void RemoveBackwardEdge( std::size_t index );
@@ -48,6 +53,10 @@ LAVA_CBASE_HIR_DEFINE(HIR_INTERNAL,ControlFlow,public Node) {
     AddForwardEdgeImpl(edge);
     edge->AddBackwardEdgeImpl(this);
   }
+  void AddForwardEdgeOnly( ControlFlow* edge ) { AddForwardEdgeImpl(edge); }
+  // replace the forward edge |from| with |to| , the edge keeps its position
+  // in this node's forward edge list
+  void ReplaceForwardEdge( ControlFlow* from , ControlFlow* to );
   void RemoveForwardEdgeOnly( ControlFlow* );
   void RemoveForwardEdge( ControlFlow* edge );
   void RemoveForwardEdge( std::size_t index );
@@ -54,6 +54,8 @@ LAVA_CBASE_HIR_DEFINE(HIR_INTERNAL,ReadEffect,public EffectNode) {
   const ReadEffectEdge& effect_edge () const { return effect_edge_; }
   WriteEffect*          write_effect() const { return effect_edge_.node; }
   inline void SetWriteEffect( WriteEffect* );
+  // unlink |this| from the write effect it depends on
+  inline void RemoveWriteEffect();
  public:
   // Replace operations
   virtual void Replace( Expr* );
@@ -102,6 +104,10 @@ LAVA_CBASE_HIR_DEFINE(HIR_INTERNAL,WriteEffect,public EffectNode ,public DoubleL
     return ret;
   }
 
+  // whether |this| node is in the effect chain , a write removed from the chain
+  // is only used as a value , ie a scalar replaced allocation used by checkpoint
+  bool IsLinked() const;
+
   // return barrier that is closest to |this| node. If |this| node is a barrier,
   // then just return |this|
   EffectBarrier* FirstBarrier() const;
@@ -1,6 +1,7 @@
 #ifndef CBASE_HIR_GUARD_H_
 #define CBASE_HIR_GUARD_H_
 #include "expr.h"
+#include "checkpoint.h"
 
 namespace lavascript {
 namespace cbase      {
@@ -49,18 +50,26 @@ LAVA_CBASE_HIR_DEFINE(Tag=TEST_TYPE;Name="test_type";Leaf=NoLeaf,
 
 // -----------------------------------------------------
 // Guard
+//
+// A guard checks its test and evaluates to the tested object. When the test
+// fails the machine code cannot continue , it materializes the interpreter
+// frame captured by the checkpoint and the interpreter resumes at the bytecode
+// of the checkpoint , ie deoptimization. The checkpoint is not part of the
+// GVN hash , see Checkpoint.
 // -----------------------------------------------------
 LAVA_CBASE_HIR_DEFINE(Tag=GUARD;Name="guard";Leaf=NoLeaf,
     Guard,public Expr) {
  public:
-  inline static Guard* New( Graph* , Test* );
+  inline static Guard* New( Graph* , Test* , Checkpoint* );
   Test*             test() const { return operand_list()->First()->As<Test>(); }
   Expr*           object() const { return test()->object(); }
+  Checkpoint* checkpoint() const { return operand_list()->Last()->As<Checkpoint>(); }
 
-  Guard( Graph* graph , std::uint32_t id , Test* test ):
+  Guard( Graph* graph , std::uint32_t id , Test* test , Checkpoint* cp ):
     Expr(HIR_GUARD,id,graph)
   {
     AddOperand(test);
+    AddOperand(cp);
   }
  public:
   virtual std::uint64_t GVNHash() const {
@@ -481,7 +481,8 @@ inline void PhiBase::set_region( Merge* region ) {
 
 inline void PhiBase::RemovePhiFromRegion( PhiBase* phi ) {
   if(phi->region()) {
-    lava_verify(phi->region()->RemoveOperand(phi));
+    phi->region()->RemovePhi(phi);
+    phi->ClearOperand();
   }
 }
 
@@ -587,12 +588,26 @@ inline LoopIVFloat64* LoopIVFloat64::New( Graph* graph , Expr* lhs , Expr* rhs ,
   return ret;
 }
 
+inline Float64Phi* Float64Phi::New( Graph* graph ) {
+  return graph->zone()->New<Float64Phi>(graph,graph->AssignID());
+}
+
+inline Float64Phi* Float64Phi::New( Graph* graph , Merge* region ) {
+  auto ret = New(graph);
+  region->AddPhi(ret);
+  return ret;
+}
+
 inline void ReadEffect::SetWriteEffect( WriteEffect* node ) {
   auto itr = node->AddReadEffect(this);
   effect_edge_.node = node;
   effect_edge_.id   = itr;
 }
 
+inline void ReadEffect::RemoveWriteEffect() {
+  if(effect_edge_.node) effect_edge_.node->RemoveReadEffect(&effect_edge_);
+}
+
 inline EffectMerge* EffectMerge::New( Graph* graph ) {
   return graph->zone()->New<EffectMerge>(graph,graph->AssignID());
 }
@@ -658,8 +673,8 @@ inline void Checkpoint::AddStackSlot( Expr* val , std::uint32_t index ) {
   AddOperand(StackSlot::New(graph(),val,index));
 }
 
-inline Guard* Guard::New( Graph* graph , Test* test ) {
-  return graph->zone()->New<Guard>(graph,graph->AssignID(),test);
+inline Guard* Guard::New( Graph* graph , Test* test , Checkpoint* cp ) {
+  return graph->zone()->New<Guard>(graph,graph->AssignID(),test,cp);
 }
 
 inline TestType* TestType::New( Graph* graph , TypeKind tc , Expr* object ) {
@@ -839,6 +854,30 @@ inline LoopHeader* LoopHeader::New( Graph* graph , ControlFlow* parent ) {
 
 inline Loop* Loop::New( Graph* graph ) { return graph->zone()->New<Loop>(graph,graph->AssignID()); }
 
+inline IfTrue* Loop::pre_header() const {
+  auto entry = In(0);
+  if(entry->Is<IfTrue>() && entry->parent()->Is<LoopHeader>()) return entry->As<IfTrue>();
+  return NULL;
+}
+
+inline IfTrue* Loop::GetPreHeader() {
+  if(auto pre = pre_header(); pre) return pre;
+  auto header = In(0);
+  if(!header->Is<LoopHeader>()) return NULL;
+
+  // the pre-header takes the place of the loop header in the loop's backward
+  // edge , so the operand order of the phi is not changed
+  auto pre = graph()->zone()->New<IfTrue>(graph(),graph()->AssignID(),nullptr);
+  ReplaceBackwardEdge(header,pre);
+  pre->AddBackwardEdge(header);
+
+  auto start  = set_loop_effect_start();
+  auto effect = BranchStartEffect::New(graph(),start->lhs_effect());
+  pre->set_branch_start_effect(effect);
+  start->ReplaceOperand(0,effect);
+  return pre;
+}
+
 inline LoopExit* LoopExit::New( Graph* graph , Expr* condition ) {
   return graph->zone()->New<LoopExit>(graph,graph->AssignID(),condition);
 }
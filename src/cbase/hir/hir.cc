@@ -82,10 +82,51 @@ void ReadEffect::Replace( Expr* node ) {
   Expr::Replace(node);
 }
 
+// The effect chain forks at an if , the branch start effects of both branches
+// happen after the same write but only one of them is its previous write in the
+// chain. Returns the branch start effect of the other branch when |prev| is one
+static WriteEffect* GetSiblingBranchStart( WriteEffect* prev ) {
+  if(!prev || !prev->Is<BranchStartEffect>()) return NULL;
+
+  auto start_effect = []( ControlFlow* cf ) -> WriteEffect* {
+    if(cf->operand_list()->empty()) return NULL;
+    if(cf->Is<IfTrue>())  return cf->As<IfTrue>()->branch_start_effect();
+    if(cf->Is<IfFalse>()) return cf->As<IfFalse>()->branch_start_effect();
+    return NULL;
+  };
+
+  lava_foreach( auto &r , prev->ref_list()->GetForwardIterator() ) {
+    if(!r.node->Is<IfTrue>() && !r.node->Is<IfFalse>()) continue;
+    auto branch = r.node->As<ControlFlow>()->In(0);
+    lava_foreach( auto cf , branch->forward_edge()->GetForwardIterator() ) {
+      auto se = start_effect(cf);
+      if(se && se != prev) return se;
+    }
+  }
+  return NULL;
+}
+
 void WriteEffect::Replace( Expr* node ) {
   // to replace a write effect node, one can replace it with lower none side
-  // effect node.
-  lava_debug(NORMAL,lava_verify(!node->Is<EffectNode>()););
+  // effect node or a read effect node which already depends on the effect
+  // chain. A write effect node that is not in the effect chain yet can also
+  // be used , then it simply takes the place of |this| node in the chain.
+  if(node->Is<WriteEffect>()) {
+    auto w = node->As<WriteEffect>();
+    lava_debug(NORMAL,lava_verify(!w->NextLink() && !w->PrevLink()););
+    auto prev = PrevLink();
+    w->AddLink(NextWrite());
+    if(auto se = GetSiblingBranchStart(prev); se && se->NextLink() == this)
+      se->AddLink(w);
+    if(prev) prev->AddLink(w);
+
+    lava_foreach( auto &k , read_effect_.GetForwardIterator() ) {
+      auto itr = w->read_effect_.PushBack(zone(),k);
+      k->set_effect_edge( itr , w );
+    }
+    Expr::Replace(w);
+    return;
+  }
 
   // 1. put all the read happened after |this| node to the node
   //    that's Next to it.
@@ -97,6 +138,8 @@ void WriteEffect::Replace( Expr* node ) {
     }
 
     // now remove  |this| from the dependency chain
+    if(auto se = GetSiblingBranchStart(PrevLink()); se && se->NextLink() == this)
+      se->AddLink(next_write);
     RemoveLink();
   }
 
@@ -115,6 +158,7 @@ void WriteEffect::Replace( Expr* node ) {
         k.id.set_value(node);
       }
     }
+    ref_list_.Clear();
 
     // 2.2 clear all the existed operands
     ClearOperand();
@@ -201,6 +245,10 @@ ReadEffectListIterator WriteEffect::AddReadEffect( ReadEffect* effect ) {
   return read_effect_.PushBack(zone(),effect);
 }
 
+bool WriteEffect::IsLinked() const {
+  return NextLink() || Is<InitBarrier>();
+}
+
 EffectBarrier* WriteEffect::FirstBarrier() const {
   if(Is<EffectBarrier>())
     return const_cast<EffectBarrier*>(As<EffectBarrier>());
@@ -362,6 +410,15 @@ void ControlFlow::Replace( ControlFlow* node ) {
   ClearOperand();
 }
 
+void ControlFlow::ReplaceBackwardEdge( ControlFlow* from , ControlFlow* to ) {
+  auto itr = backward_edge_.Find(from);
+  lava_verify(itr.HasNext());
+  itr.set_value(to);
+  to->AddRef(this,itr);
+  from->RemoveForwardEdgeOnly(this);
+  to->AddForwardEdgeImpl(this);
+}
+
 void ControlFlow::RemoveBackwardEdgeOnly( ControlFlow* node ) {
   auto itr = backward_edge_.Find(node);
   lava_verify(itr.HasNext());
@@ -391,6 +448,15 @@ void ControlFlow::ClearBackwardEdge() {
   backward_edge_.Clear();
 }
 
+void ControlFlow::ReplaceForwardEdge( ControlFlow* from , ControlFlow* to ) {
+  auto itr = forward_edge_.Find(from);
+  lava_verify(itr.HasNext());
+  itr.set_value(to);
+  to->AddRef(this,itr);
+  from->RemoveBackwardEdgeOnly(this);
+  to->AddBackwardEdgeImpl(this);
+}
+
 void ControlFlow::RemoveForwardEdgeOnly( ControlFlow* node ) {
   auto itr = forward_edge_.Find(node);
   lava_verify(itr.HasNext());
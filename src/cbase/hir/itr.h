@@ -8,6 +8,11 @@ namespace hir        {
 
 // -------------------------------------------------------------------------
 // Iterator node (side effect)
+//
+// The itr_new of a List or an Object doesn't create any heap object , the
+// iteration state is just the container plus an integer cursor which the
+// interpreter keeps in 2 registers , see InterpreterFEStart. Only Extension
+// creates a heap Iterator object.
 // -------------------------------------------------------------------------
 LAVA_CBASE_HIR_DEFINE(Tag=ITR_NEW;Name="itr_new";Leaf=NoLeaf,
     ItrNew,public HardBarrier) {
@@ -7,6 +7,8 @@ namespace lavascript {
 namespace cbase      {
 namespace hir        {
 
+class IfTrue;
+
 // --------------------------------------------------------------------------
 //
 // Loop related blocks
@@ -26,6 +28,14 @@ LAVA_CBASE_HIR_DEFINE(Tag=LOOP_HEADER;Name="loop_header";Leaf=NoLeaf,
   ControlFlow* merge() const { return merge_; }
   void set_merge( ControlFlow* merge ) { merge_ = merge; }
 
+  // check hoisted out of the loop body , ie loop predication. The check is
+  // performed once before entering the loop and it is placed after the
+  // condition in the operand list
+  void AddHoistedCheck( Expr* check ) {
+    lava_debug(NORMAL,lava_verify(!operand_list()->empty()););
+    AddOperand(check);
+  }
+
   LoopHeader( Graph* graph , std::uint32_t id , ControlFlow* region ):
     ControlFlow(HIR_LOOP_HEADER,id,graph,region)
   {}
@@ -47,6 +57,16 @@ LAVA_CBASE_HIR_DEFINE(Tag=LOOP;Name="loop";Leaf=NoLeaf,
 
   void      set_loop_exit( LoopExit* loop_exit )   { loop_exit_ = loop_exit; }
   LoopExit* loop_exit    () const                  { return loop_exit_; }
+
+  // The pre-header is the block between the loop header and the loop , it runs
+  // once before the first iteration and only when the loop header's condition
+  // is true. A node hoisted out of the loop which may fail is placed there , it
+  // must not run when the loop is skipped. The pre-header is created on demand
+  // with its own branch start effect , which the loop effect start follows.
+  inline IfTrue* pre_header() const;
+  // return the pre-header , it is created if the loop doesn't have one ; NULL is
+  // returned when the loop is not entered from a loop header , ie the OSR loop
+  inline IfTrue* GetPreHeader();
  private:
   LoopExit* loop_exit_;
   LAVA_DISALLOW_COPY_AND_ASSIGN(Loop)
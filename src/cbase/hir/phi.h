@@ -20,10 +20,8 @@ LAVA_CBASE_HIR_DEFINE(HIR_INTERNAL,PhiBase,public Expr) {
   // ref inside of the RefList. We just need to check that
   inline bool IsUsed() const;
  public:
-  // Remove the phi node from its belonged region. The reason this one is just
-  // a static function is because this function *doesn't* touch its ref_list,
-  // so its ref_list will still have its belonged region's reference there and
-  // it is invalid. This function should be used under strict condition.
+  // Remove the phi node from its belonged region and drop its operands. This
+  // function should only be used for a phi node that is not used by anyone.
   static inline void RemovePhiFromRegion( PhiBase* );
   // Bounded control flow region node.
   // Each phi node is bounded to a control flow regional node
@@ -103,6 +101,19 @@ LAVA_CBASE_HIR_DEFINE(Tag=LOOP_IV_FLOAT64;Name="loop_iv_float64";Leaf=NoLeaf;Box
    LAVA_DISALLOW_COPY_AND_ASSIGN(LoopIVFloat64)
 };
 
+// Float64Phi is a normal value phi node whose inputs are all float64 values. It is
+// produced by representation selection and it is in *BOXED* type, like LoopIVFloat64,
+// but it is not a linear induction variable and loop induction doesn't treat it as one.
+LAVA_CBASE_HIR_DEFINE(Tag=FLOAT64_PHI;Name="float64_phi";Leaf=NoLeaf;Box=Both,
+    Float64Phi, public PhiBase ) {
+  public:
+   inline static Float64Phi* New( Graph* );
+   inline static Float64Phi* New( Graph* , Merge* );
+   Float64Phi( Graph* graph , std::uint32_t id ) : PhiBase(HIR_FLOAT64_PHI, id, graph ) {}
+  private:
+   LAVA_DISALLOW_COPY_AND_ASSIGN(Float64Phi)
+};
+
 LAVA_CBASE_HIR_DEFINE(Tag=PROJECTION;Name="projection";Leaf=NoLeaf,
     Projection,public Expr) {
  public:
@@ -141,7 +141,8 @@ LAVA_CBASE_HIR_DEFINE(Tag=ISET;Name="iset";Leaf=NoLeaf,
 //                     function if cannot find the reference
 //    ObjectUpdate --> update a object's reference with a given key , cannot fail
 //    ObjectInsert --> insert a object's reference with a given key , cannot fail
-//    ListIndex    --> lookup a list element reference with given key
+//    ListIndex    --> lookup a list element reference with given key , failed out of native
+//                     function if the index is out of bound
 //    ListInsert   --> insert an element into a list
 //    ListPush     --> push an element into the back of a list
 //
@@ -200,6 +201,23 @@ LAVA_CBASE_HIR_DEFINE(HIR_INTERNAL,StaticRef,public ReadEffect) {
  public:
   StaticRef( IRType type , std::uint32_t id , Graph* graph ):
     ReadEffect(type,id,graph) {}
+ public:
+  // 2 lookups are the same value when they lookup the same component of the same
+  // object and happen after the same write effect , ie same memory state
+  virtual std::uint64_t GVNHash() const {
+    if(!write_effect()) return ReadEffect::GVNHash();
+    return GVNHash3(type_name(),Operand(0)->GVNHash(),Operand(1)->GVNHash(),
+                                                      write_effect()->id());
+  }
+  virtual bool Equal( const Expr* that ) const {
+    if(IsIdentical(that)) return true;
+    if(that->type() == type() && write_effect()) {
+      auto n = that->As<StaticRef>();
+      return write_effect() == n->write_effect() && Operand(0)->Equal(n->Operand(0)) &&
+                                                    Operand(1)->Equal(n->Operand(1));
+    }
+    return false;
+  }
 };
 
 
@@ -250,7 +268,8 @@ LAVA_CBASE_HIR_DEFINE(Tag=LIST_INDEX;Name="list_index";Leaf=NoLeaf,
   static inline ListIndex* New( Graph* , Expr* , Expr* );
 
   ListIndex( Graph* graph , std::uint32_t id , Expr* object , Expr* index ):
-    StaticRef(HIR_LIST_INDEX,id,graph)
+    StaticRef(HIR_LIST_INDEX,id,graph),
+    bound_check_(true)
   {
     lava_debug(NORMAL,lava_verify( GetTypeInference(object) == TPKIND_LIST ););
     AddOperand(object);
@@ -259,7 +278,13 @@ LAVA_CBASE_HIR_DEFINE(Tag=LIST_INDEX;Name="list_index";Leaf=NoLeaf,
 
   Expr*           object() const { return operand_list()->First(); }
   Expr*           index () const { return Operand(1); }
+
+  // whether the index needs to be checked against the size of the list. It is
+  // cleared when the index is proven to be in bound , see pass/bce.h
+  bool       bound_check() const { return bound_check_; }
+  void   set_bound_check( bool check ) { bound_check_ = check; }
  private:
+  bool bound_check_;
   LAVA_DISALLOW_COPY_AND_ASSIGN(ListIndex)
 };
 
@@ -329,6 +354,19 @@ LAVA_CBASE_HIR_DEFINE(HIR_INTERNAL,RefGet,public ReadEffect) {
   { AddOperand(oref); }
 
   Expr* ref() const { return operand_list()->First(); }
+ public:
+  virtual std::uint64_t GVNHash() const {
+    if(!write_effect()) return ReadEffect::GVNHash();
+    return GVNHash2(type_name(),ref()->GVNHash(),write_effect()->id());
+  }
+  virtual bool Equal( const Expr* that ) const {
+    if(IsIdentical(that)) return true;
+    if(that->type() == type() && write_effect()) {
+      auto n = that->As<RefGet>();
+      return write_effect() == n->write_effect() && ref()->Equal(n->ref());
+    }
+    return false;
+  }
 };
 
 LAVA_CBASE_HIR_DEFINE(HIR_INTERNAL,RefSet,public WriteEffect) {
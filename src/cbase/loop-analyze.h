@@ -134,6 +134,10 @@ class LoopAnalyze {
   // Get size of the parental loop list
   std::size_t SizeOfOuterLoop() const { return parent_list_.size(); }
 
+  // Get the inner most loop the control flow node belongs to , NULL if the
+  // node is not inside of any loop
+  LoopNode* GetLoopNode( const ControlFlow* cf ) const { return node_to_loop_[cf->id()]; }
+
   // Dump the internal loop forest as Dot graph
   void Dump( DumpWriter* ) const;
 
@@ -0,0 +1,491 @@
+#include "bce.h"
+#include "src/cbase/hir.h"
+#include "src/cbase/loop-analyze.h"
+#include "src/cbase/predicate.h"
+#include "src/cbase/type-inference.h"
+#include "src/cbase/fold/fold-box.h"
+#include "src/zone/stl.h"
+#include "src/zone/zone.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace lavascript {
+namespace cbase      {
+namespace hir        {
+namespace            {
+
+// The range of a typed loop induction variable is [start,bound) , or [start,bound]
+// when the loop condition is <= , if :
+//
+// 1) the start is a constant and the step is a positive constant
+// 2) the loop exit tests the increased value against the bound and the loop
+//    header tests the start against the same bound , so the body is entered
+//    with value less than the bound
+//
+// A list index inside of the loop whose index is the induction variable plus a
+// constant offset has a known index range. When the list is a list literal and
+// nothing shrinks it between its creation and the loop , the range is checked
+// against the list size with Float64Predicate and the bound check is removed if
+// the range is always inside. Otherwise , as long as the list is defined out of
+// the loop , a list index of the largest index is hoisted in front of the loop ,
+// see LoopHeader::AddHoistedCheck , and the list index inside of the loop doesn't
+// need its bound check anymore.
+//
+// A failing list index raises the out of bound error , so the hoisted check must
+// only fail when the loop itself would fail. It is hoisted only when the loop is
+// known to be entered , the step is 1 from an integral start and the loop body is
+// one block , ie no branch , break or inner loop ; then the body runs with every
+// index up to the largest one.
+//
+// A list is only shrinked by the pop builtin , so any call or hard barrier inside
+// of the loop stops the optimization for that loop , see MayShrink.
+class BoundCheckElimination {
+ public:
+  BoundCheckElimination( Graph* graph ):
+    graph_    (graph),
+    temp_zone_(),
+    block_    (&temp_zone_),
+    visited_  (&temp_zone_)
+  {}
+
+  void Run();
+
+ private:
+  // range of a loop induction variable
+  struct IVRange {
+    double start;
+    double step;
+    Expr*  bound;   // unboxed operand of the loop exit comparison
+    bool   close;   // whether the bound is inclusive
+  };
+
+  // list index inside of a loop that use the same list and induction variable
+  struct Group : public zone::ZoneObject {
+    Expr*        object;
+    PhiBase*     iv;
+    IVRange      range;
+    std::int64_t min;   // min offset of the index
+    std::int64_t max;   // max offset of the index
+    zone::stl::ZoneVector<ListIndex*> list;
+    Group( zone::Zone* zone , Expr* obj , PhiBase* v , const IVRange& r ):
+      object(obj), iv(v), range(r), min(0), max(0), list(zone) {}
+  };
+
+  void RunLoop ( LoopAnalyze::LoopNode* );
+  // collect all the list index inside of the loop , returns false if the loop
+  // has hard barrier
+  bool CollectListIndex( LoopEffectStart* , zone::stl::ZoneVector<ListIndex*>* );
+  // mark all the blocks inside of the loop , returns the number of blocks
+  std::size_t MarkLoopBlock( LoopAnalyze::LoopNode* );
+
+  bool GetIVRange ( LoopAnalyze::LoopNode* , PhiBase* , IVRange* );
+  // whether the loop header test of the range is always true
+  bool IsEntered  ( LoopAnalyze::LoopNode* , const IVRange& );
+  // the index is a induction variable plus a constant offset
+  bool GetIndex   ( Expr* , PhiBase** , std::int64_t* );
+  // size of the list literal if nothing shrinks it before the write effect
+  bool GetListSize( Expr* , WriteEffect* , std::int64_t* );
+  bool IsLoopInvariant( Expr* , std::size_t depth = 0 );
+
+  // check the index range of the group against the list size statically
+  bool InBound( const Group& , std::int64_t );
+  // generate the largest index of the group
+  Expr* NewMaxIndex( const Group& );
+
+ private:
+  Graph*             graph_;
+  zone::Zone         temp_zone_;
+  zone::stl::BitSet  block_;   // blocks of the current loop
+  zone::stl::BitSet  visited_; // write effects of the current loop
+};
+
+// strip the box/unbox and the int64 to float64 conversion which doesn't change
+// the value
+Expr* Value( Expr* node ) {
+  for( ;; ) {
+    if(node->Is<Box>())                 node = node->As<Box>()->value();
+    else if(node->Is<Unbox>())          node = node->As<Unbox>()->value();
+    else if(node->Is<Int64ToFloat64>()) node = node->As<Int64ToFloat64>()->value();
+    else return node;
+  }
+}
+
+bool GetConstant( Expr* node , double* output ) {
+  node = Value(node);
+  if(node->Is<Int64>()) {
+    *output = static_cast<double>(node->As<Int64>()->value());
+    return true;
+  } else if(node->Is<Float64>()) {
+    *output = node->As<Float64>()->value();
+    return true;
+  }
+  return false;
+}
+
+bool IsSameValue( Expr* lhs , Expr* rhs ) {
+  double l , r;
+  if(Value(lhs)->IsIdentical(Value(rhs))) return true;
+  return GetConstant(lhs,&l) && GetConstant(rhs,&r) && l == r;
+}
+
+BinaryNode* GetComparison( Expr* node ) {
+  node = Value(node);
+  if(node->Is<Compare>() || node->Is<Float64Compare>() || node->Is<Int64Compare>())
+    return dynamic_cast<BinaryNode*>(node);
+  return NULL;
+}
+
+// whether a float64 value is always integral
+bool IsIntegral( Expr* node , std::size_t depth = 0 ) {
+  double v;
+  if(depth > 4) return false;
+  if(GetConstant(node,&v)) return std::floor(v) == v;
+
+  node = Value(node);
+  if(GetTypeInference(node) == TPKIND_INT64) {
+    return true;
+  } else if(node->Is<Phi>()) {
+    lava_foreach( auto o , node->operand_list()->GetForwardIterator() ) {
+      if(!IsIntegral(o,depth+1)) return false;
+    }
+    return true;
+  }
+  return false;
+}
+
+// whether the write effect may shrink a list. The list is only shrinked by the pop
+// builtin which is called via ICall or Call , and any hard barrier may call into a
+// native function. The dynamic arithmetic and comparison are not expected to
+// resize a list even if they are dispatched to the extension.
+bool MayShrink( WriteEffect* w ) {
+  if(w->Is<ICall>())
+    return w->As<ICall>()->ic() == interpreter::INTRINSIC_CALL_POP;
+  if(w->Is<Call>())
+    return true;
+  return w->Is<HardBarrier>() && !w->Is<DynamicBinary>() && !w->Is<BranchStartEffect>();
+}
+
+void BoundCheckElimination::Run() {
+  LoopAnalyze la(&temp_zone_,*graph_);
+  for( auto &lp : la.parent_list() ) {
+    lava_foreach( auto n , LoopAnalyze::LoopNodeRDIterator(lp,&la) ) {
+      RunLoop(n);
+    }
+  }
+}
+
+bool BoundCheckElimination::CollectListIndex( LoopEffectStart* start ,
+                                              zone::stl::ZoneVector<ListIndex*>* output ) {
+  zone::stl::ZoneVector<WriteEffect*> stack(&temp_zone_);
+  visited_.assign(graph_->MaxID(),false);
+
+  auto collect = [&]( WriteEffect* w ) {
+    lava_foreach( auto r , w->read_effect()->GetForwardIterator() ) {
+      if(r->Is<ListIndex>()) output->push_back(r->As<ListIndex>());
+    }
+  };
+
+  // walk the effect chain from the end of the loop body back to the start ,
+  // the inner loop and branch are walked through as well
+  visited_[start->id()] = true;
+  collect(start);
+  stack.push_back(start->rhs_effect());
+
+  while(!stack.empty()) {
+    auto w = stack.back();
+    stack.pop_back();
+    if(visited_[w->id()]) continue;
+    visited_[w->id()] = true;
+    collect(w);
+
+    if(w->Is<EffectMergeBase>()) {
+      stack.push_back(w->As<EffectMergeBase>()->lhs_effect());
+      stack.push_back(w->As<EffectMergeBase>()->rhs_effect());
+    } else if(w->Is<BranchStartEffect>()) {
+      stack.push_back(w->NextWrite());
+    } else if(MayShrink(w)) {
+      return false;
+    } else {
+      stack.push_back(w->NextWrite());
+    }
+  }
+  return true;
+}
+
+std::size_t BoundCheckElimination::MarkLoopBlock( LoopAnalyze::LoopNode* node ) {
+  zone::stl::ZoneVector<ControlFlow*> stack(&temp_zone_);
+  std::size_t count = 2;
+  block_.assign(graph_->MaxID(),false);
+
+  // every block that reaches the loop exit without going through the loop
+  // body , ie the loop header , is inside of the loop
+  block_[node->loop_body()->id()] = true;
+  block_[node->loop_exit()->id()] = true;
+  stack.push_back(node->loop_exit());
+
+  while(!stack.empty()) {
+    auto cf = stack.back();
+    stack.pop_back();
+    lava_foreach( auto prev , cf->backward_edge()->GetForwardIterator() ) {
+      if(!block_[prev->id()]) {
+        block_[prev->id()] = true;
+        stack.push_back(prev);
+        ++count;
+      }
+    }
+  }
+  return count;
+}
+
+bool BoundCheckElimination::GetIVRange( LoopAnalyze::LoopNode* node , PhiBase* iv ,
+                                                                      IVRange* output ) {
+  if(!iv->Is<LoopIVInt64>() && !iv->Is<LoopIVFloat64>())
+    return false;
+
+  auto start = iv->Operand(0);
+  auto incr  = Value(iv->Operand(1));
+  double step;
+
+  if(!GetConstant(start,&output->start))
+    return false;
+
+  // 1. the step must be a positive constant
+  if(!incr->Is<Int64Arithmetic>() && !incr->Is<Float64Arithmetic>())
+    return false;
+  {
+    auto arith = dynamic_cast<BinaryNode*>(incr);
+    if(arith->op() != Binary::ADD) return false;
+    auto other = Value(arith->lhs())->IsIdentical(iv) ? arith->rhs() : arith->lhs();
+    if(!GetConstant(other,&step) || step <= 0) return false;
+    output->step = step;
+  }
+
+  // 2. the loop exit tests the increased value against the bound
+  auto exit_node = Value(node->loop_exit()->condition());
+  if(!exit_node->Is<Float64Compare>() && !exit_node->Is<Int64Compare>())
+    return false;
+  auto exit_cond = dynamic_cast<BinaryNode*>(exit_node);
+  if(exit_cond->op() != Binary::LT && exit_cond->op() != Binary::LE)
+    return false;
+  if(!Value(exit_cond->lhs())->IsIdentical(incr))
+    return false;
+  output->bound = exit_cond->rhs();
+  output->close = exit_cond->op() == Binary::LE;
+
+  // 3. the loop header tests the start against the same bound
+  auto header = Value(node->loop_header()->condition());
+  if(header->Is<Boolean>()) {
+    return header->As<Boolean>()->value();
+  } else if(auto cmp = GetComparison(header); cmp) {
+    return cmp->op() == exit_cond->op() && IsSameValue(cmp->lhs(),start) &&
+                                           IsSameValue(cmp->rhs(),output->bound);
+  }
+  return false;
+}
+
+bool BoundCheckElimination::IsEntered( LoopAnalyze::LoopNode* node , const IVRange& range ) {
+  auto header = Value(node->loop_header()->condition());
+  if(header->Is<Boolean>()) return header->As<Boolean>()->value();
+
+  // the header compares the start against the bound , see GetIVRange ; the bound
+  // is either a constant or a phi of constants
+  auto test = [&]( Expr* bound ) {
+    double v;
+    if(!GetConstant(bound,&v)) return false;
+    return range.close ? range.start <= v : range.start < v;
+  };
+  auto bound = Value(range.bound);
+  if(bound->Is<Phi>()) {
+    lava_foreach( auto o , bound->operand_list()->GetForwardIterator() ) {
+      if(!test(o)) return false;
+    }
+    return true;
+  }
+  return test(bound);
+}
+
+bool BoundCheckElimination::GetIndex( Expr* index , PhiBase** iv , std::int64_t* offset ) {
+  auto is_iv = []( Expr* node ) {
+    return node->Is<LoopIVInt64>() || node->Is<LoopIVFloat64>();
+  };
+  *offset = 0;
+  // float64 induction variable or float64 arithmetic , the index is truncated
+  if(index->Is<Float64ToInt64>())
+    index = index->As<Float64ToInt64>()->value();
+  index = Value(index);
+
+  if(is_iv(index)) {
+    *iv = index->As<PhiBase>();
+    return true;
+  } else if(index->Is<Int64Arithmetic>() || index->Is<Float64Arithmetic>()) {
+    auto arith = dynamic_cast<BinaryNode*>(index);
+    auto lhs   = Value(arith->lhs());
+    auto rhs   = arith->rhs();
+    double v;
+    if(arith->op() == Binary::ADD && !is_iv(lhs)) {
+      rhs = arith->lhs();
+      lhs = Value(arith->rhs());
+    }
+    // the offset must be an integral constant , otherwise the truncation of the
+    // index is not the truncation of the induction variable plus the offset
+    if(!is_iv(lhs) || !GetConstant(rhs,&v) || std::floor(v) != v)
+      return false;
+
+    if(arith->op() == Binary::ADD)
+      *offset = static_cast<std::int64_t>(v);
+    else if(arith->op() == Binary::SUB)
+      *offset = -static_cast<std::int64_t>(v);
+    else
+      return false;
+
+    *iv = lhs->As<PhiBase>();
+    return true;
+  }
+  return false;
+}
+
+bool BoundCheckElimination::GetListSize( Expr* object , WriteEffect* effect ,
+                                                        std::int64_t* output ) {
+  if(!object->Is<IRList>()) return false;
+  // walk back the effect chain to the list literal , the merge of effect is not
+  // walked through
+  for( auto w = effect ; ; w = w->NextWrite() ) {
+    if(w->IsIdentical(object)) {
+      *output = static_cast<std::int64_t>(object->As<IRList>()->Size());
+      return true;
+    }
+    if(w->Is<EffectMergeBase>() || w->Is<InitBarrier>() || MayShrink(w))
+      return false;
+  }
+}
+
+bool BoundCheckElimination::IsLoopInvariant( Expr* node , std::size_t depth ) {
+  if(depth > 8) return false;
+  if(node->Is<PhiBase>()) {
+    auto region = node->As<PhiBase>()->region();
+    return region && !block_[region->id()];
+  } else if(node->Is<WriteEffect>()) {
+    return !visited_[node->id()];
+  } else if(node->Is<ReadEffect>()) {
+    auto w = node->As<ReadEffect>()->write_effect();
+    if(!w || visited_[w->id()]) return false;
+  }
+  lava_foreach( auto o , node->operand_list()->GetForwardIterator() ) {
+    if(o->Is<Checkpoint>()) continue;
+    if(!IsLoopInvariant(o,depth+1)) return false;
+  }
+  return true;
+}
+
+bool BoundCheckElimination::InBound( const Group& group , std::int64_t size ) {
+  double bound;
+  if(!GetConstant(group.range.bound,&bound))
+    return false;
+
+  // the Float64Predicate only takes float64 constant node , the value is wrapped
+  // inside of temporary node which is not part of the graph
+  Float64 lower    (NULL,0,group.range.start + group.min);
+  Float64 upper    (NULL,0,bound + group.max);
+  Float64 zero     (NULL,0,0);
+  Float64 list_size(NULL,0,static_cast<double>(size));
+
+  Float64Predicate index(&temp_zone_,Binary::GE,&lower);
+  index.Intersect(group.range.close ? Binary::LE : Binary::LT,&upper);
+  Float64Predicate list (&temp_zone_,Binary::GE,&zero);
+  list.Intersect(Binary::LT,&list_size);
+
+  return index.Infer(list) == Predicate::ALWAYS_TRUE;
+}
+
+Expr* BoundCheckElimination::NewMaxIndex( const Group& group ) {
+  double bound;
+  if(GetConstant(group.range.bound,&bound)) {
+    auto v = group.range.close ? std::floor(bound) : std::ceil(bound) - 1;
+    return Int64::New(graph_,static_cast<std::int64_t>(v) + group.max);
+  }
+
+  auto value = group.range.bound;
+  Expr* index;
+  if(GetTypeInference(value) == TPKIND_INT64) {
+    index = NewUnboxNode(graph_,value,TPKIND_INT64);
+  } else if(GetTypeInference(value) == TPKIND_FLOAT64 && IsIntegral(value)) {
+    index = Float64ToInt64::New(graph_,NewUnboxNode(graph_,value,TPKIND_FLOAT64));
+  } else {
+    return NULL;
+  }
+
+  auto offset = group.max - (group.range.close ? 0 : 1);
+  if(offset != 0)
+    index = Int64Arithmetic::New(graph_,index,Int64::New(graph_,offset),Binary::ADD);
+  return index;
+}
+
+void BoundCheckElimination::RunLoop( LoopAnalyze::LoopNode* node ) {
+  auto start = node->loop_body()->set_loop_effect_start();
+  zone::stl::ZoneVector<ListIndex*> list(&temp_zone_);
+  zone::stl::ZoneVector<Group*>    group_list(&temp_zone_);
+
+  if(start->operand_list()->size() != 2 ||
+     !CollectListIndex(start,&list) || list.empty())
+    return;
+  // the loop body and the loop exit
+  auto straight = MarkLoopBlock(node) == 2;
+
+  // 1. group the list index by the list and the induction variable of this loop
+  for( auto ref : list ) {
+    PhiBase*     iv;
+    std::int64_t offset;
+    if(!ref->bound_check() || !GetIndex(ref->index(),&iv,&offset))
+      continue;
+    if(iv->region() != node->loop_body())
+      continue;
+
+    Group* group = NULL;
+    for( auto g : group_list ) {
+      if(g->iv == iv && g->object->IsIdentical(ref->object())) { group = g; break; }
+    }
+    if(!group) {
+      IVRange range;
+      if(!GetIVRange(node,iv,&range)) continue;
+      group = temp_zone_.New<Group>(&temp_zone_,ref->object(),iv,range);
+      group->min = group->max = offset;
+      group_list.push_back(group);
+    }
+    group->min = std::min(group->min,offset);
+    group->max = std::max(group->max,offset);
+    group->list.push_back(ref);
+  }
+
+  // 2. remove the bound check statically or hoist it in front of the loop
+  for( auto g : group_list ) {
+    std::int64_t size;
+    bool in_bound = GetListSize(g->object,start->lhs_effect(),&size) && InBound(*g,size);
+
+    if(!in_bound) {
+      if(!straight || g->range.step != 1 || std::floor(g->range.start) != g->range.start)
+        continue;
+      if(g->range.start + g->min < 0 || !IsLoopInvariant(g->object) || !IsEntered(node,g->range))
+        continue;
+      auto index = NewMaxIndex(*g);
+      if(!index) continue;
+      auto check = ListIndex::New(graph_,g->object,index);
+      check->SetWriteEffect(start->lhs_effect());
+      node->loop_header()->AddHoistedCheck(check);
+    }
+
+    for( auto ref : g->list ) ref->set_bound_check(false);
+  }
+}
+
+} // namespace
+
+bool BCE::Perform( Graph* graph , HIRPass::Flag flag ) {
+  (void)flag;
+  BoundCheckElimination(graph).Run();
+  return true;
+}
+
+} // namespace hir
+} // namespace cbase
+} // namespace lavascript
@@ -0,0 +1,31 @@
+#ifndef CBASE_PASS_BCE_H_
+#define CBASE_PASS_BCE_H_
+#include "src/cbase/hir-pass.h"
+
+namespace lavascript {
+namespace cbase      {
+namespace hir        {
+
+class Graph;
+
+/**
+ * Bound check elimination
+ *
+ * The range of the typed loop induction variable is decided by its start , step
+ * and the loop condition. A list index inside of the loop indexed by the induction
+ * variable doesn't need its bound check when the range is inside of the list that
+ * has a known size ; otherwise the check is hoisted in front of the loop as one
+ * list index of the largest index , ie loop predication. Both require the loop not
+ * to have any hard barrier which may shrink the list.
+ */
+class BCE : public HIRPass {
+ public:
+  virtual bool Perform( Graph* , HIRPass::Flag );
+  BCE() : HIRPass("bound-check-elimination") {}
+};
+
+} // namespace hir
+} // namespace cbase
+} // namespace lavascript
+
+#endif // CBASE_PASS_BCE_H_
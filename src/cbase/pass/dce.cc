@@ -1,13 +1,394 @@
 #include "dce.h"
-#include "src/cbase/type.h"
-#include "src/cbase/dominators.h"
-#include "src/cbase/hir-visitor.h"
+#include "src/cbase/hir.h"
+#include "src/cbase/type-inference.h"
+#include "src/zone/stl.h"
+#include "src/zone/zone.h"
 
 #include <vector>
 
 namespace lavascript {
 namespace cbase      {
 namespace hir        {
+namespace            {
+
+// The dead code elimination works in 2 phases :
+//
+// 1) Control flow. Each If whose condition is known under boolean context is
+//    turned into a Region which only goes to the taken branch. The branch not
+//    taken and everything only reachable from it are dead ; the edges from
+//    the dead blocks into the live merges are removed along with the phi and
+//    effect merge operands of those edges ; so is the edge from a return to
+//    the merge after it. A fold that makes a loop or the end lose a
+//    predecessor is not done , since the loop analysis relies on the shape
+//    of the loop.
+//
+// 2) Expression. Starting from the operands of the live blocks , the effect
+//    merges pinned in them and the write effects not in a dead block , mark
+//    everything reachable through operand and effect dependency as live. A
+//    phi is not a root so the unused phi and the phi only used by itself in
+//    a loop are dead. Every node not marked is then unlinked from the graph ,
+//    a read effect is also removed from the write effect it depends on ,
+//    otherwise the write effect still has it as a dependency.
+class DeadCodeEliminator {
+ public:
+  DeadCodeEliminator( Graph* graph ):
+    graph_     (graph),
+    fall_through_(true),
+    temp_zone_ (),
+    cf_list_   (&temp_zone_),
+    reachable_ (&temp_zone_),
+    visited_   (&temp_zone_),
+    expr_list_ (&temp_zone_),
+    dead_start_(&temp_zone_),
+    live_      (&temp_zone_),
+    worklist_  (&temp_zone_)
+  {}
+
+  void Run();
+
+ private:
+  typedef zone::stl::BitSet BitSet;
+
+  // collect all the control flow node connected to start
+  void CollectControlFlow();
+  // mark the control flow node reachable from start , the node in skip
+  // is not entered
+  void MarkReachable( const BitSet& skip , BitSet* output ) const;
+
+  // the graph builder keeps building the code after a return inside of a
+  // branch , so the return also goes to the merge of the branch though the
+  // region after it is never reached
+  static bool IsFallThrough( ControlFlow* from , ControlFlow* to ) {
+    return from->Is<Return>() && !to->Is<Success>() && !IsLoop(to);
+  }
+  static bool IsLoop( ControlFlow* cf ) {
+    return cf->Is<Loop>() || cf->Is<LoopHeader>() || cf->Is<LoopExit>() || cf->Is<LoopMerge>();
+  }
+  bool IsDeadEdge( ControlFlow* from , ControlFlow* to , const BitSet& old ) const;
+
+  // control flow
+  bool IsFoldable      ( ControlFlow* , ControlFlow** dead ) const;
+  bool IsPredecessorSafe( const BitSet& before , const BitSet& after ) const;
+  void FoldBranch      ( ControlFlow* , ControlFlow* dead );
+  void RemoveDeadEdge  ( ControlFlow* , const BitSet& old );
+  void RemoveOperandAt ( Expr* , std::size_t );
+
+  // expression
+  void CollectExpr     ();
+  void CollectExpr     ( Expr* );
+  bool IsDeadWrite     ( WriteEffect* ) const;
+  void MarkLive        ();
+  void MarkLive        ( Expr* );
+  void Sweep           ();
+
+ private:
+  Graph*                               graph_;
+  bool                                 fall_through_;  // whether to follow IsFallThrough edge
+  zone::Zone                           temp_zone_;
+  zone::stl::ZoneVector<ControlFlow*>  cf_list_;
+  BitSet                               reachable_;
+  BitSet                               visited_;
+  zone::stl::ZoneVector<Expr*>         expr_list_;
+  BitSet                               dead_start_;    // branch start effect of dead block
+  BitSet                               live_;
+  zone::stl::ZoneVector<Expr*>         worklist_;
+};
+
+void DeadCodeEliminator::CollectControlFlow() {
+  BitSet visited(&temp_zone_,false,graph_->MaxID());
+  zone::stl::ZoneVector<ControlFlow*> stack(&temp_zone_);
+
+  stack.push_back(graph_->start());
+  visited[graph_->start()->id()] = true;
+  while(!stack.empty()) {
+    auto cf = stack.back();
+    stack.pop_back();
+    cf_list_.push_back(cf);
+
+    auto visit = [&]( ControlFlow* n ) {
+      if(!visited[n->id()]) { visited[n->id()] = true; stack.push_back(n); }
+    };
+    lava_foreach( auto n , cf->forward_edge ()->GetForwardIterator() ) visit(n);
+    lava_foreach( auto n , cf->backward_edge()->GetForwardIterator() ) visit(n);
+  }
+}
+
+void DeadCodeEliminator::MarkReachable( const BitSet& skip , BitSet* output ) const {
+  output->assign(graph_->MaxID(),false);
+
+  std::vector<ControlFlow*> stack;
+  stack.push_back(graph_->start());
+  (*output)[graph_->start()->id()] = true;
+  while(!stack.empty()) {
+    auto cf = stack.back();
+    stack.pop_back();
+    lava_foreach( auto n , cf->forward_edge()->GetForwardIterator() ) {
+      if(n->id() < skip.size() && skip[n->id()]) continue;
+      if(!fall_through_ && IsFallThrough(cf,n)) continue;
+      if(!(*output)[n->id()]) {
+        (*output)[n->id()] = true;
+        stack.push_back(n);
+      }
+    }
+  }
+}
+
+bool DeadCodeEliminator::IsFoldable( ControlFlow* cf , ControlFlow** dead ) const {
+  if(!cf->Is<If>() || cf->forward_edge()->size() != 2) return false;
+  bool value;
+  if(!GetBooleanValue(cf->As<If>()->condition(),&value)) return false;
+  *dead = cf->Out(value ? IfFalse::kIndex : IfTrue::kIndex);
+  return true;
+}
+
+bool DeadCodeEliminator::IsDeadEdge( ControlFlow* from , ControlFlow* to ,
+                                                        const BitSet& old ) const {
+  if(!fall_through_ && IsFallThrough(from,to)) return true;
+  return from->id() < old.size() && old[from->id()] && !reachable_[from->id()];
+}
+
+bool DeadCodeEliminator::IsPredecessorSafe( const BitSet& before , const BitSet& after ) const {
+  for( auto cf : cf_list_ ) {
+    if(!cf->Is<End>() && !IsLoop(cf)) continue;
+
+    if(before[cf->id()] && !after[cf->id()]) {
+      // the whole loop is dead is fine , the end is not
+      if(cf->Is<End>()) return false;
+      continue;
+    }
+    lava_foreach( auto pred , cf->backward_edge()->GetForwardIterator() ) {
+      if(before[pred->id()] && !after[pred->id()]) return false;
+    }
+  }
+  return true;
+}
+
+void DeadCodeEliminator::FoldBranch( ControlFlow* cf , ControlFlow* dead ) {
+  // the region takes all the edges of the if node and the condition is gone
+  auto region = Region::New(graph_);
+  cf->Replace(region);
+  region->RemoveForwardEdge(dead);
+}
+
+void DeadCodeEliminator::RemoveOperandAt( Expr* node , std::size_t index ) {
+  std::vector<Expr*> operand;
+  lava_foreach( auto o , node->operand_list()->GetForwardIterator() ) {
+    operand.push_back(o);
+  }
+  node->ClearOperand();
+  for( std::size_t i = 0 ; i < operand.size() ; ++i ) {
+    if(i != index) node->AddOperand(operand[i]);
+  }
+}
+
+void DeadCodeEliminator::RemoveDeadEdge( ControlFlow* cf , const BitSet& old ) {
+  bool removed = false;
+
+  for( std::size_t i = cf->backward_edge()->size() ; i-- > 0 ; ) {
+    if(!IsDeadEdge(cf->In(i),cf,old)) continue;
+
+    if(cf->Is<Merge>()) {
+      auto phi_list = cf->As<Merge>()->phi_list();
+      for( std::size_t j = 0 ; j < phi_list->size() ; ++j ) {
+        RemoveOperandAt(phi_list->Index(j),i);
+      }
+    }
+    if(cf->Is<EffectMergeRegion>()) {
+      auto em_list = cf->As<EffectMergeRegion>()->effect_merge_list();
+      for( std::size_t j = 0 ; j < em_list->size() ; ++j ) {
+        auto em = em_list->Index(j);
+        RemoveOperandAt(em,i);
+        // effect merge always merges 2 effect chains
+        if(em->OperandSize() == 1) em->AddOperand(em->Operand(0));
+      }
+    }
+    cf->RemoveBackwardEdge(i);
+    removed = true;
+  }
+
+  // the phi of a merge with one predecessor is just its operand
+  if(removed && cf->Is<Merge>() && cf->backward_edge()->size() == 1) {
+    auto merge = cf->As<Merge>();
+    std::vector<PhiBase*> phi_list;
+    for( std::size_t i = 0 ; i < merge->phi_list()->size() ; ++i ) {
+      phi_list.push_back(merge->phi_list()->Index(i));
+    }
+    for( auto phi : phi_list ) {
+      lava_debug(NORMAL,lava_verify(phi->OperandSize() == 1););
+      auto value = phi->Operand(0);
+      merge->RemovePhi(phi);
+      phi->Replace(value);
+    }
+  }
+}
+
+void DeadCodeEliminator::CollectExpr( Expr* node ) {
+  if(visited_[node->id()]) return;
+  visited_[node->id()] = true;
+  expr_list_.push_back(node);
+}
+
+void DeadCodeEliminator::CollectExpr() {
+  visited_.assign(graph_->MaxID(),false);
+
+  for( auto cf : cf_list_ ) {
+    lava_foreach( auto o , cf->operand_list()->GetForwardIterator() ) CollectExpr(o);
+    if(cf->Is<Merge>()) {
+      auto phi_list = cf->As<Merge>()->phi_list();
+      for( std::size_t i = 0 ; i < phi_list->size() ; ++i ) CollectExpr(phi_list->Index(i));
+    }
+    if(cf->Is<EffectMergeRegion>()) {
+      auto em_list = cf->As<EffectMergeRegion>()->effect_merge_list();
+      for( std::size_t i = 0 ; i < em_list->size() ; ++i ) CollectExpr(em_list->Index(i));
+    }
+  }
+
+  // the list grows while it is visited
+  for( std::size_t i = 0 ; i < expr_list_.size() ; ++i ) {
+    auto node = expr_list_[i];
+    lava_foreach( auto o , node->operand_list()->GetForwardIterator() ) CollectExpr(o);
+    lava_foreach( auto d , node->GetDependencyIterator() ) CollectExpr(d);
+    lava_foreach( auto &r , node->ref_list()->GetForwardIterator() ) {
+      if(r.node->Is<Expr>()) CollectExpr(r.node->As<Expr>());
+    }
+  }
+}
+
+bool DeadCodeEliminator::IsDeadWrite( WriteEffect* node ) const {
+  // find the barrier starting the block of the write , the write is dead when
+  // the barrier is pinned in a dead block. A write not in the effect chain is
+  // only alive when it is used
+  if(!node->IsLinked()) return true;
+  for( auto w = node ; ; w = w->NextWrite() ) {
+    if(w->Is<BranchStartEffect>()) {
+      return w->id() < dead_start_.size() && dead_start_[w->id()];
+    } else if(w->Is<EffectMergeBase>()) {
+      auto region = w->As<EffectMergeBase>()->region();
+      return !region || !reachable_[region->id()];
+    } else if(w->Is<InitBarrier>()) {
+      return false;
+    }
+  }
+}
+
+void DeadCodeEliminator::MarkLive( Expr* node ) {
+  if(live_[node->id()]) return;
+  live_[node->id()] = true;
+  worklist_.push_back(node);
+}
+
+void DeadCodeEliminator::MarkLive() {
+  live_.assign(graph_->MaxID(),false);
+  dead_start_.assign(graph_->MaxID(),false);
+
+  for( auto cf : cf_list_ ) {
+    if(reachable_[cf->id()]) continue;
+    lava_foreach( auto o , cf->operand_list()->GetForwardIterator() ) {
+      if(o->Is<BranchStartEffect>()) dead_start_[o->id()] = true;
+    }
+  }
+
+  // the roots are the operands of the live blocks , the effect merges pinned
+  // in them and the write effects not in a dead block since the effect chain
+  // after the last merge is not used by anyone
+  for( auto cf : cf_list_ ) {
+    if(!reachable_[cf->id()]) continue;
+    lava_foreach( auto o , cf->operand_list()->GetForwardIterator() ) MarkLive(o);
+    if(cf->Is<EffectMergeRegion>()) {
+      auto em_list = cf->As<EffectMergeRegion>()->effect_merge_list();
+      for( std::size_t i = 0 ; i < em_list->size() ; ++i ) MarkLive(em_list->Index(i));
+    }
+  }
+  for( auto node : expr_list_ ) {
+    if(node->Is<WriteEffect>() && !IsDeadWrite(node->As<WriteEffect>())) MarkLive(node);
+  }
+
+  while(!worklist_.empty()) {
+    auto node = worklist_.back();
+    worklist_.pop_back();
+    lava_foreach( auto o , node->operand_list()->GetForwardIterator() ) MarkLive(o);
+    lava_foreach( auto d , node->GetDependencyIterator() ) MarkLive(d);
+  }
+}
+
+void DeadCodeEliminator::Sweep() {
+  for( auto cf : cf_list_ ) {
+    if(!reachable_[cf->id()]) cf->ClearOperand();
+  }
+
+  for( auto node : expr_list_ ) {
+    if(live_[node->id()]) continue;
+
+    if(node->Is<ReadEffect>()) {
+      node->As<ReadEffect>()->RemoveWriteEffect();
+    } else if(node->Is<PhiBase>()) {
+      auto phi = node->As<PhiBase>();
+      if(phi->region()) phi->region()->RemovePhi(phi);
+    }
+    node->ClearOperand();
+  }
+}
+
+void DeadCodeEliminator::Run() {
+  CollectControlFlow();
+
+  // 1. the edges after a return are dropped unless it makes a loop lose any
+  //    predecessor
+  BitSet none(&temp_zone_);
+  BitSet all (&temp_zone_);
+  MarkReachable(none,&all);
+
+  fall_through_ = false;
+  MarkReachable(none,&reachable_);
+  if(!IsPredecessorSafe(all,reachable_)) {
+    fall_through_ = true;
+    reachable_    = all;
+  }
+
+  // 2. fold the branches one by one , a fold is kept only when no loop loses
+  //    any predecessor
+  BitSet skip(&temp_zone_,false,graph_->MaxID());
+  BitSet reachable(&temp_zone_);
+  BitSet current(reachable_);
+  std::vector<std::pair<ControlFlow*,ControlFlow*>> fold_list;
+
+  for( auto cf : cf_list_ ) {
+    ControlFlow* dead;
+    if(!current[cf->id()] || !IsFoldable(cf,&dead)) continue;
+    skip[dead->id()] = true;
+    MarkReachable(skip,&reachable);
+    if(IsPredecessorSafe(reachable_,reachable)) {
+      fold_list.push_back(std::make_pair(cf,dead));
+      current = reachable;
+    } else {
+      skip[dead->id()] = false;
+    }
+  }
+  for( auto &f : fold_list ) FoldBranch(f.first,f.second);
+
+  // 3. cut the dead control flow off from the live one
+  MarkReachable(none,&reachable_);
+  for( auto cf : cf_list_ ) {
+    if(!reachable_[cf->id()]) continue;
+    RemoveDeadEdge(cf,all);
+    for( std::size_t i = cf->forward_edge()->size() ; i-- > 0 ; ) {
+      if(!reachable_[cf->Out(i)->id()]) cf->RemoveForwardEdge(i);
+    }
+  }
+
+  // 4. remove all the expression not used by the live blocks
+  CollectExpr();
+  MarkLive();
+  Sweep();
+}
+
+} // namespace
+
+bool DCE::Perform( Graph* graph , HIRPass::Flag flag ) {
+  (void)flag;
+  DeadCodeEliminator(graph).Run();
+  return true;
+}
 
 } // namespace hir
 } // namespace cbase
@@ -11,7 +11,11 @@ class Graph;
 /**
  * Dead code elmination
  *
- * This DCE phase will help to remove unused/unneeded branch
+ * This DCE phase will help to remove unused/unneeded branch. The branch whose
+ * condition is known is folded , the control flow not reachable anymore is cut
+ * off from the graph along with its phi operands and effect chain , and at last
+ * all the expression not used by the live control flow , including the unused
+ * phi node , is removed.
  */
 class DCE : public HIRPass {
  public:
@@ -0,0 +1,380 @@
+#include "escape-analysis.h"
+#include "dce.h"
+#include "src/cbase/hir.h"
+#include "src/zone/stl.h"
+#include "src/zone/zone.h"
+
+namespace lavascript {
+namespace cbase      {
+namespace hir        {
+namespace            {
+
+// The escape analysis works on each allocation , ie IRObject or IRList , one by
+// one. An allocation doesn't escape when all its users are :
+//
+// 1) a lookup (ObjectFind/ListIndex) of it with a constant key that is in the
+//    literal or a constant index that is in bound , and the reference returned
+//    by the lookup is only used by load (ObjectRefGet/ListRefGet) or as the
+//    reference of store (ObjectRefSet/ListRefSet)
+//
+// 2) the stack slot of a checkpoint
+//
+// 3) the effect merge that uses it as a write effect
+//
+// Since no one else can see the allocation , no write effect other than the
+// stores of it can change its component. A load is then replaced with the value
+// of the first store of the same component found along the effect chain , or
+// the component of the literal when the allocation itself is met. When an
+// effect merge is met , the value of each branch is found and a phi is created
+// in the merge region if they are not the same. We give up when the start of a
+// loop is met since it requires a loop carried phi , unless the allocation is
+// never mutated where each load is just the component of the literal.
+//
+// At last the stores and the allocation are removed from the effect chain , the
+// reads and the writes happened after them are moved to the write before them.
+class EscapeAnalyzer {
+ public:
+  EscapeAnalyzer( Graph* graph ):
+    graph_    (graph),
+    temp_zone_(),
+    expr_list_(&temp_zone_),
+    visited_  (&temp_zone_),
+    slot_     (&temp_zone_),
+    refs_     (&temp_zone_),
+    gets_     (&temp_zone_),
+    sets_     (&temp_zone_),
+    value_    (&temp_zone_),
+    memo_     (&temp_zone_)
+  {}
+
+  // returns true when any allocation is replaced
+  bool Run();
+
+ private:
+  typedef zone::stl::ZoneVector<Expr*> ExprList;
+
+  void CollectExpr();
+
+  // check whether the allocation escapes , all its lookups , loads and stores
+  // are collected when it doesn't
+  bool IsEscaped( WriteEffect* , bool* checkpoint );
+  // the component index of the lookup , returns false if the key is unknown
+  bool GetSlot  ( WriteEffect* , Expr* ref , std::size_t* slot ) const;
+  Expr* Initial ( WriteEffect* , std::size_t slot ) const;
+
+  // whether the value of the load can be found along the effect chain
+  bool  CanResolve( WriteEffect* , WriteEffect* );
+  Expr* Resolve   ( WriteEffect* , std::size_t slot , WriteEffect* );
+
+  bool Replace( WriteEffect* );
+  // remove the write from the effect chain , the reads after it and the effect
+  // merges that use it are moved to |to|
+  void Remove ( WriteEffect* , WriteEffect* to );
+
+  bool IsRef  ( Expr* node ) const {
+    return node->id() < slot_.size() && slot_[node->id()] != kNoSlot;
+  }
+
+  static constexpr std::size_t kNoSlot = static_cast<std::size_t>(-1);
+
+  Graph*                       graph_;
+  zone::Zone                   temp_zone_;
+  ExprList                     expr_list_;
+  zone::stl::BitSet            visited_;
+  // component index of each lookup of the allocation
+  zone::stl::ZoneVector<std::size_t> slot_;
+  zone::stl::ZoneVector<StaticRef*>  refs_;
+  zone::stl::ZoneVector<RefGet*>     gets_;
+  zone::stl::ZoneVector<RefSet*>     sets_;
+  ExprList                     value_;   // value of each load
+  zone::stl::ZoneUnorderedMap<std::uint32_t,Expr*> memo_;
+};
+
+void EscapeAnalyzer::CollectExpr() {
+  expr_list_.clear();
+  visited_.assign(graph_->MaxID(),false);
+
+  auto collect = [&]( Expr* node ) {
+    if(visited_[node->id()]) return;
+    visited_[node->id()] = true;
+    expr_list_.push_back(node);
+  };
+
+  lava_foreach( auto cf , ControlFlowRPOIterator(&temp_zone_,*graph_) ) {
+    lava_foreach( auto o , cf->operand_list()->GetForwardIterator() ) collect(o);
+    if(cf->Is<Merge>()) {
+      auto phi_list = cf->As<Merge>()->phi_list();
+      for( std::size_t i = 0 ; i < phi_list->size() ; ++i ) collect(phi_list->Index(i));
+    }
+    if(cf->Is<EffectMergeRegion>()) {
+      auto em_list = cf->As<EffectMergeRegion>()->effect_merge_list();
+      for( std::size_t i = 0 ; i < em_list->size() ; ++i ) collect(em_list->Index(i));
+    }
+  }
+
+  // the list grows while it is visited
+  for( std::size_t i = 0 ; i < expr_list_.size() ; ++i ) {
+    auto node = expr_list_[i];
+    lava_foreach( auto o , node->operand_list()->GetForwardIterator() ) collect(o);
+    lava_foreach( auto d , node->GetDependencyIterator() ) collect(d);
+    lava_foreach( auto &r , node->ref_list()->GetForwardIterator() ) {
+      if(r.node->Is<Expr>()) collect(r.node->As<Expr>());
+    }
+  }
+}
+
+bool EscapeAnalyzer::GetSlot( WriteEffect* alloc , Expr* ref , std::size_t* slot ) const {
+  if(alloc->Is<IRObject>()) {
+    if(!ref->Is<ObjectFind>()) return false;
+    auto key = ref->As<ObjectFind>()->key();
+    if(!key->Is<StringNode>()) return false;
+    auto &str = key->AsZoneString();
+    for( std::size_t i = 0 ; i < alloc->OperandSize() ; ++i ) {
+      auto k = alloc->Operand(i)->As<IRObjectKV>()->key();
+      if(k->Is<StringNode>() && k->AsZoneString() == str) {
+        *slot = i;
+        return true;
+      }
+    }
+  } else {
+    if(!ref->Is<ListIndex>()) return false;
+    auto index = ref->As<ListIndex>()->index();
+    std::int64_t idx;
+    if(index->Is<Int64>()) {
+      idx = index->As<Int64>()->value();
+    } else if(index->Is<Float64ToInt64>() && index->Operand(0)->Is<Float64>()) {
+      idx = static_cast<std::int64_t>(index->Operand(0)->As<Float64>()->value());
+    } else {
+      return false;
+    }
+    if(idx >= 0 && static_cast<std::size_t>(idx) < alloc->OperandSize()) {
+      *slot = static_cast<std::size_t>(idx);
+      return true;
+    }
+  }
+  return false;
+}
+
+Expr* EscapeAnalyzer::Initial( WriteEffect* alloc , std::size_t slot ) const {
+  auto n = alloc->Operand(slot);
+  return alloc->Is<IRObject>() ? n->As<IRObjectKV>()->value() : n;
+}
+
+bool EscapeAnalyzer::IsEscaped( WriteEffect* alloc , bool* checkpoint ) {
+  refs_.clear();
+  gets_.clear();
+  sets_.clear();
+  *checkpoint = false;
+
+  lava_foreach( auto &r , alloc->ref_list()->GetForwardIterator() ) {
+    if(!r.node->Is<Expr>()) return true;
+    auto user = r.node->As<Expr>();
+
+    if(user->Is<EffectMergeBase>()) {
+      continue;
+    } else if(user->Is<StackSlot>()) {
+      *checkpoint = true;
+      continue;
+    }
+
+    std::size_t slot;
+    if(!user->Is<StaticRef>() || !user->Operand(0)->IsIdentical(alloc) ||
+                                  user->Operand(1)->IsIdentical(alloc) ||
+                                 !GetSlot(alloc,user,&slot)) {
+      return true;
+    }
+    if(slot_[user->id()] != kNoSlot) continue; // used twice
+    slot_[user->id()] = slot;
+    refs_.push_back(user->As<StaticRef>());
+
+    lava_foreach( auto &u , user->ref_list()->GetForwardIterator() ) {
+      if(!u.node->Is<Expr>()) return true;
+      auto n = u.node->As<Expr>();
+      if(n->Is<RefGet>() && n->As<RefGet>()->ref()->IsIdentical(user)) {
+        gets_.push_back(n->As<RefGet>());
+      } else if(n->Is<RefSet>() && n->As<RefSet>()->ref()  ->IsIdentical(user) &&
+                                  !n->As<RefSet>()->value()->IsIdentical(user)) {
+        sets_.push_back(n->As<RefSet>());
+      } else {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool EscapeAnalyzer::CanResolve( WriteEffect* alloc , WriteEffect* effect ) {
+  for( auto e = effect ; ; e = e->NextWrite() ) {
+    if(e->IsIdentical(alloc) || visited_[e->id()]) return true;
+    visited_[e->id()] = true;
+
+    if(e->Is<EffectMerge>()) {
+      auto em     = e->As<EffectMerge>();
+      auto region = em->region();
+      if(!region || em->OperandSize() != 2 || region->backward_edge()->size() != 2)
+        return false;
+      return CanResolve(alloc,em->lhs_effect()) && CanResolve(alloc,em->rhs_effect());
+    } else if(e->Is<EffectMergeBase>() || e->Is<InitBarrier>()) {
+      return false;
+    }
+  }
+}
+
+Expr* EscapeAnalyzer::Resolve( WriteEffect* alloc , std::size_t slot , WriteEffect* effect ) {
+  for( auto e = effect ; ; e = e->NextWrite() ) {
+    if(e->IsIdentical(alloc)) return Initial(alloc,slot);
+
+    if(e->Is<RefSet>()) {
+      auto set = e->As<RefSet>();
+      if(IsRef(set->ref()) && slot_[set->ref()->id()] == slot) return set->value();
+    } else if(e->Is<EffectMerge>()) {
+      if(auto itr = memo_.find(e->id()); itr != memo_.end()) return itr->second;
+      auto em  = e->As<EffectMerge>();
+      auto lhs = Resolve(alloc,slot,em->lhs_effect());
+      auto rhs = Resolve(alloc,slot,em->rhs_effect());
+      Expr* v  = lhs->IsIdentical(rhs) ? lhs : Phi::New(graph_,lhs,rhs,em->region());
+      memo_[e->id()] = v;
+      return v;
+    }
+  }
+}
+
+void EscapeAnalyzer::Remove( WriteEffect* node , WriteEffect* to ) {
+  zone::stl::ZoneVector<ReadEffect*>      reads(&temp_zone_);
+  zone::stl::ZoneVector<EffectMergeBase*> merges(&temp_zone_);
+
+  lava_foreach( auto r , node->read_effect()->GetForwardIterator() ) reads.push_back(r);
+  for( auto r : reads ) {
+    r->RemoveWriteEffect();
+    r->SetWriteEffect(to);
+  }
+
+  lava_foreach( auto &r , node->ref_list()->GetForwardIterator() ) {
+    if(r.node->Is<EffectMergeBase>()) merges.push_back(r.node->As<EffectMergeBase>());
+  }
+  for( auto em : merges ) {
+    for( std::size_t i = 0 ; i < em->OperandSize() ; ++i ) {
+      if(em->Operand(i)->IsIdentical(node)) em->ReplaceOperand(i,to);
+    }
+  }
+
+  node->HappenAfter(NULL);
+}
+
+bool EscapeAnalyzer::Replace( WriteEffect* alloc ) {
+  slot_.assign(graph_->MaxID(),kNoSlot);
+
+  bool checkpoint;
+  if(IsEscaped(alloc,&checkpoint)) return false;
+  // a mutated allocation cannot be materialized by its literal
+  if(checkpoint && !sets_.empty()) return false;
+
+  if(!sets_.empty()) {
+    for( auto get : gets_ ) {
+      if(!get->write_effect()) return false;
+      visited_.assign(graph_->MaxID(),false);
+      if(!CanResolve(alloc,get->write_effect())) return false;
+    }
+  }
+
+  // 1. find the value of each load , phi may be created here
+  value_.clear();
+  for( auto get : gets_ ) {
+    auto slot = slot_[get->ref()->id()];
+    if(sets_.empty()) {
+      value_.push_back(Initial(alloc,slot));
+    } else {
+      memo_.clear();
+      value_.push_back(Resolve(alloc,slot,get->write_effect()));
+    }
+  }
+
+  // 2. replace the load , the value can be another load of the allocation ,
+  //    ie o.a = o.b , which is replaced by its own value
+  zone::stl::ZoneVector<std::size_t> index(&temp_zone_,kNoSlot,graph_->MaxID());
+  for( std::size_t i = 0 ; i < gets_.size() ; ++i ) index[gets_[i]->id()] = i;
+  for( std::size_t i = 0 ; i < gets_.size() ; ++i ) {
+    auto v = value_[i];
+    while(v->id() < index.size() && index[v->id()] != kNoSlot) v = value_[index[v->id()]];
+    value_[i] = v;
+  }
+  for( std::size_t i = 0 ; i < gets_.size() ; ++i ) {
+    gets_[i]->Replace(value_[i]);
+  }
+
+  // 3. remove the stores and the allocation from the effect chain , the write
+  //    before them is found before anything is modified
+  zone::stl::BitSet removed(&temp_zone_,false,graph_->MaxID());
+  zone::stl::ZoneVector<WriteEffect*> list(&temp_zone_);
+  for( auto set : sets_ ) list.push_back(set);
+  list.push_back(alloc);
+  for( auto w : list ) removed[w->id()] = true;
+
+  zone::stl::ZoneVector<WriteEffect*> before(&temp_zone_,NULL,graph_->MaxID());
+  for( auto w : list ) {
+    auto e = w->NextWrite();
+    while(removed[e->id()]) e = e->NextWrite();
+    before[w->id()] = e;
+  }
+
+  for( auto w : list ) Remove(w,before[w->id()]);
+
+  for( auto n : expr_list_ ) {
+    if(!n->Is<WriteEffect>() || removed[n->id()]) continue;
+    auto w = n->As<WriteEffect>();
+    if(w->IsLinked() && !w->Is<InitBarrier>() && removed[w->NextWrite()->id()]) {
+      w->HappenAfter(before[w->NextWrite()->id()]);
+    }
+  }
+
+  // 4. drop the stores , the lookups and the allocation if it is not used by
+  //    any checkpoint
+  for( auto set : sets_ ) set->ClearOperand();
+  for( auto ref : refs_ ) {
+    ref->RemoveWriteEffect();
+    ref->ClearOperand();
+  }
+  if(!checkpoint) {
+    if(alloc->Is<IRObject>()) {
+      lava_foreach( auto kv , alloc->operand_list()->GetForwardIterator() ) kv->ClearOperand();
+    }
+    alloc->ClearOperand();
+  }
+  return true;
+}
+
+bool EscapeAnalyzer::Run() {
+  bool changed = false;
+  bool again;
+
+  // removing an allocation drops its components , which may make the allocation
+  // stored in it not escaped anymore
+  do {
+    again = false;
+    CollectExpr();
+    zone::stl::ZoneVector<WriteEffect*> alloc_list(&temp_zone_);
+    for( auto n : expr_list_ ) {
+      if((n->Is<IRObject>() || n->Is<IRList>()) && n->As<WriteEffect>()->IsLinked())
+        alloc_list.push_back(n->As<WriteEffect>());
+    }
+    for( auto a : alloc_list ) {
+      if(Replace(a)) again = true;
+    }
+    changed |= again;
+  } while(again);
+
+  if(changed) DCE().Perform(graph_,HIRPass::NORMAL);
+  return changed;
+}
+
+} // namespace
+
+bool EscapeAnalysis::Perform( Graph* graph , HIRPass::Flag flag ) {
+  (void)flag;
+  EscapeAnalyzer(graph).Run();
+  return true;
+}
+
+} // namespace hir
+} // namespace cbase
+} // namespace lavascript
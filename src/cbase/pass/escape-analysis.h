@@ -0,0 +1,36 @@
+#ifndef CBASE_PASS_ESCAPE_ANALYSIS_H_
+#define CBASE_PASS_ESCAPE_ANALYSIS_H_
+#include "src/cbase/hir-pass.h"
+
+namespace lavascript {
+namespace cbase      {
+namespace hir        {
+
+class Graph;
+
+/**
+ * Escape analysis and scalar replacement
+ *
+ * An object or list created by literal (IRObject/IRList) that is only accessed
+ * by constant key or index , and is never passed to anyone else , doesn't escape
+ * the function. Its components are turned into SSA values : each load is replaced
+ * with the value stored by the closest store along the effect chain , or with the
+ * literal component , a phi is created at the merge of an if when the branches
+ * store different values. The stores and the allocation are removed from the effect
+ * chain afterwards.
+ *
+ * An allocation captured by checkpoint is only replaced when it is never mutated ,
+ * the allocation node is then kept outside of the effect chain and only used by the
+ * checkpoint to materialize the object on deoptimization.
+ */
+class EscapeAnalysis : public HIRPass {
+ public:
+  virtual bool Perform( Graph* , HIRPass::Flag );
+  EscapeAnalysis() : HIRPass("escape-analysis") {}
+};
+
+} // namespace hir
+} // namespace cbase
+} // namespace lavascript
+
+#endif // CBASE_PASS_ESCAPE_ANALYSIS_H_
@@ -1,50 +1,468 @@
 #include "gvn.h"
-#include "src/cbase/hir-visitor.h"
+#include "src/cbase/hir.h"
+#include "src/cbase/aa.h"
+#include "src/zone/stl.h"
+#include "src/zone/zone.h"
 #include "src/zone/table.h"
 
-#include <unordered_set>
-
 namespace lavascript {
-namespace cbase {
-namespace hir {
+namespace cbase      {
+namespace hir        {
+namespace            {
 
-// This implements a simple *one pass* GVN instead of iterative version. Iterative GVN
-// may capture more possible optimization at the cost of slow convergence time. It is
-// relative simple to modify this algorithm to do interative version.
-bool GVN::Perform( Graph* graph , HIRPass::Flag flag ) {
-  static const std::size_t kStackSize = 1024;
-  static const std::size_t kTableSize = 128 ; // make sure this number can utilize the stack size otherwise
-                                              // it makes no sense to have stack zone
-  (void)flag;
+// The global value numbering is iterative , each round does 3 things until
+// nothing changes :
+//
+// 1) Memory read. Each lookup (ObjectFind/ListIndex) and reference load
+//    (ObjectRefGet/ListRefGet) is moved up along the effect chain to the
+//    earliest write effect that may change what it reads , so 2 reads of the
+//    same memory become the same node in 2). A read is moved across an effect
+//    merge when both branches don't change the memory , and across the start
+//    of a loop when no write inside of the loop changes the memory ; the
+//    later is the loop invariant load hoisting , since the read then hangs
+//    on the effect before the loop and the scheduler places it in front of
+//    the loop , and it is the same value as the read of the same memory
+//    before the loop. A read is not moved out of a branch by itself since a
+//    lookup can fail , but when the same read is in both branches of an if
+//    both of them are moved before the if , which removes the partially
+//    redundant read. For the same reason a lookup moved out of a loop hangs
+//    on the effect of the loop pre-header , see Loop::GetPreHeader , which
+//    only runs when the loop is entered , since the loop body may run 0
+//    times. Any hard barrier is assumed to change all memory.
+//
+// 2) Hash consing. Every expression reachable from the graph is visited with
+//    its operands first and is replaced by the node already seen that is
+//    Equal to it.
+//
+// 3) Phi. A phi whose operands are the same value , except itself , is that
+//    value ; and 2 phis in the same region with the same operands are the
+//    same value.
+//
+// Replacing a node in one round makes the phi and the nodes using it become
+// the same as others in the next round , so the loop carried values which
+// are the same in each iteration end up as the value before the loop.
+class GlobalValueNumbering {
+ public:
+  GlobalValueNumbering( Graph* graph ):
+    graph_    (graph),
+    temp_zone_(),
+    cf_list_  (&temp_zone_),
+    expr_list_(&temp_zone_),
+    visited_  (&temp_zone_),
+    worklist_ (&temp_zone_),
+    loop_visited_(&temp_zone_),
+    sibling_  (&temp_zone_)
+  {}
+
+  void Run();
+
+ private:
+  typedef zone::stl::ZoneVector<WriteEffect*> WriteList;
+
+  // collect all the expression node in post order , operands and dependency
+  // of a node are visited before the node
+  void CollectExpr();
+
+  bool MoveRead   ();
+  bool Number     ();
+  bool SimplifyPhi();
+
+  // find the earliest write effect , starting from the input one , that the
+  // read can depend on ; all the write effects visited are recorded in path
+  WriteEffect* FindEffect( ReadEffect* , WriteEffect* , WriteList* path );
+  // find the write effect before the branches of the effect merge if none of
+  // the branches changes the memory , otherwise return NULL
+  WriteEffect* SkipBranch( ReadEffect* , EffectMerge* );
+  // check whether any write inside of the loop may change the memory
+  bool IsLoopClobbered( ReadEffect* , LoopEffectStart* );
+  // whether the read may fail , ie a lookup of missing key or out of bound
+  static bool CanFail( ReadEffect* );
+  // the write effect before the loop the read can be moved to , NULL if the
+  // read must stay inside of the loop
+  static WriteEffect* LoopEntryEffect( ReadEffect* , LoopEffectStart* );
+
+  // the read cannot go above the node its operand depends on
+  static bool IsFloor    ( ReadEffect* , WriteEffect* );
+  // whether the write may change the memory the read reads
+  static bool IsClobbered( ReadEffect* , WriteEffect* );
+  // whether 2 reads read the same memory , regardless of the write effect
+  static bool IsSameRead ( ReadEffect* , ReadEffect* );
+  static bool IsMemoryRead( Expr* node ) {
+    return node->Is<StaticRef>() || node->Is<RefGet>();
+  }
+
+  Graph*                            graph_;
+  zone::Zone                        temp_zone_;
+  zone::stl::ZoneVector<ControlFlow*> cf_list_;
+  zone::stl::ZoneVector<Expr*>      expr_list_;
+  zone::stl::BitSet                 visited_;
+  WriteList                         worklist_;
+  zone::stl::BitSet                 loop_visited_;
+  // the branch start effect of the other branch of the same if
+  zone::stl::ZoneVector<BranchStartEffect*> sibling_;
+};
+
+void GlobalValueNumbering::CollectExpr() {
+  struct Frame {
+    Expr* node;
+    bool  expanded;
+  };
+  zone::stl::ZoneVector<Frame> stack(&temp_zone_);
+
+  expr_list_.clear();
+  visited_.assign(graph_->MaxID(),false);
+
+  auto visit = [&]( Expr* root ) {
+    stack.push_back({root,false});
+    while(!stack.empty()) {
+      auto top = stack.back();
+      stack.pop_back();
+      if(top.expanded) {
+        expr_list_.push_back(top.node);
+        continue;
+      }
+      if(visited_[top.node->id()]) continue;
+      visited_[top.node->id()] = true;
+
+      stack.push_back({top.node,true});
+      lava_foreach( auto o , top.node->operand_list()->GetForwardIterator() ) {
+        if(!visited_[o->id()]) stack.push_back({o,false});
+      }
+      lava_foreach( auto d , top.node->GetDependencyIterator() ) {
+        if(!visited_[d->id()]) stack.push_back({d,false});
+      }
+    }
+  };
+
+  for( auto cf : cf_list_ ) {
+    lava_foreach( auto o , cf->operand_list()->GetForwardIterator() ) visit(o);
+    if(cf->Is<Merge>()) {
+      auto phi_list = cf->As<Merge>()->phi_list();
+      for( std::size_t i = 0 ; i < phi_list->size() ; ++i ) visit(phi_list->Index(i));
+    }
+    if(cf->Is<EffectMergeRegion>()) {
+      auto em_list = cf->As<EffectMergeRegion>()->effect_merge_list();
+      for( std::size_t i = 0 ; i < em_list->size() ; ++i ) visit(em_list->Index(i));
+    }
+  }
+}
+
+bool GlobalValueNumbering::IsFloor( ReadEffect* read , WriteEffect* effect ) {
+  lava_foreach( auto o , read->operand_list()->GetForwardIterator() ) {
+    if(o->IsIdentical(effect)) return true;
+    if(o->Is<ReadEffect>() && o->As<ReadEffect>()->write_effect() == effect) return true;
+  }
+  return false;
+}
+
+bool GlobalValueNumbering::IsClobbered( ReadEffect* read , WriteEffect* effect ) {
+  Expr* object = NULL;
+  bool  list   = false;
+  if(read->Is<StaticRef>()) {
+    object = read->Operand(0);
+    list   = read->Is<ListIndex>();
+  } else {
+    object = FieldRefNode(read->As<RefGet>()->ref()).object();
+    list   = read->Is<ListRefGet>();
+  }
+
+  if(effect->Is<EmptyWriteEffect>()) {
+    return false;
+  } else if(effect->Is<IRObject>() || effect->Is<IRList>()) {
+    // a new object doesn't change any existed memory
+    return effect->IsIdentical(object);
+  } else if(effect->Is<RefSet>()) {
+    // a store doesn't move any reference , so only the load cares about it
+    if(read->Is<RefGet>()) {
+      return AA::Query(FieldRefNode(read->As<RefGet>()->ref()),
+                       FieldRefNode(effect->As<RefSet>()->ref())) != AA::AA_NOT;
+    }
+    return false;
+  } else if(effect->Is<ObjectResize>() || effect->Is<ListResize>()) {
+    auto barrier = effect->As<EffectBarrier>();
+    return (list ? AA::QueryList(object,barrier) : AA::QueryObject(object,barrier)) != AA::AA_NOT;
+  }
+  return true;
+}
+
+bool GlobalValueNumbering::IsLoopClobbered( ReadEffect* read , LoopEffectStart* loop ) {
+  if(loop->OperandSize() != 2) return true;
+
+  auto& worklist = worklist_;
+  auto& visited  = loop_visited_;
+  worklist.clear();
+  visited.assign(graph_->MaxID(),false);
+
+  // all the writes inside of the loop body are reachable from the backward
+  // effect of the loop , and ends at the loop effect start
+  worklist.push_back(loop->rhs_effect());
+  while(!worklist.empty()) {
+    auto e = worklist.back();
+    worklist.pop_back();
+    if(e->IsIdentical(loop) || visited[e->id()]) continue;
+    visited[e->id()] = true;
+
+    if(e->Is<EffectMergeBase>()) {
+      lava_foreach( auto o , e->operand_list()->GetForwardIterator() ) {
+        worklist.push_back(o->As<WriteEffect>());
+      }
+      continue;
+    }
+    if(e->Is<BranchStartEffect>()) {
+      worklist.push_back(e->NextWrite());
+      continue;
+    }
+    if(IsClobbered(read,e)) return true;
+    worklist.push_back(e->NextWrite());
+  }
+  return false;
+}
+
+bool GlobalValueNumbering::CanFail( ReadEffect* read ) {
+  if(read->Is<ListIndex>()) return read->As<ListIndex>()->bound_check();
+  return read->Is<ObjectFind>();
+}
+
+WriteEffect* GlobalValueNumbering::LoopEntryEffect( ReadEffect* read , LoopEffectStart* loop ) {
+  auto region = loop->region();
+  if(!region || !region->Is<Loop>()) return NULL;
+  auto body   = region->As<Loop>();
+
+  // a read that may fail goes to the pre-header , a read that cannot fail goes
+  // before the loop header unless its operand is in the pre-header
+  if(CanFail(read)) {
+    auto pre = body->GetPreHeader();
+    return pre ? pre->branch_start_effect() : NULL;
+  }
+  auto effect = loop->lhs_effect();
+  if(body->pre_header() && !IsFloor(read,effect)) effect = effect->NextWrite();
+  return effect;
+}
+
+WriteEffect* GlobalValueNumbering::SkipBranch( ReadEffect* read , EffectMerge* merge ) {
+  if(merge->OperandSize() != 2) return NULL;
+
+  WriteList lhs(&temp_zone_);
+  WriteList rhs(&temp_zone_);
+
+  // walk each branch up to its branch start and then to the write before
+  // the branch
+  auto walk = [&]( WriteEffect* e , WriteList* path ) {
+    e = FindEffect(read,e,path);
+    if(e->Is<BranchStartEffect>() && !IsFloor(read,e)) FindEffect(read,e->NextWrite(),path);
+  };
+  walk(merge->lhs_effect(),&lhs);
+  walk(merge->rhs_effect(),&rhs);
+
+  // the first write shared by both branches is where they split , every
+  // write before it in both paths doesn't change the memory
+  for( auto e : rhs ) {
+    if(std::find(lhs.begin(),lhs.end(),e) != lhs.end()) return e;
+  }
+  return NULL;
+}
+
+WriteEffect* GlobalValueNumbering::FindEffect( ReadEffect* read , WriteEffect* e ,
+                                                                 WriteList* path ) {
+  while(true) {
+    path->push_back(e);
+    if(IsFloor(read,e)) return e;
+
+    if(e->Is<LoopEffectStart>()) {
+      auto loop = e->As<LoopEffectStart>();
+      if(IsLoopClobbered(read,loop)) return e;
+      auto entry = LoopEntryEffect(read,loop);
+      if(!entry) return e;
+      e = entry;
+    } else if(e->Is<EffectMerge>()) {
+      auto before = SkipBranch(read,e->As<EffectMerge>());
+      if(!before) return e;
+      e = before;
+    } else if(e->Is<HardBarrier>() || IsClobbered(read,e)) {
+      return e;
+    } else {
+      e = e->NextWrite();
+    }
+  }
+  lava_die(); return NULL;
+}
+
+bool GlobalValueNumbering::IsSameRead( ReadEffect* lhs , ReadEffect* rhs ) {
+  if(lhs->type() != rhs->type() || lhs->OperandSize() != rhs->OperandSize()) return false;
+  for( std::size_t i = 0 ; i < lhs->OperandSize() ; ++i ) {
+    auto l = lhs->Operand(i);
+    auto r = rhs->Operand(i);
+    if(!l->IsIdentical(r) && !l->Equal(r)) return false;
+  }
+  return true;
+}
+
+bool GlobalValueNumbering::MoveRead() {
+  bool changed = false;
+  WriteList path(&temp_zone_);
+  zone::stl::ZoneVector<ReadEffect*> branch_list(&temp_zone_);
+
+  auto move = [&]( ReadEffect* read , WriteEffect* target ) {
+    if(target != read->write_effect()) {
+      read->RemoveWriteEffect();
+      read->SetWriteEffect(target);
+      changed = true;
+    }
+  };
 
-  ::lavascript::zone::StackZone<kStackSize>            zone;
-  ::lavascript::zone::OOLVector<bool>                  visited(&zone,graph->MaxID());
-  ::lavascript::zone::Table<Expr*,Expr*,HIRExprHasher> table(&zone,kTableSize);
-
-  lava_foreach( auto cf , ControlFlowRPOIterator(&zone,*graph) ) {
-    lava_foreach( auto expr , cf->operand_list()->GetForwardIterator() ) {
-    // all the operands node
-      if(!visited.Get(&zone,expr->id())) {
-        // number valuing
-        lava_foreach( auto subexpr , ExprDFSIterator(&zone,*graph,expr) ) {
-          auto itr = table.Find(subexpr);
-          auto tar = itr.HasNext() ? itr.value() : NULL;
-          if(tar) {
-            if(!tar->IsIdentical(subexpr)) {
-              subexpr->Replace(tar);          // okay, find a target, just replace the old one
-              if(tar->IsIdentical(expr))
-                expr = subexpr;               // this whole expression is replaced, record it for
-                                              // marking later on to avoid visiting multiple times
-            }
-          } else {
-            lava_verify(table.Insert(&zone,subexpr,subexpr).second);
-          }
+  // the operand is visited before its user , so the lookup is moved before
+  // the load using it
+  for( auto node : expr_list_ ) {
+    if(!IsMemoryRead(node)) continue;
+    auto read = node->As<ReadEffect>();
+    if(!read->write_effect()) continue;
+
+    path.clear();
+    auto target = FindEffect(read,read->write_effect(),&path);
+    move(read,target);
+
+    // the branch start effect of a pre-header created in this round is newer
+    // than the sibling table , it has no sibling anyway
+    if(target->Is<BranchStartEffect>() && target->id() < sibling_.size() &&
+       sibling_[target->id()] && !IsFloor(read,target))
+      branch_list.push_back(read);
+  }
+
+  // the same read in both branches of an if is done whichever branch is taken ,
+  // so both of them are moved before the if and become one read
+  for( std::size_t i = 0 ; i < branch_list.size() ; ++i ) {
+    auto lhs = branch_list[i];
+    if(!lhs) continue;
+    auto sibling = sibling_[lhs->write_effect()->id()];
+
+    for( std::size_t j = i + 1 ; j < branch_list.size() ; ++j ) {
+      auto rhs = branch_list[j];
+      if(!rhs || rhs->write_effect() != sibling || !IsSameRead(lhs,rhs)) continue;
+
+      auto before = sibling->NextWrite();
+      path.clear(); move(lhs,FindEffect(lhs,before,&path));
+      path.clear(); move(rhs,FindEffect(rhs,before,&path));
+      branch_list[j] = NULL;
+      break;
+    }
+  }
+  return changed;
+}
+
+bool GlobalValueNumbering::Number() {
+  bool changed = false;
+  zone::Table<Expr*,Expr*,HIRExprHasher> table(&temp_zone_,expr_list_.size() * 2);
+
+  for( auto node : expr_list_ ) {
+    // a write effect and a phi are not moved into another place
+    if(node->Is<WriteEffect>() || node->Is<PhiBase>()) continue;
+
+    auto itr = table.Find(node);
+    if(itr.HasNext()) {
+      auto tar = itr.value();
+      if(!tar->IsIdentical(node)) {
+        node->Replace(tar);
+        changed = true;
+      }
+    } else {
+      lava_verify(table.Insert(&temp_zone_,node,node).second);
+    }
+  }
+  return changed;
+}
+
+bool GlobalValueNumbering::SimplifyPhi() {
+  bool changed = false;
+  zone::stl::ZoneVector<PhiBase*> phi_list(&temp_zone_);
+
+  auto same = []( PhiBase* lhs , Expr* l , PhiBase* rhs , Expr* r ) {
+    if(l->IsIdentical(lhs) && r->IsIdentical(rhs)) return true;
+    return l->IsIdentical(r) || l->Equal(r);
+  };
+
+  for( auto cf : cf_list_ ) {
+    if(!cf->Is<Merge>()) continue;
+    auto merge = cf->As<Merge>();
+
+    phi_list.clear();
+    for( std::size_t i = 0 ; i < merge->phi_list()->size() ; ++i ) {
+      phi_list.push_back(merge->phi_list()->Index(i));
+    }
+
+    for( std::size_t i = 0 ; i < phi_list.size() ; ++i ) {
+      auto phi = phi_list[i];
+
+      // phi of one value
+      Expr* value = NULL;
+      bool  one   = true;
+      lava_foreach( auto o , phi->operand_list()->GetForwardIterator() ) {
+        if(o->IsIdentical(phi)) continue;
+        if(!value) value = o;
+        else if(!same(phi,value,phi,o)) { one = false; break; }
+      }
+      if(one && value) {
+        merge->RemovePhi(phi);
+        phi->Replace(value);
+        phi_list[i] = NULL;
+        changed = true;
+        continue;
+      }
+
+      // phi same as another one in the region
+      for( std::size_t j = 0 ; j < i ; ++j ) {
+        auto that = phi_list[j];
+        if(!that || that->type() != phi->type() ||
+                    that->OperandSize() != phi->OperandSize()) continue;
+
+        bool equal = true;
+        for( std::size_t k = 0 ; k < phi->OperandSize() ; ++k ) {
+          if(!same(that,that->Operand(k),phi,phi->Operand(k))) { equal = false; break; }
+        }
+        if(equal) {
+          merge->RemovePhi(phi);
+          phi->Replace(that);
+          phi_list[i] = NULL;
+          changed = true;
+          break;
         }
-        // mark it to be visited
-        visited.Set(&zone,expr->id(),true);
       }
     }
   }
+  return changed;
+}
+
+void GlobalValueNumbering::Run() {
+  lava_foreach( auto cf , ControlFlowRPOIterator(&temp_zone_,*graph_) ) {
+    cf_list_.push_back(cf);
+  }
+
+  sibling_.assign(graph_->MaxID(),NULL);
+  for( auto cf : cf_list_ ) {
+    if(!cf->Is<If>() || cf->forward_edge()->size() != 2) continue;
+    auto lhs = cf->Out(0);
+    auto rhs = cf->Out(1);
+    if(lhs->operand_list()->empty() || rhs->operand_list()->empty()) continue;
+    auto l = lhs->operand_list()->First();
+    auto r = rhs->operand_list()->First();
+    if(!l->Is<BranchStartEffect>() || !r->Is<BranchStartEffect>()) continue;
+    sibling_[l->id()] = r->As<BranchStartEffect>();
+    sibling_[r->id()] = l->As<BranchStartEffect>();
+  }
+
+  bool changed;
+  do {
+    CollectExpr();
+    changed  = MoveRead   ();
+    changed |= Number     ();
+    changed |= SimplifyPhi();
+  } while(changed);
+}
+
+} // namespace
+
+bool GVN::Perform( Graph* graph , HIRPass::Flag flag ) {
+  (void)flag;
+  GlobalValueNumbering(graph).Run();
   return true;
 }
 
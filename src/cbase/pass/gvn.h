@@ -9,8 +9,9 @@ namespace hir {
 class Graph;
 
 /**
- *  Global Value Numbering pass. It also contains some other simplification algorithm
- *  like value inference.
+ *  Global Value Numbering pass. It is iterative and runs until nothing changes , it
+ *  also removes the redundant memory read , moves the loop invariant read out of the
+ *  loop and folds the phi whose operands are the same value.
  */
 class GVN: public HIRPass {
  public:
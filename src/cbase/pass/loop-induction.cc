@@ -10,6 +10,8 @@
 #include "src/cbase/fold/fold-box.h"
 #include "src/cbase/fold/fold-arith.h"
 
+#include <limits>
+
 
 namespace lavascript {
 namespace cbase      {
@@ -58,6 +60,9 @@ class LoopIVTyper {
   void RunLoop   ();
   // get a loop induction variable's start and end
   bool GetLinearLoopIVComponent( LoopIV* , Expr** , Expr** );
+  // try to narrow an integral counting loop , ie fend2i , into int64. Nothing
+  // is changed if it returns false
+  bool NarrowToInt64( Expr** , Arithmetic* , LoopIV* );
 
   // typper for propogating type back
   Expr* TypeLoopIV    ( LoopIV* );
@@ -142,6 +147,89 @@ bool LoopIVTyper::GetLinearLoopIVComponent( LoopIV* node , Expr** start , Expr**
   return false;
 }
 
+namespace {
+
+// An integral value is exact in float64 as long as its magnitude is not larger
+// than 2^53 , so an int64 induction variable inside of it computes the same
+// value as the float64 one
+static const std::int64_t kMaxExactInteger = static_cast<std::int64_t>(1) << 53;
+
+// Float64 constant that holds an integral value which fits in int32 , the
+// bytecode generator only emits fend2i when start/end/step are all like this
+bool GetIntegralConstant( Expr* node , std::int64_t* output ) {
+  if(node->Is<Int64>()) {
+    *output = node->As<Int64>()->value();
+    return true;
+  } else if(node->Is<Float64>()) {
+    double v = node->As<Float64>()->value();
+    if(v >= std::numeric_limits<std::int32_t>::min() &&
+       v <= std::numeric_limits<std::int32_t>::max() &&
+       static_cast<double>(static_cast<std::int32_t>(v)) == v) {
+      *output = static_cast<std::int64_t>(v);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool IsExactInteger( std::int64_t v ) {
+  return v >= -kMaxExactInteger && v <= kMaxExactInteger;
+}
+
+Expr* StripBox( Expr* node ) {
+  for( ;; ) {
+    if(node->Is<Box>())        node = node->As<Box>()->value();
+    else if(node->Is<Unbox>()) node = node->As<Unbox>()->value();
+    else return node;
+  }
+}
+
+} // namespace
+
+// A fend2i counting loop , ie its start , step and bound are integral constants
+// and the loop exit tests the increased value with < , can use int64 as its
+// induction variable. The value goes from start up to bound + step , so both
+// must be exact in float64. All the checks are done before the start and step
+// are rewritten into Int64 node ; the back propogation then turns the increment
+// into Int64Arithmetic. The value is only converted back to float64 when it is
+// used as a normal number.
+bool LoopIVTyper::NarrowToInt64( Expr** start , Arithmetic* incr , LoopIV* iv ) {
+  if(incr->op() != Binary::ADD && incr->op() != Binary::SUB)
+    return false;
+
+  const std::size_t step_idx = incr->lhs()->IsIdentical(iv) ? 1 : 0;
+  std::int64_t start_val , step_val , bound_val;
+
+  // sub needs induction variable to be the lhs
+  if(incr->op() == Binary::SUB && step_idx != 1)
+    return false;
+
+  if(!GetIntegralConstant(*start,&start_val) ||
+     !GetIntegralConstant(incr->Operand(step_idx),&step_val))
+    return false;
+
+  // the loop counts upward
+  auto delta = incr->op() == Binary::SUB ? -step_val : step_val;
+  if(delta <= 0)
+    return false;
+
+  // the loop exit tests the increased value against an integral constant
+  auto cond = StripBox(loop_node_->loop_exit()->condition());
+  if(!cond->Is<Compare>())
+    return false;
+  auto cmp = cond->As<Compare>();
+  if(cmp->op() != Binary::LT || !StripBox(cmp->lhs())->IsIdentical(incr) ||
+                                !GetIntegralConstant(StripBox(cmp->rhs()),&bound_val))
+    return false;
+
+  if(!IsExactInteger(start_val) || !IsExactInteger(bound_val + delta))
+    return false;
+
+  *start = Int64::New(graph_,start_val);
+  incr->ReplaceOperand(step_idx,Int64::New(graph_,step_val));
+  return true;
+}
+
 void LoopIVTyper::Enqueue( zone::stl::NodeMarker*       marker  ,
                            zone::stl::ZoneQueue<Expr*>* queue   ,
                            Expr* root ) {
@@ -183,6 +271,11 @@ Expr* LoopIVTyper::TypeLoopIV( LoopIV* iv ) {
     if(end_type = GetTypeInference(target); !TPKind::IsNumber(end_type))
       return NULL;
 
+    // integral counting loop , its start and step become int64 constant so
+    // it will be typed as LoopIVInt64 below
+    if(NarrowToInt64(&start,end->As<Arithmetic>(),iv))
+      start_type = end_type = TPKIND_INT64;
+
     // now decide which type should we use here, whether we should use specialized
     // LoopIVInt64 or just normal LoopIVFloat64.
     new_iv = NULL;
@@ -242,6 +335,12 @@ Expr* LoopIVTyper::TypeLoopIV( LoopIV* iv ) {
           if(auto nn = TypeUnbox(top->As<Unbox>()); nn)
             Enqueue(&marker,&queue,nn);
           break;
+        case HIR_IGET:
+          TypeIGet(top->As<IGet>());
+          break;
+        case HIR_ISET:
+          TypeISet(top->As<ISet>());
+          break;
         default:
           break;
       }
@@ -437,12 +536,38 @@ bool LoopIVTyper::CheckList( Expr** node ) {
   return true;
 }
 
+// The index get/set on a list indexed by a typed number is lowered into a
+// ListIndex and the reference get/set , the same as what graph builder does
+// when it knows the type. The ListIndex reads the write effect that the old
+// node depends on , the reference get takes the place of the old barrier
 Expr* LoopIVTyper::TypeIGet( IGet* node ) {
-  return NULL;
+  auto object = node->object();
+  auto tk     = GetTypeInference(node->index());
+  if(!TPKind::IsNumber(tk) || !CheckList(&object))
+    return NULL;
+
+  auto effect = node->NextWrite();
+  auto index  = ToIndex(NewUnboxNode(graph_,node->index(),tk),tk);
+  auto ref    = ListIndex::New(graph_,object,index);
+  ref->SetWriteEffect(effect);
+  auto nnode  = ListRefGet::New(graph_,ref);
+  nnode->SetWriteEffect(effect);
+  node->Replace(nnode);
+  return nnode;
 }
 
 Expr* LoopIVTyper::TypeISet( ISet* node ) {
-  return NULL;
+  auto object = node->object();
+  auto tk     = GetTypeInference(node->index());
+  if(!TPKind::IsNumber(tk) || !CheckList(&object))
+    return NULL;
+
+  auto index  = ToIndex(NewUnboxNode(graph_,node->index(),tk),tk);
+  auto ref    = ListIndex::New(graph_,object,index);
+  ref->SetWriteEffect(node->NextWrite());
+  auto nnode  = ListRefSet::New(graph_,ref,node->value());
+  node->Replace(nnode);
+  return nnode;
 }
 
 } // namespace
@@ -0,0 +1,683 @@
+#include "loop-unswitch.h"
+#include "dce.h"
+#include "src/cbase/hir.h"
+#include "src/cbase/loop-analyze.h"
+#include "src/cbase/type-inference.h"
+#include "src/zone/stl.h"
+#include "src/zone/zone.h"
+
+namespace lavascript {
+namespace cbase      {
+namespace hir        {
+namespace            {
+
+// A loop is unswitched as following :
+//
+//                                          P
+//        P                                 |
+//        |                                 If(cond)
+//    LoopHeader                      +-------+-------+
+//        |                           IfFalse      IfTrue
+//      .....        ====>          LoopHeader'  LoopHeader
+//   If(cond)                           |            |
+//      .....                         ....(false)  ....(true)
+//        |                             |            |
+//    LoopMerge                     LoopMerge'   LoopMerge
+//        |                           +-------+-------+
+//        S                                 IfMerge
+//                                             |
+//                                             S
+//
+// The loop is only unswitched when all its control flow can be duplicated , ie no
+// return , trap or jump out of the loop. The loop variant nodes , which depend on
+// the phi , the effect merge or the effect chain of the loop , are duplicated into
+// the new loop while the invariant nodes are shared by both loops. The value that
+// is alive after the loop is merged by the phi of LoopMerge , so the phi is moved
+// to the new IfMerge and 2 new phis are created at each LoopMerge. The same goes to
+// the effect merge of LoopMerge.
+//
+// The condition of the unswitched branch is replaced with constant in both loops
+// and DCE is used to fold them after all loops are unswitched.
+class LoopUnswitcher {
+ public:
+  LoopUnswitcher( Graph* graph , std::size_t max_loop_size , std::size_t max_total_size ):
+    graph_        (graph),
+    max_loop_size_(max_loop_size),
+    budget_       (max_total_size),
+    temp_zone_    (),
+    block_        (&temp_zone_),
+    chain_        (&temp_zone_),
+    state_        (&temp_zone_),
+    cf_list_      (&temp_zone_),
+    expr_list_    (&temp_zone_),
+    cf_map_       (&temp_zone_),
+    expr_map_     (&temp_zone_)
+  {}
+
+  // returns true when any loop is unswitched
+  bool Run();
+
+ private:
+  enum { UNKNOWN = 0 , VISITING , INVARIANT , VARIANT };
+
+  // unswitch the first loop that has a loop invariant branch
+  bool UnswitchOne();
+  // collect all the control flow of the loop , returns false if the loop has
+  // control flow that cannot be duplicated
+  bool CollectBlock( LoopAnalyze::LoopNode* );
+  // collect the effect chain and all the loop variant nodes of the loop
+  bool CollectExpr ( LoopAnalyze::LoopNode* );
+  bool IsVariant   ( Expr* );
+  // find a branch whose condition is loop invariant
+  If*  FindBranch  ();
+  void Unswitch    ( LoopAnalyze::LoopNode* , If* );
+
+  bool InBlock( ControlFlow* cf ) const {
+    return cf->id() < block_.size() && block_[cf->id()];
+  }
+
+  // duplicate of the node , the invariant node is not duplicated
+  ControlFlow* Map( ControlFlow* );
+  Expr*        Map( Expr*        );
+
+  ControlFlow* NewBlock    ( ControlFlow* );
+  PhiBase*     NewPhi      ( PhiBase*     );
+  Expr*        NewExpr     ( Expr*        );
+  static bool  IsCloneable ( Expr*        );
+
+ private:
+  Graph*                                 graph_;
+  std::size_t                            max_loop_size_;
+  std::size_t                            budget_;
+  zone::Zone                             temp_zone_;
+  zone::stl::BitSet                      block_;     // blocks of the loop
+  zone::stl::BitSet                      chain_;     // effect chain of the loop
+  zone::stl::ZoneVector<std::uint8_t>    state_;     // variant state of expression
+  zone::stl::ZoneVector<ControlFlow*>    cf_list_;   // blocks of the loop
+  zone::stl::ZoneVector<Expr*>           expr_list_; // variant nodes , operand first
+  zone::stl::ZoneVector<ControlFlow*>    cf_map_;
+  zone::stl::ZoneVector<Expr*>           expr_map_;
+};
+
+bool LoopUnswitcher::Run() {
+  bool changed = false;
+  while(UnswitchOne()) changed = true;
+  // fold the branch whose condition is replaced with constant
+  if(changed) DCE().Perform(graph_,HIRPass::NORMAL);
+  return changed;
+}
+
+bool LoopUnswitcher::UnswitchOne() {
+  LoopAnalyze la(&temp_zone_,*graph_);
+  for( auto &lp : la.parent_list() ) {
+    lava_foreach( auto n , LoopAnalyze::LoopNodeRDIterator(lp,&la) ) {
+      if(!n->loop_header() || !n->loop_merge()) continue;
+      if(!CollectBlock(n) || !CollectExpr(n)) continue;
+
+      auto br = FindBranch();
+      if(!br) continue;
+
+      // duplicated nodes , the phi at the loop merge is duplicated twice
+      auto size = cf_list_.size() + expr_list_.size() +
+                  n->loop_merge()->phi_list()->size() * 2;
+      if(size > max_loop_size_ || size > budget_) continue;
+
+      budget_ -= size;
+      Unswitch(n,br);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool LoopUnswitcher::CollectBlock( LoopAnalyze::LoopNode* node ) {
+  auto header = node->loop_header();
+  auto merge  = node->loop_merge();
+
+  if(header->backward_edge()->size() != 1) return false;
+
+  block_.assign(graph_->MaxID(),false);
+  cf_list_.clear();
+
+  // every block reached from the loop header before the loop merge is inside of
+  // the loop
+  block_[header->id()] = true;
+  cf_list_.push_back(header);
+
+  for( std::size_t i = 0 ; i < cf_list_.size() ; ++i ) {
+    auto cf = cf_list_[i];
+    switch(cf->type()) {
+      case HIR_LOOP_HEADER: case HIR_LOOP: case HIR_LOOP_EXIT: case HIR_LOOP_MERGE:
+      case HIR_IF: case HIR_IF_TRUE: case HIR_IF_FALSE: case HIR_IF_MERGE:
+      case HIR_REGION:
+        break;
+      default:
+        return false;
+    }
+    if(cf == merge) continue;
+
+    lava_foreach( auto next , cf->forward_edge()->GetForwardIterator() ) {
+      if(!block_[next->id()]) {
+        block_[next->id()] = true;
+        cf_list_.push_back(next);
+      }
+    }
+  }
+
+  // nothing enters the loop other than the loop header
+  for( auto cf : cf_list_ ) {
+    if(cf == header) continue;
+    lava_foreach( auto prev , cf->backward_edge()->GetForwardIterator() ) {
+      if(!block_[prev->id()]) return false;
+    }
+  }
+  return block_[merge->id()];
+}
+
+bool LoopUnswitcher::CollectExpr( LoopAnalyze::LoopNode* node ) {
+  auto start = node->loop_body()->set_loop_effect_start();
+  auto merge = node->loop_merge();
+  zone::stl::ZoneVector<WriteEffect*> stack(&temp_zone_);
+  zone::stl::ZoneVector<Expr*>        root (&temp_zone_);
+
+  if(start->operand_list()->size() != 2) return false;
+
+  chain_.assign(graph_->MaxID(),false);
+  state_.assign(graph_->MaxID(),UNKNOWN);
+  expr_list_.clear();
+
+  // 1. walk the effect chain from the end of the loop body back to the start , the
+  //    chain must not go out of the loop. The effect of the pre-header is part of
+  //    the loop since the pre-header is duplicated with the loop
+  chain_[start->id()] = true;
+  root.push_back(start);
+  stack.push_back(start->rhs_effect());
+  if(auto pre = node->loop_body()->pre_header(); pre) {
+    chain_[pre->branch_start_effect()->id()] = true;
+    root.push_back(pre->branch_start_effect());
+  }
+
+  while(!stack.empty()) {
+    auto w = stack.back();
+    stack.pop_back();
+    if(chain_[w->id()]) continue;
+    chain_[w->id()] = true;
+    root.push_back(w);
+
+    if(w->Is<EffectMergeBase>()) {
+      auto region = w->As<EffectMergeBase>()->region();
+      if(!region || region == merge || !InBlock(region)) return false;
+      stack.push_back(w->As<EffectMergeBase>()->lhs_effect());
+      stack.push_back(w->As<EffectMergeBase>()->rhs_effect());
+    } else if(w->Is<InitBarrier>()) {
+      return false;
+    } else {
+      stack.push_back(w->NextWrite());
+    }
+  }
+
+  // 2. the phi , the effect merge and the data input of the blocks inside of the
+  //    loop. The phi and effect merge of the loop merge is handled when the loop
+  //    is unswitched
+  for( auto cf : cf_list_ ) {
+    lava_foreach( auto o , cf->operand_list()->GetForwardIterator() ) root.push_back(o);
+    if(cf == merge) continue;
+    if(cf->Is<Merge>()) {
+      auto phi_list = cf->As<Merge>()->phi_list();
+      for( std::size_t i = 0 ; i < phi_list->size() ; ++i ) root.push_back(phi_list->Index(i));
+    }
+    if(cf->Is<EffectMergeRegion>()) {
+      auto em_list = cf->As<EffectMergeRegion>()->effect_merge_list();
+      for( std::size_t i = 0 ; i < em_list->size() ; ++i ) root.push_back(em_list->Index(i));
+    }
+  }
+
+  {
+    auto phi_list = merge->phi_list();
+    for( std::size_t i = 0 ; i < phi_list->size() ; ++i ) {
+      auto phi = phi_list->Index(i);
+      if(!phi->Is<Phi>()) return false;
+      lava_foreach( auto o , phi->operand_list()->GetForwardIterator() ) root.push_back(o);
+    }
+  }
+
+  // the read effect is rooted by its write effect , the phi and effect merge are
+  // not visited by IsVariant so their operands are rooted here
+  zone::stl::BitSet visited(&temp_zone_,false,graph_->MaxID());
+  for( std::size_t i = 0 ; i < root.size() ; ++i ) {
+    auto n = root[i];
+    if(visited[n->id()]) continue;
+    visited[n->id()] = true;
+    if(n->Is<WriteEffect>() && chain_[n->id()]) {
+      lava_foreach( auto r , n->As<WriteEffect>()->read_effect()->GetForwardIterator() ) {
+        root.push_back(r);
+      }
+    }
+    if(n->Is<PhiBase>() || n->Is<EffectMergeBase>()) {
+      lava_foreach( auto o , n->operand_list()->GetForwardIterator() ) root.push_back(o);
+    }
+  }
+
+  for( auto n : root ) IsVariant(n);
+
+  // 3. all the variant node must be duplicated
+  for( auto n : expr_list_ ) {
+    if(!IsCloneable(n)) return false;
+    // write effect not in the loop's effect chain
+    if(n->Is<WriteEffect>() && !chain_[n->id()]) return false;
+  }
+  return true;
+}
+
+bool LoopUnswitcher::IsVariant( Expr* node ) {
+  auto &st = state_[node->id()];
+  if(st == VISITING || st == INVARIANT) return false;
+  if(st == VARIANT) return true;
+
+  bool variant = false;
+  if(node->Is<PhiBase>()) {
+    auto region = node->As<PhiBase>()->region();
+    variant = region && InBlock(region);
+  } else if(node->Is<EffectMergeBase>()) {
+    variant = chain_[node->id()];
+  } else {
+    st = VISITING;
+    variant = node->Is<WriteEffect>() && chain_[node->id()];
+    if(node->Is<ReadEffect>()) {
+      auto w = node->As<ReadEffect>()->write_effect();
+      if(w && chain_[w->id()]) variant = true;
+    }
+    lava_foreach( auto o , node->operand_list()->GetForwardIterator() ) {
+      if(IsVariant(o)) variant = true;
+    }
+  }
+
+  // the phi and the effect merge are pushed before their operands , it is fine
+  // since they are pre-created before any other node
+  state_[node->id()] = variant ? VARIANT : INVARIANT;
+  if(variant) expr_list_.push_back(node);
+  return variant;
+}
+
+If* LoopUnswitcher::FindBranch() {
+  for( auto cf : cf_list_ ) {
+    if(!cf->Is<If>()) continue;
+    auto cond = cf->As<If>()->condition();
+    bool bval;
+    if(state_[cond->id()] == VARIANT || GetBooleanValue(cond,&bval))
+      continue;
+    return cf->As<If>();
+  }
+  return NULL;
+}
+
+ControlFlow* LoopUnswitcher::Map( ControlFlow* cf ) {
+  if(!cf || cf->id() >= cf_map_.size() || !cf_map_[cf->id()]) return cf;
+  return cf_map_[cf->id()];
+}
+
+Expr* LoopUnswitcher::Map( Expr* node ) {
+  if(node->id() >= expr_map_.size()) return node;
+  if(auto n = expr_map_[node->id()]; n) return n;
+  if(state_[node->id()] != VARIANT) return node;
+
+  auto n = NewExpr(node);
+  expr_map_[node->id()] = n;
+  return n;
+}
+
+ControlFlow* LoopUnswitcher::NewBlock( ControlFlow* cf ) {
+  auto zone = graph_->zone();
+  switch(cf->type()) {
+    case HIR_LOOP_HEADER: return LoopHeader::New(graph_,NULL);
+    case HIR_LOOP:        return Loop::New(graph_);
+    case HIR_LOOP_EXIT:   return LoopExit::New(graph_,cf->As<LoopExit>()->condition());
+    case HIR_LOOP_MERGE:  return LoopMerge::New(graph_);
+    case HIR_IF:          return If::New(graph_,cf->As<If>()->condition(),NULL);
+    case HIR_IF_TRUE:     return zone->New<IfTrue> (graph_,graph_->AssignID(),nullptr);
+    case HIR_IF_FALSE:    return zone->New<IfFalse>(graph_,graph_->AssignID(),nullptr);
+    case HIR_IF_MERGE:    return IfMerge::New(graph_);
+    case HIR_REGION:      return Region::New(graph_);
+    default: lava_die(); return NULL;
+  }
+}
+
+PhiBase* LoopUnswitcher::NewPhi( PhiBase* phi ) {
+  switch(phi->type()) {
+    case HIR_PHI:             return Phi::New(graph_);
+    case HIR_LOOP_IV:         return LoopIV::New(graph_);
+    case HIR_LOOP_IV_INT64:   return LoopIVInt64::New(graph_);
+    case HIR_LOOP_IV_FLOAT64: return LoopIVFloat64::New(graph_);
+    case HIR_FLOAT64_PHI:     return Float64Phi::New(graph_);
+    default: lava_die(); return NULL;
+  }
+}
+
+bool LoopUnswitcher::IsCloneable( Expr* node ) {
+  switch(node->type()) {
+    case HIR_PHI: case HIR_LOOP_IV: case HIR_LOOP_IV_INT64: case HIR_LOOP_IV_FLOAT64:
+    case HIR_FLOAT64_PHI:
+    case HIR_EFFECT_MERGE: case HIR_LOOP_EFFECT_START:
+    case HIR_BRANCH_START_EFFECT: case HIR_EMPTY_WRITE_EFFECT:
+    case HIR_BOX: case HIR_UNBOX:
+    case HIR_CONV_BOOLEAN: case HIR_CONV_NBOOLEAN:
+    case HIR_FLOAT64_TO_INT64: case HIR_INT64_TO_FLOAT64:
+    case HIR_UNARY: case HIR_FLOAT64_NEGATE: case HIR_BOOLEAN_NOT:
+    case HIR_ARITHMETIC: case HIR_COMPARE: case HIR_LOGICAL: case HIR_TERNARY:
+    case HIR_INT64_ARITHMETIC: case HIR_FLOAT64_ARITHMETIC: case HIR_FLOAT64_BITWISE:
+    case HIR_FLOAT64_COMPARE: case HIR_INT64_COMPARE: case HIR_STRING_COMPARE:
+    case HIR_SSTRING_EQ: case HIR_SSTRING_NE: case HIR_BOOLEAN_LOGIC:
+    case HIR_PGET: case HIR_PSET: case HIR_IGET: case HIR_ISET:
+    case HIR_OBJECT_FIND: case HIR_LIST_INDEX:
+    case HIR_OBJECT_REF_GET: case HIR_OBJECT_REF_SET:
+    case HIR_LIST_REF_GET: case HIR_LIST_REF_SET:
+    case HIR_GGET: case HIR_GSET:
+    case HIR_ICALL: case HIR_LIST: case HIR_OBJECT: case HIR_OBJECT_KV:
+    case HIR_ITR_NEW: case HIR_ITR_NEXT: case HIR_ITR_TEST: case HIR_ITR_DEREF:
+    case HIR_PROJECTION:
+    case HIR_TEST_TYPE: case HIR_GUARD: case HIR_CHECKPOINT: case HIR_STACK_SLOT:
+      return true;
+    default:
+      return false;
+  }
+}
+
+Expr* LoopUnswitcher::NewExpr( Expr* node ) {
+  auto m = [=]( std::size_t index ) { return Map(node->Operand(index)); };
+  auto op= [=]() { return dynamic_cast<BinaryNode*>(node)->op(); };
+
+  switch(node->type()) {
+    case HIR_BRANCH_START_EFFECT: return BranchStartEffect::New(graph_);
+    case HIR_EMPTY_WRITE_EFFECT:  return EmptyWriteEffect::New(graph_);
+
+    case HIR_BOX:   return Box::New  (graph_,m(0),node->As<Box>  ()->type_kind());
+    case HIR_UNBOX: return Unbox::New(graph_,m(0),node->As<Unbox>()->type_kind());
+    case HIR_CONV_BOOLEAN:     return ConvBoolean::New   (graph_,m(0));
+    case HIR_CONV_NBOOLEAN:    return ConvNBoolean::New  (graph_,m(0));
+    case HIR_FLOAT64_TO_INT64: return Float64ToInt64::New(graph_,m(0));
+    case HIR_INT64_TO_FLOAT64: return Int64ToFloat64::New(graph_,m(0));
+
+    case HIR_UNARY:          return Unary::New(graph_,m(0),node->As<Unary>()->op());
+    case HIR_FLOAT64_NEGATE: return Float64Negate::New(graph_,m(0));
+    case HIR_BOOLEAN_NOT:    return BooleanNot::New   (graph_,m(0));
+
+    case HIR_ARITHMETIC:         return Arithmetic::New       (graph_,m(0),m(1),op());
+    case HIR_COMPARE:            return Compare::New          (graph_,m(0),m(1),op());
+    case HIR_LOGICAL:            return Logical::New          (graph_,m(0),m(1),op());
+    case HIR_INT64_ARITHMETIC:   return Int64Arithmetic::New  (graph_,m(0),m(1),op());
+    case HIR_FLOAT64_ARITHMETIC: return Float64Arithmetic::New(graph_,m(0),m(1),op());
+    case HIR_FLOAT64_BITWISE:    return Float64Bitwise::New   (graph_,m(0),m(1),op());
+    case HIR_FLOAT64_COMPARE:    return Float64Compare::New   (graph_,m(0),m(1),op());
+    case HIR_INT64_COMPARE:      return Int64Compare::New     (graph_,m(0),m(1),op());
+    case HIR_STRING_COMPARE:     return StringCompare::New    (graph_,m(0),m(1),op());
+    case HIR_BOOLEAN_LOGIC:      return BooleanLogic::New     (graph_,m(0),m(1),op());
+    case HIR_SSTRING_EQ:         return SStringEq::New        (graph_,m(0),m(1));
+    case HIR_SSTRING_NE:         return SStringNe::New        (graph_,m(0),m(1));
+    case HIR_TERNARY:            return Ternary::New          (graph_,m(0),m(1),m(2));
+
+    case HIR_PGET:        return PGet::New        (graph_,m(0),m(1));
+    case HIR_PSET:        return PSet::New        (graph_,m(0),m(1),m(2));
+    case HIR_IGET:        return IGet::New        (graph_,m(0),m(1));
+    case HIR_ISET:        return ISet::New        (graph_,m(0),m(1),m(2));
+    case HIR_OBJECT_FIND: return ObjectFind::New  (graph_,m(0),m(1));
+    case HIR_LIST_INDEX:
+      {
+        auto n = ListIndex::New(graph_,m(0),m(1));
+        n->set_bound_check(node->As<ListIndex>()->bound_check());
+        return n;
+      }
+    case HIR_OBJECT_REF_GET: return ObjectRefGet::New(graph_,m(0));
+    case HIR_OBJECT_REF_SET: return ObjectRefSet::New(graph_,m(0),m(1));
+    case HIR_LIST_REF_GET:   return ListRefGet::New  (graph_,m(0));
+    case HIR_LIST_REF_SET:   return ListRefSet::New  (graph_,m(0),m(1));
+    case HIR_GGET:           return GGet::New        (graph_,m(0));
+    case HIR_GSET:           return GSet::New        (graph_,m(0),m(1));
+
+    case HIR_ICALL:
+      {
+        auto ic = node->As<ICall>();
+        auto n  = ICall::New(graph_,ic->ic(),ic->tail_call());
+        for( std::size_t i = 0 ; i < ic->operand_list()->size() ; ++i ) n->AddArgument(m(i));
+        return n;
+      }
+    case HIR_LIST:
+      {
+        auto n = IRList::New(graph_,node->operand_list()->size());
+        for( std::size_t i = 0 ; i < node->operand_list()->size() ; ++i ) n->Add(m(i));
+        return n;
+      }
+    case HIR_OBJECT:
+      {
+        auto n = IRObject::New(graph_,node->operand_list()->size());
+        for( std::size_t i = 0 ; i < node->operand_list()->size() ; ++i ) n->AddOperand(m(i));
+        return n;
+      }
+    case HIR_OBJECT_KV: return IRObjectKV::New(graph_,m(0),m(1));
+
+    case HIR_ITR_NEW:   return ItrNew::New  (graph_,m(0));
+    case HIR_ITR_NEXT:  return ItrNext::New (graph_,m(0));
+    case HIR_ITR_TEST:  return ItrTest::New (graph_,m(0));
+    case HIR_ITR_DEREF: return ItrDeref::New(graph_,m(0));
+    case HIR_PROJECTION:
+      return Projection::New(graph_,m(0),node->As<Projection>()->index());
+
+    case HIR_TEST_TYPE:
+      return TestType::New(graph_,node->As<TestType>()->type_kind(),m(0));
+    case HIR_GUARD:
+      {
+        auto n = Guard::New(graph_,m(0)->As<Test>(),m(1)->As<Checkpoint>());
+        // the guard is also an operand of the fail node
+        lava_foreach( auto &r , node->ref_list()->GetForwardIterator() ) {
+          if(r.node->Is<Fail>()) {
+            r.node->As<Fail>()->AddOperand(n);
+            break;
+          }
+        }
+        return n;
+      }
+    case HIR_CHECKPOINT:
+      {
+        auto n = Checkpoint::New(graph_,node->As<Checkpoint>()->ir_info());
+        for( std::size_t i = 0 ; i < node->operand_list()->size() ; ++i ) n->AddOperand(m(i));
+        return n;
+      }
+    case HIR_STACK_SLOT:
+      return StackSlot::New(graph_,m(0),node->As<StackSlot>()->index());
+    default:
+      lava_die(); return NULL;
+  }
+}
+
+void LoopUnswitcher::Unswitch( LoopAnalyze::LoopNode* node , If* branch ) {
+  auto header = node->loop_header();
+  auto merge  = node->loop_merge()->As<EffectMergeRegion>();
+  auto start  = node->loop_body()->set_loop_effect_start();
+  auto parent = header->parent();
+  auto cond   = branch->condition();
+  auto pre    = node->loop_body()->pre_header();
+  // effect before entering the loop
+  auto effect = pre ? pre->branch_start_effect()->NextWrite() : start->lhs_effect();
+
+  cf_map_.assign  (graph_->MaxID(),NULL);
+  expr_map_.assign(graph_->MaxID(),NULL);
+
+  // 1. the hoisted branch , the true side goes to the old loop and the false side
+  //    goes to the new loop
+  auto hif     = If::New(graph_,cond,NULL);
+  auto if_merge= IfMerge::New(graph_);
+  parent->ReplaceForwardEdge(header,hif);
+  auto if_false= IfFalse::New(graph_,hif);
+  auto if_true = IfTrue::New (graph_,hif);
+  auto bs_true = BranchStartEffect::New(graph_,effect);
+  auto bs_false= BranchStartEffect::New(graph_,effect);
+  if_true ->set_branch_start_effect(bs_true);
+  if_false->set_branch_start_effect(bs_false);
+  hif->set_merge(if_merge);
+
+  // the effect before the loop may be used as a value , ie the dynamic comparison
+  // of the loop header , so it is only replaced when it is used as an effect
+  auto map_effect = [&]( Expr* w ) -> WriteEffect* {
+    return (w->IsIdentical(effect) ? bs_false : Map(w))->As<WriteEffect>();
+  };
+
+  // 2. duplicate the blocks along with the phi and the effect merge , they are
+  //    created before other nodes since they may be referenced by loop carried
+  //    value
+  for( auto cf : cf_list_ ) {
+    auto n = NewBlock(cf);
+    cf_map_[cf->id()] = n;
+    if(cf == merge) continue;
+
+    if(cf->Is<Merge>()) {
+      auto phi_list = cf->As<Merge>()->phi_list();
+      for( std::size_t i = 0 ; i < phi_list->size() ; ++i ) {
+        auto phi = phi_list->Index(i);
+        auto p   = NewPhi(phi);
+        n->As<Merge>()->AddPhi(p);
+        expr_map_[phi->id()] = p;
+      }
+    }
+    if(cf->Is<EffectMergeRegion>()) {
+      auto em_list = cf->As<EffectMergeRegion>()->effect_merge_list();
+      for( std::size_t i = 0 ; i < em_list->size() ; ++i ) {
+        auto em = em_list->Index(i);
+        EffectMergeBase* e;
+        if(em->Is<LoopEffectStart>())
+          e = graph_->zone()->New<LoopEffectStart>(graph_,graph_->AssignID());
+        else
+          e = EffectMerge::New(graph_);
+        n->As<EffectMergeRegion>()->AddEffectMerge(e);
+        expr_map_[em->id()] = e;
+      }
+    }
+  }
+
+  // 3. duplicate all the loop variant nodes and fix the operand of phi and effect
+  //    merge , the write effect is linked into the new effect chain
+  for( auto n : expr_list_ ) {
+    auto c = Map(n);
+    if(n->Is<PhiBase>()) {
+      lava_foreach( auto o , n->operand_list()->GetForwardIterator() ) {
+        c->AddOperand(Map(o));
+      }
+    } else if(n->Is<EffectMergeBase>()) {
+      lava_foreach( auto o , n->operand_list()->GetForwardIterator() ) {
+        c->AddOperand(map_effect(o));
+      }
+    } else if(n->Is<WriteEffect>()) {
+      c->As<WriteEffect>()->HappenAfter(map_effect(n->As<WriteEffect>()->NextWrite()));
+    }
+    if(n->Is<ReadEffect>()) {
+      if(auto w = n->As<ReadEffect>()->write_effect(); w)
+        c->As<ReadEffect>()->SetWriteEffect(map_effect(w));
+    }
+  }
+
+  // 4. data input and edges of the duplicated blocks , the order of edges is kept
+  for( auto cf : cf_list_ ) {
+    auto n = Map(cf);
+    n->ClearOperand();
+    lava_foreach( auto o , cf->operand_list()->GetForwardIterator() ) {
+      n->AddOperand(Map(o));
+    }
+    lava_foreach( auto prev , cf->backward_edge()->GetForwardIterator() ) {
+      if(InBlock(prev)) n->AddBackwardEdgeOnly(Map(prev));
+    }
+    lava_foreach( auto next , cf->forward_edge()->GetForwardIterator() ) {
+      if(InBlock(next)) n->AddForwardEdgeOnly(Map(next));
+    }
+    if(cf->Is<LoopHeader>())
+      n->As<LoopHeader>()->set_merge(Map(cf->As<LoopHeader>()->merge()));
+    else if(cf->Is<Loop>())
+      n->As<Loop>()->set_loop_exit(Map(cf->As<Loop>()->loop_exit())->As<LoopExit>());
+    else if(cf->Is<If>())
+      n->As<If>()->set_merge(Map(cf->As<If>()->merge()));
+  }
+
+  // 5. link both loops into the hoisted branch
+  auto new_header = Map(header);
+  auto new_merge  = Map(merge)->As<EffectMergeRegion>();
+  header    ->AddBackwardEdge(if_true );
+  new_header->AddBackwardEdge(if_false);
+  if(pre)
+    pre->branch_start_effect()->HappenAfter(bs_true);
+  else
+    start->ReplaceOperand(0,bs_true);
+
+  {
+    zone::stl::ZoneVector<ControlFlow*> succ(&temp_zone_);
+    lava_foreach( auto next , merge->forward_edge()->GetForwardIterator() ) {
+      succ.push_back(next);
+    }
+    for( auto next : succ ) next->ReplaceBackwardEdge(merge,if_merge);
+  }
+  if_merge->AddBackwardEdge(new_merge);
+  if_merge->AddBackwardEdge(merge);
+
+  // 6. the phi and effect merge of the loop merge are moved to the if merge and
+  //    each loop merge gets its own copy
+  {
+    zone::stl::ZoneVector<PhiBase*> phi_list(&temp_zone_);
+    for( std::size_t i = 0 ; i < merge->phi_list()->size() ; ++i )
+      phi_list.push_back(merge->phi_list()->Index(i));
+
+    for( auto phi : phi_list ) {
+      auto lhs = Phi::New(graph_);
+      auto rhs = Phi::New(graph_);
+      lava_foreach( auto o , phi->operand_list()->GetForwardIterator() ) {
+        lhs->AddOperand(Map(o));
+        rhs->AddOperand(o);
+      }
+      new_merge->AddPhi(lhs);
+      merge->ReplacePhi(phi,rhs);
+      phi->ResetRegion();
+      phi->ClearOperand();
+      phi->AddOperand(lhs);
+      phi->AddOperand(rhs);
+      if_merge->AddPhi(phi);
+    }
+  }
+  {
+    zone::stl::ZoneVector<EffectMergeBase*> em_list(&temp_zone_);
+    for( std::size_t i = 0 ; i < merge->effect_merge_list()->size() ; ++i )
+      em_list.push_back(merge->effect_merge_list()->Index(i));
+
+    for( auto em : em_list ) {
+      auto lhs = EffectMerge::New(graph_);
+      auto rhs = EffectMerge::New(graph_);
+      lava_foreach( auto o , em->operand_list()->GetForwardIterator() ) {
+        lhs->AddOperand(map_effect(o));
+        rhs->AddOperand(o->IsIdentical(effect) ? bs_true : o);
+      }
+      new_merge->AddEffectMerge(lhs);
+      merge->ReplaceEffectMerge(em,rhs);
+      em->ResetRegion();
+      em->ClearOperand();
+      em->set_lhs_effect(lhs);
+      em->set_rhs_effect(rhs);
+      if_merge->AddEffectMerge(em);
+    }
+  }
+
+  // 7. the condition is known inside of each loop
+  for( auto cf : cf_list_ ) {
+    if(!cf->Is<If>() || !cf->As<If>()->condition()->IsIdentical(cond)) continue;
+    auto n = Map(cf);
+    cf->ClearOperand();
+    cf->AddOperand(Boolean::New(graph_,true));
+    n ->ClearOperand();
+    n ->AddOperand(Boolean::New(graph_,false));
+  }
+}
+
+} // namespace
+
+bool LoopUnswitch::Perform( Graph* graph , HIRPass::Flag flag ) {
+  (void)flag;
+  LoopUnswitcher(graph,max_loop_size_,max_total_size_).Run();
+  return true;
+}
+
+} // namespace hir
+} // namespace cbase
+} // namespace lavascript
@@ -0,0 +1,45 @@
+#ifndef CBASE_PASS_LOOP_UNSWITCH_H_
+#define CBASE_PASS_LOOP_UNSWITCH_H_
+#include "src/cbase/hir-pass.h"
+
+#include <cstddef>
+
+namespace lavascript {
+namespace cbase      {
+namespace hir        {
+
+class Graph;
+
+/**
+ * Loop unswitching
+ *
+ * A branch inside of a loop whose condition is loop invariant is hoisted in front
+ * of the loop and the loop is duplicated into both sides of the hoisted branch. In
+ * each copy the condition is a known constant , so the branch is folded by DCE and
+ * the loop body doesn't test the condition anymore. A loop is only duplicated when
+ * its size , the number of control flow and loop variant nodes , is under budget ,
+ * and the total number of duplicated nodes of a graph is bounded as well.
+ */
+class LoopUnswitch : public HIRPass {
+ public:
+  static const std::size_t kMaxLoopSize  = 256;  // max nodes of a loop to be duplicated
+  static const std::size_t kMaxTotalSize = 1024; // max nodes duplicated in a graph
+
+  virtual bool Perform( Graph* , HIRPass::Flag );
+
+  LoopUnswitch( std::size_t max_loop_size  = kMaxLoopSize ,
+                std::size_t max_total_size = kMaxTotalSize ):
+    HIRPass        ("loop-unswitch"),
+    max_loop_size_ (max_loop_size),
+    max_total_size_(max_total_size)
+  {}
+ private:
+  std::size_t max_loop_size_;
+  std::size_t max_total_size_;
+};
+
+} // namespace hir
+} // namespace cbase
+} // namespace lavascript
+
+#endif // CBASE_PASS_LOOP_UNSWITCH_H_
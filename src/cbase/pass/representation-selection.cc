@@ -0,0 +1,350 @@
+#include "representation-selection.h"
+#include "dce.h"
+#include "src/cbase/hir.h"
+#include "src/cbase/fold/fold-box.h"
+#include "src/zone/stl.h"
+#include "src/zone/zone.h"
+
+namespace lavascript {
+namespace cbase      {
+namespace hir        {
+namespace            {
+
+// The candidates of float64 representation are the untyped phis and loop induction
+// variables , and the dynamic arithmetic in between. A candidate is selected when
+// each of its operands is a number , ie a typed float64 or int64 node , or another
+// selected candidate. We start with all candidates selected and drop the ones that
+// have any other operand until nothing changes , so a cycle of loop carried values
+// is selected as a whole when it only starts from numbers.
+//
+// A phi is also judged by its uses : when each of its operands is boxed already or
+// is a constant , and none of its uses takes a number , it is dropped since
+// converting it just adds an unbox to each operand and a box to each use.
+//
+// The arithmetic of two numbers always produces a float64 , so the selected
+// arithmetic is specialized into Float64Arithmetic and the selected phi becomes
+// Float64Phi. An int64 operand is converted by Int64ToFloat64.
+//
+// At last a box that is only unboxed again is bypassed :
+//
+// 1) the boxed operand of a typed phi (LoopIVInt64/LoopIVFloat64/Float64Phi)
+// 2) unbox of a box or of a node that is already unboxed
+// 3) the boxed boolean condition of a branch
+class RepresentationSelector {
+ public:
+  RepresentationSelector( Graph* graph ):
+    graph_    (graph),
+    temp_zone_(),
+    expr_list_(&temp_zone_),
+    visited_  (&temp_zone_),
+    selected_ (&temp_zone_),
+    value_    (&temp_zone_)
+  {}
+
+  // returns true when the graph is changed
+  bool Run();
+
+ private:
+  typedef zone::stl::ZoneVector<Expr*> ExprList;
+
+  void CollectExpr();
+
+  // the representation of a node that is known to be a number , TPKIND_UNKNOWN
+  // is returned for any other node
+  static TypeKind GetRepresentation( Expr* );
+  static bool     IsCandidate      ( Expr* );
+
+  // whether the phi gains from float64 , see the comment of the class
+  bool IsNumberPhi( Expr* ) const;
+
+  bool IsSelected( Expr* node ) const {
+    return node->id() < selected_.size() && selected_[node->id()];
+  }
+
+  // select the float64 candidates , returns true if any is selected
+  bool  Select   ();
+  Expr* Convert  ( Expr* );
+  Expr* ToFloat64( Expr* );
+
+  bool RemoveBox();
+
+  Graph*                       graph_;
+  zone::Zone                   temp_zone_;
+  ExprList                     expr_list_;
+  zone::stl::BitSet            visited_;
+  zone::stl::BitSet            selected_;
+  ExprList                     value_;     // float64 node of each selected candidate
+};
+
+void RepresentationSelector::CollectExpr() {
+  expr_list_.clear();
+  visited_.assign(graph_->MaxID(),false);
+
+  auto collect = [&]( Expr* node ) {
+    if(visited_[node->id()]) return;
+    visited_[node->id()] = true;
+    expr_list_.push_back(node);
+  };
+
+  lava_foreach( auto cf , ControlFlowRPOIterator(&temp_zone_,*graph_) ) {
+    lava_foreach( auto o , cf->operand_list()->GetForwardIterator() ) collect(o);
+    if(cf->Is<Merge>()) {
+      auto phi_list = cf->As<Merge>()->phi_list();
+      for( std::size_t i = 0 ; i < phi_list->size() ; ++i ) collect(phi_list->Index(i));
+    }
+    if(cf->Is<EffectMergeRegion>()) {
+      auto em_list = cf->As<EffectMergeRegion>()->effect_merge_list();
+      for( std::size_t i = 0 ; i < em_list->size() ; ++i ) collect(em_list->Index(i));
+    }
+  }
+
+  // the list grows while it is visited
+  for( std::size_t i = 0 ; i < expr_list_.size() ; ++i ) {
+    auto node = expr_list_[i];
+    lava_foreach( auto o , node->operand_list()->GetForwardIterator() ) collect(o);
+    lava_foreach( auto d , node->GetDependencyIterator() ) collect(d);
+    lava_foreach( auto &r , node->ref_list()->GetForwardIterator() ) {
+      if(r.node->Is<Expr>()) collect(r.node->As<Expr>());
+    }
+  }
+}
+
+TypeKind RepresentationSelector::GetRepresentation( Expr* node ) {
+  switch(node->type()) {
+    case HIR_FLOAT64:
+    case HIR_FLOAT64_NEGATE:
+    case HIR_FLOAT64_ARITHMETIC:
+    case HIR_FLOAT64_BITWISE:
+    case HIR_INT64_TO_FLOAT64:
+    case HIR_LOOP_IV_FLOAT64:
+    case HIR_FLOAT64_PHI:
+      return TPKIND_FLOAT64;
+    case HIR_INT64:
+    case HIR_INT64_ARITHMETIC:
+    case HIR_FLOAT64_TO_INT64:
+    case HIR_LOOP_IV_INT64:
+      return TPKIND_INT64;
+    case HIR_BOX: case HIR_UNBOX:
+      {
+        auto tk = node->Is<Box>() ? node->As<Box>()->type_kind() :
+                                    node->As<Unbox>()->type_kind();
+        return tk == TPKIND_FLOAT64 || tk == TPKIND_INT64 ? tk : TPKIND_UNKNOWN;
+      }
+    default:
+      return TPKIND_UNKNOWN;
+  }
+}
+
+bool RepresentationSelector::IsCandidate( Expr* node ) {
+  if(node->Is<Phi>() || node->Is<LoopIV>()) return true;
+  if(node->Is<Arithmetic>()) {
+    // float64 modulo and power are not supported by the backend
+    auto op = node->As<Arithmetic>()->op();
+    return op == Binary::ADD || op == Binary::SUB || op == Binary::MUL || op == Binary::DIV;
+  }
+  return false;
+}
+
+bool RepresentationSelector::IsNumberPhi( Expr* node ) const {
+  // an operand which is a number but not a constant has to be boxed to flow
+  // into a boxed phi , an unbox operand has its boxed value around already
+  lava_foreach( auto o , node->operand_list()->GetForwardIterator() ) {
+    if(IsSelected(o)) return true;
+    if(GetRepresentation(o) != TPKIND_UNKNOWN && !o->Is<Float64>() &&
+                                                 !o->Is<Int64>()   &&
+                                                 !o->Is<Unbox>())
+      return true;
+  }
+  lava_foreach( auto &r , node->ref_list()->GetForwardIterator() ) {
+    auto user = r.node;
+    if(!user->Is<Expr>()) continue;
+    if(IsSelected(user->As<Expr>())) return true;
+    switch(user->type()) {
+      case HIR_LOOP_IV_FLOAT64: case HIR_FLOAT64_PHI:
+        return true;
+      case HIR_UNBOX:
+        if(GetRepresentation(user->As<Expr>()) != TPKIND_UNKNOWN) return true;
+        break;
+      default:
+        break;
+    }
+  }
+  return false;
+}
+
+bool RepresentationSelector::Select() {
+  ExprList candidate_list(&temp_zone_);
+  selected_.assign(graph_->MaxID(),false);
+
+  for( auto n : expr_list_ ) {
+    if(IsCandidate(n)) {
+      selected_[n->id()] = true;
+      candidate_list.push_back(n);
+    }
+  }
+
+  bool changed;
+  do {
+    changed = false;
+    for( auto n : candidate_list ) {
+      if(!selected_[n->id()]) continue;
+      if((n->Is<Phi>() || n->Is<LoopIV>()) && !IsNumberPhi(n)) {
+        selected_[n->id()] = false;
+        changed = true;
+        continue;
+      }
+      lava_foreach( auto o , n->operand_list()->GetForwardIterator() ) {
+        if(!IsSelected(o) && GetRepresentation(o) == TPKIND_UNKNOWN) {
+          selected_[n->id()] = false;
+          changed = true;
+          break;
+        }
+      }
+    }
+  } while(changed);
+
+  for( auto n : candidate_list ) {
+    if(selected_[n->id()]) return true;
+  }
+  return false;
+}
+
+Expr* RepresentationSelector::ToFloat64( Expr* node ) {
+  if(IsSelected(node)) return Convert(node);
+  if(GetRepresentation(node) == TPKIND_INT64)
+    return Int64ToFloat64::New(graph_,NewUnboxNode(graph_,node,TPKIND_INT64));
+  return NewUnboxNode(graph_,node,TPKIND_FLOAT64);
+}
+
+Expr* RepresentationSelector::Convert( Expr* node ) {
+  if(auto v = value_[node->id()]; v) return v;
+
+  if(node->Is<PhiBase>()) {
+    auto phi  = node->As<PhiBase>();
+    auto nphi = Float64Phi::New(graph_);
+    // set it before visiting the operands since the phi can be reached again
+    // through its loop carried operand
+    value_[node->id()] = nphi;
+
+    ExprList operand(&temp_zone_);
+    lava_foreach( auto o , phi->operand_list()->GetForwardIterator() ) operand.push_back(o);
+
+    phi->region()->ReplacePhi(phi,nphi);
+    phi->Replace(nphi);
+    for( auto o : operand ) nphi->AddOperand(ToFloat64(o));
+    return nphi;
+  }
+
+  auto arith = node->As<Arithmetic>();
+  // convert the selected operands at first , the arithmetic itself may have been
+  // converted when the cycle is closed through them
+  lava_foreach( auto o , arith->operand_list()->GetForwardIterator() ) {
+    if(IsSelected(o)) Convert(o);
+  }
+  if(auto v = value_[node->id()]; v) return v;
+
+  auto nnode = Float64Arithmetic::New(graph_,ToFloat64(arith->lhs()),
+                                             ToFloat64(arith->rhs()),arith->op());
+  value_[node->id()] = nnode;
+  arith->Replace(nnode);
+  return nnode;
+}
+
+bool RepresentationSelector::RemoveBox() {
+  bool changed = false;
+
+  // typed phis use the unboxed operand directly
+  auto strip = [&]( Expr* node , TypeKind tk ) {
+    for( std::size_t i = 0 ; i < node->OperandSize() ; ++i ) {
+      auto o = node->Operand(i);
+      if(o->Is<Box>() && o->As<Box>()->type_kind() == tk) {
+        node->ReplaceOperand(i,o->As<Box>()->value());
+        changed = true;
+      }
+    }
+  };
+
+  for( auto n : expr_list_ ) {
+    if(IsSelected(n)) continue;  // replaced
+
+    switch(n->type()) {
+      case HIR_LOOP_IV_INT64:
+        strip(n,TPKIND_INT64);
+        break;
+      case HIR_LOOP_IV_FLOAT64: case HIR_FLOAT64_PHI:
+        strip(n,TPKIND_FLOAT64);
+        break;
+      case HIR_UNBOX:
+        {
+          auto unbox = n->As<Unbox>();
+          auto value = unbox->value();
+          if(value->Is<Box>() && value->As<Box>()->type_kind() == unbox->type_kind()) {
+            unbox->Replace(value->As<Box>()->value());
+            changed = true;
+          } else if(!value->Is<Box>() && !value->Is<Unbox>() &&
+                    GetRepresentation(value) == unbox->type_kind()) {
+            unbox->Replace(value);
+            changed = true;
+          }
+        }
+        break;
+      case HIR_BOX:
+        {
+          // unbox float64 is a move of the same bits , but int64 and boolean are not
+          auto box   = n->As<Box>();
+          auto value = box->value();
+          if(box->type_kind() == TPKIND_FLOAT64 && value->Is<Unbox>() &&
+                                 value->As<Unbox>()->type_kind() == TPKIND_FLOAT64) {
+            box->Replace(value->As<Unbox>()->value());
+            changed = true;
+          }
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  // branch on the unboxed boolean directly
+  lava_foreach( auto cf , ControlFlowRPOIterator(&temp_zone_,*graph_) ) {
+    if(!cf->Is<If>() && !cf->Is<LoopHeader>() && !cf->Is<LoopExit>()) continue;
+    if(cf->operand_list()->size() != 1) continue;
+    auto cond = cf->operand_list()->First();
+    if(cond->Is<Box>() && cond->As<Box>()->type_kind() == TPKIND_BOOLEAN) {
+      auto value = cond->As<Box>()->value();
+      cf->RemoveOperand(cond);
+      cf->AddOperand(value);
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+bool RepresentationSelector::Run() {
+  bool changed = false;
+  CollectExpr();
+
+  if(Select()) {
+    value_.assign(graph_->MaxID(),NULL);
+    for( auto n : expr_list_ ) {
+      if(IsSelected(n)) Convert(n);
+    }
+    changed = true;
+  }
+
+  if(RemoveBox()) changed = true;
+  if(changed) DCE().Perform(graph_,HIRPass::NORMAL);
+  return changed;
+}
+
+} // namespace
+
+bool RepresentationSelection::Perform( Graph* graph , HIRPass::Flag flag ) {
+  (void)flag;
+  RepresentationSelector(graph).Run();
+  return true;
+}
+
+} // namespace hir
+} // namespace cbase
+} // namespace lavascript
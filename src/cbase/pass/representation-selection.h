@@ -0,0 +1,35 @@
+#ifndef CBASE_PASS_REPRESENTATION_SELECTION_H_
+#define CBASE_PASS_REPRESENTATION_SELECTION_H_
+#include "src/cbase/hir-pass.h"
+
+namespace lavascript {
+namespace cbase      {
+namespace hir        {
+
+class Graph;
+
+/**
+ * Representation selection
+ *
+ * Phis and loop induction variables are created in boxed form , so a loop carried
+ * number is boxed and unboxed again in every iteration , and the dynamic arithmetic
+ * that computes it cannot be specialized since the type of the phi is unknown.
+ *
+ * This pass picks the float64 representation for a phi when all its inputs are
+ * numbers , assuming optimistically that the phis and the arithmetic in a cycle
+ * are numbers until one of their inputs proves otherwise. The phi becomes a
+ * Float64Phi and the arithmetic becomes Float64Arithmetic so the loop stays in
+ * float64 registers. A boxed value that is only unboxed again , ie the input of
+ * a typed phi , an unbox or a branch condition , uses the unboxed value directly.
+ */
+class RepresentationSelection : public HIRPass {
+ public:
+  virtual bool Perform( Graph* , HIRPass::Flag );
+  RepresentationSelection() : HIRPass("representation-selection") {}
+};
+
+} // namespace hir
+} // namespace cbase
+} // namespace lavascript
+
+#endif // CBASE_PASS_REPRESENTATION_SELECTION_H_
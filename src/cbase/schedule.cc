@@ -0,0 +1,302 @@
+#include "schedule.h"
+#include "dominators.h"
+#include "loop-analyze.h"
+
+#include <algorithm>
+
+namespace lavascript {
+namespace cbase      {
+namespace hir        {
+
+Schedule::Schedule( zone::Zone* zone , const Graph& graph ):
+  zone_       (zone),
+  block_list_ (zone),
+  block_index_(zone,kNotScheduled,static_cast<std::size_t>(graph.MaxID())),
+  idom_       (zone),
+  depth_      (zone),
+  loop_depth_ (zone),
+  node_block_ (zone,NULL,graph.MaxID()),
+  node_list_  (zone),
+  node_order_ (zone,0,static_cast<std::size_t>(graph.MaxID())),
+  pinned_     (zone,false,static_cast<std::size_t>(graph.MaxID())),
+  order_      (0)
+{
+  BuildBlockList(graph);
+  BuildDominator(graph);
+  BuildLoopDepth(graph);
+
+  // 1. pin all the nodes that belong to a certain block , they must be in the
+  //    node list of the block before any floating node
+  for( auto cf : block_list_ ) PinBlock(cf);
+
+  // 2. schedule all floating nodes reachable from the pinned nodes and blocks
+  for( auto cf : block_list_ ) ScheduleRoots(cf);
+
+  // 3. move the pure nodes down to their uses and out of loops
+  ScheduleLate();
+}
+
+void Schedule::BuildBlockList( const Graph& graph ) {
+  // iterative DFS along the forward edges , the post order is reversed at last
+  struct Frame {
+    ControlFlow* node;
+    std::size_t  next;
+  };
+  zone::stl::ZoneVector<Frame> stack(zone_);
+  zone::stl::BitSet visited(zone_,false,graph.MaxID());
+
+  stack.push_back({graph.start(),0});
+  visited[graph.start()->id()] = true;
+
+  while(!stack.empty()) {
+    auto& top = stack.back();
+    auto  cf  = top.node;
+    if(top.next < cf->forward_edge()->size()) {
+      auto succ = cf->Out(top.next++);
+      if(!visited[succ->id()]) {
+        visited[succ->id()] = true;
+        stack.push_back({succ,0});
+      }
+    } else {
+      block_list_.push_back(cf);
+      stack.pop_back();
+    }
+  }
+
+  std::reverse(block_list_.begin(),block_list_.end());
+  for( std::size_t i = 0 ; i < block_list_.size() ; ++i ) {
+    block_index_[block_list_[i]->id()] = static_cast<std::uint32_t>(i);
+    node_list_.push_back(zone_->New<NodeList>(zone_));
+  }
+}
+
+void Schedule::BuildDominator( const Graph& graph ) {
+  // the dominator tree is indexed by block so the common dominator of 2 blocks
+  // is found by walking up along the tree , in reverse post order a dominator
+  // always has a smaller index
+  Dominators dom(zone_,graph);
+  const std::size_t size = block_list_.size();
+  idom_.assign (size,0);
+  depth_.assign(size,0);
+  for( std::size_t i = 1 ; i < size ; ++i ) {
+    auto idom = dom.GetImmDominator(block_list_[i]);
+    lava_debug(NORMAL,lava_verify(idom););
+    idom_[i]  = GetBlockIndex(idom);
+    lava_debug(NORMAL,lava_verify(idom_[i] < i););
+    depth_[i] = depth_[idom_[i]] + 1;
+  }
+}
+
+void Schedule::BuildLoopDepth( const Graph& graph ) {
+  // LoopAnalyze puts the LoopHeader , the pre-header and the LoopMerge into the
+  // loop they start and end , but they run once per loop like the pre-header and
+  // the exit block of a natural loop , so they are in the loop nest of the parent
+  LoopAnalyze la(zone_,graph);
+  const std::size_t size = block_list_.size();
+  loop_depth_.assign(size,0);
+  for( std::size_t i = 0 ; i < size ; ++i ) {
+    auto cf = block_list_[i];
+    if(auto ln = la.GetLoopNode(cf); ln) {
+      auto depth = static_cast<std::uint32_t>(ln->depth());
+      if(cf->Is<LoopHeader>() || cf->Is<LoopMerge>() ||
+         (ln->loop_body() && ln->loop_body()->pre_header() == cf))
+        --depth;
+      loop_depth_[i] = depth;
+    }
+  }
+}
+
+void Schedule::Place( Expr* node , ControlFlow* cf ) {
+  node_block_[node->id()] = cf;
+  node_order_[node->id()] = order_++;
+  if(!node->Is<PhiBase>()) node_list_[GetBlockIndex(cf)]->push_back(node);
+}
+
+void Schedule::Pin( Expr* node , ControlFlow* cf ) {
+  lava_debug(NORMAL,lava_verify(!GetBlock(node)););
+  pinned_[node->id()] = true;
+  Place(node,cf);
+}
+
+void Schedule::PinBlock( ControlFlow* cf ) {
+  if(cf->Is<Start>()) {
+    Pin(cf->As<Start>()->init_barrier(),cf);
+  } else if(cf->Is<IfTrue>() || cf->Is<IfFalse>()) {
+    if(!cf->operand_list()->empty()) Pin(cf->operand_list()->First(),cf);
+  }
+
+  if(cf->Is<Merge>()) {
+    auto phi_list = cf->As<Merge>()->phi_list();
+    for( std::size_t i = 0 ; i < phi_list->size() ; ++i ) Pin(phi_list->Index(i),cf);
+  }
+
+  if(cf->Is<EffectMergeRegion>()) {
+    auto em_list = cf->As<EffectMergeRegion>()->effect_merge_list();
+    for( std::size_t i = 0 ; i < em_list->size() ; ++i ) Pin(em_list->Index(i),cf);
+  }
+}
+
+void Schedule::ScheduleRoots( ControlFlow* cf ) {
+  lava_foreach( auto n , cf->operand_list()->GetForwardIterator() ) {
+    ScheduleEarly(n);
+  }
+
+  // operands and dependencies of the pinned nodes , the phi nodes' operands
+  // are placed in the predecessor blocks so they are also roots here
+  auto& list = *node_list_[GetBlockIndex(cf)];
+  for( std::size_t i = 0 ; i < list.size() ; ++i ) {
+    auto n = list[i];
+    if(!n->Is<EffectMergeBase>()) {
+      lava_foreach( auto d , n->GetDependencyIterator() ) ScheduleEarly(d);
+    } else {
+      lava_foreach( auto o , n->operand_list()->GetForwardIterator() ) ScheduleEarly(o);
+    }
+  }
+
+  if(cf->Is<Merge>()) {
+    auto phi_list = cf->As<Merge>()->phi_list();
+    for( std::size_t i = 0 ; i < phi_list->size() ; ++i ) {
+      lava_foreach( auto o , phi_list->Index(i)->operand_list()->GetForwardIterator() ) {
+        ScheduleEarly(o);
+      }
+    }
+  }
+}
+
+void Schedule::ScheduleEarly( Expr* root ) {
+  if(root->Is<Checkpoint>() || GetBlock(root)) return;
+
+  // iterative post order visit , a node is placed after all its inputs are
+  // placed ; the inputs of the node on top of the stack are kept in the input
+  // buffer , starting at Frame::start
+  struct Frame {
+    Expr*       node;
+    std::size_t start;
+    std::size_t next;
+  };
+  zone::stl::ZoneVector<Frame> stack (zone_);
+  zone::stl::ZoneVector<Expr*> inputs(zone_);
+
+  auto push = [&]( Expr* node ) {
+    std::size_t start = inputs.size();
+    lava_foreach( auto o , node->operand_list()->GetForwardIterator() ) {
+      if(!o->Is<Checkpoint>()) {
+        inputs.push_back(o);
+      } else if(node->Is<Guard>()) {
+        // the frame captured by the guard's checkpoint is materialized when
+        // the guard fails , so its values are inputs of the guard
+        lava_foreach( auto slot , o->operand_list()->GetForwardIterator() ) {
+          if(slot->Is<StackSlot>()) inputs.push_back(slot->As<StackSlot>()->expr());
+        }
+      }
+    }
+    lava_foreach( auto d , node->GetDependencyIterator() ) {
+      inputs.push_back(d);
+    }
+    // mark the node as visiting by placing it at start temporarily , a
+    // cycle can only go through phi node which is always pinned
+    node_block_[node->id()] = block_list_.front();
+    stack.push_back({node,start,start});
+  };
+
+  push(root);
+
+  while(!stack.empty()) {
+    auto& top = stack.back();
+    if(top.next < inputs.size()) {
+      auto in = inputs[top.next++];
+      if(!GetBlock(in)) push(in);
+      continue;
+    }
+
+    // all inputs are placed , find the deepest block among them
+    ControlFlow* block = block_list_.front();
+    for( std::size_t i = top.start ; i < inputs.size() ; ++i ) {
+      auto b = GetBlock(inputs[i]);
+      if(GetDepth(b) > GetDepth(block)) block = b;
+    }
+    Place(top.node,block);
+
+    inputs.resize(top.start);
+    stack.pop_back();
+  }
+}
+
+bool Schedule::IsFloating( Expr* node ) const {
+  return !pinned_[node->id()] && !node->Is<PhiBase>() && !node->Is<EffectNode>() &&
+         !node->HasDependency();
+}
+
+std::uint32_t Schedule::CommonDominator( std::uint32_t a , std::uint32_t b ) const {
+  while(a != b) {
+    while(depth_[a] > depth_[b]) a = idom_[a];
+    while(depth_[b] > depth_[a]) b = idom_[b];
+    if(a != b) { a = idom_[a]; b = idom_[b]; }
+  }
+  return a;
+}
+
+void Schedule::ScheduleLate() {
+  zone::stl::ZoneVector<Expr*> node_list(zone_);
+  for( auto l : node_list_ ) {
+    node_list.insert(node_list.end(),l->begin(),l->end());
+    l->clear();
+  }
+
+  // a node is placed after all its operands in schedule early , so visiting
+  // in reverse placing order sees all uses of a node before the node
+  auto cmp = [this]( Expr* l , Expr* r ) { return node_order_[l->id()] < node_order_[r->id()]; };
+  std::sort(node_list.begin(),node_list.end(),cmp);
+
+  for( auto itr = node_list.rbegin() ; itr != node_list.rend() ; ++itr ) {
+    auto node = *itr;
+    if(!IsFloating(node)) continue;
+
+    // lowest common dominator of all the uses , the use of a phi is at the end
+    // of the predecessor the value flows from
+    auto lca = kNotScheduled;
+    auto add = [&]( std::uint32_t idx ) {
+      if(idx == kNotScheduled) return;
+      lca = (lca == kNotScheduled) ? idx : CommonDominator(lca,idx);
+    };
+
+    lava_foreach( auto &r , node->ref_list()->GetForwardIterator() ) {
+      auto user = r.node;
+      if(user->Is<ControlFlow>()) {
+        add(GetBlockIndex(user->As<ControlFlow>()));
+      } else if(user->Is<PhiBase>()) {
+        auto phi    = user->As<PhiBase>();
+        auto region = GetBlock(phi);
+        if(!region) continue;
+        for( std::size_t i = 0 ; i < phi->OperandSize() ; ++i ) {
+          if(phi->Operand(i) == node && i < region->backward_edge()->size())
+            add(GetBlockIndex(region->In(i)));
+        }
+      } else if(auto b = GetBlock(user->As<Expr>())) {
+        add(GetBlockIndex(b));
+      }
+    }
+    if(lca == kNotScheduled) continue;
+
+    // walk up to the early block and take the one with the shallowest loop
+    // nest , the lower one wins when the nest is the same
+    auto early = GetBlockIndex(GetBlock(node));
+    auto best  = lca;
+    auto cur   = lca;
+    while(cur != early && cur != 0) {
+      cur = idom_[cur];
+      if(loop_depth_[cur] < loop_depth_[best]) best = cur;
+    }
+    // early doesn't dominate the uses , leave it where it is
+    if(cur != early) continue;
+    node_block_[node->id()] = block_list_[best];
+  }
+
+  for( auto node : node_list ) {
+    node_list_[GetBlockIndex(GetBlock(node))]->push_back(node);
+  }
+}
+
+} // namespace hir
+} // namespace cbase
+} // namespace lavascript
@@ -0,0 +1,116 @@
+#ifndef CBASE_SCHEDULE_H_
+#define CBASE_SCHEDULE_H_
+#include "hir.h"
+
+#include "src/zone/zone.h"
+#include "src/zone/stl.h"
+
+namespace lavascript {
+namespace cbase      {
+namespace hir        {
+
+// -----------------------------------------------------------------------
+// Schedule of the HIR graph for code generation.
+//
+// Only control flow nodes are ordered in the HIR graph , expression nodes
+// are floating. The schedule assigns each expression node reachable from
+// the control flow graph to a control flow node , called block here , and
+// orders the nodes inside of each block , so the backend can simply walk the
+// graph block by block.
+//
+// The blocks are in reverse post order of the forward edges starting from
+// the start node , a block always comes after its dominators. Phi nodes are
+// placed in their region , the effect markers (InitBarrier , BranchStartEffect,
+// EffectMerge and LoopEffectStart) are pinned to the control flow node they
+// belong to. The rest are placed by Click's global code motion :
+//
+//   1) schedule early , every node is placed into the deepest block in the
+//      dominator tree among the blocks of its operands and effect
+//      dependencies. Side effect nodes are chained by their effect
+//      dependencies so they keep their order , and they stay here.
+//
+//   2) schedule late , a pure node , ie no side effect and no dependency , is
+//      moved down to the lowest common dominator of its uses , then back up
+//      along the dominator tree to the block with the shallowest loop nest
+//      between the two. So a loop invariant is hoisted out of the loop , while
+//      a value only used in one branch is sunk into the branch.
+//
+// The dominator tree comes from Dominators and the loop nest from LoopAnalyze.
+//
+// Checkpoint is not scheduled since it only describes the interpreter frame ,
+// the values captured by a guard's checkpoint are scheduled as the guard's
+// inputs since they are needed when the guard deoptimizes.
+// -----------------------------------------------------------------------
+class Schedule {
+ public:
+  typedef zone::stl::ZoneVector<ControlFlow*> BlockList;
+  typedef zone::stl::ZoneVector<Expr*>        NodeList;
+
+  static const std::uint32_t kNotScheduled = static_cast<std::uint32_t>(-1);
+
+  Schedule( zone::Zone* , const Graph& );
+
+  // All blocks reachable from start in reverse post order
+  const BlockList& block_list() const { return block_list_; }
+
+  // Index of the block inside of the block list , kNotScheduled if the block
+  // is not reachable from start
+  std::uint32_t GetBlockIndex( const ControlFlow* cf ) const { return block_index_[cf->id()]; }
+
+  // The block the node is scheduled in , NULL if the node is not scheduled
+  ControlFlow* GetBlock( const Expr* node ) const { return node_block_[node->id()]; }
+
+  // Nodes scheduled inside of the block in execution order , phi nodes are
+  // not in the list since they are evaluated on the edges into the block
+  const NodeList& GetNodeList( const ControlFlow* cf ) const {
+    return *node_list_[GetBlockIndex(cf)];
+  }
+
+  // Dominator tree depth of the block , start is 0
+  std::uint32_t GetDepth( const ControlFlow* cf ) const { return depth_[GetBlockIndex(cf)]; }
+
+  // Immediate dominator of the block , NULL for start
+  ControlFlow* GetImmDominator( const ControlFlow* cf ) const {
+    auto idx = GetBlockIndex(cf);
+    return idx ? block_list_[idom_[idx]] : NULL;
+  }
+
+  // How many loops the block is nested in , 0 for block not in any loop
+  std::uint32_t GetLoopDepth( const ControlFlow* cf ) const {
+    return loop_depth_[GetBlockIndex(cf)];
+  }
+
+ private:
+  void BuildBlockList( const Graph& );
+  void BuildDominator( const Graph& );
+  void BuildLoopDepth( const Graph& );
+  void Pin           ( Expr* , ControlFlow* );
+  void PinBlock      ( ControlFlow* );
+  void ScheduleEarly ( Expr* );
+  void ScheduleRoots ( ControlFlow* );
+  void ScheduleLate  ();
+  bool IsFloating    ( Expr* ) const;
+  // lowest common dominator of 2 block index
+  std::uint32_t CommonDominator( std::uint32_t , std::uint32_t ) const;
+  void Place         ( Expr* , ControlFlow* );
+
+  zone::Zone*                            zone_;
+  BlockList                              block_list_;
+  zone::stl::ZoneVector<std::uint32_t>   block_index_;
+  zone::stl::ZoneVector<std::uint32_t>   idom_;
+  zone::stl::ZoneVector<std::uint32_t>   depth_;
+  zone::stl::ZoneVector<std::uint32_t>   loop_depth_;
+  zone::stl::ZoneVector<ControlFlow*>    node_block_;
+  zone::stl::ZoneVector<NodeList*>       node_list_;
+  zone::stl::ZoneVector<std::uint32_t>   node_order_;   // placing order
+  zone::stl::BitSet                      pinned_;
+  std::uint32_t                          order_;
+
+  LAVA_DISALLOW_COPY_AND_ASSIGN(Schedule)
+};
+
+} // namespace hir
+} // namespace cbase
+} // namespace lavascript
+
+#endif // CBASE_SCHEDULE_H_
@@ -83,6 +83,7 @@ TypeKind GetTypeInference( Expr* node ) {
     // normal high ir node which has implicit type
     case HIR_FLOAT64:            return TPKIND_FLOAT64;
     case HIR_LOOP_IV_FLOAT64:    return TPKIND_FLOAT64;
+    case HIR_FLOAT64_PHI:        return TPKIND_FLOAT64;
     case HIR_INT64_TO_FLOAT64:   return TPKIND_FLOAT64;
 
     case HIR_INT64:              return TPKIND_INT64;
@@ -112,7 +113,9 @@ TypeKind GetTypeInference( Expr* node ) {
     // lower HIR type translation
     case HIR_FLOAT64_NEGATE:     return TPKIND_FLOAT64;
     case HIR_FLOAT64_ARITHMETIC: return TPKIND_FLOAT64;
-    case HIR_FLOAT64_COMPARE:    return TPKIND_FLOAT64;
+    case HIR_FLOAT64_COMPARE:    return TPKIND_BOOLEAN;
+    case HIR_INT64_ARITHMETIC:   return TPKIND_INT64;
+    case HIR_INT64_COMPARE:      return TPKIND_BOOLEAN;
     case HIR_STRING_COMPARE:     return TPKIND_BOOLEAN;
     case HIR_SSTRING_EQ:         return TPKIND_BOOLEAN;
     case HIR_SSTRING_NE:         return TPKIND_BOOLEAN;
@@ -3,6 +3,7 @@
 #include "src/macro.h"
 #include "src/object-type.h"
 #include <vector>
+#include <cstddef>
 
 namespace lavascript {
 class Value;
@@ -0,0 +1,250 @@
+#include "assembler.h"
+
+namespace lavascript {
+namespace cbase      {
+namespace x64        {
+
+void Assembler::Emit32( std::uint32_t v ) {
+  for( int i = 0 ; i < 4 ; ++i ) Emit(static_cast<std::uint8_t>(v >> (i*8)));
+}
+
+void Assembler::Emit64( std::uint64_t v ) {
+  for( int i = 0 ; i < 8 ; ++i ) Emit(static_cast<std::uint8_t>(v >> (i*8)));
+}
+
+void Assembler::Patch32( std::size_t pos , std::uint32_t v ) {
+  for( int i = 0 ; i < 4 ; ++i ) buffer_[pos+i] = static_cast<std::uint8_t>(v >> (i*8));
+}
+
+void Assembler::Rex( bool w , int reg , int base , bool force ) {
+  std::uint8_t rex = static_cast<std::uint8_t>(0x40 | (w ? 8 : 0) | ((reg & 8) ? 4 : 0) |
+                                                                     ((base& 8) ? 1 : 0));
+  if(rex != 0x40 || force) Emit(rex);
+}
+
+void Assembler::ModRM( int reg , const Address& addr ) {
+  int base = addr.base & 7;
+  int mod;
+  // rbp/r13 as base has no mod 00 form , it means rip relative
+  if(addr.disp == 0 && base != RBP)
+    mod = 0;
+  else if(addr.disp >= -128 && addr.disp <= 127)
+    mod = 1;
+  else
+    mod = 2;
+
+  Emit(static_cast<std::uint8_t>((mod<<6)|((reg&7)<<3)|base));
+  // rsp/r12 as base needs SIB byte
+  if(base == RSP) Emit(0x24);
+  if(mod == 1)
+    Emit(static_cast<std::uint8_t>(addr.disp));
+  else if(mod == 2)
+    Emit32(static_cast<std::uint32_t>(addr.disp));
+}
+
+void Assembler::Bind( Label* label ) {
+  lava_debug(NORMAL,lava_verify(!label->IsBound()););
+  label->pos_ = static_cast<std::int32_t>(size());
+  for( auto pos : label->fixup_ ) {
+    Patch32(pos,static_cast<std::uint32_t>(label->pos_ - (pos + 4)));
+  }
+  label->fixup_.clear();
+}
+
+void Assembler::mov( Register dst , Register src ) {
+  Rex(true,src,dst);
+  Emit(0x89);
+  ModRM(src,dst);
+}
+
+void Assembler::mov( Register dst , const Address& src ) {
+  Rex(true,dst,src.base);
+  Emit(0x8b);
+  ModRM(dst,src);
+}
+
+void Assembler::mov( const Address& dst , Register src ) {
+  Rex(true,src,dst.base);
+  Emit(0x89);
+  ModRM(src,dst);
+}
+
+void Assembler::movi( Register dst , std::uint64_t imm ) {
+  if(imm <= 0xffffffff) {
+    // mov r32 , imm32 zero extends
+    Rex(false,0,dst);
+    Emit(static_cast<std::uint8_t>(0xb8 + (dst&7)));
+    Emit32(static_cast<std::uint32_t>(imm));
+  } else if(static_cast<std::int64_t>(imm) >= INT32_MIN &&
+            static_cast<std::int64_t>(imm) <= INT32_MAX) {
+    Rex(true,0,dst);
+    Emit(0xc7);
+    ModRM(0,dst);
+    Emit32(static_cast<std::uint32_t>(imm));
+  } else {
+    Rex(true,0,dst);
+    Emit(static_cast<std::uint8_t>(0xb8 + (dst&7)));
+    Emit64(imm);
+  }
+}
+
+void Assembler::movi( const Address& dst , std::int32_t imm ) {
+  Rex(true,0,dst.base);
+  Emit(0xc7);
+  ModRM(0,dst);
+  Emit32(static_cast<std::uint32_t>(imm));
+}
+
+void Assembler::lea( Register dst , const Address& src ) {
+  Rex(true,dst,src.base);
+  Emit(0x8d);
+  ModRM(dst,src);
+}
+
+void Assembler::Arith( std::uint8_t op , Register dst , Register src ) {
+  Rex(true,src,dst);
+  Emit(op);
+  ModRM(src,dst);
+}
+
+void Assembler::ArithImm( int digit , Register dst , std::int32_t imm ) {
+  Rex(true,0,dst);
+  if(imm >= -128 && imm <= 127) {
+    Emit(0x83);
+    ModRM(digit,dst);
+    Emit(static_cast<std::uint8_t>(imm));
+  } else {
+    Emit(0x81);
+    ModRM(digit,dst);
+    Emit32(static_cast<std::uint32_t>(imm));
+  }
+}
+
+void Assembler::imul( Register dst , Register src ) {
+  Rex(true,dst,src);
+  Emit(0x0f); Emit(0xaf);
+  ModRM(dst,src);
+}
+
+void Assembler::neg( Register dst ) {
+  Rex(true,0,dst);
+  Emit(0xf7);
+  ModRM(3,dst);
+}
+
+void Assembler::setcc( Condition cc , Register dst ) {
+  // without REX , 4-7 encode ah/ch/dh/bh instead of spl/bpl/sil/dil
+  Rex(false,0,dst,dst >= RSP);
+  Emit(0x0f); Emit(static_cast<std::uint8_t>(0x90 | cc));
+  ModRM(0,dst);
+}
+
+void Assembler::movzxb( Register dst , Register src ) {
+  Rex(true,dst,src);
+  Emit(0x0f); Emit(0xb6);
+  ModRM(dst,src);
+}
+
+void Assembler::cmov( Condition cc , Register dst , Register src ) {
+  Rex(true,dst,src);
+  Emit(0x0f); Emit(static_cast<std::uint8_t>(0x40 | cc));
+  ModRM(dst,src);
+}
+
+void Assembler::Jump( Label* label ) {
+  if(label->IsBound()) {
+    Emit32(static_cast<std::uint32_t>(label->pos_ - static_cast<std::int32_t>(size() + 4)));
+  } else {
+    label->fixup_.push_back(static_cast<std::int32_t>(size()));
+    Emit32(0);
+  }
+}
+
+void Assembler::jmp( Label* label ) {
+  Emit(0xe9);
+  Jump(label);
+}
+
+void Assembler::jcc( Condition cc , Label* label ) {
+  Emit(0x0f); Emit(static_cast<std::uint8_t>(0x80 | cc));
+  Jump(label);
+}
+
+void Assembler::call( Register reg ) {
+  Rex(false,0,reg);
+  Emit(0xff);
+  ModRM(2,reg);
+}
+
+void Assembler::push( Register reg ) {
+  Rex(false,0,reg);
+  Emit(static_cast<std::uint8_t>(0x50 + (reg&7)));
+}
+
+void Assembler::pop( Register reg ) {
+  Rex(false,0,reg);
+  Emit(static_cast<std::uint8_t>(0x58 + (reg&7)));
+}
+
+void Assembler::ret () { Emit(0xc3); }
+void Assembler::int3() { Emit(0xcc); }
+
+void Assembler::SSE( std::uint8_t prefix , std::uint8_t op , FPRegister dst ,
+                                                             FPRegister src ) {
+  Emit(prefix);
+  Rex(false,dst,src);
+  Emit(0x0f); Emit(op);
+  ModRM(dst,src);
+}
+
+void Assembler::movq( FPRegister dst , Register src ) {
+  Emit(0x66);
+  Rex(true,dst,src);
+  Emit(0x0f); Emit(0x6e);
+  ModRM(dst,src);
+}
+
+void Assembler::movq( Register dst , FPRegister src ) {
+  Emit(0x66);
+  Rex(true,src,dst);
+  Emit(0x0f); Emit(0x7e);
+  ModRM(src,dst);
+}
+
+void Assembler::movsd( FPRegister dst , const Address& src ) {
+  Emit(0xf2);
+  Rex(false,dst,src.base);
+  Emit(0x0f); Emit(0x10);
+  ModRM(dst,src);
+}
+
+void Assembler::movsd( const Address& dst , FPRegister src ) {
+  Emit(0xf2);
+  Rex(false,src,dst.base);
+  Emit(0x0f); Emit(0x11);
+  ModRM(src,dst);
+}
+
+void Assembler::movaps( FPRegister dst , FPRegister src ) {
+  Rex(false,dst,src);
+  Emit(0x0f); Emit(0x28);
+  ModRM(dst,src);
+}
+
+void Assembler::cvtsi2sd( FPRegister dst , Register src ) {
+  Emit(0xf2);
+  Rex(true,dst,src);
+  Emit(0x0f); Emit(0x2a);
+  ModRM(dst,src);
+}
+
+void Assembler::cvttsd2si( Register dst , FPRegister src ) {
+  Emit(0xf2);
+  Rex(true,dst,src);
+  Emit(0x0f); Emit(0x2c);
+  ModRM(dst,src);
+}
+
+} // namespace x64
+} // namespace cbase
+} // namespace lavascript
@@ -0,0 +1,162 @@
+#ifndef CBASE_X64_ASSEMBLER_H_
+#define CBASE_X64_ASSEMBLER_H_
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "src/util.h"
+
+namespace lavascript {
+namespace cbase      {
+namespace x64        {
+
+enum Register {
+  RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+  R8     , R9 , R10, R11, R12, R13, R14, R15
+};
+
+enum FPRegister {
+  XMM0 = 0, XMM1, XMM2 , XMM3 , XMM4 , XMM5 , XMM6 , XMM7 ,
+  XMM8    , XMM9, XMM10, XMM11, XMM12, XMM13, XMM14, XMM15
+};
+
+static const std::size_t kRegisterSize = 16;
+
+// condition code , the low nibble of jcc/setcc/cmovcc opcode
+enum Condition {
+  CC_O  = 0x0, CC_NO = 0x1, CC_B  = 0x2, CC_AE = 0x3,
+  CC_E  = 0x4, CC_NE = 0x5, CC_BE = 0x6, CC_A  = 0x7,
+  CC_S  = 0x8, CC_NS = 0x9, CC_P  = 0xa, CC_NP = 0xb,
+  CC_L  = 0xc, CC_GE = 0xd, CC_LE = 0xe, CC_G  = 0xf
+};
+
+inline Condition NegateCondition( Condition cc ) {
+  return static_cast<Condition>(cc ^ 1);
+}
+
+// [base + disp] memory operand
+struct Address {
+  Register     base;
+  std::int32_t disp;
+  explicit Address( Register b , std::int32_t d = 0 ) : base(b) , disp(d) {}
+};
+
+// A position in the code buffer , jumps to a label not yet bound are patched
+// once the label is bound
+class Label {
+ public:
+  Label() : pos_(-1) , fixup_() {}
+  bool IsBound() const { return pos_ >= 0; }
+  std::int32_t pos() const { return pos_; }
+ private:
+  std::int32_t pos_;
+  std::vector<std::int32_t> fixup_;   // position of rel32 to patch
+  friend class Assembler;
+  LAVA_DISALLOW_COPY_AND_ASSIGN(Label)
+};
+
+// -----------------------------------------------------------------------
+// A tiny x64 assembler for the cbase backend.
+//
+// The interpreter is written in DynAsm which needs the code layout fixed at
+// build time ; the backend emits code for each function on the fly so it uses
+// this assembler which just encodes the handful of instructions it needs into
+// a byte buffer. The code is position independent except absolute addresses
+// loaded via movi , so the buffer can be copied anywhere once finished.
+//
+// All general purpose instructions are 64 bits.
+// -----------------------------------------------------------------------
+class Assembler {
+ public:
+  Assembler() : buffer_() {}
+
+  const std::vector<std::uint8_t>& buffer() const { return buffer_; }
+  std::size_t size() const { return buffer_.size(); }
+
+  // Bind the label to the current position
+  void Bind( Label* );
+
+ public: // general purpose instructions
+  void mov ( Register dst , Register src );
+  void mov ( Register dst , const Address& src );
+  void mov ( const Address& dst , Register src );
+
+  // load immediate , uses the shortest encoding
+  void movi( Register dst , std::uint64_t imm );
+  // store sign extended 32 bits immediate
+  void movi( const Address& dst , std::int32_t imm );
+
+  void lea ( Register dst , const Address& src );
+
+  void add ( Register dst , Register src ) { Arith(0x01,dst,src); }
+  void or_ ( Register dst , Register src ) { Arith(0x09,dst,src); }
+  void and_( Register dst , Register src ) { Arith(0x21,dst,src); }
+  void sub ( Register dst , Register src ) { Arith(0x29,dst,src); }
+  void xor_( Register dst , Register src ) { Arith(0x31,dst,src); }
+  void cmp ( Register dst , Register src ) { Arith(0x39,dst,src); }
+  void test( Register dst , Register src ) { Arith(0x85,dst,src); }
+
+  void add ( Register dst , std::int32_t imm ) { ArithImm(0,dst,imm); }
+  void or_ ( Register dst , std::int32_t imm ) { ArithImm(1,dst,imm); }
+  void and_( Register dst , std::int32_t imm ) { ArithImm(4,dst,imm); }
+  void sub ( Register dst , std::int32_t imm ) { ArithImm(5,dst,imm); }
+  void xor_( Register dst , std::int32_t imm ) { ArithImm(6,dst,imm); }
+  void cmp ( Register dst , std::int32_t imm ) { ArithImm(7,dst,imm); }
+
+  void imul  ( Register dst , Register src );
+  void neg   ( Register dst );
+  void setcc ( Condition , Register dst );
+  void movzxb( Register dst , Register src );
+  void cmov  ( Condition , Register dst , Register src );
+
+  void jmp   ( Label* );
+  void jcc   ( Condition , Label* );
+  void call  ( Register );
+  void push  ( Register );
+  void pop   ( Register );
+  void ret   ();
+  void int3  ();
+
+ public: // SSE2 instructions
+  void movq    ( FPRegister dst , Register   src );
+  void movq    ( Register   dst , FPRegister src );
+  void movsd   ( FPRegister dst , const Address& src );
+  void movsd   ( const Address& dst , FPRegister src );
+  void movaps  ( FPRegister dst , FPRegister src );
+  void addsd   ( FPRegister dst , FPRegister src ) { SSE(0xf2,0x58,dst,src); }
+  void subsd   ( FPRegister dst , FPRegister src ) { SSE(0xf2,0x5c,dst,src); }
+  void mulsd   ( FPRegister dst , FPRegister src ) { SSE(0xf2,0x59,dst,src); }
+  void divsd   ( FPRegister dst , FPRegister src ) { SSE(0xf2,0x5e,dst,src); }
+  void ucomisd ( FPRegister dst , FPRegister src ) { SSE(0x66,0x2e,dst,src); }
+  void xorpd   ( FPRegister dst , FPRegister src ) { SSE(0x66,0x57,dst,src); }
+  void cvtsi2sd( FPRegister dst , Register   src );
+  void cvttsd2si( Register  dst , FPRegister src );
+
+ private:
+  void Emit  ( std::uint8_t b ) { buffer_.push_back(b); }
+  void Emit32( std::uint32_t );
+  void Emit64( std::uint64_t );
+  void Patch32( std::size_t pos , std::uint32_t );
+
+  // emit REX prefix , the prefix is omitted when it is 0x40 unless forced
+  void Rex( bool w , int reg , int base , bool force = false );
+  // ModRM for register direct operand
+  void ModRM( int reg , int rm ) { Emit(static_cast<std::uint8_t>(0xc0|((reg&7)<<3)|(rm&7))); }
+  // ModRM , SIB and displacement for memory operand
+  void ModRM( int reg , const Address& );
+
+  void Arith   ( std::uint8_t op , Register dst , Register src );
+  void ArithImm( int digit , Register dst , std::int32_t imm );
+  void SSE     ( std::uint8_t prefix , std::uint8_t op , FPRegister dst , FPRegister src );
+  void Jump    ( Label* );
+
+  std::vector<std::uint8_t> buffer_;
+
+  LAVA_DISALLOW_COPY_AND_ASSIGN(Assembler)
+};
+
+} // namespace x64
+} // namespace cbase
+} // namespace lavascript
+
+#endif // CBASE_X64_ASSEMBLER_H_
@@ -0,0 +1,51 @@
+#include "code-arena.h"
+#include "src/os.h"
+
+#include <cstring>
+#include <sys/mman.h>
+
+namespace lavascript {
+namespace cbase      {
+namespace x64        {
+
+CodeArena::CodeArena():
+  page_list_(),
+  cursor_   (NULL),
+  left_     (0),
+  code_size_(0)
+{}
+
+CodeArena::~CodeArena() {
+  for( auto &p : page_list_ ) OS::FreeCodePage(p.start,p.size);
+}
+
+bool CodeArena::Grow( std::size_t size ) {
+  std::size_t adjusted;
+  void* ptr = OS::CreateCodePage(size < kPageSize ? kPageSize : size,&adjusted);
+  if(ptr == MAP_FAILED) return false;
+  page_list_.push_back(Page(ptr,adjusted));
+  cursor_ = static_cast<std::uint8_t*>(ptr);
+  left_   = adjusted;
+  return true;
+}
+
+void* CodeArena::Install( const void* code , std::size_t size ) {
+  std::size_t aligned = Align(size,kAlign);
+  if(aligned > left_ && !Grow(aligned)) return NULL;
+
+  void* ret = cursor_;
+  memcpy(ret,code,size);
+  cursor_    += aligned;
+  left_      -= aligned;
+  code_size_ += size;
+  return ret;
+}
+
+CodeArena* CodeArena::GetInstance() {
+  static CodeArena kCodeArena;
+  return &kCodeArena;
+}
+
+} // namespace x64
+} // namespace cbase
+} // namespace lavascript
@@ -0,0 +1,60 @@
+#ifndef CBASE_X64_CODE_ARENA_H_
+#define CBASE_X64_CODE_ARENA_H_
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "src/util.h"
+
+namespace lavascript {
+namespace cbase      {
+namespace x64        {
+
+// -----------------------------------------------------------------------
+// Memory for machine code generated by the backend.
+//
+// Code is copied into executable pages got from OS::CreateCodePage and is
+// never freed before the process exits , the compiled function is cached in
+// the Prototype which may live as long as the process. Since the pages are
+// mapped with MAP_32BIT the generated code is near each other and near the
+// interpreter.
+// -----------------------------------------------------------------------
+class CodeArena {
+ public:
+  CodeArena();
+  ~CodeArena();
+
+  // Copy the code into the arena , returns NULL when out of memory
+  void* Install( const void* code , std::size_t size );
+
+  std::size_t code_size() const { return code_size_; }
+
+ public:
+  // Get the process wide instance
+  static CodeArena* GetInstance();
+
+ private:
+  struct Page {
+    void*       start;
+    std::size_t size;
+    Page( void* s , std::size_t sz ) : start(s) , size(sz) {}
+  };
+
+  bool Grow( std::size_t size );
+
+  std::vector<Page> page_list_;
+  std::uint8_t*     cursor_;
+  std::size_t       left_;
+  std::size_t       code_size_;
+
+  static const std::size_t kPageSize = 64 * 1024;
+  static const std::size_t kAlign    = 16;
+
+  LAVA_DISALLOW_COPY_AND_ASSIGN(CodeArena)
+};
+
+} // namespace x64
+} // namespace cbase
+} // namespace lavascript
+
+#endif // CBASE_X64_CODE_ARENA_H_
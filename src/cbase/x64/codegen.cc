@@ -0,0 +1,569 @@
+#include "codegen.h"
+#include "jit-runtime.h"
+#include "src/config.h"
+#include "src/objects.h"
+#include "src/cbase/hir.h"
+#include "src/interpreter/runtime.h"
+
+#include <utility>
+
+namespace lavascript {
+namespace cbase      {
+namespace x64        {
+using hir::Binary;
+
+namespace {
+
+// bytes pushed by prologue after the return address , rbp rbx r12 r13 r14 r15
+static const std::int32_t kPushSize = 6 * 8;
+
+// reserved slots , see RegisterAllocator::kReservedSlot
+static const std::uint32_t kLhsSlot  = 0;
+static const std::uint32_t kRhsSlot  = 1;
+static const std::uint32_t kOutSlot  = 2;
+static const std::uint32_t kTempSlot = 3;
+
+} // namespace
+
+CodeGenerator::CodeGenerator( const Function& func , const RegisterAllocator& ra ,
+                                                     Assembler* masm ):
+  func_       (func),
+  ra_         (ra),
+  masm_       (masm),
+  block_label_(func.block_id_size()),
+  slow_path_  (),
+  fail_       (),
+  exit_       (),
+  frame_size_ (0),
+  index_      (0)
+{
+  // keep rsp 16 bytes aligned after the pushes in prologue
+  frame_size_ = static_cast<std::int32_t>(ra.stack_slot_size() * 8);
+  if((frame_size_ + kPushSize + 8) % 16) frame_size_ += 8;
+}
+
+Register CodeGenerator::LoadGpr( VReg v , Register scratch ) {
+  auto loc = UseLoc(v);
+  switch(loc.kind) {
+    case Location::GPR: return loc.gpr();
+    case Location::FPR: masm_->movq(scratch,loc.fpr()); return scratch;
+    default:            masm_->mov (scratch,SlotAddress(loc.index)); return scratch;
+  }
+}
+
+FPRegister CodeGenerator::LoadFpr( VReg v , FPRegister scratch ) {
+  auto loc = UseLoc(v);
+  switch(loc.kind) {
+    case Location::FPR: return loc.fpr();
+    case Location::GPR: masm_->movq (scratch,loc.gpr()); return scratch;
+    default:            masm_->movsd(scratch,SlotAddress(loc.index)); return scratch;
+  }
+}
+
+void CodeGenerator::StoreGpr( VReg v , Register reg ) {
+  EmitMove(DefLoc(v),Location::Gpr(reg));
+}
+
+void CodeGenerator::StoreFpr( VReg v , FPRegister reg ) {
+  EmitMove(DefLoc(v),Location::Fpr(reg));
+}
+
+void CodeGenerator::EmitMove( const Location& dst , const Location& src ) {
+  if(dst == src) return;
+  switch(src.kind) {
+    case Location::GPR:
+      if(dst.IsGpr())      masm_->mov (dst.gpr(),src.gpr());
+      else if(dst.IsFpr()) masm_->movq(dst.fpr(),src.gpr());
+      else                 masm_->mov (SlotAddress(dst.index),src.gpr());
+      break;
+    case Location::FPR:
+      if(dst.IsGpr())      masm_->movq  (dst.gpr(),src.fpr());
+      else if(dst.IsFpr()) masm_->movaps(dst.fpr(),src.fpr());
+      else                 masm_->movsd (SlotAddress(dst.index),src.fpr());
+      break;
+    default:
+      if(dst.IsGpr())      masm_->mov  (dst.gpr(),SlotAddress(src.index));
+      else if(dst.IsFpr()) masm_->movsd(dst.fpr(),SlotAddress(src.index));
+      else {
+        masm_->mov(kScratch0,SlotAddress(src.index));
+        masm_->mov(SlotAddress(dst.index),kScratch0);
+      }
+      break;
+  }
+}
+
+void CodeGenerator::EmitParallelMove( const LocationMoveList& move_list ) {
+  std::vector<std::pair<Location,Location>> pending;  // dst , src
+  for( auto &m : move_list ) {
+    if(m.dst != m.src) pending.push_back(std::make_pair(m.dst,m.src));
+  }
+
+  const Location temp(Location::Stack(kTempSlot));
+
+  while(!pending.empty()) {
+    bool progress = false;
+    // emit a move whose destination is not read by any other pending move
+    for( std::size_t i = 0 ; i < pending.size() && !progress ; ++i ) {
+      bool read = false;
+      for( std::size_t j = 0 ; j < pending.size() ; ++j ) {
+        if(j != i && pending[j].second == pending[i].first) { read = true; break; }
+      }
+      if(!read) {
+        EmitMove(pending[i].first,pending[i].second);
+        pending.erase(pending.begin()+i);
+        progress = true;
+      }
+    }
+
+    // only cycles are left , save one destination to break the cycle
+    if(!progress) {
+      Location dst = pending.front().first;
+      EmitMove(temp,dst);
+      for( auto &p : pending ) {
+        if(p.second == dst) p.second = temp;
+      }
+    }
+  }
+}
+
+void CodeGenerator::EmitSave() {
+  if(auto list = ra_.call_save(index_)) {
+    for( std::size_t i = 0 ; i < list->size() ; ++i ) {
+      EmitMove(Location::Stack(ra_.save_slot(i)),(*list)[i]);
+    }
+  }
+}
+
+void CodeGenerator::EmitRestore() {
+  if(auto list = ra_.call_save(index_)) {
+    for( std::size_t i = 0 ; i < list->size() ; ++i ) {
+      EmitMove((*list)[i],Location::Stack(ra_.save_slot(i)));
+    }
+  }
+}
+
+void CodeGenerator::EmitCall( const void* fn ) {
+  masm_->movi(kScratch0,reinterpret_cast<std::uint64_t>(fn));
+  masm_->call(kScratch0);
+}
+
+void CodeGenerator::EmitRealCheck( Register lhs , Register rhs , Label* slow ) {
+  masm_->movi(kScratch2,Value::TAG_REAL);
+  masm_->cmp (lhs,kScratch2);
+  masm_->jcc (CC_AE,slow);
+  masm_->cmp (rhs,kScratch2);
+  masm_->jcc (CC_AE,slow);
+}
+
+void CodeGenerator::EmitF64Condition( int op , FPRegister lhs , FPRegister rhs ) {
+  switch(op) {
+    case Binary::LT: masm_->ucomisd(rhs,lhs); masm_->setcc(CC_A ,kScratch0); break;
+    case Binary::LE: masm_->ucomisd(rhs,lhs); masm_->setcc(CC_AE,kScratch0); break;
+    case Binary::GT: masm_->ucomisd(lhs,rhs); masm_->setcc(CC_A ,kScratch0); break;
+    case Binary::GE: masm_->ucomisd(lhs,rhs); masm_->setcc(CC_AE,kScratch0); break;
+    default:
+      // unordered sets ZF and PF , so NaN is never equal
+      masm_->ucomisd(lhs,rhs);
+      if(op == Binary::EQ) {
+        masm_->setcc(CC_E ,kScratch0);
+        masm_->setcc(CC_NP,kScratch2);
+      } else {
+        masm_->setcc(CC_NE,kScratch0);
+        masm_->setcc(CC_P ,kScratch2);
+      }
+      masm_->movzxb(kScratch0,kScratch0);
+      masm_->movzxb(kScratch2,kScratch2);
+      if(op == Binary::EQ) masm_->and_(kScratch0,kScratch2);
+      else                 masm_->or_ (kScratch0,kScratch2);
+      return;
+  }
+  masm_->movzxb(kScratch0,kScratch0);
+}
+
+void CodeGenerator::EmitI64Condition( int op , Register lhs , Register rhs ) {
+  Condition cc;
+  switch(op) {
+    case Binary::LT: cc = CC_L;  break;
+    case Binary::LE: cc = CC_LE; break;
+    case Binary::GT: cc = CC_G;  break;
+    case Binary::GE: cc = CC_GE; break;
+    case Binary::EQ: cc = CC_E;  break;
+    default:         cc = CC_NE; break;
+  }
+  masm_->cmp(lhs,rhs);
+  masm_->setcc(cc,kScratch0);
+  masm_->movzxb(kScratch0,kScratch0);
+}
+
+void CodeGenerator::EmitArith( const Instruction* instr ) {
+  slow_path_.emplace_back(instr,index_);
+  auto sp = &slow_path_.back();
+  auto op = static_cast<int>(instr->imm);
+
+  if(op == Binary::MOD || op == Binary::POW) {
+    masm_->jmp(&sp->entry);
+  } else {
+    auto lhs = LoadGpr(instr->use[0],kScratch0);
+    auto rhs = LoadGpr(instr->use[1],kScratch1);
+    EmitRealCheck(lhs,rhs,&sp->entry);
+    masm_->movq(kFPScratch0,lhs);
+    masm_->movq(kFPScratch1,rhs);
+    switch(op) {
+      case Binary::ADD: masm_->addsd(kFPScratch0,kFPScratch1); break;
+      case Binary::SUB: masm_->subsd(kFPScratch0,kFPScratch1); break;
+      case Binary::MUL: masm_->mulsd(kFPScratch0,kFPScratch1); break;
+      default:          masm_->divsd(kFPScratch0,kFPScratch1); break;
+    }
+    StoreFpr(instr->def,kFPScratch0);
+  }
+  masm_->Bind(&sp->exit);
+}
+
+void CodeGenerator::EmitCompare( const Instruction* instr ) {
+  slow_path_.emplace_back(instr,index_);
+  auto sp = &slow_path_.back();
+
+  auto lhs = LoadGpr(instr->use[0],kScratch0);
+  auto rhs = LoadGpr(instr->use[1],kScratch1);
+  EmitRealCheck(lhs,rhs,&sp->entry);
+  masm_->movq(kFPScratch0,lhs);
+  masm_->movq(kFPScratch1,rhs);
+  EmitF64Condition(static_cast<int>(instr->imm),kFPScratch0,kFPScratch1);
+
+  masm_->movi(kScratch1,Value::TAG_FALSE);
+  masm_->movi(kScratch2,Value::TAG_TRUE);
+  masm_->test(kScratch0,kScratch0);
+  masm_->cmov(CC_NE,kScratch1,kScratch2);
+  StoreGpr(instr->def,kScratch1);
+  masm_->Bind(&sp->exit);
+}
+
+void CodeGenerator::EmitGuard( const Instruction* instr ) {
+  slow_path_.emplace_back(instr,index_);
+  auto sp = &slow_path_.back();
+  auto v  = LoadGpr(instr->use[0],kScratch0);
+
+  switch(static_cast<TypeKind>(instr->imm)) {
+    case TPKIND_FLOAT64:
+      masm_->movi(kScratch2,Value::TAG_REAL);
+      masm_->cmp (v,kScratch2);
+      masm_->jcc (CC_AE,&sp->entry);
+      break;
+    case TPKIND_BOOLEAN:
+      masm_->movi(kScratch2,Value::TAG_TRUE);
+      masm_->cmp (v,kScratch2);
+      masm_->jcc (CC_E,&sp->exit);
+      masm_->movi(kScratch2,Value::TAG_FALSE);
+      masm_->cmp (v,kScratch2);
+      masm_->jcc (CC_NE,&sp->entry);
+      break;
+    default:
+      masm_->movi(kScratch2,Value::TAG_NULL);
+      masm_->cmp (v,kScratch2);
+      masm_->jcc (CC_NE,&sp->entry);
+      break;
+  }
+  masm_->Bind(&sp->exit);
+}
+
+void CodeGenerator::EmitDeopt( SlowPath* sp ) {
+  auto deopt = sp->instr->deopt;
+  index_     = sp->index;
+  masm_->Bind(&sp->entry);
+
+  // the slots are read at the guard and written into the interpreter frame ,
+  // they never overlap
+  for( auto &s : deopt->slot_list ) {
+    masm_->mov(Address(kStack,static_cast<std::int32_t>(s.index*8)),LoadGpr(s.value,kScratch0));
+  }
+  masm_->movi(kScratch0,reinterpret_cast<std::uint64_t>(deopt->pc));
+  masm_->mov (Address(kRuntime,interpreter::RuntimeLayout::kDeoptPCOffset),kScratch0);
+  masm_->movi(kScratch0,1);
+  masm_->jmp (&exit_);
+}
+
+void CodeGenerator::EmitSlowPath( SlowPath* sp ) {
+  auto instr = sp->instr;
+  index_      = sp->index;
+  masm_->Bind(&sp->entry);
+
+  masm_->mov (SlotAddress(kLhsSlot),LoadGpr(instr->use[0],kScratch0));
+  masm_->mov (SlotAddress(kRhsSlot),LoadGpr(instr->use[1],kScratch0));
+  EmitSave();
+  masm_->mov (RDI,kRuntime);
+  masm_->movi(RSI,instr->imm);
+  masm_->lea (RDX,SlotAddress(kLhsSlot));
+  masm_->lea (RCX,SlotAddress(kRhsSlot));
+  masm_->lea (R8 ,SlotAddress(kOutSlot));
+  if(instr->op == LIR_ARITH)
+    EmitCall(reinterpret_cast<const void*>(&JITArithmetic));
+  else
+    EmitCall(reinterpret_cast<const void*>(&JITCompare));
+
+  // the helper returns bool , only al is defined
+  masm_->movzxb(kScratch0,kScratch0);
+  masm_->test  (kScratch0,kScratch0);
+  masm_->jcc   (CC_E,&fail_);
+  masm_->mov   (kScratch0,SlotAddress(kOutSlot));
+  EmitRestore();
+  StoreGpr(instr->def,kScratch0);
+  masm_->jmp   (&sp->exit);
+}
+
+void CodeGenerator::EmitF64Arith( const Instruction* instr ) {
+  auto op  = static_cast<int>(instr->imm);
+  auto lhs = LoadFpr(instr->use[0],kFPScratch0);
+  if(lhs != kFPScratch0) masm_->movaps(kFPScratch0,lhs);
+  auto rhs = LoadFpr(instr->use[1],kFPScratch1);
+
+  switch(op) {
+    case Binary::ADD: masm_->addsd(kFPScratch0,rhs); break;
+    case Binary::SUB: masm_->subsd(kFPScratch0,rhs); break;
+    case Binary::MUL: masm_->mulsd(kFPScratch0,rhs); break;
+    case Binary::DIV: masm_->divsd(kFPScratch0,rhs); break;
+    default:
+      if(rhs != kFPScratch1) masm_->movaps(kFPScratch1,rhs);
+      EmitSave();
+      masm_->movaps(XMM0,kFPScratch0);
+      masm_->movaps(XMM1,kFPScratch1);
+      EmitCall(reinterpret_cast<const void*>(&JITFloat64Pow));
+      masm_->movaps(kFPScratch0,XMM0);
+      EmitRestore();
+      break;
+  }
+  StoreFpr(instr->def,kFPScratch0);
+}
+
+void CodeGenerator::EmitI64Arith( const Instruction* instr ) {
+  auto lhs = LoadGpr(instr->use[0],kScratch0);
+  if(lhs != kScratch0) masm_->mov(kScratch0,lhs);
+  auto rhs = LoadGpr(instr->use[1],kScratch1);
+
+  switch(static_cast<int>(instr->imm)) {
+    case Binary::ADD : masm_->add (kScratch0,rhs); break;
+    case Binary::SUB : masm_->sub (kScratch0,rhs); break;
+    case Binary::MUL : masm_->imul(kScratch0,rhs); break;
+    case Binary::AND : case Binary::BAND: masm_->and_(kScratch0,rhs); break;
+    case Binary::OR  : case Binary::BOR : masm_->or_ (kScratch0,rhs); break;
+    default:           masm_->xor_(kScratch0,rhs); break;
+  }
+  StoreGpr(instr->def,kScratch0);
+}
+
+void CodeGenerator::EmitInstruction( const Instruction* instr , const Block* next ) {
+  switch(instr->op) {
+    case LIR_CONST:
+      {
+        auto dst = DefLoc(instr->def);
+        auto reg = dst.IsGpr() ? dst.gpr() : kScratch0;
+        masm_->movi(reg,instr->imm);
+        StoreGpr(instr->def,reg);
+      }
+      break;
+
+    case LIR_ARG:
+      {
+        auto dst = DefLoc(instr->def);
+        auto reg = dst.IsGpr() ? dst.gpr() : kScratch0;
+        masm_->mov(reg,Address(kStack,static_cast<std::int32_t>(instr->imm*8)));
+        StoreGpr(instr->def,reg);
+      }
+      break;
+
+    case LIR_MOVE:
+      EmitMove(DefLoc(instr->def),UseLoc(instr->use[0]));
+      break;
+
+    case LIR_ARITH:   EmitArith   (instr); break;
+    case LIR_COMPARE: EmitCompare (instr); break;
+    case LIR_F64_ARITH: EmitF64Arith(instr); break;
+    case LIR_GUARD:   EmitGuard   (instr); break;
+
+    case LIR_I64_ARITH:
+    case LIR_BOOL_LOGIC:
+      EmitI64Arith(instr);
+      break;
+
+    case LIR_F64_COMPARE:
+      {
+        auto lhs = LoadFpr(instr->use[0],kFPScratch0);
+        auto rhs = LoadFpr(instr->use[1],kFPScratch1);
+        EmitF64Condition(static_cast<int>(instr->imm),lhs,rhs);
+        StoreGpr(instr->def,kScratch0);
+      }
+      break;
+
+    case LIR_I64_COMPARE:
+      {
+        auto lhs = LoadGpr(instr->use[0],kScratch0);
+        auto rhs = LoadGpr(instr->use[1],kScratch1);
+        EmitI64Condition(static_cast<int>(instr->imm),lhs,rhs);
+        StoreGpr(instr->def,kScratch0);
+      }
+      break;
+
+    case LIR_F64_NEGATE:
+      {
+        auto v = LoadFpr(instr->use[0],kFPScratch0);
+        if(v != kFPScratch0) masm_->movaps(kFPScratch0,v);
+        masm_->movi (kScratch0,0x8000000000000000ULL);
+        masm_->movq (kFPScratch1,kScratch0);
+        masm_->xorpd(kFPScratch0,kFPScratch1);
+        StoreFpr(instr->def,kFPScratch0);
+      }
+      break;
+
+    case LIR_I64_TO_F64:
+      masm_->cvtsi2sd(kFPScratch0,LoadGpr(instr->use[0],kScratch0));
+      StoreFpr(instr->def,kFPScratch0);
+      break;
+
+    case LIR_F64_TO_I64:
+      masm_->cvttsd2si(kScratch0,LoadFpr(instr->use[0],kFPScratch0));
+      StoreGpr(instr->def,kScratch0);
+      break;
+
+    case LIR_TEST:
+      {
+        // only false and null are false , and they are the largest tags
+        auto v = LoadGpr(instr->use[0],kScratch0);
+        masm_->movi  (kScratch2,Value::TAG_FALSE);
+        masm_->cmp   (v,kScratch2);
+        masm_->setcc (CC_B,kScratch0);
+        masm_->movzxb(kScratch0,kScratch0);
+        StoreGpr(instr->def,kScratch0);
+      }
+      break;
+
+    case LIR_BOX_BOOLEAN:
+      {
+        auto v = LoadGpr(instr->use[0],kScratch0);
+        masm_->movi(kScratch1,Value::TAG_FALSE);
+        masm_->movi(kScratch2,Value::TAG_TRUE);
+        masm_->test(v,v);
+        masm_->cmov(CC_NE,kScratch1,kScratch2);
+        StoreGpr(instr->def,kScratch1);
+      }
+      break;
+
+    case LIR_BOOL_NOT:
+      {
+        auto v = LoadGpr(instr->use[0],kScratch0);
+        if(v != kScratch0) masm_->mov(kScratch0,v);
+        masm_->xor_(kScratch0,1);
+        StoreGpr(instr->def,kScratch0);
+      }
+      break;
+
+    case LIR_SELECT:
+      {
+        auto c = LoadGpr(instr->use[0],kScratch0);
+        auto t = LoadGpr(instr->use[1],kScratch1);
+        auto f = LoadGpr(instr->use[2],kScratch2);
+        if(f != kScratch2) masm_->mov(kScratch2,f);
+        masm_->test(c,c);
+        masm_->cmov(CC_NE,kScratch2,t);
+        StoreGpr(instr->def,kScratch2);
+      }
+      break;
+
+    case LIR_PARALLEL_MOVE:
+      {
+        LocationMoveList move_list(func_.zone());
+        for( auto &m : *instr->move_list ) {
+          move_list.push_back(LocationMove(DefLoc(m.dst),UseLoc(m.src)));
+        }
+        EmitParallelMove(move_list);
+      }
+      break;
+
+    case LIR_JUMP:
+      if(instr->target[0] != next) masm_->jmp(BlockLabel(instr->target[0]));
+      break;
+
+    case LIR_BRANCH:
+      {
+        auto c = LoadGpr(instr->use[0],kScratch0);
+        masm_->test(c,c);
+        if(instr->target[0] == next) {
+          masm_->jcc(CC_E,BlockLabel(instr->target[1]));
+        } else {
+          masm_->jcc(CC_NE,BlockLabel(instr->target[0]));
+          if(instr->target[1] != next) masm_->jmp(BlockLabel(instr->target[1]));
+        }
+      }
+      break;
+
+    case LIR_RETURN:
+      {
+        auto v = LoadGpr(instr->use[0],kScratch0);
+        masm_->mov (Address(kStack,interpreter::kAccRegisterIndex*8),v);
+        masm_->movi(kScratch0,1);
+        masm_->jmp (&exit_);
+      }
+      break;
+
+    default:
+      lava_die();
+      break;
+  }
+}
+
+void CodeGenerator::EmitPrologue() {
+  masm_->push(RBP);
+  masm_->mov (RBP,RSP);
+  masm_->push(RBX);
+  masm_->push(R12);
+  masm_->push(R13);
+  masm_->push(R14);
+  masm_->push(R15);
+  masm_->sub (RSP,frame_size_);
+  masm_->mov (kRuntime,RDI);
+  masm_->mov (kStack  ,RSI);
+}
+
+void CodeGenerator::EmitEpilogue() {
+  masm_->Bind(&fail_);
+  masm_->movi(kScratch0,0);
+  masm_->Bind(&exit_);
+  masm_->add (RSP,frame_size_);
+  masm_->pop (R15);
+  masm_->pop (R14);
+  masm_->pop (R13);
+  masm_->pop (R12);
+  masm_->pop (RBX);
+  masm_->pop (RBP);
+  masm_->ret ();
+}
+
+void CodeGenerator::Generate() {
+  EmitPrologue();
+
+  auto& block_list = func_.block_list();
+  for( std::size_t i = 0 ; i < block_list.size() ; ++i ) {
+    const Block* blk  = block_list[i];
+    auto next = i + 1 < block_list.size() ? block_list[i+1] : NULL;
+    masm_->Bind(BlockLabel(blk));
+    if(auto m = ra_.block_start_move(blk)) EmitParallelMove(*m);
+
+    for( auto instr : blk->instr_list() ) {
+      if(auto m = ra_.gap_move(index_)) EmitParallelMove(*m);
+      if(instr->IsControlTransfer()) {
+        if(auto m = ra_.block_end_move(blk)) EmitParallelMove(*m);
+      }
+      EmitInstruction(instr,next);
+      ++index_;
+    }
+  }
+
+  for( auto &sp : slow_path_ ) {
+    if(sp.instr->op == LIR_GUARD) EmitDeopt(&sp);
+    else                          EmitSlowPath(&sp);
+  }
+
+  EmitEpilogue();
+}
+
+} // namespace x64
+} // namespace cbase
+} // namespace lavascript
@@ -0,0 +1,136 @@
+#ifndef CBASE_X64_CODEGEN_H_
+#define CBASE_X64_CODEGEN_H_
+#include <deque>
+#include <vector>
+
+#include "lir.h"
+#include "assembler.h"
+#include "register-allocator.h"
+
+namespace lavascript {
+namespace cbase      {
+namespace x64        {
+
+// -----------------------------------------------------------------------
+// Machine code generator of the x64 backend.
+//
+// The generated function has the signature
+//
+//   bool function( interpreter::Runtime* , Value* stack );
+//
+// the stack is the interpreter frame of the function , the arguments are in
+// the first registers and the return value is stored into the accumulator
+// register. It returns false when a runtime helper fails and the error is in
+// Runtime::error already.
+//
+// Frame layout , rsp is 16 bytes aligned inside of the function body :
+//
+//   [rbp]                  saved rbp
+//   [rbp-8  ... rbp-40]    saved rbx , r12 , r13 , r14 , r15
+//   [rsp+0  ... rsp+24]    reserved slots : lhs , rhs and output of the
+//                          runtime helper and the parallel move temporary
+//   [rsp+32 ...]           save area for registers live across a call
+//   [...]                  spill slots
+//
+// r12 holds the Runtime* and r13 holds the stack during the whole function ;
+// rax , r10 , r11 , xmm14 and xmm15 are scratch registers never allocated.
+// Since the location of a virtual register may change when it is split by
+// the register allocator , operands are read at the use position and the
+// result is written at the def position of the current instruction.
+//
+// The boxed arithmetic and comparison only inline the real number case , any
+// other operand goes to an out of line slow path calling the runtime helper.
+//
+// The out of line path of a guard is its deopt exit , it stores the deopt
+// slots into the interpreter frame , records the bytecode to resume at in
+// Runtime::deopt_pc and returns true. The interpreter then continues the
+// function from there.
+// -----------------------------------------------------------------------
+class CodeGenerator {
+ public:
+  static const Register   kRuntime  = R12;
+  static const Register   kStack    = R13;
+  static const Register   kScratch0 = RAX;
+  static const Register   kScratch1 = R10;
+  static const Register   kScratch2 = R11;
+  static const FPRegister kFPScratch0 = XMM14;
+  static const FPRegister kFPScratch1 = XMM15;
+
+  CodeGenerator( const Function& , const RegisterAllocator& , Assembler* );
+
+  void Generate();
+
+ private:
+  // out of line slow path of an instruction
+  struct SlowPath {
+    const Instruction* instr;
+    std::uint32_t      index;
+    Label              entry;
+    Label              exit;
+    SlowPath( const Instruction* i , std::uint32_t idx ):
+      instr(i) , index(idx) , entry() , exit() {}
+  };
+
+  Address SlotAddress( std::uint32_t slot ) const {
+    return Address(RSP,static_cast<std::int32_t>(slot*8));
+  }
+
+  Location UseLoc( VReg v ) const {
+    return ra_.location(v,RegisterAllocator::UsePosition(index_));
+  }
+  Location DefLoc( VReg v ) const {
+    return ra_.location(v,RegisterAllocator::DefPosition(index_));
+  }
+
+  // Get the value in a general purpose register , load into the scratch
+  // register if it is not in a general purpose register
+  Register   LoadGpr ( VReg , Register scratch );
+  FPRegister LoadFpr ( VReg , FPRegister scratch );
+  // Store the register into the location of the virtual register
+  void       StoreGpr( VReg , Register   );
+  void       StoreFpr( VReg , FPRegister );
+
+  void EmitMove( const Location& dst , const Location& src );
+  void EmitParallelMove( const LocationMoveList& );
+  // save and restore the caller saved registers live across the call
+  void EmitSave   ();
+  void EmitRestore();
+  void EmitPrologue();
+  void EmitEpilogue();
+  void EmitInstruction( const Instruction* , const Block* next );
+  void EmitSlowPath   ( SlowPath* );
+
+  void EmitArith      ( const Instruction* );
+  void EmitCompare    ( const Instruction* );
+  void EmitF64Arith   ( const Instruction* );
+  void EmitI64Arith   ( const Instruction* );
+  void EmitGuard      ( const Instruction* );
+  void EmitDeopt      ( SlowPath* );
+  // compare the 2 operands and set the scratch0 to 0 or 1
+  void EmitF64Condition( int op , FPRegister lhs , FPRegister rhs );
+  void EmitI64Condition( int op , Register   lhs , Register   rhs );
+  // branch to the slow path if any of the operand is not real
+  void EmitRealCheck  ( Register , Register , Label* );
+  // call a C function , the address is loaded into scratch0
+  void EmitCall       ( const void* );
+
+  Label* BlockLabel( const Block* blk ) { return &block_label_[blk->id()]; }
+
+  const Function&           func_;
+  const RegisterAllocator&  ra_;
+  Assembler*                masm_;
+  std::vector<Label>        block_label_;
+  std::deque<SlowPath>      slow_path_;
+  Label                     fail_;
+  Label                     exit_;
+  std::int32_t              frame_size_;
+  std::uint32_t             index_;       // index of current instruction
+
+  LAVA_DISALLOW_COPY_AND_ASSIGN(CodeGenerator)
+};
+
+} // namespace x64
+} // namespace cbase
+} // namespace lavascript
+
+#endif // CBASE_X64_CODEGEN_H_
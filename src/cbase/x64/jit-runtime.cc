@@ -0,0 +1,149 @@
+#include "jit-runtime.h"
+#include "src/interpreter/runtime.h"
+#include "src/cbase/hir.h"
+
+#include <cmath>
+#include <cstdarg>
+
+namespace lavascript {
+namespace cbase      {
+namespace x64        {
+namespace {
+
+using interpreter::Runtime;
+using hir::Binary;
+
+void ReportError( Runtime* runtime , const char* fmt , ... ) {
+  va_list vl;
+  va_start(vl,fmt);
+  FormatV(runtime->error,fmt,vl);
+  va_end(vl);
+}
+
+bool ExtensionArithmetic( const Value& left , const Value& right , int op ,
+                                                                   Value* output ,
+                                                                   std::string* error ) {
+  Handle<Extension> ext(left.IsExtension() ? left.GetExtension() : right.GetExtension());
+  switch(op) {
+    case Binary::ADD: return ext->Add(left,right,output,error);
+    case Binary::SUB: return ext->Sub(left,right,output,error);
+    case Binary::MUL: return ext->Mul(left,right,output,error);
+    case Binary::DIV: return ext->Div(left,right,output,error);
+    case Binary::MOD: return ext->Mod(left,right,output,error);
+    default:          return ext->Pow(left,right,output,error);
+  }
+}
+
+bool ExtensionCompare( const Value& left , const Value& right , int op ,
+                                                                Value* output ,
+                                                                std::string* error ) {
+  Handle<Extension> ext(left.IsExtension() ? left.GetExtension() : right.GetExtension());
+  switch(op) {
+    case Binary::LT: return ext->Lt(left,right,output,error);
+    case Binary::LE: return ext->Le(left,right,output,error);
+    case Binary::GT: return ext->Gt(left,right,output,error);
+    case Binary::GE: return ext->Ge(left,right,output,error);
+    case Binary::EQ: return ext->Eq(left,right,output,error);
+    default:         return ext->Ne(left,right,output,error);
+  }
+}
+
+} // namespace
+
+bool JITArithmetic( Runtime* runtime , int op , const Value* lhs , const Value* rhs ,
+                                                                   Value* output ) {
+  const Value& left = *lhs;
+  const Value& right= *rhs;
+
+  if(left.IsExtension() || right.IsExtension())
+    return ExtensionArithmetic(left,right,op,output,runtime->error);
+
+  if(!left.IsReal() || !right.IsReal()) {
+    if(op == Binary::POW)
+      ReportError(runtime,"\"%\" operator cannot work between type %s and %s",
+          left.type_name(),right.type_name());
+    else
+      ReportError(runtime,"arithmetic operator cannot work between type %s and %s",
+          left.type_name(),right.type_name());
+    return false;
+  }
+
+  double l = left.GetReal() , r = right.GetReal();
+  switch(op) {
+    case Binary::ADD: output->SetReal(l + r); break;
+    case Binary::SUB: output->SetReal(l - r); break;
+    case Binary::MUL: output->SetReal(l * r); break;
+    case Binary::DIV: output->SetReal(l / r); break;
+    case Binary::MOD:
+      {
+        std::int32_t il = static_cast<std::int32_t>(l);
+        std::int32_t ir = static_cast<std::int32_t>(r);
+        if(ir == 0) {
+          ReportError(runtime,"\"%\"'s rhs value is 0");
+          return false;
+        }
+        output->SetReal(static_cast<double>(il % ir));
+      }
+      break;
+    default:
+      output->SetReal(std::pow(l,r));
+      break;
+  }
+  return true;
+}
+
+bool JITCompare( Runtime* runtime , int op , const Value* lhs , const Value* rhs ,
+                                                                Value* output ) {
+  const Value& left = *lhs;
+  const Value& right= *rhs;
+
+  if(left.IsString() && right.IsString()) {
+    const String& l = *left.GetString();
+    const String& r = *right.GetString();
+    switch(op) {
+      case Binary::LT: output->SetBoolean(l <  r); break;
+      case Binary::LE: output->SetBoolean(l <= r); break;
+      case Binary::GT: output->SetBoolean(l >  r); break;
+      case Binary::GE: output->SetBoolean(l >= r); break;
+      case Binary::EQ: output->SetBoolean(l == r); break;
+      default:         output->SetBoolean(l != r); break;
+    }
+    return true;
+  }
+
+  if(left.IsExtension() || right.IsExtension())
+    return ExtensionCompare(left,right,op,output,runtime->error);
+
+  if(left.IsReal() && right.IsReal()) {
+    double l = left.GetReal() , r = right.GetReal();
+    switch(op) {
+      case Binary::LT: output->SetBoolean(l <  r); break;
+      case Binary::LE: output->SetBoolean(l <= r); break;
+      case Binary::GT: output->SetBoolean(l >  r); break;
+      case Binary::GE: output->SetBoolean(l >= r); break;
+      case Binary::EQ: output->SetBoolean(l == r); break;
+      default:         output->SetBoolean(l != r); break;
+    }
+    return true;
+  }
+
+  // equality of other types , same as the interpreter's fast path , compares
+  // primitive by value and heap object by identity
+  if(op == Binary::EQ || op == Binary::NE) {
+    bool eq = left.Equal(right);
+    output->SetBoolean(op == Binary::EQ ? eq : !eq);
+    return true;
+  }
+
+  ReportError(runtime,"comparison operator doesn't work between type %s and %s",
+      left.type_name(),right.type_name());
+  return false;
+}
+
+double JITFloat64Pow( double l , double r ) {
+  return std::pow(l,r);
+}
+
+} // namespace x64
+} // namespace cbase
+} // namespace lavascript
@@ -0,0 +1,36 @@
+#ifndef CBASE_X64_JIT_RUNTIME_H_
+#define CBASE_X64_JIT_RUNTIME_H_
+#include "src/objects.h"
+
+namespace lavascript {
+namespace interpreter {
+class Runtime;
+} // namespace interpreter
+
+namespace cbase      {
+namespace x64        {
+
+// -----------------------------------------------------------------------
+// Runtime helpers called by the JITted code.
+//
+// The fast path of a boxed operation is inlined in the JITted code for real
+// operands , any other operand goes through these helpers which share the
+// semantic and the error message of the interpreter. The operator is the
+// hir::Binary::Operator. On error the message goes to Runtime::error and
+// false is returned , then the JITted code bails out with failure.
+// -----------------------------------------------------------------------
+bool JITArithmetic( interpreter::Runtime* , int op , const Value* lhs ,
+                                                     const Value* rhs ,
+                                                     Value* output );
+
+bool JITCompare   ( interpreter::Runtime* , int op , const Value* lhs ,
+                                                     const Value* rhs ,
+                                                     Value* output );
+
+double JITFloat64Pow( double , double );
+
+} // namespace x64
+} // namespace cbase
+} // namespace lavascript
+
+#endif // CBASE_X64_JIT_RUNTIME_H_
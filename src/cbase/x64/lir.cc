@@ -0,0 +1,65 @@
+#include "lir.h"
+
+#include <cinttypes>
+
+namespace lavascript {
+namespace cbase      {
+namespace x64        {
+
+const char* GetValueKindName( ValueKind vk ) {
+  switch(vk) {
+    case VK_VALUE:   return "value";
+    case VK_INT64:   return "int64";
+    case VK_BOOLEAN: return "boolean";
+    default:         return "float64";
+  }
+}
+
+const char* GetOpcodeName( Opcode op ) {
+  switch(op) {
+#define __(A,B) case LIR_##A: return B;
+    LAVA_X64_LIR_LIST(__)
+#undef __
+    default: lava_die(); return NULL;
+  }
+}
+
+std::string Function::PrintToString() const {
+  std::string buffer;
+  for( const Block* blk : block_list_ ) {
+    buffer.append(Format("B%u:\n",blk->id()));
+    for( auto instr : blk->instr_list() ) {
+      buffer.append("  ");
+      if(instr->def != kNoVReg)
+        buffer.append(Format("v%u:%s = ",instr->def,GetValueKindName(vreg_kind(instr->def))));
+      buffer.append(GetOpcodeName(instr->op));
+      for( std::size_t i = 0 ; i < instr->use_size ; ++i ) {
+        buffer.append(Format(" v%u",instr->use[i]));
+      }
+      if(instr->op == LIR_CONST || instr->op == LIR_ARG || instr->op == LIR_ARITH   ||
+         instr->op == LIR_COMPARE   || instr->op == LIR_F64_ARITH   ||
+         instr->op == LIR_F64_COMPARE || instr->op == LIR_I64_ARITH ||
+         instr->op == LIR_I64_COMPARE || instr->op == LIR_BOOL_LOGIC) {
+        buffer.append(Format(" #%" PRIx64,instr->imm));
+      }
+      if(instr->op == LIR_GUARD) {
+        buffer.append(Format(" #%" PRIx64 " deopt%u",instr->imm,instr->deopt->id));
+        for( auto &s : instr->deopt->slot_list ) buffer.append(Format(" r%u<-v%u",s.index,s.value));
+      }
+      if(instr->op == LIR_PARALLEL_MOVE) {
+        for( auto &m : *instr->move_list ) buffer.append(Format(" v%u<-v%u",m.dst,m.src));
+      }
+      if(instr->op == LIR_JUMP) {
+        buffer.append(Format(" B%u",instr->target[0]->id()));
+      } else if(instr->op == LIR_BRANCH) {
+        buffer.append(Format(" B%u B%u",instr->target[0]->id(),instr->target[1]->id()));
+      }
+      buffer.push_back('\n');
+    }
+  }
+  return buffer;
+}
+
+} // namespace x64
+} // namespace cbase
+} // namespace lavascript
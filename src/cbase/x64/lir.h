@@ -0,0 +1,237 @@
+#ifndef CBASE_X64_LIR_H_
+#define CBASE_X64_LIR_H_
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#include "src/util.h"
+#include "src/zone/zone.h"
+#include "src/zone/stl.h"
+
+namespace lavascript {
+namespace cbase      {
+namespace x64        {
+
+// -----------------------------------------------------------------------
+// LIR , the low level IR of the x64 backend.
+//
+// LIR is a plain CFG of blocks , each block holds a list of instructions
+// which are executed in order and ends with exactly one control transfer
+// instruction. Values are virtual registers , each of them is defined once
+// by an instruction and has a kind which tells how the value is represented :
+//
+//   1) VK_VALUE   , a boxed Value , ie NaN tagged 64 bits
+//   2) VK_INT64   , an unboxed 64 bits integer
+//   3) VK_BOOLEAN , an unboxed boolean , 0 or 1
+//   4) VK_FLOAT64 , an unboxed double
+//
+// There is no phi instruction , the lowering resolves phi nodes into a
+// parallel move at the end of each predecessor block.
+// -----------------------------------------------------------------------
+enum ValueKind {
+  VK_VALUE = 0,
+  VK_INT64,
+  VK_BOOLEAN,
+  VK_FLOAT64
+};
+
+const char* GetValueKindName( ValueKind );
+
+// The kind needs a floating point register
+inline bool IsFPKind( ValueKind vk ) { return vk == VK_FLOAT64; }
+
+typedef std::uint32_t VReg;
+static const VReg kNoVReg = static_cast<VReg>(-1);
+
+#define LAVA_X64_LIR_LIST(__)                                                \
+  /* def = imm , the constant bits in the def's kind */                      \
+  __(CONST      ,"const"      )                                              \
+  /* def = argument at index imm */                                          \
+  __(ARG        ,"arg"        )                                              \
+  /* def = use0 , the kinds share the same bits representation */            \
+  __(MOVE       ,"move"       )                                              \
+  /* boxed arithmetic , imm is Binary::Operator , calls out if not real */   \
+  __(ARITH      ,"arith"      )                                              \
+  /* boxed comparison , imm is Binary::Operator , result is boxed */         \
+  __(COMPARE    ,"compare"    )                                              \
+  __(F64_ARITH  ,"f64_arith"  )                                              \
+  __(F64_COMPARE,"f64_compare")                                              \
+  __(F64_NEGATE ,"f64_negate" )                                              \
+  __(I64_ARITH  ,"i64_arith"  )                                              \
+  __(I64_COMPARE,"i64_compare")                                              \
+  __(I64_TO_F64 ,"i64_to_f64" )                                              \
+  __(F64_TO_I64 ,"f64_to_i64" )                                              \
+  /* boolean = use0 is neither false nor null */                             \
+  __(TEST       ,"test"       )                                              \
+  __(BOX_BOOLEAN,"box_boolean")                                              \
+  __(BOOL_NOT   ,"bool_not"   )                                              \
+  /* imm is Binary::AND or Binary::OR */                                     \
+  __(BOOL_LOGIC ,"bool_logic" )                                              \
+  /* def = use0 ? use1 : use2 , use0 is boolean */                           \
+  __(SELECT     ,"select"     )                                              \
+  /* deopt unless use0 is of the type kind imm , see Deopt */               \
+  __(GUARD      ,"guard"      )                                              \
+  /* control transfer */                                                     \
+  __(PARALLEL_MOVE,"parallel_move")                                          \
+  __(JUMP       ,"jump"       )                                              \
+  /* goto use0 ? target0 : target1 , use0 is boolean */                      \
+  __(BRANCH     ,"branch"     )                                              \
+  __(RETURN     ,"return"     )
+
+enum Opcode {
+#define __(A,B) LIR_##A,
+  LAVA_X64_LIR_LIST(__)
+#undef __
+  SIZE_OF_LIR
+};
+
+const char* GetOpcodeName( Opcode );
+
+class Block;
+
+// A move inside of a parallel move , all moves read their source before any
+// of them writes its destination
+struct Move {
+  VReg dst;
+  VReg src;
+  Move( VReg d , VReg s ) : dst(d) , src(s) {}
+};
+
+typedef zone::stl::ZoneVector<Move> MoveList;
+
+// A register of the interpreter frame restored by deoptimization
+struct DeoptSlot {
+  std::uint32_t index;   // register index in the interpreter frame
+  VReg          value;   // boxed value of the register
+  DeoptSlot( std::uint32_t i , VReg v ) : index(i) , value(v) {}
+};
+
+typedef zone::stl::ZoneVector<DeoptSlot> DeoptSlotList;
+
+// Deoptimization metadata of a guard. When the guard fails , the slots are
+// stored back into the interpreter frame and the interpreter resumes the
+// function at pc. The slot values are read at the guard , so they are uses of
+// the guard for the register allocator.
+struct Deopt {
+  std::uint32_t        id;        // index inside of the function's deopt list
+  const std::uint32_t* pc;        // bytecode to resume at
+  DeoptSlotList        slot_list;
+  Deopt( zone::Zone* zone , std::uint32_t i , const std::uint32_t* p ):
+    id(i) , pc(p) , slot_list(zone) {}
+};
+
+typedef zone::stl::ZoneVector<Deopt*> DeoptList;
+
+struct Instruction {
+  Opcode        op;
+  VReg          def;
+  VReg          use[3];
+  std::size_t   use_size;
+  std::uint64_t imm;
+  Block*        target[2];
+  MoveList*     move_list;     // for parallel move only
+  Deopt*        deopt;         // for guard only
+
+  Instruction( Opcode o ):
+    op(o), def(kNoVReg), use(), use_size(0), imm(0), target(), move_list(NULL),
+    deopt(NULL)
+  {}
+
+  void AddUse( VReg v ) {
+    lava_debug(NORMAL,lava_verify(use_size < 3););
+    use[use_size++] = v;
+  }
+
+  bool IsControlTransfer() const {
+    return op == LIR_JUMP || op == LIR_BRANCH || op == LIR_RETURN;
+  }
+};
+
+typedef zone::stl::ZoneVector<Instruction*> InstructionList;
+typedef zone::stl::ZoneVector<Block*>       BlockList;
+
+class Block {
+ public:
+  Block( zone::Zone* zone , std::uint32_t id ):
+    id_(id), instr_list_(zone), pred_list_(zone), succ_list_(zone) {}
+
+  std::uint32_t id() const { return id_; }
+
+  const InstructionList& instr_list() const { return instr_list_; }
+  InstructionList*       instr_list()       { return &instr_list_; }
+
+  const BlockList& pred_list() const { return pred_list_; }
+  const BlockList& succ_list() const { return succ_list_; }
+
+  void AddSuccessor( Block* succ ) {
+    succ_list_.push_back(succ);
+    succ->pred_list_.push_back(this);
+  }
+
+  Instruction* last() const { return instr_list_.empty() ? NULL : instr_list_.back(); }
+
+ private:
+  std::uint32_t   id_;
+  InstructionList instr_list_;
+  BlockList       pred_list_;
+  BlockList       succ_list_;
+
+  LAVA_DISALLOW_COPY_AND_ASSIGN(Block)
+};
+
+// A function in LIR , the blocks are in layout order and the first one is the
+// entry block
+class Function {
+ public:
+  explicit Function( zone::Zone* zone ):
+    zone_(zone), vreg_kind_(zone), block_list_(zone), deopt_list_(zone), block_id_(0) {}
+
+  zone::Zone* zone() const { return zone_; }
+
+  VReg NewVReg( ValueKind vk ) {
+    vreg_kind_.push_back(vk);
+    return static_cast<VReg>(vreg_kind_.size() - 1);
+  }
+  ValueKind   vreg_kind( VReg v ) const { return vreg_kind_[v]; }
+  std::size_t vreg_size()         const { return vreg_kind_.size(); }
+
+  // Create a new block , the block is not in the layout until it is placed
+  Block* NewBlock() {
+    return zone_->New<Block>(zone_,static_cast<std::uint32_t>(block_id_++));
+  }
+  std::size_t block_id_size() const { return block_id_; }
+
+  void PlaceBlock( Block* block ) { block_list_.push_back(block); }
+  void PlaceBlock( Block* block , std::size_t pos ) {
+    block_list_.insert(block_list_.begin()+pos,block);
+  }
+  const BlockList& block_list() const { return block_list_; }
+
+  Instruction* NewInstruction( Opcode op ) { return zone_->New<Instruction>(op); }
+
+  // Create the deopt metadata of a guard which resumes at the pc
+  Deopt* NewDeopt( const std::uint32_t* pc ) {
+    auto deopt = zone_->New<Deopt>(zone_,static_cast<std::uint32_t>(deopt_list_.size()),pc);
+    deopt_list_.push_back(deopt);
+    return deopt;
+  }
+  const DeoptList& deopt_list() const { return deopt_list_; }
+
+  // Dump the function in text for debugging purpose
+  std::string PrintToString() const;
+
+ private:
+  zone::Zone*                        zone_;
+  zone::stl::ZoneVector<ValueKind>   vreg_kind_;
+  BlockList                          block_list_;
+  DeoptList                          deopt_list_;
+  std::size_t                        block_id_;
+
+  LAVA_DISALLOW_COPY_AND_ASSIGN(Function)
+};
+
+} // namespace x64
+} // namespace cbase
+} // namespace lavascript
+
+#endif // CBASE_X64_LIR_H_
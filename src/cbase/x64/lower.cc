@@ -0,0 +1,598 @@
+#include "lower.h"
+
+#include <cstring>
+#include <cstdarg>
+
+namespace lavascript {
+namespace cbase      {
+namespace x64        {
+using namespace ::lavascript::cbase::hir;
+
+namespace {
+
+// Lowering of one graph , see Lower for the description
+class Lowering {
+ public:
+  Lowering( const Graph& graph , const Schedule& schedule , Function* func ,
+                                                            std::string* error ):
+    graph_    (graph),
+    schedule_ (schedule),
+    func_     (func),
+    zone_     (func->zone()),
+    error_    (error),
+    block_    (zone_,NULL,schedule.block_list().size()),
+    vreg_     (zone_,kNoVReg,static_cast<std::size_t>(graph.MaxID())),
+    kind_     (zone_,VK_VALUE,graph.MaxID()),
+    cache_    (zone_,kNoVReg,static_cast<std::size_t>(graph.MaxID())*4),
+    cache_blk_(zone_,static_cast<std::uint32_t>(-1),static_cast<std::size_t>(graph.MaxID())*4),
+    current_  (NULL)
+  {}
+
+  bool Run();
+
+ private:
+  bool Fail( const char* format , ... );
+
+  // HIR block to LIR block , NULL if the block doesn't generate code
+  Block* GetBlock( ControlFlow* cf ) const { return block_[schedule_.GetBlockIndex(cf)]; }
+
+  Instruction* Emit( Opcode op , VReg def = kNoVReg ) {
+    auto instr = func_->NewInstruction(op);
+    instr->def = def;
+    current_->instr_list()->push_back(instr);
+    return instr;
+  }
+
+  VReg Emit1( Opcode op , ValueKind vk , VReg a , std::uint64_t imm = 0 ) {
+    auto instr = Emit(op,func_->NewVReg(vk));
+    instr->AddUse(a);
+    instr->imm = imm;
+    return instr->def;
+  }
+
+  VReg Emit2( Opcode op , ValueKind vk , VReg a , VReg b , std::uint64_t imm = 0 ) {
+    auto instr = Emit(op,func_->NewVReg(vk));
+    instr->AddUse(a);
+    instr->AddUse(b);
+    instr->imm = imm;
+    return instr->def;
+  }
+
+  VReg EmitConst( ValueKind vk , std::uint64_t bits ) {
+    auto instr = Emit(LIR_CONST,func_->NewVReg(vk));
+    instr->imm = bits;
+    return instr->def;
+  }
+
+  // Get the node's value in the wanted kind inside of the current block ,
+  // returns kNoVReg on failure
+  VReg Use        ( Expr* , ValueKind );
+  VReg UseConst   ( Expr* , ValueKind );
+  VReg Convert    ( Expr* , VReg , ValueKind from , ValueKind to );
+
+  void Define( Expr* node , VReg v , ValueKind vk ) {
+    vreg_[node->id()] = v;
+    kind_[node->id()] = vk;
+  }
+
+  bool LowerPhi       ();
+  bool LowerNode      ( Expr* );
+  bool LowerGuard     ( Guard* );
+  bool LowerTerminator( ControlFlow* );
+  bool LowerEdge      ( ControlFlow* from , ControlFlow* to , Block** target );
+  bool EmitPhiMove    ( ControlFlow* from , ControlFlow* to );
+
+  static bool IsConst( Expr* node ) {
+    return node->Is<Int64>() || node->Is<Float64>() || node->Is<Boolean>() || node->Is<Nil>();
+  }
+
+  // the test is only used by guards , which do the test themselves
+  static bool IsGuardTest( Expr* node ) {
+    lava_foreach( auto &r , node->ref_list()->GetForwardIterator() ) {
+      if(!r.node->Is<Guard>()) return false;
+    }
+    return true;
+  }
+
+  static bool IsEffect( Expr* node ) {
+    return node->Is<InitBarrier>() || node->Is<BranchStartEffect>() ||
+           node->Is<EffectMergeBase>() || node->Is<EmptyWriteEffect>();
+  }
+
+  static bool HasCode( ControlFlow* cf ) {
+    return !cf->Is<Success>() && !cf->Is<End>();
+  }
+
+  static bool HasPhi( ControlFlow* cf ) {
+    return cf->Is<Merge>() && cf->As<Merge>()->phi_list()->size() != 0;
+  }
+
+  const Graph&                         graph_;
+  const Schedule&                      schedule_;
+  Function*                            func_;
+  zone::Zone*                          zone_;
+  std::string*                         error_;
+  zone::stl::ZoneVector<Block*>        block_;
+  zone::stl::ZoneVector<VReg>          vreg_;
+  zone::stl::ZoneVector<ValueKind>     kind_;
+  // conversion of node into each kind , valid inside of the block in cache_blk_
+  zone::stl::ZoneVector<VReg>          cache_;
+  zone::stl::ZoneVector<std::uint32_t> cache_blk_;
+  Block*                               current_;
+};
+
+bool Lowering::Fail( const char* format , ... ) {
+  va_list vl;
+  va_start(vl,format);
+  FormatV(error_,format,vl);
+  va_end(vl);
+  return false;
+}
+
+VReg Lowering::UseConst( Expr* node , ValueKind vk ) {
+  std::uint64_t bits;
+
+  if(node->Is<Float64>() || node->Is<Int64>()) {
+    double d = node->Is<Float64>() ? node->As<Float64>()->value() :
+                                     static_cast<double>(node->As<Int64>()->value());
+    switch(vk) {
+      case VK_INT64:
+        bits = node->Is<Int64>() ? static_cast<std::uint64_t>(node->As<Int64>()->value()) :
+                                   static_cast<std::uint64_t>(static_cast<std::int64_t>(d));
+        break;
+      case VK_BOOLEAN:
+        bits = 1;
+        break;
+      default:
+        memcpy(&bits,&d,sizeof(bits));
+        break;
+    }
+  } else if(node->Is<Boolean>()) {
+    bool b = node->As<Boolean>()->value();
+    switch(vk) {
+      case VK_VALUE:   bits = b ? Value::TAG_TRUE : Value::TAG_FALSE; break;
+      case VK_BOOLEAN: bits = b ? 1 : 0; break;
+      default:
+        Fail("cannot use boolean as %s",GetValueKindName(vk));
+        return kNoVReg;
+    }
+  } else {
+    switch(vk) {
+      case VK_VALUE:   bits = Value::TAG_NULL; break;
+      case VK_BOOLEAN: bits = 0; break;
+      default:
+        Fail("cannot use nil as %s",GetValueKindName(vk));
+        return kNoVReg;
+    }
+  }
+  return EmitConst(vk,bits);
+}
+
+VReg Lowering::Convert( Expr* node , VReg v , ValueKind from , ValueKind to ) {
+  switch(to) {
+    case VK_VALUE:
+      if(from == VK_FLOAT64) return Emit1(LIR_MOVE,to,v);
+      if(from == VK_INT64  ) return Emit1(LIR_MOVE,to,Emit1(LIR_I64_TO_F64,VK_FLOAT64,v));
+      return Emit1(LIR_BOX_BOOLEAN,to,v);
+    case VK_FLOAT64:
+      if(from == VK_VALUE  ) return Emit1(LIR_MOVE,to,v);
+      if(from == VK_INT64  ) return Emit1(LIR_I64_TO_F64,to,v);
+      break;
+    case VK_INT64:
+      if(from == VK_FLOAT64) return Emit1(LIR_F64_TO_I64,to,v);
+      if(from == VK_VALUE  ) return Emit1(LIR_F64_TO_I64,to,Emit1(LIR_MOVE,VK_FLOAT64,v));
+      break;
+    default:
+      // all numbers are true in boolean context
+      if(from == VK_VALUE  ) return Emit1(LIR_TEST,to,v);
+      return EmitConst(to,1);
+  }
+  Fail("cannot convert %s from %s to %s",node->type_name(),GetValueKindName(from),
+                                                           GetValueKindName(to));
+  return kNoVReg;
+}
+
+VReg Lowering::Use( Expr* node , ValueKind vk ) {
+  std::size_t key = node->id() * 4 + vk;
+  if(cache_blk_[key] == current_->id()) return cache_[key];
+
+  VReg ret;
+  if(IsConst(node)) {
+    ret = UseConst(node,vk);
+  } else {
+    VReg v = vreg_[node->id()];
+    if(v == kNoVReg) {
+      Fail("node %s is not supported",node->type_name());
+      return kNoVReg;
+    }
+    ret = kind_[node->id()] == vk ? v : Convert(node,v,kind_[node->id()],vk);
+  }
+
+  if(ret != kNoVReg) {
+    cache_    [key] = ret;
+    cache_blk_[key] = current_->id();
+  }
+  return ret;
+}
+
+// Create the virtual register of all phi nodes , a phi's value may be used by
+// a block laid out before any of its predecessors , ie the loop induction
+// variable used inside of the loop
+bool Lowering::LowerPhi() {
+  for( auto cf : schedule_.block_list() ) {
+    if(!cf->Is<Merge>()) continue;
+    auto phi_list = cf->As<Merge>()->phi_list();
+    for( std::size_t i = 0 ; i < phi_list->size() ; ++i ) {
+      auto phi = phi_list->Index(i);
+      ValueKind vk;
+      switch(phi->type()) {
+        case HIR_PHI: case HIR_LOOP_IV: vk = VK_VALUE;   break;
+        case HIR_LOOP_IV_INT64:         vk = VK_INT64;   break;
+        case HIR_LOOP_IV_FLOAT64:
+        case HIR_FLOAT64_PHI:           vk = VK_FLOAT64; break;
+        default: return Fail("node %s is not supported",phi->type_name());
+      }
+      Define(phi,func_->NewVReg(vk),vk);
+    }
+  }
+  return true;
+}
+
+// The guard evaluates to its object , when the type test fails the frame
+// captured by the checkpoint is stored back and the interpreter takes over
+bool Lowering::LowerGuard( Guard* node ) {
+  if(!node->test()->Is<TestType>())
+    return Fail("guard on %s is not supported",node->test()->type_name());
+  auto tk = node->test()->As<TestType>()->type_kind();
+  if(tk != TPKIND_FLOAT64 && tk != TPKIND_BOOLEAN && tk != TPKIND_NIL)
+    return Fail("guard on type %s is not supported",GetTypeKindName(tk));
+
+  // the interpreter frame of an inlined function is not materialized , so the
+  // checkpoint must be of the top function , ie method 1 , whose frame is the
+  // one the code runs in
+  auto cp = node->checkpoint();
+  if(cp->ir_info()->method() != 1)
+    return Fail("deoptimization of inlined frame is not supported");
+
+  VReg o = Use(node->object(),VK_VALUE);
+  if(o == kNoVReg) return false;
+
+  auto deopt = func_->NewDeopt(cp->ir_info()->bc().address());
+  lava_foreach( auto slot , cp->operand_list()->GetForwardIterator() ) {
+    if(!slot->Is<StackSlot>())
+      return Fail("checkpoint with %s is not supported",slot->type_name());
+    VReg v = Use(slot->As<StackSlot>()->expr(),VK_VALUE);
+    if(v == kNoVReg) return false;
+    deopt->slot_list.push_back(DeoptSlot(slot->As<StackSlot>()->index(),v));
+  }
+
+  auto instr   = Emit(LIR_GUARD);
+  instr->AddUse(o);
+  instr->imm   = tk;
+  instr->deopt = deopt;
+  Define(node,o,VK_VALUE);
+  return true;
+}
+
+bool Lowering::LowerNode( Expr* node ) {
+  if(IsConst(node) || IsEffect(node)) return true;
+  if(node->Is<Guard>()) return LowerGuard(node->As<Guard>());
+  if(node->Is<TestType>() && IsGuardTest(node)) return true;
+
+#define USE(N,K)                                              \
+  VReg N = Use(node->Operand(N##_index),K);                   \
+  if(N == kNoVReg) return false
+
+  VReg ret = kNoVReg;
+  ValueKind vk = VK_VALUE;
+
+  switch(node->type()) {
+    case HIR_ARG:
+      {
+        auto instr = Emit(LIR_ARG,func_->NewVReg(VK_VALUE));
+        instr->imm = node->As<Arg>()->index();
+        ret = instr->def;
+      }
+      break;
+
+    case HIR_ARITHMETIC:
+    case HIR_COMPARE:
+      {
+        const std::size_t l_index = 0 , r_index = 1;
+        USE(l,VK_VALUE); USE(r,VK_VALUE);
+        ret = Emit2(node->Is<Arithmetic>() ? LIR_ARITH : LIR_COMPARE,VK_VALUE,l,r,
+                    node->As<DynamicBinary>()->op());
+      }
+      break;
+
+    case HIR_UNARY:
+      {
+        if(node->As<Unary>()->op() != Unary::NOT) return Fail("unary minus is not supported");
+        const std::size_t o_index = 0;
+        USE(o,VK_BOOLEAN);
+        ret = Emit1(LIR_BOOL_NOT,VK_BOOLEAN,o);
+        vk  = VK_BOOLEAN;
+      }
+      break;
+
+    case HIR_LOGICAL:
+      {
+        const std::size_t c_index = 0 , l_index = 0 , r_index = 1;
+        USE(c,VK_BOOLEAN); USE(l,VK_VALUE); USE(r,VK_VALUE);
+        auto instr = Emit(LIR_SELECT,func_->NewVReg(VK_VALUE));
+        instr->AddUse(c);
+        // a && b is b if a is true , otherwise a ; a || b is a if a is true
+        if(node->As<Logical>()->op() == Binary::AND) {
+          instr->AddUse(r); instr->AddUse(l);
+        } else {
+          instr->AddUse(l); instr->AddUse(r);
+        }
+        ret = instr->def;
+      }
+      break;
+
+    case HIR_TERNARY:
+      {
+        const std::size_t c_index = 0 , l_index = 1 , r_index = 2;
+        USE(c,VK_BOOLEAN); USE(l,VK_VALUE); USE(r,VK_VALUE);
+        auto instr = Emit(LIR_SELECT,func_->NewVReg(VK_VALUE));
+        instr->AddUse(c); instr->AddUse(l); instr->AddUse(r);
+        ret = instr->def;
+      }
+      break;
+
+    case HIR_FLOAT64_NEGATE:
+      {
+        const std::size_t o_index = 0;
+        USE(o,VK_FLOAT64);
+        ret = Emit1(LIR_F64_NEGATE,VK_FLOAT64,o);
+        vk  = VK_FLOAT64;
+      }
+      break;
+
+    case HIR_BOOLEAN_NOT:
+      {
+        const std::size_t o_index = 0;
+        USE(o,VK_BOOLEAN);
+        ret = Emit1(LIR_BOOL_NOT,VK_BOOLEAN,o);
+        vk  = VK_BOOLEAN;
+      }
+      break;
+
+    case HIR_FLOAT64_ARITHMETIC:
+      {
+        auto op = node->As<Float64Arithmetic>()->op();
+        if(op == Binary::MOD) return Fail("float64 modulo is not supported");
+        const std::size_t l_index = 0 , r_index = 1;
+        USE(l,VK_FLOAT64); USE(r,VK_FLOAT64);
+        ret = Emit2(LIR_F64_ARITH,VK_FLOAT64,l,r,op);
+        vk  = VK_FLOAT64;
+      }
+      break;
+
+    case HIR_INT64_ARITHMETIC:
+      {
+        auto op = node->As<Int64Arithmetic>()->op();
+        if(op != Binary::ADD  && op != Binary::SUB && op != Binary::MUL &&
+           op != Binary::BAND && op != Binary::BOR && op != Binary::BXOR)
+          return Fail("int64 operator %s is not supported",Binary::GetOperatorName(op));
+        const std::size_t l_index = 0 , r_index = 1;
+        USE(l,VK_INT64); USE(r,VK_INT64);
+        ret = Emit2(LIR_I64_ARITH,VK_INT64,l,r,op);
+        vk  = VK_INT64;
+      }
+      break;
+
+    case HIR_FLOAT64_COMPARE:
+    case HIR_INT64_COMPARE:
+      {
+        bool f = node->Is<Float64Compare>();
+        ValueKind k = f ? VK_FLOAT64 : VK_INT64;
+        const std::size_t l_index = 0 , r_index = 1;
+        USE(l,k); USE(r,k);
+        ret = Emit2(f ? LIR_F64_COMPARE : LIR_I64_COMPARE,VK_BOOLEAN,l,r,
+                    node->As<SpecializeBinary>()->op());
+        vk  = VK_BOOLEAN;
+      }
+      break;
+
+    case HIR_BOOLEAN_LOGIC:
+      {
+        const std::size_t l_index = 0 , r_index = 1;
+        USE(l,VK_BOOLEAN); USE(r,VK_BOOLEAN);
+        ret = Emit2(LIR_BOOL_LOGIC,VK_BOOLEAN,l,r,node->As<BooleanLogic>()->op());
+        vk  = VK_BOOLEAN;
+      }
+      break;
+
+    case HIR_CONV_BOOLEAN:
+      {
+        const std::size_t o_index = 0;
+        USE(o,VK_BOOLEAN);
+        ret = o;
+        vk  = VK_BOOLEAN;
+      }
+      break;
+
+    case HIR_CONV_NBOOLEAN:
+      {
+        const std::size_t o_index = 0;
+        USE(o,VK_BOOLEAN);
+        ret = Emit1(LIR_BOOL_NOT,VK_BOOLEAN,o);
+        vk  = VK_BOOLEAN;
+      }
+      break;
+
+    case HIR_FLOAT64_TO_INT64:
+      {
+        const std::size_t o_index = 0;
+        USE(o,VK_FLOAT64);
+        ret = Emit1(LIR_F64_TO_I64,VK_INT64,o);
+        vk  = VK_INT64;
+      }
+      break;
+
+    case HIR_INT64_TO_FLOAT64:
+      {
+        const std::size_t o_index = 0;
+        USE(o,VK_INT64);
+        ret = Emit1(LIR_I64_TO_F64,VK_FLOAT64,o);
+        vk  = VK_FLOAT64;
+      }
+      break;
+
+    case HIR_BOX:
+      {
+        const std::size_t o_index = 0;
+        USE(o,VK_VALUE);
+        ret = o;
+      }
+      break;
+
+    case HIR_UNBOX:
+      {
+        switch(node->As<Unbox>()->type_kind()) {
+          case TPKIND_FLOAT64: vk = VK_FLOAT64; break;
+          case TPKIND_INT64:   vk = VK_INT64;   break;
+          case TPKIND_BOOLEAN: vk = VK_BOOLEAN; break;
+          default: return Fail("unbox to %s is not supported",
+                               GetTypeKindName(node->As<Unbox>()->type_kind()));
+        }
+        const std::size_t o_index = 0;
+        USE(o,vk);
+        ret = o;
+      }
+      break;
+
+    default:
+      return Fail("node %s is not supported",node->type_name());
+  }
+
+#undef USE // USE
+
+  Define(node,ret,vk);
+  return true;
+}
+
+bool Lowering::EmitPhiMove( ControlFlow* from , ControlFlow* to ) {
+  if(!HasPhi(to)) return true;
+
+  std::size_t index = 0;
+  for( ; index < to->backward_edge()->size() ; ++index ) {
+    if(to->In(index) == from) break;
+  }
+  lava_debug(NORMAL,lava_verify(index < to->backward_edge()->size()););
+
+  auto phi_list = to->As<Merge>()->phi_list();
+  auto move_list= zone_->New<MoveList>(zone_);
+  for( std::size_t i = 0 ; i < phi_list->size() ; ++i ) {
+    auto phi = phi_list->Index(i);
+    VReg src = Use(phi->Operand(index),kind_[phi->id()]);
+    if(src == kNoVReg) return false;
+    move_list->push_back(Move(vreg_[phi->id()],src));
+  }
+  Emit(LIR_PARALLEL_MOVE)->move_list = move_list;
+  return true;
+}
+
+// Get the LIR block to jump to when going from one block to another , a new
+// block is placed right after the current one when the phi moves cannot be
+// done at the end of the current block , ie the edge is a critical edge
+bool Lowering::LowerEdge( ControlFlow* from , ControlFlow* to , Block** target ) {
+  // an edge block is needed for the phi moves , and also to split critical
+  // edge so the register allocator always has a place for its moves
+  if(!HasPhi(to) && to->backward_edge()->size() <= 1) {
+    *target = GetBlock(to);
+    return true;
+  }
+
+  auto saved = current_;
+  current_ = func_->NewBlock();
+  func_->PlaceBlock(current_);
+  if(!EmitPhiMove(from,to)) return false;
+  Emit(LIR_JUMP)->target[0] = GetBlock(to);
+  current_->AddSuccessor(GetBlock(to));
+
+  *target  = current_;
+  current_ = saved;
+  return true;
+}
+
+bool Lowering::LowerTerminator( ControlFlow* cf ) {
+  switch(cf->type()) {
+    case HIR_START: case HIR_REGION: case HIR_IF_TRUE: case HIR_IF_FALSE:
+    case HIR_IF_MERGE: case HIR_JUMP: case HIR_LOOP: case HIR_LOOP_MERGE:
+      {
+        lava_debug(NORMAL,lava_verify(cf->forward_edge()->size() == 1););
+        auto succ = cf->Out(0);
+        if(!EmitPhiMove(cf,succ)) return false;
+        Emit(LIR_JUMP)->target[0] = GetBlock(succ);
+        current_->AddSuccessor(GetBlock(succ));
+      }
+      return true;
+
+    case HIR_IF: case HIR_LOOP_HEADER: case HIR_LOOP_EXIT:
+      {
+        Expr* cond = cf->operand_list()->First();
+        // LoopExit jumps back to the loop when the condition is true
+        ControlFlow* t = cf->Is<LoopExit>() ? cf->Out(0) : cf->Out(1);
+        ControlFlow* f = cf->Is<LoopExit>() ? cf->Out(1) : cf->Out(0);
+        VReg c = Use(cond,VK_BOOLEAN);
+        if(c == kNoVReg) return false;
+
+        auto instr = Emit(LIR_BRANCH);
+        instr->AddUse(c);
+        auto cur = current_;
+        if(!LowerEdge(cf,t,&instr->target[0]) ||
+           !LowerEdge(cf,f,&instr->target[1]))
+          return false;
+        cur->AddSuccessor(instr->target[0]);
+        cur->AddSuccessor(instr->target[1]);
+      }
+      return true;
+
+    case HIR_RETURN:
+      {
+        VReg v = Use(cf->As<Return>()->value(),VK_VALUE);
+        if(v == kNoVReg) return false;
+        Emit(LIR_RETURN)->AddUse(v);
+      }
+      return true;
+
+    default:
+      return Fail("control flow %s is not supported",cf->type_name());
+  }
+}
+
+bool Lowering::Run() {
+  auto& block_list = schedule_.block_list();
+  for( std::size_t i = 0 ; i < block_list.size() ; ++i ) {
+    if(HasCode(block_list[i])) block_[i] = func_->NewBlock();
+  }
+
+  if(!LowerPhi()) return false;
+
+  for( auto cf : block_list ) {
+    if(!HasCode(cf)) continue;
+    current_ = GetBlock(cf);
+    func_->PlaceBlock(current_);
+
+    for( auto node : schedule_.GetNodeList(cf) ) {
+      if(!LowerNode(node)) return false;
+    }
+    if(!LowerTerminator(cf)) return false;
+  }
+  return true;
+}
+
+} // namespace
+
+bool Lower( const Graph& graph , const Schedule& schedule , Function* func ,
+                                                            std::string* error ) {
+  Lowering lowering(graph,schedule,func,error);
+  return lowering.Run();
+}
+
+} // namespace x64
+} // namespace cbase
+} // namespace lavascript
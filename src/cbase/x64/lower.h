@@ -0,0 +1,34 @@
+#ifndef CBASE_X64_LOWER_H_
+#define CBASE_X64_LOWER_H_
+#include <string>
+
+#include "lir.h"
+#include "src/cbase/hir.h"
+#include "src/cbase/schedule.h"
+
+namespace lavascript {
+namespace cbase      {
+namespace x64        {
+
+// -----------------------------------------------------------------------
+// Lower the scheduled HIR graph into LIR.
+//
+// Each expression node is lowered in the kind of value it naturally
+// produces , ie the typed nodes produce unboxed value and the generic nodes
+// produce boxed value ; a use which needs another kind gets a conversion in
+// front of it. Constants are not lowered on their own , they are
+// materialized at each use in the kind the use needs.
+//
+// The backend only supports a subset of HIR now , the numeric and boolean
+// operations , type guard , branch and loop. If any other node is met the
+// lowering fails with the reason in error and the function stays interpreted.
+// Notably the list and object accesses , ie ListIndex , ObjectFind and the
+// reference get/set nodes using them , are not lowered yet.
+// -----------------------------------------------------------------------
+bool Lower( const hir::Graph& , const hir::Schedule& , Function* , std::string* error );
+
+} // namespace x64
+} // namespace cbase
+} // namespace lavascript
+
+#endif // CBASE_X64_LOWER_H_
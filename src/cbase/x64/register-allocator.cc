@@ -0,0 +1,569 @@
+#include "register-allocator.h"
+#include "src/cbase/hir.h"
+
+#include <algorithm>
+
+namespace lavascript {
+namespace cbase      {
+namespace x64        {
+using namespace ::lavascript::zone;
+
+namespace {
+
+static const std::uint32_t kMaxPosition = static_cast<std::uint32_t>(-1);
+
+// allocatable registers in preference order , callee saved registers are
+// preferred since they don't need to be saved around calls ; rax , r10 , r11 ,
+// xmm14 and xmm15 are the code generator's scratch registers and r12 , r13
+// are fixed
+static const Register kGprList[] = {
+  RBX , R14 , R15 , RSI , RDI , R8 , R9 , RCX , RDX
+};
+
+static const FPRegister kFprList[] = {
+  XMM0 , XMM1 , XMM2 , XMM3 , XMM4  , XMM5  , XMM6 ,
+  XMM7 , XMM8 , XMM9 , XMM10, XMM11 , XMM12 , XMM13
+};
+
+static const std::size_t kGprSize = sizeof(kGprList) / sizeof(Register);
+static const std::size_t kFprSize = sizeof(kFprList) / sizeof(FPRegister);
+
+inline bool IsCalleeSaved( const Location& loc ) {
+  return loc.IsGpr() && (loc.gpr() == RBX || loc.gpr() == R14 || loc.gpr() == R15);
+}
+
+inline std::uint32_t EvenPosition( std::uint32_t pos ) { return pos & ~1u; }
+
+} // namespace
+
+// [from,to)
+struct LiveRange {
+  std::uint32_t from;
+  std::uint32_t to;
+  LiveRange( std::uint32_t f , std::uint32_t t ) : from(f) , to(t) {}
+};
+
+// A live interval of a virtual register , or a part of it after splitting.
+// The parts of a virtual register are linked in order of their position and
+// never overlap.
+struct LiveInterval {
+  VReg                       vreg;
+  bool                       fp;
+  stl::ZoneVector<LiveRange> range_list;   // ordered
+  stl::ZoneVector<std::uint32_t> use_list; // ordered
+  Location                   location;
+  LiveInterval*              next;         // next split part
+
+  LiveInterval( Zone* zone , VReg v , bool f ):
+    vreg(v), fp(f), range_list(zone), use_list(zone), location(), next(NULL) {}
+
+  bool          empty() const { return range_list.empty(); }
+  std::uint32_t start() const { return range_list.front().from; }
+  std::uint32_t end  () const { return range_list.back ().to;   }
+
+  bool Covers( std::uint32_t pos ) const {
+    for( auto &r : range_list ) {
+      if(pos < r.from) return false;
+      if(pos < r.to  ) return true;
+    }
+    return false;
+  }
+
+  // first position both intervals cover , kMaxPosition if none
+  std::uint32_t Intersect( const LiveInterval* that ) const {
+    std::size_t i = 0 , j = 0;
+    while(i < range_list.size() && j < that->range_list.size()) {
+      auto &a = range_list[i];
+      auto &b = that->range_list[j];
+      if(a.to <= b.from)      ++i;
+      else if(b.to <= a.from) ++j;
+      else return std::max(a.from,b.from);
+    }
+    return kMaxPosition;
+  }
+
+  // first use at or after the position , kMaxPosition if none
+  std::uint32_t NextUse( std::uint32_t pos ) const {
+    auto itr = std::lower_bound(use_list.begin(),use_list.end(),pos);
+    return itr == use_list.end() ? kMaxPosition : *itr;
+  }
+
+  // used while building , ranges and uses are added in descending order and
+  // reversed once finished
+  void AddRange( std::uint32_t from , std::uint32_t to ) {
+    if(!range_list.empty() && range_list.back().from <= to) {
+      range_list.back().from = std::min(range_list.back().from,from);
+      range_list.back().to   = std::max(range_list.back().to  ,to  );
+    } else {
+      range_list.push_back(LiveRange(from,to));
+    }
+  }
+
+  void Define( std::uint32_t pos ) {
+    if(range_list.empty() || range_list.back().from > pos) {
+      // never used , still needs a location to write to
+      range_list.push_back(LiveRange(pos,pos+1));
+    } else {
+      range_list.back().from = pos;
+    }
+  }
+
+  void AddUse( std::uint32_t pos ) {
+    if(use_list.empty() || use_list.back() != pos) use_list.push_back(pos);
+  }
+};
+
+bool RegisterAllocator::IsCall( const Instruction* instr ) {
+  return (instr->op == LIR_ARITH || instr->op == LIR_COMPARE) ||
+         (instr->op == LIR_F64_ARITH && static_cast<int>(instr->imm) == hir::Binary::POW);
+}
+
+RegisterAllocator::RegisterAllocator( zone::Zone* zone , const Function& func ):
+  zone_            (zone),
+  func_            (func),
+  instr_list_      (zone),
+  block_start_     (zone),
+  block_from_      (zone,0,func.block_id_size()),
+  block_to_        (zone,0,func.block_id_size()),
+  live_in_         (zone,static_cast<BitSet*>(NULL),func.block_id_size()),
+  live_out_        (zone,static_cast<BitSet*>(NULL),func.block_id_size()),
+  interval_        (zone),
+  unhandled_       (zone),
+  active_          (zone),
+  inactive_        (zone),
+  gap_move_        (zone),
+  block_start_move_(zone,static_cast<LocationMoveList*>(NULL),func.block_id_size()),
+  block_end_move_  (zone,static_cast<LocationMoveList*>(NULL),func.block_id_size()),
+  call_save_       (zone),
+  save_slot_size_  (0),
+  stack_slot_size_ (kReservedSlot)
+{}
+
+void RegisterAllocator::Allocate() {
+  NumberInstruction();
+  ComputeLiveness  ();
+  BuildInterval    ();
+  LinearScan       ();
+  ComputeCallSave  ();
+  AssignSpillSlot  ();
+  Resolve          ();
+}
+
+Location RegisterAllocator::location( VReg v , std::uint32_t pos ) const {
+  // the parts are ordered and never overlap , so the part covering the
+  // position is the last one starting before it
+  LiveInterval* ret = NULL;
+  for( auto it = interval_[v] ; it && it->start() <= pos ; it = it->next ) ret = it;
+  lava_debug(NORMAL,lava_verify(ret && ret->location.kind != Location::NONE););
+  return ret->location;
+}
+
+void RegisterAllocator::NumberInstruction() {
+  for( const Block* blk : func_.block_list() ) {
+    auto from = static_cast<std::uint32_t>(instr_list_.size());
+    for( auto instr : blk->instr_list() ) {
+      block_start_.push_back(instr_list_.size() == from);
+      instr_list_ .push_back(instr);
+    }
+    block_from_[blk->id()] = UsePosition(from);
+    block_to_  [blk->id()] = UsePosition(static_cast<std::uint32_t>(instr_list_.size()));
+  }
+  gap_move_ .assign(instr_list_.size(),NULL);
+  call_save_.assign(instr_list_.size(),NULL);
+}
+
+namespace {
+
+template< typename F >
+void ForEachDef( const Instruction* instr , const F& f ) {
+  if(instr->op == LIR_PARALLEL_MOVE) {
+    for( auto &m : *instr->move_list ) f(m.dst);
+  } else if(instr->def != kNoVReg) {
+    f(instr->def);
+  }
+}
+
+template< typename F >
+void ForEachUse( const Instruction* instr , const F& f ) {
+  if(instr->op == LIR_PARALLEL_MOVE) {
+    for( auto &m : *instr->move_list ) f(m.src);
+  } else {
+    for( std::size_t i = 0 ; i < instr->use_size ; ++i ) f(instr->use[i]);
+    // the deopt slots are read when the guard fails
+    if(instr->op == LIR_GUARD) {
+      for( auto &s : instr->deopt->slot_list ) f(s.value);
+    }
+  }
+}
+
+} // namespace
+
+// The virtual registers are not in SSA form since a phi is assigned by the
+// parallel move in each predecessor , so liveness is solved as a plain
+// backward data flow problem
+void RegisterAllocator::ComputeLiveness() {
+  auto vreg_size  = func_.vreg_size();
+  auto& block_list = func_.block_list();
+  stl::ZoneVector<BitSet*> gen (zone_,static_cast<BitSet*>(NULL),block_list.size());
+  stl::ZoneVector<BitSet*> kill(zone_,static_cast<BitSet*>(NULL),block_list.size());
+
+  for( std::size_t i = 0 ; i < block_list.size() ; ++i ) {
+    const Block* blk = block_list[i];
+    auto g   = zone_->New<BitSet>(zone_,false,vreg_size);
+    auto k   = zone_->New<BitSet>(zone_,false,vreg_size);
+    for( auto instr : blk->instr_list() ) {
+      ForEachUse(instr,[=]( VReg v ) { if(!(*k)[v]) (*g)[v] = true; });
+      ForEachDef(instr,[=]( VReg v ) { (*k)[v] = true; });
+    }
+    gen [i] = g;
+    kill[i] = k;
+    live_in_ [blk->id()] = zone_->New<BitSet>(zone_,false,vreg_size);
+    live_out_[blk->id()] = zone_->New<BitSet>(zone_,false,vreg_size);
+  }
+
+  bool changed;
+  do {
+    changed = false;
+    for( std::size_t i = block_list.size() ; i-- > 0 ; ) {
+      const Block* blk = block_list[i];
+      auto out = live_out_[blk->id()];
+      auto in  = live_in_ [blk->id()];
+      for( auto succ : blk->succ_list() ) {
+        auto succ_in = live_in_[succ->id()];
+        for( std::size_t v = 0 ; v < vreg_size ; ++v ) {
+          if((*succ_in)[v]) (*out)[v] = true;
+        }
+      }
+      for( std::size_t v = 0 ; v < vreg_size ; ++v ) {
+        bool live = (*gen[i])[v] || ((*out)[v] && !(*kill[i])[v]);
+        if(live && !(*in)[v]) { (*in)[v] = true; changed = true; }
+      }
+    }
+  } while(changed);
+}
+
+void RegisterAllocator::BuildInterval() {
+  auto vreg_size = func_.vreg_size();
+  interval_.reserve(vreg_size);
+  for( std::size_t v = 0 ; v < vreg_size ; ++v ) {
+    interval_.push_back(zone_->New<LiveInterval>(zone_,static_cast<VReg>(v),
+          IsFPKind(func_.vreg_kind(static_cast<VReg>(v)))));
+  }
+
+  // walk backward so ranges are built in descending order
+  auto& block_list = func_.block_list();
+  for( std::size_t i = block_list.size() ; i-- > 0 ; ) {
+    const Block* blk = block_list[i];
+    auto from = block_from_[blk->id()];
+    auto to   = block_to_  [blk->id()];
+    auto out  = live_out_[blk->id()];
+    for( std::size_t v = 0 ; v < vreg_size ; ++v ) {
+      if((*out)[v]) interval_[v]->AddRange(from,to);
+    }
+
+    auto& instr_list = blk->instr_list();
+    for( std::size_t j = instr_list.size() ; j-- > 0 ; ) {
+      auto instr = instr_list[j];
+      auto index = from / 2 + static_cast<std::uint32_t>(j);
+      ForEachDef(instr,[=]( VReg v ) { interval_[v]->Define(DefPosition(index)); });
+      ForEachUse(instr,[=]( VReg v ) {
+        interval_[v]->AddRange(from,DefPosition(index));
+        interval_[v]->AddUse  (UsePosition(index));
+      });
+    }
+  }
+
+  for( auto it : interval_ ) {
+    std::reverse(it->range_list.begin(),it->range_list.end());
+    std::reverse(it->use_list  .begin(),it->use_list  .end());
+  }
+}
+
+void RegisterAllocator::AddUnhandled( LiveInterval* it ) {
+  // ordered by start descending so the next one is at the back
+  auto itr = std::upper_bound(unhandled_.begin(),unhandled_.end(),it,
+      []( const LiveInterval* l , const LiveInterval* r ) { return l->start() > r->start(); });
+  unhandled_.insert(itr,it);
+}
+
+LiveInterval* RegisterAllocator::Split( LiveInterval* it , std::uint32_t pos ) {
+  lava_debug(NORMAL,lava_verify(pos > it->start() && pos < it->end()););
+  auto child = zone_->New<LiveInterval>(zone_,it->vreg,it->fp);
+
+  std::size_t keep = 0;
+  for( auto &r : it->range_list ) {
+    if(r.to <= pos) {
+      ++keep;
+    } else if(r.from >= pos) {
+      child->range_list.push_back(r);
+    } else {
+      child->range_list.push_back(LiveRange(pos,r.to));
+      r.to = pos;
+      ++keep;
+    }
+  }
+  it->range_list.resize(keep,LiveRange(0,0));
+
+  auto itr = std::lower_bound(it->use_list.begin(),it->use_list.end(),pos);
+  child->use_list.assign(itr,it->use_list.end());
+  it->use_list.erase(itr,it->use_list.end());
+
+  child->next = it->next;
+  it->next    = child;
+  return child;
+}
+
+// Put the interval on the stack until right before its next use , the rest
+// is allocated again
+void RegisterAllocator::SpillUntilNextUse( LiveInterval* it ) {
+  it->location = Location::Stack(0);
+  // a use at the start is served from the stack
+  auto use = it->NextUse(it->start()+1);
+  if(use == kMaxPosition) return;
+  auto pos = EvenPosition(use);
+  if(pos > it->start()) AddUnhandled(Split(it,pos));
+}
+
+// The interval loses its register from the position
+void RegisterAllocator::SplitAndSpill( LiveInterval* it , std::uint32_t pos ) {
+  pos = EvenPosition(pos);
+  if(pos <= it->start()) {
+    SpillUntilNextUse(it);
+  } else if(pos < it->end()) {
+    SpillUntilNextUse(Split(it,pos));
+  }
+}
+
+bool RegisterAllocator::TryAllocateFree( LiveInterval* cur ) {
+  std::uint32_t free_until[kRegisterSize];
+  std::fill(free_until,free_until+kRegisterSize,kMaxPosition);
+
+  for( auto it : active_ ) {
+    if(it->fp == cur->fp) free_until[it->location.index] = 0;
+  }
+  for( auto it : inactive_ ) {
+    if(it->fp != cur->fp) continue;
+    auto pos = it->Intersect(cur);
+    if(pos < free_until[it->location.index]) free_until[it->location.index] = pos;
+  }
+
+  std::uint32_t reg = 0 , best = 0;
+  std::size_t size  = cur->fp ? kFprSize : kGprSize;
+  for( std::size_t i = 0 ; i < size ; ++i ) {
+    std::uint32_t r = cur->fp ? static_cast<std::uint32_t>(kFprList[i]) :
+                                static_cast<std::uint32_t>(kGprList[i]);
+    if(free_until[r] > best) { best = free_until[r]; reg = r; }
+  }
+
+  if(best <= cur->start()) return false;
+  if(best < cur->end()) {
+    // free for the first part only
+    auto pos = EvenPosition(best);
+    if(pos <= cur->start()) return false;
+    AddUnhandled(Split(cur,pos));
+  }
+  cur->location = Location(cur->fp ? Location::FPR : Location::GPR,reg);
+  return true;
+}
+
+void RegisterAllocator::AllocateBlocked( LiveInterval* cur ) {
+  std::uint32_t next_use[kRegisterSize];
+  std::fill(next_use,next_use+kRegisterSize,kMaxPosition);
+  auto start = cur->start();
+
+  for( auto it : active_ ) {
+    if(it->fp != cur->fp) continue;
+    auto pos = it->NextUse(start);
+    if(pos < next_use[it->location.index]) next_use[it->location.index] = pos;
+  }
+  for( auto it : inactive_ ) {
+    if(it->fp != cur->fp || it->Intersect(cur) == kMaxPosition) continue;
+    auto pos = it->NextUse(start);
+    if(pos < next_use[it->location.index]) next_use[it->location.index] = pos;
+  }
+
+  std::uint32_t reg = 0 , best = 0;
+  std::size_t size  = cur->fp ? kFprSize : kGprSize;
+  for( std::size_t i = 0 ; i < size ; ++i ) {
+    std::uint32_t r = cur->fp ? static_cast<std::uint32_t>(kFprList[i]) :
+                                static_cast<std::uint32_t>(kGprList[i]);
+    if(next_use[r] > best) { best = next_use[r]; reg = r; }
+  }
+
+  // all other intervals are used before the current one , spill it
+  if(cur->NextUse(start) >= best) {
+    SpillUntilNextUse(cur);
+    return;
+  }
+
+  cur->location = Location(cur->fp ? Location::FPR : Location::GPR,reg);
+
+  // evict the intervals holding the register
+  for( auto itr = active_.begin() ; itr != active_.end() ; ) {
+    auto it = *itr;
+    if(it->fp == cur->fp && it->location.index == reg) {
+      SplitAndSpill(it,start);
+      itr = active_.erase(itr);
+    } else {
+      ++itr;
+    }
+  }
+  for( auto itr = inactive_.begin() ; itr != inactive_.end() ; ) {
+    auto it = *itr;
+    if(it->fp == cur->fp && it->location.index == reg && it->Intersect(cur) != kMaxPosition) {
+      SplitAndSpill(it,start);
+      itr = inactive_.erase(itr);
+    } else {
+      ++itr;
+    }
+  }
+}
+
+void RegisterAllocator::LinearScan() {
+  for( auto it : interval_ ) {
+    if(!it->empty()) unhandled_.push_back(it);
+  }
+  std::stable_sort(unhandled_.begin(),unhandled_.end(),
+      []( const LiveInterval* l , const LiveInterval* r ) { return l->start() > r->start(); });
+
+  while(!unhandled_.empty()) {
+    auto cur = unhandled_.back();
+    unhandled_.pop_back();
+    auto pos = cur->start();
+
+    // retire or deactivate the intervals not covering the position
+    for( auto itr = active_.begin() ; itr != active_.end() ; ) {
+      auto it = *itr;
+      if(it->end() <= pos) {
+        itr = active_.erase(itr);
+      } else if(!it->Covers(pos)) {
+        inactive_.push_back(it);
+        itr = active_.erase(itr);
+      } else {
+        ++itr;
+      }
+    }
+    for( auto itr = inactive_.begin() ; itr != inactive_.end() ; ) {
+      auto it = *itr;
+      if(it->end() <= pos) {
+        itr = inactive_.erase(itr);
+      } else if(it->Covers(pos)) {
+        active_.push_back(it);
+        itr = inactive_.erase(itr);
+      } else {
+        ++itr;
+      }
+    }
+
+    if(!TryAllocateFree(cur)) AllocateBlocked(cur);
+    if(cur->location.IsReg()) active_.push_back(cur);
+  }
+}
+
+void RegisterAllocator::ComputeCallSave() {
+  for( std::size_t i = 0 ; i < instr_list_.size() ; ++i ) {
+    auto instr = instr_list_[i];
+    if(!IsCall(instr)) continue;
+    auto pos = DefPosition(static_cast<std::uint32_t>(i));
+
+    stl::ZoneVector<Location>* list = NULL;
+    for( auto root : interval_ ) {
+      if(root->vreg == instr->def) continue;
+      for( auto it = root ; it ; it = it->next ) {
+        if(it->location.IsReg() && !IsCalleeSaved(it->location) && it->Covers(pos)) {
+          if(!list) list = zone_->New<stl::ZoneVector<Location>>(zone_);
+          list->push_back(it->location);
+        }
+      }
+    }
+    if(list) {
+      call_save_[i] = list;
+      save_slot_size_ = std::max(save_slot_size_,static_cast<std::uint32_t>(list->size()));
+    }
+  }
+  stack_slot_size_ = kReservedSlot + save_slot_size_;
+}
+
+// All the spilled parts of a virtual register share one slot , a slot is
+// reused by another virtual register once all spilled parts are dead
+void RegisterAllocator::AssignSpillSlot() {
+  struct Span {
+    LiveInterval* root;
+    std::uint32_t from;
+    std::uint32_t to;
+  };
+  std::vector<Span> span_list;
+  for( auto root : interval_ ) {
+    Span span = { root , kMaxPosition , 0 };
+    for( auto it = root ; it ; it = it->next ) {
+      if(!it->location.IsStack() || it->empty()) continue;
+      span.from = std::min(span.from,it->start());
+      span.to   = std::max(span.to  ,it->end  ());
+    }
+    if(span.from != kMaxPosition) span_list.push_back(span);
+  }
+  std::sort(span_list.begin(),span_list.end(),
+      []( const Span& l , const Span& r ) { return l.from < r.from; });
+
+  std::vector<std::uint32_t> slot_end;   // per spill slot
+  for( auto &span : span_list ) {
+    std::uint32_t slot = 0;
+    for( ; slot < slot_end.size() ; ++slot ) {
+      if(slot_end[slot] <= span.from) break;
+    }
+    if(slot == slot_end.size()) slot_end.push_back(span.to);
+    else                        slot_end[slot] = span.to;
+
+    auto loc = Location::Stack(stack_slot_size_ + slot);
+    for( auto it = span.root ; it ; it = it->next ) {
+      if(it->location.IsStack()) it->location = loc;
+    }
+  }
+  stack_slot_size_ += static_cast<std::uint32_t>(slot_end.size());
+}
+
+void RegisterAllocator::AddMove( LocationMoveList** list , const Location& dst ,
+                                                           const Location& src ) {
+  if(dst == src) return;
+  if(!*list) *list = zone_->New<LocationMoveList>(zone_);
+  (*list)->push_back(LocationMove(dst,src));
+}
+
+void RegisterAllocator::Resolve() {
+  // split inside of a block
+  for( auto root : interval_ ) {
+    for( auto it = root ; it && it->next ; it = it->next ) {
+      auto child = it->next;
+      if(it->empty() || child->empty() || it->end() != child->start()) continue;
+      auto index = child->start() / 2;
+      if(block_start_[index]) continue;
+      AddMove(&gap_move_[index],child->location,it->location);
+    }
+  }
+
+  // split across a control flow edge
+  auto vreg_size = func_.vreg_size();
+  for( auto succ : func_.block_list() ) {
+    auto in = live_in_[succ->id()];
+    for( auto pred : succ->pred_list() ) {
+      auto end   = block_to_[pred->id()] - 1;
+      auto start = block_from_[succ->id()];
+      for( std::size_t v = 0 ; v < vreg_size ; ++v ) {
+        if(!(*in)[v]) continue;
+        auto src = location(static_cast<VReg>(v),end);
+        auto dst = location(static_cast<VReg>(v),start);
+        if(src == dst) continue;
+        if(pred->succ_list().size() == 1) {
+          AddMove(&block_end_move_[pred->id()],dst,src);
+        } else {
+          lava_debug(NORMAL,lava_verify(succ->pred_list().size() == 1););
+          AddMove(&block_start_move_[succ->id()],dst,src);
+        }
+      }
+    }
+  }
+}
+
+} // namespace x64
+} // namespace cbase
+} // namespace lavascript
@@ -0,0 +1,176 @@
+#ifndef CBASE_X64_REGISTER_ALLOCATOR_H_
+#define CBASE_X64_REGISTER_ALLOCATOR_H_
+#include "lir.h"
+#include "assembler.h"
+
+namespace lavascript {
+namespace cbase      {
+namespace x64        {
+
+// Where a virtual register lives at a certain position
+struct Location {
+  enum Kind { NONE , GPR , FPR , STACK };
+
+  Kind          kind;
+  std::uint32_t index;   // register number or stack slot
+
+  Location() : kind(NONE) , index(0) {}
+  Location( Kind k , std::uint32_t i ) : kind(k) , index(i) {}
+
+  static Location Gpr  ( Register r   ) { return Location(GPR,r); }
+  static Location Fpr  ( FPRegister r ) { return Location(FPR,r); }
+  static Location Stack( std::uint32_t slot ) { return Location(STACK,slot); }
+
+  bool IsNone () const { return kind == NONE;  }
+  bool IsGpr  () const { return kind == GPR;   }
+  bool IsFpr  () const { return kind == FPR;   }
+  bool IsStack() const { return kind == STACK; }
+  bool IsReg  () const { return IsGpr() || IsFpr(); }
+
+  Register   gpr() const { return static_cast<Register>  (index); }
+  FPRegister fpr() const { return static_cast<FPRegister>(index); }
+
+  bool operator == ( const Location& that ) const {
+    return kind == that.kind && index == that.index;
+  }
+  bool operator != ( const Location& that ) const { return !(*this == that); }
+};
+
+// A move between 2 locations , moves in the same list are parallel
+struct LocationMove {
+  Location dst;
+  Location src;
+  LocationMove( const Location& d , const Location& s ) : dst(d) , src(s) {}
+};
+
+typedef zone::stl::ZoneVector<LocationMove> LocationMoveList;
+
+struct LiveInterval;
+
+// -----------------------------------------------------------------------
+// Linear scan register allocator of the x64 backend.
+//
+// The allocator follows the design of Wimmer and Mossenbock , "Optimized
+// Interval Splitting in a Linear Scan Register Allocator". Instructions are
+// numbered in layout order , instruction k reads its operands at position 2k
+// and writes its result at position 2k+1. Each virtual register gets a live
+// interval which is a list of ranges , the intervals are visited in the order
+// of their start position and get a register which is free for the whole
+// interval or , if none is , the interval or the one blocking the register is
+// split and the part not in register goes to the stack.
+//
+// Since the code generator can take any operand from the stack , no use needs
+// a register and an interval is spilled as a whole until its next use. All
+// the split parts of a virtual register share the same spill slot , and
+// virtual registers whose spilled parts never overlap share the spill slot.
+//
+// After the scan , the allocator computes the moves needed between the split
+// parts : a gap move before an instruction when a split happens inside of a
+// block , or a move at the start/end of a block when the location differs
+// between the end of a predecessor and the start of the successor. The
+// lowering splits all critical edges so one of them is always available.
+//
+// The instructions calling out into the runtime , ie the slow path of boxed
+// arithmetic/comparison and pow , preserve the caller saved registers live
+// across the call in the save area of the frame instead of blocking those
+// registers for all intervals crossing the call , since the call is rare.
+//
+// The frame is
+//
+//   [0 , kReservedSlot)     reserved for the code generator
+//   [kReservedSlot , ...)   save area for registers live across a call
+//   [... , stack_slot_size) spill slots
+// -----------------------------------------------------------------------
+class RegisterAllocator {
+ public:
+  static const std::uint32_t kReservedSlot = 4;
+
+  RegisterAllocator( zone::Zone* , const Function& );
+
+  void Allocate();
+
+  // Location of the virtual register at a position , use UsePosition for an
+  // operand and DefPosition for the result
+  Location location( VReg , std::uint32_t pos ) const;
+
+  static std::uint32_t UsePosition( std::uint32_t index ) { return index * 2;     }
+  static std::uint32_t DefPosition( std::uint32_t index ) { return index * 2 + 1; }
+
+  // Moves needed before the instruction at index , NULL if no move is needed
+  const LocationMoveList* gap_move( std::uint32_t index ) const {
+    return gap_move_[index];
+  }
+  // Moves needed at the start of the block , the block has one predecessor
+  const LocationMoveList* block_start_move( const Block* blk ) const {
+    return block_start_move_[blk->id()];
+  }
+  // Moves needed before the control transfer of the block , the block has
+  // one successor
+  const LocationMoveList* block_end_move( const Block* blk ) const {
+    return block_end_move_[blk->id()];
+  }
+
+  // Caller saved registers live across the call at the index , NULL if none
+  const zone::stl::ZoneVector<Location>* call_save( std::uint32_t index ) const {
+    return call_save_[index];
+  }
+  std::uint32_t save_slot( std::size_t i ) const {
+    return kReservedSlot + static_cast<std::uint32_t>(i);
+  }
+
+  // How many stack slots are needed , including the reserved ones
+  std::uint32_t stack_slot_size() const { return stack_slot_size_; }
+
+  // Whether the instruction calls out into the runtime
+  static bool IsCall( const Instruction* );
+
+ private:
+  void NumberInstruction();
+  void ComputeLiveness  ();
+  void BuildInterval    ();
+  void LinearScan       ();
+  void ComputeCallSave  ();
+  void AssignSpillSlot  ();
+  void Resolve          ();
+
+  // linear scan
+  bool TryAllocateFree ( LiveInterval* );
+  void AllocateBlocked ( LiveInterval* );
+  void SplitAndSpill   ( LiveInterval* , std::uint32_t pos );
+  void SpillUntilNextUse( LiveInterval* );
+  LiveInterval* Split  ( LiveInterval* , std::uint32_t pos );
+  void AddUnhandled    ( LiveInterval* );
+
+  void AddMove( LocationMoveList** , const Location& dst , const Location& src );
+
+  typedef zone::stl::ZoneVector<bool> BitSet;
+
+  zone::Zone*                                   zone_;
+  const Function&                               func_;
+  zone::stl::ZoneVector<const Instruction*>     instr_list_;
+  zone::stl::ZoneVector<bool>                   block_start_;    // per instruction
+  zone::stl::ZoneVector<std::uint32_t>          block_from_;     // per block id
+  zone::stl::ZoneVector<std::uint32_t>          block_to_;
+  zone::stl::ZoneVector<BitSet*>                live_in_;
+  zone::stl::ZoneVector<BitSet*>                live_out_;
+
+  zone::stl::ZoneVector<LiveInterval*>          interval_;       // per vreg
+  zone::stl::ZoneVector<LiveInterval*>          unhandled_;      // start descending
+  zone::stl::ZoneVector<LiveInterval*>          active_;
+  zone::stl::ZoneVector<LiveInterval*>          inactive_;
+
+  zone::stl::ZoneVector<LocationMoveList*>      gap_move_;
+  zone::stl::ZoneVector<LocationMoveList*>      block_start_move_;
+  zone::stl::ZoneVector<LocationMoveList*>      block_end_move_;
+  zone::stl::ZoneVector<zone::stl::ZoneVector<Location>*> call_save_;
+  std::uint32_t                                 save_slot_size_;
+  std::uint32_t                                 stack_slot_size_;
+
+  LAVA_DISALLOW_COPY_AND_ASSIGN(RegisterAllocator)
+};
+
+} // namespace x64
+} // namespace cbase
+} // namespace lavascript
+
+#endif // CBASE_X64_REGISTER_ALLOCATOR_H_
@@ -42,6 +42,14 @@ static const std::uint8_t kAccRegisterIndex        = 255;
 static const std::size_t kReserveCallStack         = 24;
 static const std::size_t kReserveCallStackSlot     =  3; // 24 / sizeof(Value)
 
+// Size of the inaccessible area that ends the interpreter stack. A call probes
+// the last register of the callee's frame , which is at most 2 register windows
+// away from the current frame , so one page is always enough to catch it.
+static const std::size_t kStackGuardSize           = 4096;
+
+// Default size of the interpreter stack segment of a coroutine , in Value
+static const std::size_t kCoroutineStackSize       = 8192;
+
 } // namespace interpreter
 
 namespace compiler {
@@ -55,6 +63,10 @@ static const std::size_t   kHotCountArraySize = 256;
 static const std::uint16_t kJITHotCallTrigger = 100;
 static const std::uint16_t kJITHotLoopTrigger = 1000;
 
+// How many times the native code of a prototype deopts before it is dropped
+// and compiled again without type speculation
+static const std::uint16_t kJITDeoptTrigger   = 8;
+
 // type of hot count
 typedef std::uint16_t hotcount_t;
 
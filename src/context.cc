@@ -1,7 +1,13 @@
 #include "context.h"
+#include "src/interpreter/runtime.h"
 
 namespace lavascript {
 
+void Context::PushCurrentRuntime( interpreter::Runtime* runtime ) {
+  runtime->previous = runtime_;
+  runtime_ = runtime;
+}
+
 void Context::PopCurrentRuntime() {
   lava_debug(NORMAL,lava_verify(runtime_););
   runtime_ = runtime_->previous;
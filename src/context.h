@@ -21,9 +21,7 @@ class Context {
   // Runtime pointer
   interpreter::Runtime*       runtime()       { return runtime_; }
   const interpreter::Runtime* runtime() const { return runtime_; }
-  void PushCurrentRuntime( interpreter::Runtime* runtime ) {
-    runtime_ = runtime;
-  }
+  void PushCurrentRuntime( interpreter::Runtime* runtime );
   void PopCurrentRuntime();
   // ------------------------------------------------------------
   // JIT hot conut data field
@@ -33,6 +31,22 @@ class Context {
   const compiler::JITHotCountData* hotcount_data() const {
     return &hotcount_data_;
   }
+  // ------------------------------------------------------------
+  // Call site cache of the interpreter
+  interpreter::CallSiteCache* call_site_cache() {
+    return &call_site_cache_;
+  }
+  const interpreter::CallSiteCache* call_site_cache() const {
+    return &call_site_cache_;
+  }
+  // ------------------------------------------------------------
+  // Global variable cache of the interpreter
+  interpreter::GlobalCache* global_cache() {
+    return &global_cache_;
+  }
+  const interpreter::GlobalCache* global_cache() const {
+    return &global_cache_;
+  }
  private:
   // GC interfaces
   GC gc_;
@@ -42,12 +56,18 @@ class Context {
   interpreter::Runtime* runtime_;
   // hot count for recording JIT compiler's profile data
   compiler::JITHotCountData hotcount_data_;
+  // monomorphic call site cache , shared by all runs inside of this context
+  interpreter::CallSiteCache call_site_cache_;
+  // global variable slot cache , shared by all runs inside of this context
+  interpreter::GlobalCache global_cache_;
 };
 
 inline Context::Context():
   gc_                (this),
   runtime_           (NULL),
-  hotcount_data_     ()
+  hotcount_data_     (),
+  call_site_cache_   (),
+  global_cache_      ()
 {}
 
 } // namespace lavascript
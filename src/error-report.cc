@@ -65,6 +65,12 @@ void ReportErrorV( std::string* buffer , const char* where , const char* source
                                                                 message.c_str());
 }
 
+size_t GetSourceLine( const std::string& source , size_t pos ) {
+  size_t line , ccount;
+  GetCoordinate(source.c_str(),pos < source.size() ? pos : source.size(),&line,&ccount);
+  return line;
+}
+
 std::string GetSourceSnippetInOneLine( const std::string& source , size_t start, size_t end ) {
   if(end > start) {
     // NOTES: the source code coordinate is [start,end]
@@ -38,6 +38,9 @@ std::string ReportError( const char* where, const char* source, size_t start, si
   return ReportErrorV(where,source,start,end,format,vl);
 }
 
+// get the line number , starts from 1 , of the position in source code
+size_t GetSourceLine( const std::string& source , size_t pos );
+
 // get source code snippet
 std::string GetSourceSnippetInOneLine( const std::string& source , size_t start, size_t end );
 inline std::string GetSourceSnippetInOneLine( const std::string& source , const SourceCodeInfo& sci ) {
@@ -2,6 +2,7 @@
 #include "os.h"
 #include "objects.h"
 #include "hash.h"
+#include "context.h"
 
 #include <iostream>
 #include <fstream>
@@ -491,60 +492,6 @@ Script** GC::NewScript( Context* context ,
   return ref;
 }
 
-bool GC::GrowInterpreterStack( interpreter::Runtime* runtime ) {
-  // Get max_stack_size of interpreter
-  const std::size_t max_stack_size = LAVA_OPTION(Interpreter,max_stack_size);
-
-  if(interpreter_stack_size() >= max_stack_size) return false;
-
-  std::size_t nsize = interpreter_stack_size() * 2;
-
-  if(nsize > max_stack_size) nsize = max_stack_size;
-
-  if(!nsize) nsize = LAVA_OPTION(Interpreter,init_stack_size);
-
-  /**
-   * this loop figures out the diff for each runtime object created while
-   * doing the intepretation. Because after the realloc, we gonna lose the
-   * diff information due to the old pointer is not valid anymore
-   */
-  std::vector<std::uint64_t> diff_array;
-  diff_array.reserve(16);
-
-  {
-    auto temp = runtime;
-    do {
-      auto diff = (char*)(temp->cur_stk) - (char*)(interp_stack_start_);
-      diff_array.push_back(diff);
-      temp = temp->previous;
-    } while(temp);
-  }
-
-  // do the reallcation
-  void* data = Realloc( allocator_ , interp_stack_start_ , nsize * sizeof(Value) );
-
-  interp_stack_start_ = reinterpret_cast<Value*>(data);
-  interp_stack_end_   = reinterpret_cast<Value*>(data) + nsize;
-
-  // setup the test field for indicating the stack is overflow
-  Value* test_field = interp_stack_end_ - interpreter::kRegisterSize;
-
-
-  /**
-   * Restore each runtime's field due to the nested call or other stuff
-   */
-  {
-    std::size_t idx = 0;
-    do {
-      runtime->cur_stk = interp_stack_start_ + diff_array[idx];
-      runtime->stack_test = test_field;
-      runtime = runtime->previous;
-    } while(runtime);
-  }
-
-  return true;
-}
-
 /**
  * Marking phase for our GC
  *
@@ -604,6 +551,13 @@ void GC::ForceGC() {
   if(result.dead_size >0) {
     PhaseSwap(result.new_heap_size);
   }
+
+  // The interpreter caches hold raw address of heap objects and ref slots ,
+  // which may be moved or released by this cycle ; drop them all
+  if(context_) {
+    context_->call_site_cache()->Clear();
+    context_->global_cache()->Clear();
+  }
   ++cycle_;
 }
 
@@ -13,6 +13,7 @@
 #include "bits.h"
 #include "util.h"
 #include "trace.h"
+#include "os.h"
 #include "free-list.h"
 #include "bump-allocator.h"
 
@@ -580,6 +581,7 @@ inline SSO* SSOPool::Iterator::sso() const {
 class GC : AllStatic {
  public:
   inline GC( Context* , HeapAllocator* allocator = NULL );
+  inline ~GC();
 
  public:
   std::size_t cycle() const { return cycle_; }
@@ -679,22 +681,17 @@ class GC : AllStatic {
   bool TryGC();
 
  public:
-  // Grow the interpreter stack size into the next possible stack size
-  // which should not exceeds the maximum size, if so function returns
-  // false. This function will *modify* the *cur_stk* field as well and
-  // the intepreter should make change to corresponding register to reflect
-  // the cur_stk field changes.
-  bool GrowInterpreterStack    ( interpreter::Runtime* runtime );
-
   // Get the current interpreter stack size . NOTES: this is not a size of
   // byte but size of Value object
   std::size_t interpreter_stack_size() const {
     return interp_stack_end_ - interp_stack_start_;
   }
 
+  // The interpreter stack is reserved once with its maximum size and never
+  // moves. The memory right after interp_stack_end() is a guard area , touching
+  // it means the interpreter stack overflows.
   Value* interp_stack_start() const { return interp_stack_start_; }
   Value* interp_stack_end  () const { return interp_stack_end_  ; }
-  Value* interp_stack_test () const { return interp_stack_end_ + interpreter::kRegisterSize; }
 
  private: // GC related code
 
@@ -790,11 +787,21 @@ inline GC::GC( Context* context , HeapAllocator* allocator ):
   context_              (context),
   allocator_            (allocator)
 {
-  // initialize the interpreter stack pointer at very first
-  auto sz = LAVA_OPTION(Interpreter,init_stack_size);
-  void* data = Realloc( allocator_ , interp_stack_start_ , sz * sizeof(Value) );
+  // reserve the whole interpreter stack up front , pages are committed by the
+  // OS lazily when the interpreter touches them
+  std::size_t sz = LAVA_OPTION(Interpreter,max_stack_size) * sizeof(Value);
+  std::size_t adjusted_size;
+  void* data = OS::ReserveMemory(sz,interpreter::kStackGuardSize,&adjusted_size);
+  lava_verify(data);
   interp_stack_start_ = reinterpret_cast<Value*>(data);
-  interp_stack_end_   = reinterpret_cast<Value*>(data) + sz;
+  interp_stack_end_   = reinterpret_cast<Value*>(
+      static_cast<char*>(data) + adjusted_size);
+}
+
+inline GC::~GC() {
+  OS::FreeReservedMemory(interp_stack_start_,
+                         interpreter_stack_size() * sizeof(Value),
+                         interpreter::kStackGuardSize);
 }
 
 } // namespace lavascript
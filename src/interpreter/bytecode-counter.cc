@@ -0,0 +1,101 @@
+#include "bytecode-counter.h"
+#include "src/error-report.h"
+
+#include <algorithm>
+#include <cinttypes>
+
+namespace lavascript {
+namespace interpreter {
+
+std::uint64_t BytecodeCounter::total() const {
+  std::uint64_t sum = 0;
+  for( auto c : opcode_ ) sum += c;
+  return sum;
+}
+
+void BytecodeCounter::GetHotBytecode( std::size_t n , std::vector<HotBytecode>* output ) const {
+  output->clear();
+  output->reserve(pc_.size());
+  for( auto &e : pc_ ) {
+    HotBytecode hb;
+    hb.pc    = e.first;
+    hb.proto = e.second.proto;
+    hb.bc    = static_cast<Bytecode>(*e.first & 0xff);
+    hb.count = e.second.count;
+    output->push_back(hb);
+  }
+  std::size_t top = n < output->size() ? n : output->size();
+  std::partial_sort(output->begin(),output->begin()+top,output->end(),
+                    []( const HotBytecode& l , const HotBytecode& r ) {
+                      return l.count > r.count ||
+                            (l.count == r.count && l.pc < r.pc);
+                    });
+  output->resize(top);
+}
+
+void BytecodeCounter::Dump( const Handle<Script>& script , std::size_t n ,
+                                                           DumpWriter* writer ) const {
+  std::uint64_t sum = total();
+  if(!sum) sum = 1;
+
+  {
+    DumpWriter::Section section(writer,"Opcode histogram");
+    std::vector<std::size_t> order;
+    for( std::size_t i = 0 ; i < SIZE_OF_BYTECODE ; ++i )
+      if(opcode_[i]) order.push_back(i);
+    std::sort(order.begin(),order.end(),[this]( std::size_t l , std::size_t r ) {
+        return opcode_[l] > opcode_[r];
+    });
+    for( auto i : order ) {
+      writer->WriteL("%-10s %12" PRIu64 " %6.2f%%",GetBytecodeName(static_cast<Bytecode>(i)),
+                                                  opcode_[i],
+                                                  opcode_[i]*100.0/sum);
+    }
+  }
+
+  {
+    DumpWriter::Section section(writer,"Top %d hot bytecode",static_cast<int>(n));
+    std::vector<HotBytecode> hot;
+    GetHotBytecode(n,&hot);
+
+    const std::string source(script->source()->ToStdString());
+    for( auto &hb : hot ) {
+      Handle<Prototype> proto(hb.proto);
+      const SourceCodeInfo& sci = proto->GetSci(hb.pc - proto->code_buffer());
+      int line = static_cast<int>(GetSourceLine(source,sci.start));
+      writer->WriteL("%-10s %12" PRIu64 " %6.2f%% line %d: %s",GetBytecodeName(hb.bc),
+                                                             hb.count,
+                                                             hb.count*100.0/sum,
+                                                             line,
+                                                             GetSourceSnippetInOneLine(source,sci).c_str());
+    }
+  }
+}
+
+void BytecodeCounter::WriteOpcodeProfile( std::string* output ) const {
+  output->clear();
+  for( std::size_t i = 0 ; i < SIZE_OF_BYTECODE ; ++i ) {
+    if(opcode_[i])
+      output->append(Format("%s %" PRIu64 "\n",GetBytecodeName(static_cast<Bytecode>(i)),
+                                               opcode_[i]));
+  }
+  for( std::size_t i = 0 ; i < SIZE_OF_BYTECODE ; ++i ) {
+    for( std::size_t j = 0 ; j < SIZE_OF_BYTECODE ; ++j ) {
+      std::uint64_t c = pair_[i*SIZE_OF_BYTECODE+j];
+      if(c)
+        output->append(Format("%s %s %" PRIu64 "\n",GetBytecodeName(static_cast<Bytecode>(i)),
+                                                    GetBytecodeName(static_cast<Bytecode>(j)),
+                                                    c));
+    }
+  }
+}
+
+void BytecodeCounter::Clear() {
+  for( auto &c : opcode_ ) c = 0;
+  std::fill(pair_.begin(),pair_.end(),0);
+  pc_.clear();
+  last_ = SIZE_OF_BYTECODE;
+}
+
+} // namespace interpreter
+} // namespace lavascript
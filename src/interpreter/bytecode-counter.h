@@ -0,0 +1,110 @@
+#ifndef BYTECODE_COUNTER_H_
+#define BYTECODE_COUNTER_H_
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "src/trace.h"
+#include "src/objects.h"
+#include "bytecode.h"
+
+namespace lavascript {
+class DumpWriter;
+
+namespace interpreter{
+
+// -----------------------------------------------------------------------
+// Bytecode execution counter.
+//
+// When a BytecodeCounter is installed into the AssemblerInterpreter , the
+// interpreter runs with the counting dispatch table instead of the normal
+// one. Each handler of the counting table calls out to bump the counter of
+// the opcode and the counter of the instruction , ie the (Prototype , PC)
+// pair , and then continues to the normal handler. It is slow but it needs
+// no rebuild of the interpreter and it tells which part of the script the
+// interpreter spends its time on.
+//
+// The counter doesn't keep the Prototype alive , so the script must still
+// be alive when the counter is dumped.
+//
+// It also counts how often an opcode is followed by another one , which
+// together with the opcode histogram forms the opcode profile used to lay
+// out the bytecode handlers , see HandlerLayout.
+// -----------------------------------------------------------------------
+class BytecodeCounter {
+ public:
+  struct HotBytecode {
+    const std::uint32_t* pc;
+    Prototype**          proto;
+    Bytecode             bc;
+    std::uint64_t        count;
+  };
+
+  BytecodeCounter() : opcode_() , pair_(SIZE_OF_BYTECODE*SIZE_OF_BYTECODE) ,
+                                  pc_    () ,
+                                  last_  (SIZE_OF_BYTECODE) {}
+
+  inline void Count( Bytecode , Prototype** , const std::uint32_t* pc );
+
+  // execution count of the opcode
+  std::uint64_t opcode_count( Bytecode bc ) const { return opcode_[bc]; }
+
+  // how many times opcode *next* is executed right after opcode *prev*
+  std::uint64_t opcode_pair_count( Bytecode prev , Bytecode next ) const {
+    return pair_[prev*SIZE_OF_BYTECODE+next];
+  }
+
+  // execution count of the instruction
+  std::uint64_t count( const std::uint32_t* pc ) const {
+    auto itr = pc_.find(pc);
+    return itr == pc_.end() ? 0 : itr->second.count;
+  }
+
+  // total number of instructions executed
+  std::uint64_t total() const;
+
+  // Get top n hottest instructions , hottest first
+  void GetHotBytecode( std::size_t n , std::vector<HotBytecode>* ) const;
+
+  // Dump the opcode histogram and the top n hottest instructions with the
+  // source code location of the script they belong to
+  void Dump( const Handle<Script>& , std::size_t n , DumpWriter* ) const;
+
+  // Write the opcode profile in text , one "<opcode> <count>" line for each
+  // executed opcode followed by one "<opcode> <opcode> <count>" line for each
+  // executed opcode pair. HandlerLayout::Load reads it back.
+  void WriteOpcodeProfile( std::string* ) const;
+
+  void Clear();
+
+ private:
+  struct Entry {
+    Prototype**   proto;
+    std::uint64_t count;
+    Entry() : proto(NULL) , count(0) {}
+  };
+
+  std::uint64_t opcode_[SIZE_OF_BYTECODE];
+  std::vector<std::uint64_t> pair_;
+  std::unordered_map<const std::uint32_t*,Entry> pc_;
+  std::size_t last_; // last counted opcode , SIZE_OF_BYTECODE if none
+
+  LAVA_DISALLOW_COPY_AND_ASSIGN(BytecodeCounter)
+};
+
+inline void BytecodeCounter::Count( Bytecode bc , Prototype** proto ,
+                                                  const std::uint32_t* pc ) {
+  ++opcode_[bc];
+  if(last_ != SIZE_OF_BYTECODE) ++pair_[last_*SIZE_OF_BYTECODE+bc];
+  last_ = bc;
+  Entry& e = pc_[pc];
+  e.proto  = proto;
+  ++e.count;
+}
+
+} // namespace interpreter
+} // namespace lavascript
+
+#endif // BYTECODE_COUNTER_H_
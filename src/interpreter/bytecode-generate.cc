@@ -6,6 +6,7 @@
 
 #include <vector>
 #include <memory>
+#include <limits>
 
 namespace lavascript {
 namespace interpreter {
@@ -1697,6 +1698,30 @@ bool Generator::Visit( const ast::If& node ) {
   return true;
 }
 
+/*
+ * A for loop is integral when its start , end and step are all integral
+ * literals which fits in int32. The end and step are stored in the loop
+ * iterator registers which cannot be modified by the loop body, so the
+ * interpreter only needs to check the induction variable.
+ */
+namespace {
+
+bool IsIntegralLiteral( const ast::Node* node ) {
+  if(!node || !node->IsLiteral() || !node->AsLiteral()->IsReal()) return false;
+  double v = node->AsLiteral()->real_value;
+  return v >= std::numeric_limits<std::int32_t>::min() &&
+         v <= std::numeric_limits<std::int32_t>::max() &&
+         static_cast<double>(static_cast<std::int32_t>(v)) == v;
+}
+
+} // namespace
+
+bool Generator::IsIntegralLoop( const ast::For& node ) const {
+  return node._1st && IsIntegralLiteral(node._1st->expr) &&
+         IsIntegralLiteral(node._2nd) &&
+         IsIntegralLiteral(node._3rd);
+}
+
 bool Generator::Visit( const ast::For& node ) {
   BytecodeBuilder::Label forward;
   Register induct_reg;
@@ -1766,10 +1791,17 @@ bool Generator::Visit( const ast::For& node ) {
 
     if(node._2nd) {
       if(node._3rd) {
-        // 1. We have step and condition variable, use fend2 instruction
-        SEMIT(fend2,node.sci(),induct_reg.index(),second_reg.index(),
-                                                  third_reg.index(),
-                                                  header);
+        // 1. We have step and condition variable, use fend2 instruction or
+        //    its integral version fend2i
+        if(IsIntegralLoop(node)) {
+          SEMIT(fend2i,node.sci(),induct_reg.index(),second_reg.index(),
+                                                     third_reg.index(),
+                                                     header);
+        } else {
+          SEMIT(fend2,node.sci(),induct_reg.index(),second_reg.index(),
+                                                    third_reg.index(),
+                                                    header);
+        }
       } else {
         // 2. We only have condition variable, no stepping
         SEMIT(fend1,node.sci(),induct_reg.index(),second_reg.index(),
@@ -1798,15 +1830,20 @@ bool Generator::Visit( const ast::For& node ) {
 }
 
 bool Generator::Visit( const ast::ForEach& node ) {
-  // Get the iterator register
+  // Get the iterator register. The foreach loop needs 2 consecutive registers,
+  // one holds the container and the one after it holds the cursor. They are
+  // implicitly used by festart/feend/idref so only the first one is encoded.
   Register itr_reg(lexical_scope()->GetLoopIter1());
+  Register cursor_reg(lexical_scope()->GetLoopIter2());
+  lava_debug(NORMAL,lava_verify(cursor_reg.index() == itr_reg.index() + 1););
+  (void)cursor_reg;
 
   // Evaluate the interator initial value and force it into iter_reg
   if(!VisitExpressionWithOutputRegister(*node.iter,itr_reg)) return false;
 
 
-  // Generate the festart. Festart will convert itr_reg into iterator
-  // and then do the comparison and other stuff
+  // Generate the festart. Festart will setup the cursor , or convert
+  // itr_reg into heap iterator for extension , and then do the comparison
   BytecodeBuilder::Label forward =
     func_scope()->bb()->festart(func_scope()->ra()->base(),node.sci(),
                                                            itr_reg.index());
@@ -628,6 +628,7 @@ class Generator {
   bool Visit( const ast::If& );
 
   bool Visit( const ast::For& );
+  bool IsIntegralLoop( const ast::For& node ) const;
   bool Visit( const ast::ForEach& );
   bool Visit( const ast::Break& );
   bool Visit( const ast::Continue& );
@@ -234,6 +234,8 @@ class BytecodeUsage {
   __(B,FSTART,fstart,  OUTPUT, PC     , UNUSED , UNUSED,true ) \
   __(H,FEND1,fend1  ,  INPUT , INPUT  , UNUSED , PC    ,true ) \
   __(H,FEND2,fend2  ,  INPUT , INPUT  , INPUT  , PC    ,true ) \
+  /* fend2i is fend2 with integral start/end/step literals */ \
+  __(H,FEND2I,fend2i,  INPUT , INPUT  , INPUT  , PC    ,true ) \
   __(X,FEVRSTART,fevrstart,UNUSED,UNUSED,UNUSED,UNUSED ,false) \
   /* fevrend also has feedback , thouth it is empty, we need it */    \
   /* simply because we can use the fevrend to stop a profile trace */ \
@@ -290,7 +292,8 @@ inline bool IsLoopStartBytecode( Bytecode bc ) {
 }
 
 inline bool IsLoopEndBytecode( Bytecode bc ) {
-  return bc == BC_FEND1 || bc == BC_FEND2 || bc == BC_FEVREND || bc == BC_FEEND;
+  return bc == BC_FEND1 || bc == BC_FEND2 || bc == BC_FEND2I || bc == BC_FEVREND ||
+         bc == BC_FEEND;
 }
 
 inline bool IsBlockJumpBytecode( Bytecode bc ) {
@@ -0,0 +1,33 @@
+#include "call-site-cache.h"
+#include "src/runtime-trace.h"
+
+namespace lavascript {
+namespace interpreter {
+
+const CallSiteCacheEntry* CallSiteCache::GetCallTarget( const std::uint32_t* pc ) const {
+  auto e = Find(pc);
+  if(e && e->miss <= kCallSiteCacheMaxMiss) return e;
+  return NULL;
+}
+
+void CallSiteCache::FeedRuntimeTrace( const Handle<Prototype>& proto ,
+                                      RuntimeTrace* trace ) const {
+  const std::uint32_t* start = proto->code_buffer();
+  const std::uint32_t* end   = start + proto->code_buffer_size();
+
+  for( auto &e : entry_ ) {
+    if(e.pc >= start && e.pc < end && e.miss <= kCallSiteCacheMaxMiss) {
+      trace->AddCallTrace(e.pc,CallTracePoint(Value(Handle<Closure>(e.cls)),
+                                              e.argument_size,
+                                              e.max_local_var_size,
+                                              e.hit));
+    }
+  }
+}
+
+void CallSiteCache::Clear() {
+  for( auto &e : entry_ ) e = CallSiteCacheEntry();
+}
+
+} // namespace interpreter
+} // namespace lavascript
@@ -0,0 +1,102 @@
+#ifndef CALL_SITE_CACHE_H_
+#define CALL_SITE_CACHE_H_
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+#include "src/trace.h"
+#include "src/objects.h"
+
+namespace lavascript {
+class RuntimeTrace;
+
+namespace interpreter{
+
+// Size of the call site cache table, must be power of 2 since the assembly
+// interpreter uses ((PC >> 2) & (kCallSiteCacheSize-1)) as hash function
+static const std::size_t kCallSiteCacheSize = 256;
+
+// Once a call site is rebound to a different callee more than this times ,
+// it is considered polymorphic and it will not be used as inline feedback
+static const std::uint32_t kCallSiteCacheMaxMiss = 4;
+
+// -----------------------------------------------------------------------
+// Monomorphic call site cache.
+//
+// Each CALL/TCALL instruction hashes its PC into a direct mapped table and
+// remembers the last closure it called. When the callee Value is the same
+// one , the interpreter skips the type dispatch and the argument number check
+// and setup the frame directly from the cached closure. A miss simply rebinds
+// the entry to the new callee.
+//
+// The table is owned by Context so it survives multiple runs of a script and
+// the cached callee , along with its frame size , is also used as call target
+// feedback for the JIT. It holds raw callee bits and closure ref slot , so it
+// is cleared by every GC cycle since both may be reused after the collection.
+// -----------------------------------------------------------------------
+struct CallSiteCacheEntry {
+  const std::uint32_t* pc;     // PC of the call site , NULL means empty
+  std::uint64_t        callee; // raw bits of the callee Value
+  Closure**            cls;    // cached closure
+  std::uint32_t        hit;    // how many times the cached closure is called
+  std::uint16_t        miss;   // how many times this entry has been rebound , saturated
+  std::uint8_t         argument_size;      // frame info of the cached closure
+  std::uint8_t         max_local_var_size;
+
+  CallSiteCacheEntry(): pc(NULL), callee(0), cls(NULL), hit(0), miss(0),
+                        argument_size(0), max_local_var_size(0) {}
+};
+
+static_assert( std::is_standard_layout<CallSiteCacheEntry>::value );
+static_assert( sizeof(CallSiteCacheEntry) == 32 ); // assembly interpreter relies on it
+
+struct CallSiteCacheEntryLayout {
+  static const std::uint32_t kPCOffset     = offsetof(CallSiteCacheEntry,pc);
+  static const std::uint32_t kCalleeOffset = offsetof(CallSiteCacheEntry,callee);
+  static const std::uint32_t kClsOffset    = offsetof(CallSiteCacheEntry,cls);
+  static const std::uint32_t kHitOffset    = offsetof(CallSiteCacheEntry,hit);
+  static const std::uint32_t kMissOffset   = offsetof(CallSiteCacheEntry,miss);
+  static const std::uint32_t kArgumentSizeOffset = offsetof(CallSiteCacheEntry,argument_size);
+  static const std::uint32_t kMaxLocalVarSizeOffset =
+    offsetof(CallSiteCacheEntry,max_local_var_size);
+};
+
+class CallSiteCache {
+ public:
+  CallSiteCache() : entry_() {}
+
+  // Find the cache entry of a call site , return NULL if the call site
+  // is not cached
+  inline const CallSiteCacheEntry* Find( const std::uint32_t* pc ) const;
+
+  // Find the cache entry of the call site if it is monomorphic enough to be
+  // used as feedback
+  const CallSiteCacheEntry* GetCallTarget( const std::uint32_t* pc ) const;
+
+  // Feed all monomorphic call sites inside of the prototype into the runtime
+  // trace as CallTracePoint , so the graph builder will pick them up as inline
+  // candidate.
+  void FeedRuntimeTrace( const Handle<Prototype>& , RuntimeTrace* ) const;
+
+  // Drop all cached entries
+  void Clear();
+
+  CallSiteCacheEntry* entry() { return entry_; }
+
+  static std::size_t Hash( const std::uint32_t* pc ) {
+    return (reinterpret_cast<std::uintptr_t>(pc) >> 2) & (kCallSiteCacheSize-1);
+  }
+
+ private:
+  CallSiteCacheEntry entry_[kCallSiteCacheSize];
+};
+
+inline const CallSiteCacheEntry* CallSiteCache::Find( const std::uint32_t* pc ) const {
+  const CallSiteCacheEntry& e = entry_[Hash(pc)];
+  return e.pc == pc ? &e : NULL;
+}
+
+} // namespace interpreter
+} // namespace lavascript
+
+#endif // CALL_SITE_CACHE_H_
@@ -0,0 +1,72 @@
+#include "coroutine.h"
+#include "runtime.h"
+
+#include "src/context.h"
+#include "src/call-frame.h"
+#include "src/os.h"
+
+namespace lavascript {
+namespace interpreter {
+
+const char* GetCoroutineStatusName( CoroutineStatus st ) {
+  switch(st) {
+    case COROUTINE_READY:     return "ready";
+    case COROUTINE_SUSPENDED: return "suspended";
+    case COROUTINE_DONE:      return "done";
+    default:                  return "failed";
+  }
+}
+
+Coroutine::Coroutine( Context* context , const Handle<Script>& script ,
+                                         const Handle<Object>& globals ,
+                                         std::size_t stack_size ):
+  context_    (context),
+  stack_start_(NULL),
+  stack_end_  (NULL),
+  main_       (Closure::New(context->gc(),Handle<Prototype>(script->main()))),
+  runtime_    (),
+  status_     (COROUTINE_READY),
+  yield_value_(),
+  yielded_    (false)
+{
+  // own stack segment , reserved up front and ends with a guard area so the
+  // stack probe of call instruction works as it does on the Context's stack
+  std::size_t adjusted_size;
+  void* data = OS::ReserveMemory(stack_size*sizeof(Value),kStackGuardSize,&adjusted_size);
+  lava_verify(data);
+  stack_start_ = reinterpret_cast<Value*>(data);
+  stack_end_   = reinterpret_cast<Value*>(static_cast<char*>(data) + adjusted_size);
+
+  runtime_.reset(new Runtime(context,script,main_,globals,this));
+  runtime_->cur_pc = Handle<Prototype>(script->main())->code_buffer();
+}
+
+Coroutine::~Coroutine() {
+  lava_debug(NORMAL,lava_verify(context_->runtime() != runtime_.get()););
+  runtime_.reset();
+  OS::FreeReservedMemory(stack_start_,(stack_end_ - stack_start_)*sizeof(Value),
+                                      kStackGuardSize);
+}
+
+bool Coroutine::Yield( CallFrame* cf , const Value& value , std::string* error ) {
+  Runtime* runtime = cf->interp_runtime();
+  if(cf->frame_type() != INTERPRETER_FRAME || !runtime->coroutine) {
+    *error = "yield can only be called inside of a coroutine";
+    return false;
+  }
+  Coroutine* co = runtime->coroutine;
+  co->yielded_     = true;
+  co->yield_value_ = value;
+
+  // The budget is checked right after the extension call returns , so set
+  // it to be exhausted at that check. A nested runtime of the coroutine writes
+  // its budget back to the previous one when it is popped , but the runtimes
+  // below it must give up at their own check as well. The coroutine gets a
+  // fresh budget when it is resumed.
+  for( Runtime* r = runtime ; r && r->coroutine == co ; r = r->previous )
+    r->budget = 1;
+  return true;
+}
+
+} // namespace interpreter
+} // namespace lavascript
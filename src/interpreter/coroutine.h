@@ -0,0 +1,96 @@
+#ifndef COROUTINE_H_
+#define COROUTINE_H_
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+#include "src/config.h"
+#include "src/trace.h"
+#include "src/objects.h"
+
+namespace lavascript {
+class Context;
+class CallFrame;
+
+namespace interpreter{
+struct Runtime;
+class AssemblerInterpreter;
+
+enum CoroutineStatus {
+  COROUTINE_READY,     // created but not started
+  COROUTINE_SUSPENDED, // yielded or ran out of instruction budget
+  COROUTINE_DONE,      // returned from the script
+  COROUTINE_FAILED     // stopped due to an error
+};
+
+const char* GetCoroutineStatusName( CoroutineStatus );
+
+// -----------------------------------------------------------------------
+// Coroutine.
+//
+// A Coroutine runs a script on its own interpreter stack segment with its
+// own Runtime object , so it can be suspended in the middle of the script
+// and resumed later by the host while other coroutines or runs use the same
+// Context in between. Frames of a suspended coroutine simply stay on its
+// stack segment , and the Runtime remembers the closure , stack and pc of
+// the innermost frame to continue from.
+//
+// A coroutine is suspended when :
+//
+//   1) an extension function called by the script calls Coroutine::Yield ,
+//      the coroutine is suspended once the extension returns and the value
+//      passed to Resume becomes the return value of the extension call
+//   2) the instruction budget of the interpreter runs out
+//
+// The Runtime of a coroutine is only the current Runtime of the Context
+// while it is running , Runtime::previous links it to the one it is resumed
+// from.
+// -----------------------------------------------------------------------
+class Coroutine {
+ public:
+  Coroutine( Context* , const Handle<Script>& , const Handle<Object>& globals ,
+             std::size_t stack_size = kCoroutineStackSize );
+  ~Coroutine();
+
+  CoroutineStatus status() const { return status_; }
+  bool IsAlive() const {
+    return status_ == COROUTINE_READY || status_ == COROUTINE_SUSPENDED;
+  }
+
+  // Whether the coroutine is suspended by Yield , otherwise it is suspended
+  // due to running out of instruction budget
+  bool yielded() const { return yielded_; }
+
+  Context* context() const { return context_; }
+  Runtime* runtime() const { return runtime_.get(); }
+
+  // Interpreter stack segment of this coroutine , it ends with a guard area
+  // just like the Context's interpreter stack
+  Value* stack_start() const { return stack_start_; }
+  Value* stack_end  () const { return stack_end_;   }
+
+ public:
+  // Suspend the coroutine which is running the extension function once the
+  // extension returns. The value is returned to the host by the Resume call.
+  // Fails if the extension is not called by a coroutine.
+  static bool Yield( CallFrame* , const Value& , std::string* );
+
+ private:
+  Context* context_;
+  Value* stack_start_;
+  Value* stack_end_;
+  Handle<Closure> main_;
+  std::unique_ptr<Runtime> runtime_;
+  CoroutineStatus status_;
+  Value yield_value_;
+  bool yielded_;
+
+  friend class AssemblerInterpreter;
+
+  LAVA_DISALLOW_COPY_AND_ASSIGN(Coroutine)
+};
+
+} // namespace interpreter
+} // namespace lavascript
+
+#endif // COROUTINE_H_
@@ -0,0 +1,98 @@
+#ifndef GLOBAL_CACHE_H_
+#define GLOBAL_CACHE_H_
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+#include "src/trace.h"
+#include "src/objects.h"
+
+namespace lavascript {
+namespace interpreter{
+
+// Size of the global cache table, must be power of 2 since the assembly
+// interpreter uses ((PC >> 2) & (kGlobalCacheSize-1)) as hash function
+static const std::size_t kGlobalCacheSize = 256;
+
+// -----------------------------------------------------------------------
+// Global variable slot cache.
+//
+// GGET/GGETSSO/GSET/GSETSSO hash their PC into a direct mapped table and
+// remember the Map::Entry , ie the property cell , of the global they
+// accessed last time. An entry of Map never moves until the Map is rehashed
+// so the cell is valid as long as :
+//
+//   1) the global object's Map is still the one we cached , this fails if
+//      the Map is rehashed or the global object is swapped
+//   2) the cell still holds the same key and it is not deleted
+//
+// The interpreter checks both conditions before using the cell , so any
+// mutation of the global object simply turns into a cache miss which goes
+// back to the hash lookup and rebinds the entry.
+//
+// The Map and the cell are raw address inside of the heap , a GC cycle may
+// move or release them and reuse the address , so the whole table is dropped
+// by every GC cycle.
+// -----------------------------------------------------------------------
+struct GlobalCacheEntry {
+  const std::uint32_t* pc;   // PC of the global access instruction
+  Map*                 map;  // Map of the global object when cached
+  Map::Entry*          cell; // cached property cell
+  String**             key;  // key of the cell when cached
+
+  GlobalCacheEntry(): pc(NULL), map(NULL), cell(NULL), key(NULL) {}
+};
+
+static_assert( std::is_standard_layout<GlobalCacheEntry>::value );
+static_assert( sizeof(GlobalCacheEntry) == 32 ); // assembly interpreter relies on it
+
+struct GlobalCacheEntryLayout {
+  static const std::uint32_t kPCOffset   = offsetof(GlobalCacheEntry,pc);
+  static const std::uint32_t kMapOffset  = offsetof(GlobalCacheEntry,map);
+  static const std::uint32_t kCellOffset = offsetof(GlobalCacheEntry,cell);
+  static const std::uint32_t kKeyOffset  = offsetof(GlobalCacheEntry,key);
+};
+
+class GlobalCache {
+ public:
+  GlobalCache() : entry_() {}
+
+  // Find the cached cell of the global access instruction if it is still
+  // valid for the given Map of the global object , otherwise return NULL
+  inline Map::Entry* Find( const std::uint32_t* pc , const Map* map ) const;
+
+  // Bind the global access instruction to the cell
+  inline void Fill( const std::uint32_t* pc , Map* map , Map::Entry* cell );
+
+  // Drop all cached entries
+  void Clear() { for( auto &e : entry_ ) e = GlobalCacheEntry(); }
+
+  GlobalCacheEntry* entry() { return entry_; }
+
+  static std::size_t Hash( const std::uint32_t* pc ) {
+    return (reinterpret_cast<std::uintptr_t>(pc) >> 2) & (kGlobalCacheSize-1);
+  }
+
+ private:
+  GlobalCacheEntry entry_[kGlobalCacheSize];
+};
+
+inline Map::Entry* GlobalCache::Find( const std::uint32_t* pc , const Map* map ) const {
+  const GlobalCacheEntry& e = entry_[Hash(pc)];
+  if(e.pc == pc && e.map == map && e.cell->key == e.key && e.cell->active())
+    return e.cell;
+  return NULL;
+}
+
+inline void GlobalCache::Fill( const std::uint32_t* pc , Map* map , Map::Entry* cell ) {
+  GlobalCacheEntry& e = entry_[Hash(pc)];
+  e.pc   = pc;
+  e.map  = map;
+  e.cell = cell;
+  e.key  = cell->key;
+}
+
+} // namespace interpreter
+} // namespace lavascript
+
+#endif // GLOBAL_CACHE_H_
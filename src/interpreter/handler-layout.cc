@@ -0,0 +1,133 @@
+#include "handler-layout.h"
+#include "bytecode-counter.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+namespace lavascript {
+namespace interpreter {
+namespace {
+
+bool GetBytecodeByName( const char* name , Bytecode* output ) {
+  for( int i = 0 ; i < SIZE_OF_BYTECODE ; ++i ) {
+    if(strcmp(GetBytecodeName(static_cast<Bytecode>(i)),name) == 0) {
+      *output = static_cast<Bytecode>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+HandlerLayout::HandlerLayout():
+  count_(),
+  pair_ (SIZE_OF_BYTECODE*SIZE_OF_BYTECODE)
+{
+  for( int i = 0 ; i < SIZE_OF_BYTECODE ; ++i ) order_[i] = static_cast<Bytecode>(i);
+}
+
+void HandlerLayout::Load( const BytecodeCounter& counter ) {
+  for( int i = 0 ; i < SIZE_OF_BYTECODE ; ++i ) {
+    Bytecode prev = static_cast<Bytecode>(i);
+    count_[i] = counter.opcode_count(prev);
+    for( int j = 0 ; j < SIZE_OF_BYTECODE ; ++j ) {
+      pair_[i*SIZE_OF_BYTECODE+j] = counter.opcode_pair_count(prev,static_cast<Bytecode>(j));
+    }
+  }
+  Build();
+}
+
+bool HandlerLayout::Load( const std::string& profile , std::string* error ) {
+  std::uint64_t count[SIZE_OF_BYTECODE] = {};
+  std::vector<std::uint64_t> pair(SIZE_OF_BYTECODE*SIZE_OF_BYTECODE);
+
+  std::size_t start = 0;
+  std::size_t line  = 0;
+  while(start < profile.size()) {
+    std::size_t end = profile.find('\n',start);
+    if(end == std::string::npos) end = profile.size();
+    std::string l(profile.substr(start,end-start));
+    start = end + 1;
+    ++line;
+
+    char n1[64] , n2[64];
+    std::uint64_t c;
+    Bytecode b1 , b2;
+    bool ok = true;
+
+    if(sscanf(l.c_str(),"%63s %63s %" SCNu64,n1,n2,&c) == 3) {
+      if((ok = GetBytecodeByName(n1,&b1) && GetBytecodeByName(n2,&b2)))
+        pair[b1*SIZE_OF_BYTECODE+b2] = c;
+    } else if(sscanf(l.c_str(),"%63s %" SCNu64,n1,&c) == 2) {
+      if((ok = GetBytecodeByName(n1,&b1)))
+        count[b1] = c;
+    } else {
+      ok = l.find_first_not_of(" \t\r") == std::string::npos;
+    }
+
+    if(!ok) {
+      *error = Format("bad opcode profile at line %d: %s",static_cast<int>(line),l.c_str());
+      return false;
+    }
+  }
+
+  memcpy(count_,count,sizeof(count_));
+  pair_.swap(pair);
+  Build();
+  return true;
+}
+
+bool HandlerLayout::LoadFile( const char* path , std::string* error ) {
+  FILE* file = fopen(path,"r");
+  if(!file) {
+    *error = Format("cannot open opcode profile %s",path);
+    return false;
+  }
+  std::string profile;
+  char buf[1024];
+  std::size_t sz;
+  while((sz = fread(buf,1,sizeof(buf),file)) != 0) profile.append(buf,sz);
+  fclose(file);
+  return Load(profile,error);
+}
+
+void HandlerLayout::Build() {
+  bool placed[SIZE_OF_BYTECODE] = {};
+  std::size_t pos = 0;
+
+  // hottest opcode not yet placed , SIZE_OF_BYTECODE if none
+  auto hottest = [&]() {
+    std::size_t ret = SIZE_OF_BYTECODE;
+    for( std::size_t i = 0 ; i < SIZE_OF_BYTECODE ; ++i ) {
+      if(!placed[i] && count_[i] && (ret == SIZE_OF_BYTECODE || count_[i] > count_[ret]))
+        ret = i;
+    }
+    return ret;
+  };
+
+  std::size_t cur = hottest();
+  while(cur != SIZE_OF_BYTECODE) {
+    order_[pos++] = static_cast<Bytecode>(cur);
+    placed[cur]   = true;
+
+    // chain the most frequent successor which is not placed yet
+    std::size_t next = SIZE_OF_BYTECODE;
+    for( std::size_t i = 0 ; i < SIZE_OF_BYTECODE ; ++i ) {
+      std::uint64_t c = pair_[cur*SIZE_OF_BYTECODE+i];
+      if(!placed[i] && count_[i] && c &&
+         (next == SIZE_OF_BYTECODE || c > pair_[cur*SIZE_OF_BYTECODE+next]))
+        next = i;
+    }
+    cur = next == SIZE_OF_BYTECODE ? hottest() : next;
+  }
+
+  for( std::size_t i = 0 ; i < SIZE_OF_BYTECODE ; ++i ) {
+    if(!placed[i]) order_[pos++] = static_cast<Bytecode>(i);
+  }
+  lava_debug(NORMAL,lava_verify(pos == SIZE_OF_BYTECODE););
+}
+
+} // namespace interpreter
+} // namespace lavascript
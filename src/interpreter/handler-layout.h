@@ -0,0 +1,61 @@
+#ifndef HANDLER_LAYOUT_H_
+#define HANDLER_LAYOUT_H_
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "src/trace.h"
+#include "bytecode.h"
+
+namespace lavascript {
+namespace interpreter{
+class BytecodeCounter;
+
+// -----------------------------------------------------------------------
+// Layout of the bytecode handlers inside of the interpreter's code buffer.
+//
+// By default the handlers are emitted in the order of the bytecode list , so
+// a hot loop may touch handlers scattered all over the code buffer. With an
+// opcode profile , either taken from a BytecodeCounter or loaded from the
+// text written by BytecodeCounter::WriteOpcodeProfile , the handlers of the
+// executed opcodes are emitted first and each of them starts at a cache line.
+// They are chained greedily : starting from the hottest opcode , the next
+// handler is the not yet placed successor most often executed right after the
+// current one , or the hottest remaining opcode if there is none. Opcodes not
+// executed at all follow in the bytecode list order.
+// -----------------------------------------------------------------------
+class HandlerLayout {
+ public:
+  // Default layout , the bytecode list order with no hot handler
+  HandlerLayout();
+
+  // Lay out by the opcode profile recorded by the counter
+  void Load( const BytecodeCounter& );
+
+  // Lay out by the opcode profile in text , the layout is not changed on error
+  bool Load( const std::string& profile , std::string* error );
+
+  // Load the opcode profile from a file
+  bool LoadFile( const char* path , std::string* error );
+
+  // The i-th handler to emit
+  Bytecode order( std::size_t i ) const { return order_[i]; }
+
+  // Whether the handler is hot , ie it is executed in the profile
+  bool IsHot( Bytecode bc ) const { return count_[bc] != 0; }
+
+  std::uint64_t count( Bytecode bc ) const { return count_[bc]; }
+
+ private:
+  void Build();
+
+  std::uint64_t count_[SIZE_OF_BYTECODE];
+  std::vector<std::uint64_t> pair_;
+  Bytecode order_[SIZE_OF_BYTECODE];
+};
+
+} // namespace interpreter
+} // namespace lavascript
+
+#endif // HANDLER_LAYOUT_H_
@@ -47,6 +47,11 @@ namespace interpreter{
 // The reason why such structure is presented is because this is easier to
 // write assembly code
 // -----------------------------------------------------------------------
+// Markers stored in the base field of the bottom frame of an interpreter
+// entry , IFRAME_EOF and IFRAME_BATCH in the assembly interpreter
+static const std::uint16_t kIFrameEOF   = 0xffff;
+static const std::uint16_t kIFrameBatch = 0xfffe;
+
 struct IFrame {
   CompilationJob** cjob; // Pointer points CompilationJob
   std::uint64_t field1;  // First  8 bytes
@@ -54,7 +59,6 @@ struct IFrame {
 
  public:
   inline void SetUpAsExtension( std::uint16_t base , const std::uint32_t* pc ,
-                                                     bool tcall ,
                                                      std::uint8_t narg ,
                                                      Extension** );
 
@@ -64,7 +68,6 @@ struct IFrame {
   inline const std::uint32_t* pc() const;
   inline Closure** closure() const;
   inline Extension** extension() const;
-  inline bool tcall() const;
   inline std::uint8_t narg() const;
 
   enum { CLOSURE_CALL = 0 , EXTENSION_CALL = 1 };
@@ -80,13 +83,11 @@ struct IFrameLayout {
 };
 
 inline void IFrame::SetUpAsExtension( std::uint16_t base , const std::uint32_t* pc ,
-                                                           bool tcall ,
                                                            std::uint8_t narg ,
                                                            Extension** cls ) {
   std::uint64_t temp = static_cast<std::uint64_t>(base) << 48;
   field1 = temp | reinterpret_cast<std::uint64_t>(pc);
-  field2 = (static_cast<std::uint64_t>(tcall) << 56) |
-           (bits::BitOn<std::uint64_t,57,58>::value) |
+  field2 = (bits::BitOn<std::uint64_t,57,58>::value) |
            (static_cast<std::uint64_t>(narg)  << 48) |
            (reinterpret_cast<std::uint64_t>(cls));
 }
@@ -118,11 +119,6 @@ inline Extension** IFrame::extension() const {
       bits::BitOn<std::uint64_t,0,48>::value & field2);
 }
 
-inline bool IFrame::tcall() const {
-  std::uint64_t temp = field2 & bits::BitOn<std::uint64_t,56,57>::value;
-  return static_cast<bool>((temp>>56));
-}
-
 inline int IFrame::call_type() const {
   std::uint64_t temp = field2 & bits::BitOn<std::uint64_t,57,58>::value;
   return static_cast<int>(temp>>57);
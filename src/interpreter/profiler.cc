@@ -0,0 +1,230 @@
+#include "profiler.h"
+#include "runtime.h"
+#include "iframe.h"
+#include "x64-interpreter.h"
+
+#include "src/context.h"
+#include "src/error-report.h"
+
+#include <map>
+#include <csignal>
+#include <cstring>
+#include <sys/time.h>
+
+namespace lavascript {
+namespace interpreter {
+namespace {
+
+// The running profiler , SIGPROF is process wide so there can be only one
+Profiler* active_profiler;
+struct sigaction old_sigprof_action;
+
+void ProfilerSigProfHandler( int sig , siginfo_t* info , void* context ) {
+  (void)sig;
+  (void)info;
+  Profiler* profiler = active_profiler;
+  if(profiler) profiler->Sample(context);
+}
+
+} // namespace
+
+Profiler::Profiler( Context* context , std::size_t buffer_size ):
+  context_    (context),
+  stub_       (AssemblerInterpreterStub::GetInstance()),
+  buffer_     (buffer_size),
+  size_       (0),
+  sample_size_(0),
+  dropped_    (0),
+  running_    (false)
+{}
+
+Profiler::~Profiler() {
+  Stop();
+}
+
+bool Profiler::Start( std::size_t rate ) {
+  if(running_) return true;
+  if(active_profiler || !rate) return false;
+
+  active_profiler = this;
+
+  struct sigaction act;
+  memset(&act,0,sizeof(act));
+  act.sa_sigaction = ProfilerSigProfHandler;
+  act.sa_flags     = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&act.sa_mask);
+  if(sigaction(SIGPROF,&act,&old_sigprof_action) != 0) {
+    active_profiler = NULL;
+    return false;
+  }
+
+  struct itimerval timer;
+  std::size_t us = 1000000 / rate;
+  timer.it_interval.tv_sec  = static_cast<time_t>(us / 1000000);
+  timer.it_interval.tv_usec = static_cast<suseconds_t>(us % 1000000);
+  if(!timer.it_interval.tv_sec && !timer.it_interval.tv_usec)
+    timer.it_interval.tv_usec = 1;
+  timer.it_value = timer.it_interval;
+  if(setitimer(ITIMER_PROF,&timer,NULL) != 0) {
+    sigaction(SIGPROF,&old_sigprof_action,NULL);
+    active_profiler = NULL;
+    return false;
+  }
+
+  running_ = true;
+  return true;
+}
+
+void Profiler::Stop() {
+  if(!running_) return;
+
+  struct itimerval timer;
+  memset(&timer,0,sizeof(timer));
+  setitimer(ITIMER_PROF,&timer,NULL);
+  sigaction(SIGPROF,&old_sigprof_action,NULL);
+
+  active_profiler = NULL;
+  running_ = false;
+}
+
+void Profiler::Clear() {
+  size_        = 0;
+  sample_size_ = 0;
+  dropped_     = 0;
+}
+
+void Profiler::SetPrototypeFrame( Frame* f , Closure** cls , const std::uint32_t* pc ) {
+  Prototype** proto = (*cls)->prototype().ref();
+  const std::uint32_t* cb = (*proto)->code_buffer();
+
+  // PC points to the next instruction once it is dispatched , and the saved PC
+  // of the caller points to the one after the call instruction
+  f->object = reinterpret_cast<HeapObject**>(proto);
+  f->type   = FRAME_PROTOTYPE;
+  f->index  = (pc > cb && pc <= cb + (*proto)->code_buffer_size()) ?
+              static_cast<std::uint32_t>(pc - 1 - cb) : 0;
+}
+
+void Profiler::Sample( const void* ucontext ) {
+  Runtime* runtime = context_->runtime();
+  if(!runtime) return;
+
+  Value* stk;
+  const std::uint32_t* pc;
+  if(!stub_->GetInterpreterState(ucontext,&stk,&pc)) {
+    stk = runtime->cur_stk;
+    pc  = runtime->cur_pc;
+  }
+
+  // The registers are garbage while the interpreter is entering or leaving ,
+  // so only trust a STK that points into the stack segment of the runtime
+  Value* start = runtime->stack_start();
+  Value* end   = runtime->stack_end();
+
+  std::size_t pos   = size_;
+  std::size_t limit = buffer_.size();
+  if(pos + 1 >= limit) {
+    ++dropped_;
+    return;
+  }
+
+  Frame* header = &buffer_[pos++];
+  std::uint32_t depth = 0;
+
+  while(depth < kProfilerMaxDepth && pos < limit) {
+    if(stk <= start || stk >= end ||
+       reinterpret_cast<char*>(stk) - sizeof(IFrame) < reinterpret_cast<char*>(start))
+      break;
+
+    const IFrame* frame = reinterpret_cast<const IFrame*>(
+        reinterpret_cast<char*>(stk) - sizeof(IFrame));
+    Frame& f = buffer_[pos];
+
+    if(frame->call_type() == IFrame::EXTENSION_CALL) {
+      f.object = reinterpret_cast<HeapObject**>(frame->extension());
+      f.type   = FRAME_EXTENSION;
+      f.index  = 0;
+      ++pos; ++depth;
+    } else {
+      Closure** cls = frame->closure();
+      if(!cls || !*cls) break;
+      SetPrototypeFrame(&f,cls,pc);
+      ++pos; ++depth;
+
+      // the frames elided by tail call in this frame sit right below it
+      runtime->tcall_trace.VisitFrame(stk,cls,[&]( const TailCallTrace::Entry& e ) {
+        if(depth < kProfilerMaxDepth && pos < limit) {
+          SetPrototypeFrame(&buffer_[pos],e.cls,e.pc);
+          ++pos; ++depth;
+        }
+      });
+    }
+
+    std::uint16_t base = frame->base();
+    if(base >= kIFrameBatch) break; // bottom frame of the interpreter entry
+    stk = reinterpret_cast<Value*>(reinterpret_cast<char*>(stk) - base);
+    pc  = reinterpret_cast<const IFrame*>(
+        reinterpret_cast<char*>(stk) - sizeof(IFrame))->pc();
+  }
+
+  if(!depth) return;
+
+  header->object = NULL;
+  header->type   = FRAME_HEADER;
+  header->index  = depth;
+  size_ = pos;
+  ++sample_size_;
+}
+
+void Profiler::GetFoldedStack( const Handle<Script>& script , std::string* output ) const {
+  // name of each function defined by the script
+  std::map<Prototype**,std::string> name;
+  name[script->main().ref()] = "main";
+  for( std::size_t i = 0 ; i < script->function_table_size() ; ++i ) {
+    const Script::FunctionTableEntry& e = script->GetFunction(i);
+    name[e.prototype.ref()] = e.name ? e.name->ToStdString() : "<anonymous>";
+  }
+
+  const std::string source(script->source()->ToStdString());
+  std::map<std::string,std::uint64_t> stack;
+  std::vector<std::string> label;
+
+  std::size_t size = size_;
+  for( std::size_t i = 0 ; i < size ; ) {
+    const Frame& header = buffer_[i];
+    lava_debug(NORMAL,lava_verify(header.type == FRAME_HEADER););
+
+    label.clear();
+    for( std::size_t j = 0 ; j < header.index ; ++j ) {
+      const Frame& f = buffer_[i+1+j];
+      if(f.type == FRAME_EXTENSION) {
+        Handle<Extension> ext(reinterpret_cast<Extension**>(f.object));
+        label.push_back(ext->name());
+      } else {
+        Prototype** ref = reinterpret_cast<Prototype**>(f.object);
+        Handle<Prototype> proto(ref);
+        auto itr = name.find(ref);
+        std::size_t line = GetSourceLine(source,proto->GetSci(f.index).start);
+        label.push_back(Format("%s:%d",itr == name.end() ? "<unknown>" : itr->second.c_str(),
+                                        static_cast<int>(line)));
+      }
+    }
+
+    // frames are recorded from the innermost one
+    std::string key;
+    for( auto itr = label.rbegin() ; itr != label.rend() ; ++itr ) {
+      if(!key.empty()) key.push_back(';');
+      key.append(*itr);
+    }
+    ++stack[key];
+    i += 1 + header.index;
+  }
+
+  output->clear();
+  for( auto &e : stack ) {
+    output->append(Format("%s %d\n",e.first.c_str(),static_cast<int>(e.second)));
+  }
+}
+
+} // namespace interpreter
+} // namespace lavascript
@@ -0,0 +1,107 @@
+#ifndef PROFILER_H_
+#define PROFILER_H_
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "src/trace.h"
+#include "src/objects.h"
+
+namespace lavascript {
+class Context;
+
+namespace interpreter{
+class AssemblerInterpreterStub;
+
+// Default sampling rate of the profiler in Hz
+static const std::size_t kProfilerDefaultRate = 1000;
+
+// How many frames the profiler can hold for all samples , samples taken after
+// the buffer is full are dropped
+static const std::size_t kProfilerDefaultBufferSize = 256*1024;
+
+// How many frames of a sample is recorded , from the innermost frame
+static const std::size_t kProfilerMaxDepth = 64;
+
+// -----------------------------------------------------------------------
+// Sampling profiler.
+//
+// The profiler arms an ITIMER_PROF timer and its SIGPROF handler takes a
+// sample of the Context's interpreted stack. The innermost frame is taken
+// from the STK/PC register if the signal interrupts the interpreter's code ,
+// otherwise from the Runtime which records them before calling out to any
+// C++ helper. The handler then walks the IFrames back to the bottom frame of
+// the interpreter entry ; the frames elided by tail call are taken from the
+// Runtime's TailCallTrace and recorded right after the frame that reused them.
+//
+// The handler only records (Prototype , instruction index) pairs into a
+// preallocated buffer , each sample is a header followed by its frames. The
+// samples are aggregated by function and source line by GetFoldedStack ,
+// which writes the folded stack format used by flamegraph tools :
+//
+//   main:12;fib:3;fib:3 42
+//
+// Only one profiler can be running at a time , and it only samples the
+// thread which runs the Context since ITIMER_PROF is per process and the
+// signal is delivered to the running thread.
+// -----------------------------------------------------------------------
+class Profiler {
+ public:
+  explicit Profiler( Context* , std::size_t buffer_size = kProfilerDefaultBufferSize );
+  ~Profiler();
+
+  // Start sampling at the rate in Hz , fails if other profiler is running
+  bool Start( std::size_t rate = kProfilerDefaultRate );
+
+  // Stop sampling , the samples are kept
+  void Stop();
+
+  bool running() const { return running_; }
+
+  // How many samples are recorded and dropped due to full buffer
+  std::size_t sample_size() const { return sample_size_; }
+  std::size_t dropped() const { return dropped_; }
+
+  // Aggregate the samples into folded stack format , the function name is
+  // resolved via the function table of the script
+  void GetFoldedStack( const Handle<Script>& , std::string* ) const;
+
+  // Drop all samples
+  void Clear();
+
+ public:
+  // Take a sample of the Context , called by the signal handler with the
+  // ucontext of the signal. It is async signal safe.
+  void Sample( const void* ucontext );
+
+ private:
+  enum { FRAME_HEADER , FRAME_PROTOTYPE , FRAME_EXTENSION };
+
+  struct Frame {
+    HeapObject**  object; // Prototype** or Extension** , NULL for header
+    std::uint32_t type;
+    std::uint32_t index;  // instruction index , or depth for header
+  };
+
+  static_assert( sizeof(Frame) == 16 );
+
+  static void SetPrototypeFrame( Frame* , Closure** , const std::uint32_t* );
+
+  Context* context_;
+  std::shared_ptr<AssemblerInterpreterStub> stub_;
+  std::vector<Frame> buffer_;
+  std::atomic<std::size_t> size_;        // used slots of buffer
+  std::atomic<std::size_t> sample_size_;
+  std::atomic<std::size_t> dropped_;
+  bool running_;
+
+  LAVA_DISALLOW_COPY_AND_ASSIGN(Profiler)
+};
+
+} // namespace interpreter
+} // namespace lavascript
+
+#endif // PROFILER_H_
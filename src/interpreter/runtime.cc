@@ -1,10 +1,10 @@
 #include "runtime.h"
 #include "src/context.h"
+#include "coroutine.h"
 
 namespace lavascript {
 
-LAVA_DEFINE_INT32(Interpreter,init_stack_size,"initial evaluations stack size for interpreter",40960);
-LAVA_DEFINE_INT32(Interpreter,max_stack_size ,"maximum evaluation stack size for interpreter" ,1024*60);
+LAVA_DEFINE_INT32(Interpreter,max_stack_size ,"evaluation stack size for interpreter, reserved up front" ,1024*60);
 LAVA_DEFINE_INT32(Interpreter,max_call_size  ,"maximum recursive call size for interpreter"   ,1024*20);
 
 namespace interpreter {
@@ -26,16 +26,24 @@ Runtime::Runtime( Context* context , const Handle<Script>&  script  ,
   interp        (inp),
   context       (context),
   ic_entry      (NULL),
+  call_cache    (context->call_site_cache()->entry()),
+  global_cache  (context->global_cache()->entry()),
+  coroutine     (NULL),
 
-  stack_test    (context->gc()->interp_stack_test ()),
   call_size     (0),
+  tcall_trace   (),
+  batch         (NULL),
 
   max_call_size (LAVA_OPTION(Interpreter,max_call_size)),
+  stack_limit   (context->gc()->interp_stack_end()),
+  budget        (0),
 
   cjob          (NULL),
   loop_hot_count(context->hotcount_data()->loop_hot_count),
   call_hot_count(context->hotcount_data()->call_hot_count),
-  jit_enable    (true)
+  deopt_pc      (NULL),
+  jit_enable    (true),
+  detached      (false)
 {
   // for this version of consturctor, the current context should not existed
   // or should be *NULL*
@@ -56,16 +64,24 @@ Runtime::Runtime( Context* context , const Handle<Closure>& cls ):
   interp        (NULL),
   context       (context),
   ic_entry      (NULL),
+  call_cache    (context->call_site_cache()->entry()),
+  global_cache  (context->global_cache()->entry()),
+  coroutine     (NULL),
 
-  stack_test    (context->gc()->interp_stack_test ()),
   call_size     (0),
+  tcall_trace   (),
+  batch         (NULL),
 
   max_call_size (LAVA_OPTION(Interpreter,max_call_size)),
+  stack_limit   (NULL),
+  budget        (0),
 
   cjob          (NULL),
   loop_hot_count(NULL),
   call_hot_count(NULL),
-  jit_enable    () {
+  deopt_pc      (NULL),
+  jit_enable    (),
+  detached      (false) {
 
   // for this version of consturctor, the current context should not existed
   // or should be *NULL*
@@ -90,6 +106,10 @@ Runtime::Runtime( Context* context , const Handle<Closure>& cls ):
   interp   = prev->interp;
   ic_entry = prev->ic_entry;
 
+  coroutine= prev->coroutine;
+  stack_limit = prev->stack_limit;
+  budget   = prev->budget;
+
   // jit related
   cjob           = prev->cjob;
   loop_hot_count = prev->loop_hot_count;
@@ -99,8 +119,62 @@ Runtime::Runtime( Context* context , const Handle<Closure>& cls ):
   context->PushCurrentRuntime(this);
 }
 
+Runtime::Runtime( Context* context , const Handle<Script>&  script  ,
+                                     const Handle<Closure>& closure ,
+                                     const Handle<Object>&  globals ,
+                                     Coroutine*             co ):
+  previous      (NULL),
+  cur_cls       (closure.ref()),
+  cur_stk       (co ? co->stack_start() : NULL),
+  cur_pc        (NULL),
+
+  script        (script.ref()),
+  global        (globals.ref()),
+  ret           (),
+  error         (NULL),
+  interp        (NULL),
+  context       (context),
+  ic_entry      (NULL),
+  call_cache    (context->call_site_cache()->entry()),
+  global_cache  (context->global_cache()->entry()),
+  coroutine     (co),
+
+  call_size     (0),
+  tcall_trace   (),
+  batch         (NULL),
+
+  max_call_size (LAVA_OPTION(Interpreter,max_call_size)),
+  stack_limit   (co ? co->stack_end() : context->gc()->interp_stack_end()),
+  budget        (0),
+
+  cjob          (NULL),
+  loop_hot_count(context->hotcount_data()->loop_hot_count),
+  call_hot_count(context->hotcount_data()->call_hot_count),
+  deopt_pc      (NULL),
+  jit_enable    (true),
+  detached      (true)
+{}
+
+Value* Runtime::stack_start() const {
+  return coroutine ? coroutine->stack_start() : context->gc()->interp_stack_start();
+}
+
+Value* Runtime::stack_end() const {
+  return coroutine ? coroutine->stack_end() : context->gc()->interp_stack_end();
+}
+
+std::uint64_t Runtime::RemainingBudget( std::uint64_t outer , std::uint64_t inner ) {
+  // the nested run gives up at its budget check with 0 left , the outer run
+  // must give up at its next check then instead of counting as unlimited
+  return (inner == 0 && outer != 0) ? 1 : inner;
+}
+
 Runtime::~Runtime() {
-  context->PopCurrentRuntime();
+  if(!detached) {
+    // only the nested runtime has a previous one when it is constructed
+    if(previous) previous->budget = RemainingBudget(previous->budget,budget);
+    context->PopCurrentRuntime();
+  }
 }
 
 } // namespace interpreter
@@ -5,16 +5,100 @@
 #include "src/objects.h"
 
 #include "iframe.h"
+#include "call-site-cache.h"
+#include "global-cache.h"
 
 namespace lavascript {
 
-LAVA_DECLARE_INT32(Interpreter,init_stack_size);
 LAVA_DECLARE_INT32(Interpreter,max_stack_size);
 LAVA_DECLARE_INT32(Interpreter,max_call_size);
 
 namespace interpreter{
 
 class Interpreter;
+class Coroutine;
+
+// Ring buffer records frames that are elided by tail call. A tail call reuses the
+// caller's IFrame so after the call the caller is gone from the interpreter stack.
+// To still be able to tell what happened, the closure of the elided frame and the
+// PC of the tail call site are recorded here along with the frame and the callee ;
+// only the latest kSize entries are kept around. They are used by the runtime
+// error message and the profiler's stack walk , see VisitFrame.
+struct TailCallTrace {
+  static const std::uint32_t kSize = 16;
+  static_assert( (kSize & (kSize-1)) == 0 );
+
+  struct Entry {
+    Closure**            cls;    // closure of the elided frame
+    const std::uint32_t* pc ;    // PC after the tail call instruction
+    const Value*         stk;    // the frame reused by the callee
+    Closure**            callee; // closure that replaces the elided one
+  };
+
+  Entry         entry[kSize];
+  std::uint32_t count;        // how many tail call happened , not capped by kSize
+
+  // how many entries are valid in the ring buffer
+  std::uint32_t size() const { return count < kSize ? count : kSize; }
+
+  // get the latest idx-th elided frame , 0 means the most recent one
+  const Entry& Get( std::uint32_t idx ) const {
+    lava_debug(NORMAL,lava_verify(idx < size()););
+    return entry[(count-1-idx) & (kSize-1)];
+  }
+
+  // Visit the elided frames of the frame at stk which runs cls now , from the
+  // most recent one. Entries left by a frame that has returned already don't
+  // lead to the closure running there , so the walk stops at the first one
+  // whose callee isn't the closure that replaced it. It is async signal safe.
+  template< typename T >
+  void VisitFrame( const Value* stk , Closure** cls , const T& visitor ) const {
+    for( std::uint32_t i = 0 ; i < size() ; ++i ) {
+      const Entry& e = Get(i);
+      if(e.stk != stk) continue;
+      if(e.callee != cls) return;
+      visitor(e);
+      cls = e.cls;
+    }
+  }
+
+  void Clear() { count = 0; }
+
+  TailCallTrace(): entry(), count(0) {}
+};
+
+static_assert( std::is_standard_layout<TailCallTrace>::value );
+static_assert( sizeof(TailCallTrace::Entry) == 32 ); // assembly interpreter relies on it
+
+struct TailCallTraceLayout {
+  static const std::uint32_t kEntryOffset = offsetof(TailCallTrace,entry);
+  static const std::uint32_t kCountOffset = offsetof(TailCallTrace,count);
+  static const std::uint32_t kEntrySize   = sizeof(TailCallTrace::Entry);
+  static const std::uint32_t kEntryPCOffset = offsetof(TailCallTrace::Entry,pc);
+  static const std::uint32_t kEntryStkOffset= offsetof(TailCallTrace::Entry,stk);
+  static const std::uint32_t kEntryCalleeOffset = offsetof(TailCallTrace::Entry,callee);
+};
+
+// Records of a host driven batch call , see AssemblerInterpreter::CallBatch. Once the
+// closure returns to the bottom frame , the interpreter stores the result and starts
+// the next record in the same frame without going back to C++.
+struct BatchCall {
+  Closure**     cls;    // closure called for each record
+  const Value*  args;   // arguments of the next record
+  Value*        output; // where to store the result of the current record
+  std::uint64_t left;   // how many records are left , including the current one
+  std::uint64_t narg;   // number of arguments of each record
+};
+
+static_assert( std::is_standard_layout<BatchCall>::value );
+
+struct BatchCallLayout {
+  static const std::uint32_t kClsOffset    = offsetof(BatchCall,cls);
+  static const std::uint32_t kArgsOffset   = offsetof(BatchCall,args);
+  static const std::uint32_t kOutputOffset = offsetof(BatchCall,output);
+  static const std::uint32_t kLeftOffset   = offsetof(BatchCall,left);
+  static const std::uint32_t kNArgOffset   = offsetof(BatchCall,narg);
+};
 
 // This serves as a global state holder object cross interpretation and JIT compliation.
 // It is kind of mess but it is easy for us to hold these core data fields in a single
@@ -28,7 +112,8 @@ struct Runtime {
   // current interpreted frame information
   // ---------------------------------------------------------
   Closure**            cur_cls;          // current closure, if not called by closure , then it is NULL
-  Value*               cur_stk;          // current frame's start of stack
+  Value*               cur_stk;          // current frame's start of stack , only recorded
+                                         // when the interpreter calls out to a helper
   const std::uint32_t* cur_pc ;          // current frame's start of PC
 
   Prototype* cur_proto() const { return (*cur_cls)->prototype().ptr(); }
@@ -50,19 +135,29 @@ struct Runtime {
   Interpreter* interp;      // Which interpreter is used to interpreting it
   Context* const context;   // Immutable , binded while initialized
   void** ic_entry;          // Hold intrinsic call entry point, used only by assembly interpreter
+  CallSiteCacheEntry* call_cache; // Call site cache table , owned by Context
+  GlobalCacheEntry* global_cache; // Global variable cache table , owned by Context
+  Coroutine* coroutine;     // Coroutine owns this runtime , NULL if not a coroutine
 
   // ---------------------------------------------------------
   // interpretation information
   // ---------------------------------------------------------
-  Value* stack_test ;       // If stack pointer is larger than this value, then it means
-                            // we don't have 256 register slots , needs to grow
   std::uint32_t call_size ; // how many function call is on going
+  TailCallTrace tcall_trace;// frames elided by tail call
+  BatchCall* batch;         // records of the on going batch call
 
   // ---------------------------------------------------------
   // interpreter threshold/constraints
   // ---------------------------------------------------------
   std::uint32_t max_stack_size;
   std::uint32_t max_call_size;
+  Value*        stack_limit;   // end of the stack segment , see stack_end
+
+  // Instruction budget of this run. It is decremented at every loop back edge
+  // and function call , once it reaches 0 the interpreter returns to the host
+  // and the run can be resumed later on. A budget of 0 means unlimited since
+  // the counter wraps around and needs 2^64 decrements to reach 0 again.
+  std::uint64_t budget;
 
   // ---------------------------------------------------------
   // JIT
@@ -92,18 +187,44 @@ struct Runtime {
   compiler::hotcount_t* loop_hot_count;
   compiler::hotcount_t* call_hot_count;
 
+  // Set by the jitted code when a guard fails , it is the bytecode the
+  // interpreter resumes the function at after the frame is written back.
+  // It is NULL when the jitted code runs to the end.
+  const std::uint32_t* deopt_pc;
 
-  // Whether we enable JIT compilation or not. This is useful for debugging purpose
+  // Whether we enable JIT compilation or not. This is useful for debugging purpose.
+  // It is cleared for a run with instruction budget since the machine code doesn't
+  // consume the budget , such run neither compiles nor enters the machine code.
   bool jit_enable;
 
+  // Whether the runtime is pushed to the Context by the caller while it is
+  // running instead of by the constructor , see the 3rd constructor
+  bool detached;
+
  public:
   Runtime( Context* , const Handle<Script>& , const Handle<Closure>& closure ,
                                               const Handle<Object>&  globals ,
                                               Interpreter*           interp  ,
                                               std::string*           error   );
 
+  // Nested runtime of the current runtime of the Context , it shares the
+  // budget of the current runtime and writes what is left back when popped
   Runtime( Context* , const Handle<Closure>& closure );
 
+  // Runtime that is only the current runtime of the Context while it is
+  // running , used by coroutine and host to script call. Coroutine can be
+  // NULL and the stack is set up by the caller.
+  Runtime( Context* , const Handle<Script>& , const Handle<Closure>& closure ,
+                                              const Handle<Object>&  globals ,
+                                              Coroutine*             coroutine );
+
+  // Start and end of the interpreter stack segment used by this runtime
+  Value* stack_start() const;
+  Value* stack_end() const;
+
+  // Budget left to the outer run after a nested run , which shares the budget
+  // of the outer run , ends with inner left
+  static std::uint64_t RemainingBudget( std::uint64_t outer , std::uint64_t inner );
 
   ~Runtime();
 };
@@ -122,15 +243,22 @@ struct RuntimeLayout {
   static const std::uint32_t kInterpOffset   = offsetof(Runtime,interp);
   static const std::uint32_t kContextOffset  = offsetof(Runtime,context);
   static const std::uint32_t kICEntryOffset  = offsetof(Runtime,ic_entry);
+  static const std::uint32_t kCallCacheOffset= offsetof(Runtime,call_cache);
+  static const std::uint32_t kGlobalCacheOffset = offsetof(Runtime,global_cache);
 
-  static const std::uint32_t kStackTestOffset = offsetof(Runtime,stack_test);
+  static const std::uint32_t kTailCallTraceOffset = offsetof(Runtime,tcall_trace);
+  static const std::uint32_t kBatchOffset         = offsetof(Runtime,batch);
 
   static const std::uint32_t kMaxStackSizeOffset = offsetof(Runtime,max_stack_size);
   static const std::uint32_t kMaxCallSizeOffset  = offsetof(Runtime,max_call_size);
+  static const std::uint32_t kStackLimitOffset   = offsetof(Runtime,stack_limit);
+  static const std::uint32_t kBudgetOffset       = offsetof(Runtime,budget);
 
   static const std::uint32_t kCompilerJobOffset  = offsetof(Runtime,cjob);
   static const std::uint32_t kLoopHotCountOffset = offsetof(Runtime,loop_hot_count);
   static const std::uint32_t kCallHotCountOffset = offsetof(Runtime,call_hot_count);
+  static const std::uint32_t kDeoptPCOffset      = offsetof(Runtime,deopt_pc);
+  static const std::uint32_t kJITEnableOffset    = offsetof(Runtime,jit_enable);
 };
 
 } // namespace interpreter
@@ -11,9 +11,15 @@
 
 namespace lavascript {
 class Context;
+class PerfMap;
 
 namespace interpreter{
 
+struct Runtime;
+struct BatchCall;
+class Coroutine;
+class BytecodeCounter;
+class HandlerLayout;
 class AssemblerInterpreter;
 struct AssemblerInterpreterStubLayout;
 
@@ -36,17 +42,31 @@ class AssemblerInterpreterStub {
   // Dump the interpreter into human readable assembly into the DumpWriter
   void Dump( DumpWriter* ) const;
 
+  // Get the STK and PC register of the interpreter from the ucontext passed
+  // to a signal handler. Returns false if the signal doesn't interrupt the
+  // interpreter's code , ie it is inside of a C++ helper , and the registers
+  // are not usable. It is async signal safe.
+  bool GetInterpreterState( const void* ucontext , Value** stk ,
+                                                   const std::uint32_t** pc ) const;
+
+  // Name each bytecode handler , helper routine and intrinsic call entry in
+  // the perf map. Done by Init if the process wide PerfMap is enabled.
+  void WritePerfMap( PerfMap* ) const;
+
  private:
   Bytecode      CheckBytecodeRoutine ( void* pc ) const;
   int           CheckHelperRoutine   ( void* pc ) const;
   IntrinsicCall CheckIntrinsicCall   ( void* pc ) const;
 
-  // Generate the dispatch interp
-  bool GenerateDispatchInterp();
+  // Generate the dispatch interp , bytecode handlers are emitted by the layout
+  bool GenerateDispatchInterp( const HandlerLayout& );
 
   // Generate the dispatch profile handler, *MUST* be called after GenerateDispatchInterp
   bool GenerateDispatchProfile();
 
+  // Generate the bytecode counting handler
+  bool GenerateDispatchCount();
+
   // Call it after instantiate the object
   bool Init();
 
@@ -66,6 +86,9 @@ class AssemblerInterpreterStub {
   // dispatch table for each bytecode in jitting mode
   void* dispatch_jit_   [ SIZE_OF_BYTECODE ];
 
+  // dispatch table for each bytecode in counting mode , see BytecodeCounter
+  void* dispatch_count_ [ SIZE_OF_BYTECODE ];
+
   // all builtin intrinsic call function's entrance address. these builtin functions are *not*
   // suitable for normal C++ call since they don't obey normal ABI but assume all the value are
   // on the stack
@@ -78,6 +101,12 @@ class AssemblerInterpreterStub {
   // we can use inline assembly to jmp to this routine
   void* interp_entry_;
 
+  // entry to continue a run suspended due to running out of instruction budget
+  void* resume_entry_;
+
+  // entry to run a batch call
+  void* batch_entry_;
+
   struct CodeBuffer {
     void* entry;
     std::size_t code_size;
@@ -96,6 +125,10 @@ class AssemblerInterpreterStub {
     {}
 
     void FreeIfNeeded();
+
+    bool Contains( const void* pc ) const {
+      return pc >= entry && pc < static_cast<const char*>(entry) + code_size;
+    }
   };
 
   // buffer to hold dispatch_interp_ handler
@@ -104,6 +137,9 @@ class AssemblerInterpreterStub {
   // buffer to hold dispatch_profile_ handler
   CodeBuffer profile_code_buffer_;
 
+  // buffer to hold dispatch_count_ handler
+  CodeBuffer count_code_buffer_;
+
   friend struct AssemblerInterpreterStubLayout;
   friend class AssemblerInterpreter;
 
@@ -117,6 +153,7 @@ struct AssemblerInterpreterStubLayout {
   static const std::uint32_t kDispatchRecordOffset = offsetof(AssemblerInterpreterStub,dispatch_profile_);
   static const std::uint32_t kDispatchJitOffset    = offsetof(AssemblerInterpreterStub,dispatch_jit_   );
   static const std::uint32_t kInterpEntryOffset    = offsetof(AssemblerInterpreterStub,interp_entry_   );
+  static const std::uint32_t kResumeEntryOffset    = offsetof(AssemblerInterpreterStub,resume_entry_   );
   static const std::uint32_t kIntrinsicEntry       = offsetof(AssemblerInterpreterStub,ic_entry_);
 };
 
@@ -130,23 +167,120 @@ class AssemblerInterpreter : public Interpreter {
                                                        Value*,
                                                        std::string* );
 
+  // The closure is called without argument and it must be called inside of
+  // an on going run since the closure needs the script it belongs to , use
+  // Call otherwise
   virtual bool Run( Context* , const Handle<Closure>&, const Handle<Object>& ,
                                                        Value*,
-                                                       std::string* ) {
-    return false;
-  }
+                                                       std::string* );
 
   virtual ~AssemblerInterpreter();
  public:
   const void* dispatch_interp() const { return dispatch_interp_; }
   const void* dispatch_profile()const { return dispatch_profile_;}
 
+ public:
+  // Install a BytecodeCounter , the following runs use the counting dispatch
+  // table and record every bytecode they execute into it. NULL switches back
+  // to the normal dispatch table. The counter is not owned.
+  void set_bytecode_counter( BytecodeCounter* counter ) { counter_ = counter; }
+  BytecodeCounter* bytecode_counter() const { return counter_; }
+
+ public:
+  // Instruction budget of each Run/Resume. The budget is consumed by loop back
+  // edges and function calls , once it runs out Run returns false with an error
+  // and the run is *suspended* : all its frames are kept , and the host can
+  // either Resume it with a fresh budget or Abort it. 0 means unlimited.
+  // The machine code doesn't consume the budget , so a run with budget is
+  // always interpreted even if the JIT is enabled.
+  void set_budget( std::uint64_t budget ) { budget_ = budget; }
+  std::uint64_t budget() const { return budget_; }
+
+ public:
+  // Whether hot functions are compiled into machine code , the default is
+  // the JIT.enable option. Functions compiled already keep running in
+  // machine code after the JIT is disabled.
+  void set_jit_enable( bool enable ) { jit_enable_ = enable; }
+  bool jit_enable() const { return jit_enable_; }
+
+  // Whether the last Run/Resume ran out of budget
+  bool suspended() const { return static_cast<bool>(suspended_); }
+
+  // Continue the suspended run , it can be suspended again
+  bool Resume( Value* , std::string* );
+
+  // Drop the suspended run. A suspended run is still the current Runtime of
+  // its Context , so it must be resumed to the end or aborted before the
+  // Context is used by other run or destroyed.
+  void Abort();
+
+  // Start or continue the coroutine until it yields , returns or runs out of
+  // budget. The input is the return value of the yield call the coroutine is
+  // suspended at. The output is the yielded value or the return value of the
+  // script. Returns false if the coroutine fails or runs out of budget , the
+  // status of the coroutine tells whether it can be resumed.
+  bool Resume( Coroutine* , const Value& , Value* , std::string* );
+
+ public:
+  // Call a closure of the script from C++ with arguments. The Runtime used by
+  // the call is cached and reused by the following calls with the same script
+  // and globals , so a script callback can be called repeatedly without any
+  // setup cost. The call can be made inside of an extension called by script ,
+  // and if the cached Runtime is in use already a temporary one is used.
+  // Running out of instruction budget fails the call and it is not resumable.
+  bool Call( Context* , const Handle<Script>& , const Handle<Object>& globals ,
+                                               const Handle<Closure>& ,
+                                               const Value* args ,
+                                               std::size_t narg ,
+                                               Value* ,
+                                               std::string* );
+
+  // Call a closure of the script on each record of a batch back to back inside
+  // of one interpreter entry. The args holds count records and each record is
+  // the closure's arguments , the result of each record is stored in output
+  // which must hold count Values. The interpreter moves to the next record by
+  // itself once the closure returns , so the per record cost is close to a
+  // function call inside of script. Fails on the first record that fails.
+  bool CallBatch( Context* , const Handle<Script>& , const Handle<Object>& globals ,
+                                                    const Handle<Closure>& ,
+                                                    const Value* args ,
+                                                    std::size_t count ,
+                                                    Value* output ,
+                                                    std::string* );
+
+ private:
+  bool Invoke( Context* , const Handle<Script>& , const Handle<Object>& ,
+                                                  const Handle<Closure>& ,
+                                                  const Value* ,
+                                                  BatchCall* ,
+                                                  Value* ,
+                                                  std::string* );
+
+  // Get the cached Runtime for calling closure , NULL if it is in use
+  Runtime* GetCallRuntime( Context* , const Handle<Script>& , const Handle<Object>& ,
+                                                                 const Handle<Closure>& );
+
+  // Collect the result of the run , or keep the runtime if it is suspended
+  bool Finish( std::unique_ptr<Runtime>* , bool , Value* );
+
+  // Dispatch table to start the interpreter with
+  void* dispatch() { return counter_ ? dispatch_count_ : dispatch_interp_; }
+
  private:
   void* dispatch_interp_ [SIZE_OF_BYTECODE];
   void* dispatch_profile_[SIZE_OF_BYTECODE];
   void* dispatch_jit_    [SIZE_OF_BYTECODE];
+  void* dispatch_count_  [SIZE_OF_BYTECODE];
   void**ic_entry_;
   void* interp_entry_;
+  void* resume_entry_;
+  void* batch_entry_;
+
+  std::uint64_t budget_;
+  BytecodeCounter* counter_;
+  bool jit_enable_;
+  std::unique_ptr<Runtime> suspended_; // runtime of the suspended run
+  std::unique_ptr<Runtime> call_runtime_; // runtime cached for Call
 
   LAVA_DISALLOW_COPY_AND_ASSIGN(AssemblerInterpreter)
 };
@@ -9,6 +9,14 @@ namespace compiler   {
 struct JITHotCountData {
   hotcount_t loop_hot_count[kHotCountArraySize];
   hotcount_t call_hot_count[kHotCountArraySize];
+
+  // The interpreter counts down , the JIT is triggered when it hits 0
+  JITHotCountData() {
+    for( std::size_t i = 0 ; i < kHotCountArraySize ; ++i ) {
+      loop_hot_count[i] = kJITHotLoopTrigger;
+      call_hot_count[i] = kJITHotCallTrigger;
+    }
+  }
 };
 
 } // namespace compiler
@@ -0,0 +1,50 @@
+#include "native-function.h"
+#include "call-frame.h"
+
+namespace lavascript {
+
+const char* GetNativeTypeName( NativeType type ) {
+  switch(type) {
+    case NATIVE_VOID:    return "void";
+    case NATIVE_REAL:    return "real";
+    case NATIVE_BOOLEAN: return "boolean";
+    case NATIVE_STRING:  return "string";
+    default:             return "value";
+  }
+}
+
+// Slow path used when the function is not called by the interpreter's fast path
+bool NativeFunction::Call( CallFrame* cf , std::string* error ) {
+  std::size_t narg = cf->GetArgumentSize();
+  Value args[kMaxNativeArgument];
+  if(narg > kMaxNativeArgument)
+    return detail::NativeArgumentSizeMismatch(this,narg,error);
+  for( std::size_t i = 0 ; i < narg ; ++i ) args[i] = cf->GetArgument(i);
+
+  Value ret;
+  if(!Invoke(args,narg,&ret,error)) return false;
+  cf->SetReturn(ret);
+  return true;
+}
+
+namespace detail {
+
+bool NativeArgumentSizeMismatch( const NativeFunction* fn , std::size_t narg ,
+                                                            std::string* error ) {
+  Format(error,"native function %s expects %d arguments but got %d",fn->name(),
+                                                                     static_cast<int>(fn->signature_.narg),
+                                                                     static_cast<int>(narg));
+  return false;
+}
+
+bool NativeArgumentTypeMismatch( const NativeFunction* fn , std::size_t index ,
+                                                            const Value& arg ,
+                                                            std::string* error ) {
+  Format(error,"argument %d of native function %s expects type %s but got type %s",
+      static_cast<int>(index),fn->name(),GetNativeTypeName(fn->signature_.arg[index]),
+      arg.type_name());
+  return false;
+}
+
+} // namespace detail
+} // namespace lavascript
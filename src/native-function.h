@@ -0,0 +1,207 @@
+#ifndef NATIVE_FUNCTION_H_
+#define NATIVE_FUNCTION_H_
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+#include "src/trace.h"
+#include "src/util.h"
+#include "src/objects.h"
+#include "src/gc.h"
+
+namespace lavascript {
+
+// Maximum number of arguments a typed native function can have
+static const std::size_t kMaxNativeArgument = 8;
+
+// Types that can appear in signature of a typed native function
+enum NativeType {
+  NATIVE_VOID,    // return type only , returns null to script
+  NATIVE_REAL,    // double
+  NATIVE_BOOLEAN, // bool
+  NATIVE_STRING,  // Handle<String>
+  NATIVE_VALUE    // Value , no conversion
+};
+
+const char* GetNativeTypeName( NativeType );
+
+// Signature of a typed native function , used to report a mismatched call
+struct NativeSignature {
+  NativeType   ret;
+  std::uint8_t narg;
+  NativeType   arg[kMaxNativeArgument];
+};
+
+class NativeFunction;
+
+// Thunk generated for each signature, it checks and unboxes the arguments, calls
+// the raw C++ function and boxes the return value into *ret*. The argument array
+// is the interpreter's register window of the callee , so no frame is needed.
+typedef bool (*NativeThunk)( const NativeFunction* , const Value* args ,
+                                                     std::size_t narg ,
+                                                     Value* ret ,
+                                                     std::string* error );
+
+namespace detail {
+
+bool NativeArgumentSizeMismatch( const NativeFunction* , std::size_t , std::string* );
+bool NativeArgumentTypeMismatch( const NativeFunction* , std::size_t , const Value& ,
+                                                                       std::string* );
+
+template< typename T > struct NativeTypeTraits;
+
+template<> struct NativeTypeTraits<double> {
+  static const NativeType kType = NATIVE_REAL;
+  static bool   Check( const Value& v ) { return v.IsReal(); }
+  static double Unbox( const Value& v ) { return v.GetReal(); }
+  static void   Box  ( double v , Value* output ) { output->SetReal(v); }
+};
+
+template<> struct NativeTypeTraits<bool> {
+  static const NativeType kType = NATIVE_BOOLEAN;
+  static bool Check( const Value& v ) { return v.IsBoolean(); }
+  static bool Unbox( const Value& v ) { return v.GetBoolean(); }
+  static void Box  ( bool v , Value* output ) { output->SetBoolean(v); }
+};
+
+template<> struct NativeTypeTraits<Handle<String>> {
+  static const NativeType kType = NATIVE_STRING;
+  static bool           Check( const Value& v ) { return v.IsString(); }
+  static Handle<String> Unbox( const Value& v ) { return v.GetString(); }
+  static void           Box  ( const Handle<String>& v , Value* output ) {
+    if(v) output->SetString(v); else output->SetNull();
+  }
+};
+
+template<> struct NativeTypeTraits<Value> {
+  static const NativeType kType = NATIVE_VALUE;
+  static bool  Check( const Value& ) { return true; }
+  static Value Unbox( const Value& v ) { return v; }
+  static void  Box  ( const Value& v , Value* output ) { *output = v; }
+};
+
+template< typename T > struct NativeTypeTraits<const T&> : NativeTypeTraits<T> {};
+
+template< typename R , typename ... ARGS > struct NativeThunkImpl;
+
+} // namespace detail
+
+// -----------------------------------------------------------------------
+// Typed native function.
+//
+// A NativeFunction binds a plain C++ function , like double(double,double)
+// or Handle<String>(Handle<String>) , as a callable Extension. The argument
+// conversion is generated from the C++ signature at compile time , so a call
+// from script does not need a CallFrame , an IFrame or a virtual call; the
+// interpreter checks IsNativeFunction and calls the thunk directly on the
+// register window of the callee.
+// -----------------------------------------------------------------------
+class LAVASCRIPT_OBJECT_ALIGN NativeFunction final : public Extension {
+ public:
+  typedef void (*Address)();
+
+  // Create a typed native function from a C++ function pointer
+  template< typename R , typename ... ARGS >
+  static Handle<Extension> New( GC* , R (*)( ARGS... ) , const char* name );
+
+  // Call the function with arguments stored in a Value array
+  bool Invoke( const Value* args , std::size_t narg , Value* ret ,
+                                                      std::string* error ) const {
+    return thunk_(this,args,narg,ret,error);
+  }
+
+ public:
+  virtual bool Call( CallFrame* , std::string* );
+  virtual const char* name() const { return name_; }
+
+  NativeFunction( NativeThunk thunk , Address address , const NativeSignature& signature ,
+                                                        const char* name ):
+    Extension (true),
+    thunk_    (thunk),
+    address_  (address),
+    signature_(signature),
+    name_     (name)
+  {}
+
+  virtual ~NativeFunction() {}
+
+ private:
+  template< typename R , typename ... ARGS > friend struct detail::NativeThunkImpl;
+  friend bool detail::NativeArgumentSizeMismatch( const NativeFunction* , std::size_t ,
+                                                                          std::string* );
+  friend bool detail::NativeArgumentTypeMismatch( const NativeFunction* , std::size_t ,
+                                                                          const Value& ,
+                                                                          std::string* );
+
+  NativeThunk     thunk_;
+  Address         address_;
+  NativeSignature signature_;
+  const char*     name_;
+};
+
+namespace detail {
+
+template< typename R , typename ... ARGS > struct NativeThunkImpl {
+  typedef R (*Function)( ARGS... );
+
+  static bool Thunk( const NativeFunction* fn , const Value* args , std::size_t narg ,
+                                                                    Value* ret ,
+                                                                    std::string* error ) {
+    return Call(fn,args,narg,ret,error,std::index_sequence_for<ARGS...>());
+  }
+
+  template< std::size_t ... I >
+  static bool Call( const NativeFunction* fn , const Value* args , std::size_t narg ,
+                                                                   Value* ret ,
+                                                                   std::string* error ,
+                                                                   std::index_sequence<I...> ) {
+    if(narg != sizeof...(ARGS))
+      return NativeArgumentSizeMismatch(fn,narg,error);
+
+    // check all arguments before calling , stops at the first bad one
+    std::size_t bad = sizeof...(ARGS);
+    (void)((NativeTypeTraits<ARGS>::Check(args[I]) || ((bad = I) , false)) && ...);
+    if(bad != sizeof...(ARGS))
+      return NativeArgumentTypeMismatch(fn,bad,args[bad],error);
+
+    Function f = reinterpret_cast<Function>(fn->address_);
+    if constexpr (std::is_void<R>::value) {
+      f(NativeTypeTraits<ARGS>::Unbox(args[I])...);
+      ret->SetNull();
+    } else {
+      NativeTypeTraits<R>::Box(f(NativeTypeTraits<ARGS>::Unbox(args[I])...),ret);
+    }
+    return true;
+  }
+};
+
+} // namespace detail
+
+template< typename R , typename ... ARGS >
+Handle<Extension> NativeFunction::New( GC* gc , R (*function)( ARGS... ) , const char* name ) {
+  static_assert( sizeof...(ARGS) <= kMaxNativeArgument );
+
+  NativeSignature sig = {};
+  if constexpr (std::is_void<R>::value)
+    sig.ret = NATIVE_VOID;
+  else
+    sig.ret = detail::NativeTypeTraits<R>::kType;
+  sig.narg = static_cast<std::uint8_t>(sizeof...(ARGS));
+  {
+    std::size_t i = 0;
+    (void)i;
+    ((sig.arg[i++] = detail::NativeTypeTraits<ARGS>::kType) , ...);
+  }
+
+  NativeFunction** ref = gc->NewExtension<NativeFunction>(
+      &detail::NativeThunkImpl<R,ARGS...>::Thunk,
+      reinterpret_cast<Address>(function),
+      sig,
+      name);
+  return Handle<Extension>(reinterpret_cast<Extension**>(ref));
+}
+
+} // namespace lavascript
+
+#endif // NATIVE_FUNCTION_H_
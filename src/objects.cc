@@ -246,13 +246,17 @@ Prototype::Prototype( const Handle<String>& pp , std::uint8_t argument_size ,
   string_table_size_(string_table_size),
   sso_table_size_   (sso_table_size),
   upvalue_size_(upvalue_size),
+  jit_failed_(false),
+  jit_no_speculation_(false),
+  deopt_count_(0),
   code_buffer_size_(code_buffer_size),
   string_table_(stable),
   sso_table_(ssotable),
   upvalue_table_(utable),
   code_buffer_(cb),
   sci_buffer_(sci),
-  reg_offset_table_(reg_offset_table)
+  reg_offset_table_(reg_offset_table),
+  native_code_(NULL)
 {
   lava_debug(NORMAL,
       if(real_table_size)
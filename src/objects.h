@@ -819,6 +819,11 @@ class LAVASCRIPT_OBJECT_ALIGN Map final : public HeapObject {
   inline bool Delete ( const char*   );
   inline bool Delete ( const std::string& );
 
+  // Get the entry of the key , return NULL if not found. The entry doesn't
+  // move until the Map is rehashed , it is used by the interpreter to cache
+  // global variable
+  inline Entry* GetEntry( const Handle<String>& ) const;
+
   Handle<Iterator> NewIterator( GC* , const Handle<Map>& ) const;
 
  public: // Factory functions
@@ -975,6 +980,22 @@ class LAVASCRIPT_OBJECT_ALIGN Prototype final : public HeapObject {
   std::uint32_t sci_size() const { return code_buffer_size_; }
   std::uint32_t reg_offset_size() const { return code_buffer_size_; }
 
+ public: // JIT
+  // Machine code compiled by the backend , NULL if not compiled
+  void* native_code() const { return native_code_; }
+  void  set_native_code( void* code ) { native_code_ = code; }
+  // Whether the backend failed to compile this prototype , then it is not
+  // tried again
+  bool jit_failed() const { return jit_failed_; }
+  void set_jit_failed() { jit_failed_ = true; }
+  // Whether the backend is allowed to speculate on the types recorded while
+  // profiling , it is turned off once the speculated code deopts too often
+  bool jit_speculation() const { return !jit_no_speculation_; }
+  void disable_jit_speculation() { jit_no_speculation_ = true; }
+  // How many times the native code deopts back into the interpreter
+  std::uint16_t deopt_count() const { return deopt_count_; }
+  std::uint16_t IncreaseDeoptCount() { return ++deopt_count_; }
+
  public: // Constant table
   inline double GetReal( std::size_t ) const;
   inline Handle<String> GetString( std::size_t ) const;
@@ -1034,6 +1055,10 @@ class LAVASCRIPT_OBJECT_ALIGN Prototype final : public HeapObject {
   // Upvalue slot size
   std::uint8_t upvalue_size_;
 
+  bool jit_failed_;
+  bool jit_no_speculation_;
+  std::uint16_t deopt_count_;
+
   // Code buffer size
   std::uint32_t code_buffer_size_;
 
@@ -1058,6 +1083,8 @@ class LAVASCRIPT_OBJECT_ALIGN Prototype final : public HeapObject {
   SourceCodeInfo* sci_buffer_;
   std::uint8_t* reg_offset_table_;
 
+  void* native_code_;
+
   friend struct PrototypeLayout;
   friend class GC;
   friend class interpreter::BytecodeBuilder;
@@ -1082,6 +1109,7 @@ struct PrototypeLayout {
   static const std::uint32_t kCodeBufferOffset = offsetof (Prototype,code_buffer_);
   static const std::uint32_t kSciBufferOffset  = offsetof (Prototype,sci_buffer_);
   static const std::uint32_t kRegOffsetTableOffset = offsetof(Prototype,reg_offset_table_);
+  static const std::uint32_t kNativeCodeOffset = offsetof(Prototype,native_code_);
 
   // GC will guarantee this , always put the constant table for real right after the
   // object in terms of memory layout
@@ -1206,8 +1234,17 @@ class LAVASCRIPT_OBJECT_ALIGN Extension : public HeapObject {
   virtual bool Call( CallFrame* call_frame , std::string* error );
   // Unique type name
   virtual const char* name() const = 0;
+
+  // Whether this extension is a typed NativeFunction , see native-function.h.
+  // It is a plain field so the interpreter can test it without a virtual call
+  bool IsNativeFunction() const { return native_function_; }
  public:
   virtual ~Extension() = 0;
+ protected:
+  Extension() : native_function_(false) {}
+  explicit Extension( bool native_function ) : native_function_(native_function) {}
+ private:
+  bool native_function_;
 };
 
 /**
@@ -2202,6 +2239,11 @@ inline bool Map::Get( const Handle<String>& key , Value* output ) const {
   return false;
 }
 
+inline Map::Entry* Map::GetEntry( const Handle<String>& key ) const {
+  if(size_ == 0) return NULL;
+  return FindEntry(key,Hash(key),FIND);
+}
+
 inline bool Map::Get( const char* key , Value* output ) const {
   if(size_ == 0) return false;
 
@@ -27,4 +27,29 @@ void OS::FreeCodePage( void* ptr , std::size_t size ) {
   lava_verify( munmap(ptr,size) == 0 );
 }
 
+void* OS::ReserveMemory( std::size_t size , std::size_t guard_size ,
+                                            std::size_t* adjusted_size ) {
+  const std::size_t page_size = GetPageSize();
+  std::size_t nsize = Align(size,page_size);
+  std::size_t gsize = Align(guard_size,page_size);
+  *adjusted_size = nsize;
+
+  static const int kFlag = MAP_ANONYMOUS | MAP_PRIVATE | MAP_NORESERVE;
+
+  void* ptr = mmap(NULL,nsize+gsize,PROT_READ|PROT_WRITE,kFlag,-1,0);
+  if(ptr == MAP_FAILED) return NULL;
+
+  if(gsize && mprotect(static_cast<char*>(ptr)+nsize,gsize,PROT_NONE) != 0) {
+    lava_verify( munmap(ptr,nsize+gsize) == 0 );
+    return NULL;
+  }
+  return ptr;
+}
+
+void OS::FreeReservedMemory( void* ptr , std::size_t size , std::size_t guard_size ) {
+  const std::size_t page_size = GetPageSize();
+  lava_verify( Align(size,page_size) == size );
+  lava_verify( munmap(ptr,size+Align(guard_size,page_size)) == 0 );
+}
+
 } // namespace lavascript
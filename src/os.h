@@ -22,6 +22,16 @@ class OS {
   static void* CreateCodePage( std::size_t size , std::size_t* adjusted_size );
 
   static void  FreeCodePage  ( void* , std::size_t size );
+
+  // Reserve a large range of virtual memory. The range is readable and writable
+  // but physical memory is only committed by the OS when a page is touched. The
+  // last guard_size bytes of the range are inaccessible so running off the end
+  // traps instead of corrupting whatever is mapped after it. The returned size
+  // excludes the guard area.
+  static void* ReserveMemory( std::size_t size , std::size_t guard_size ,
+                                                 std::size_t* adjusted_size );
+
+  static void  FreeReservedMemory( void* , std::size_t size , std::size_t guard_size );
 };
 
 inline std::int64_t OS::GetPid() {
@@ -821,7 +821,8 @@ Parser::AddChunkStmt( ast::Node* stmt , Vector<ast::Variable*>* lv ) {
       }
     }
 
-    ret = ITERATOR_NEED1;
+    // Container and cursor of the foreach loop
+    ret = ITERATOR_NEED2;
   }
 
   return ret;
@@ -0,0 +1,167 @@
+#include "perf-map.h"
+#include "config.h"
+#include "trace.h"
+#include "os.h"
+
+#include <cinttypes>
+#include <cstring>
+#include <ctime>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <elf.h>
+
+namespace lavascript {
+
+LAVA_DEFINE_BOOLEAN(Perf,perf_map,"write /tmp/perf-<pid>.map for generated code",false);
+LAVA_DEFINE_BOOLEAN(Perf,jitdump ,"write /tmp/jit-<pid>.dump for generated code" ,false);
+
+namespace {
+
+// jitdump format , see tools/perf/Documentation/jitdump-specification.txt
+static const std::uint32_t kJITDumpMagic   = 0x4A695444;
+static const std::uint32_t kJITDumpVersion = 1;
+
+enum { JIT_CODE_LOAD = 0 };
+
+struct JITDumpHeader {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t total_size;
+  std::uint32_t elf_mach;
+  std::uint32_t pad1;
+  std::uint32_t pid;
+  std::uint64_t timestamp;
+  std::uint64_t flags;
+};
+
+static_assert( sizeof(JITDumpHeader) == 40 );
+
+struct JITDumpCodeLoad {
+  std::uint32_t id;
+  std::uint32_t total_size;
+  std::uint64_t timestamp;
+  std::uint32_t pid;
+  std::uint32_t tid;
+  std::uint64_t vma;
+  std::uint64_t code_addr;
+  std::uint64_t code_size;
+  std::uint64_t code_index;
+  // followed by null terminated name and the code
+};
+
+static_assert( sizeof(JITDumpCodeLoad) == 56 );
+
+// perf uses CLOCK_MONOTONIC for jitdump timestamp unless -k is specified
+std::uint64_t JITDumpTimestamp() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+} // namespace
+
+PerfMap::PerfMap():
+  perf_map_      (NULL),
+  jitdump_       (NULL),
+  jitdump_marker_(NULL),
+  code_index_    (0)
+{}
+
+PerfMap::~PerfMap() {
+  Close();
+}
+
+bool PerfMap::OpenPerfMap( const char* path ) {
+  lava_debug(NORMAL,lava_verify(!perf_map_););
+  std::string name(path ? std::string(path) :
+                          Format("/tmp/perf-%d.map",static_cast<int>(OS::GetPid())));
+  perf_map_ = fopen(name.c_str(),"w");
+  return perf_map_ != NULL;
+}
+
+bool PerfMap::OpenJITDump( const char* path ) {
+  lava_debug(NORMAL,lava_verify(!jitdump_););
+  std::string name(path ? std::string(path) :
+                          Format("/tmp/jit-%d.dump",static_cast<int>(OS::GetPid())));
+  jitdump_ = fopen(name.c_str(),"w+");
+  if(!jitdump_) return false;
+
+  // perf record finds the jitdump file by this executable mapping of it
+  std::size_t page = OS::GetPageSize();
+  void* marker = mmap(NULL,page,PROT_READ|PROT_EXEC,MAP_PRIVATE,fileno(jitdump_),0);
+  jitdump_marker_ = marker == MAP_FAILED ? NULL : marker;
+
+  WriteJITDumpHeader();
+  return true;
+}
+
+void PerfMap::Close() {
+  if(perf_map_) {
+    fclose(perf_map_);
+    perf_map_ = NULL;
+  }
+  if(jitdump_) {
+    if(jitdump_marker_) munmap(jitdump_marker_,OS::GetPageSize());
+    fclose(jitdump_);
+    jitdump_ = NULL;
+    jitdump_marker_ = NULL;
+  }
+}
+
+void PerfMap::AddCode( const void* start , std::size_t size , const char* name ) {
+  if(!size) return;
+  if(perf_map_) {
+    fprintf(perf_map_,"%" PRIxPTR " %zx %s\n",reinterpret_cast<std::uintptr_t>(start),
+                                              size,
+                                              name);
+    fflush(perf_map_);
+  }
+  if(jitdump_) WriteJITDumpCodeLoad(start,size,name);
+}
+
+void PerfMap::WriteJITDumpHeader() {
+  JITDumpHeader header;
+  memset(&header,0,sizeof(header));
+  header.magic      = kJITDumpMagic;
+  header.version    = kJITDumpVersion;
+  header.total_size = sizeof(header);
+  header.elf_mach   = EM_X86_64;
+  header.pid        = static_cast<std::uint32_t>(OS::GetPid());
+  header.timestamp  = JITDumpTimestamp();
+  fwrite(&header,sizeof(header),1,jitdump_);
+  fflush(jitdump_);
+}
+
+void PerfMap::WriteJITDumpCodeLoad( const void* start , std::size_t size ,
+                                                        const char* name ) {
+  std::size_t name_size = strlen(name) + 1;
+  JITDumpCodeLoad record;
+  record.id         = JIT_CODE_LOAD;
+  record.total_size = static_cast<std::uint32_t>(sizeof(record) + name_size + size);
+  record.timestamp  = JITDumpTimestamp();
+  record.pid        = static_cast<std::uint32_t>(OS::GetPid());
+  record.tid        = static_cast<std::uint32_t>(syscall(SYS_gettid));
+  record.vma        = reinterpret_cast<std::uint64_t>(start);
+  record.code_addr  = reinterpret_cast<std::uint64_t>(start);
+  record.code_size  = size;
+  record.code_index = code_index_++;
+  fwrite(&record,sizeof(record),1,jitdump_);
+  fwrite(name,name_size,1,jitdump_);
+  fwrite(start,size,1,jitdump_);
+  fflush(jitdump_);
+}
+
+PerfMap* PerfMap::GetInstance() {
+  static PerfMap kPerfMap;
+  static bool kInit = false;
+  if(!kInit) {
+    kInit = true;
+    if(LAVA_OPTION(Perf,perf_map) && !kPerfMap.OpenPerfMap())
+      lava_warn("%s","cannot open perf map file");
+    if(LAVA_OPTION(Perf,jitdump) && !kPerfMap.OpenJITDump())
+      lava_warn("%s","cannot open jitdump file");
+  }
+  return kPerfMap.IsOpen() ? &kPerfMap : NULL;
+}
+
+} // namespace lavascript
@@ -0,0 +1,66 @@
+#ifndef PERF_MAP_H_
+#define PERF_MAP_H_
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+#include "util.h"
+
+namespace lavascript {
+
+// -----------------------------------------------------------------------
+// Symbol information of generated code for linux perf.
+//
+// perf sees the machine code generated on the fly , the assembly interpreter
+// and the JITted code , as anonymous memory. Two ways are supported to tell
+// perf about them :
+//
+//   1) perf map , /tmp/perf-<pid>.map , one "start size name" line for each
+//      chunk of code , perf report reads it to resolve symbols
+//
+//   2) jitdump , /tmp/jit-<pid>.dump , a binary file which also holds a copy
+//      of the code , so perf inject --jit can annotate the code. The file is
+//      mmapped with exec permission so perf record notices it.
+//
+// The process wide instance is enabled by the Perf.perf_map and Perf.jitdump
+// options , any code generator names its code via PerfMap::GetInstance.
+// -----------------------------------------------------------------------
+class PerfMap {
+ public:
+  PerfMap();
+  ~PerfMap();
+
+  // Open the perf map file , the default path is /tmp/perf-<pid>.map
+  bool OpenPerfMap( const char* path = NULL );
+
+  // Open the jitdump file , the default path is /tmp/jit-<pid>.dump
+  bool OpenJITDump( const char* path = NULL );
+
+  void Close();
+
+  bool IsOpen() const { return perf_map_ || jitdump_; }
+
+  // Name a chunk of generated code
+  void AddCode( const void* start , std::size_t size , const char* name );
+
+ public:
+  // Get the process wide instance , NULL if neither perf map nor jitdump is
+  // enabled by the options
+  static PerfMap* GetInstance();
+
+ private:
+  void WriteJITDumpHeader();
+  void WriteJITDumpCodeLoad( const void* , std::size_t , const char* );
+
+  FILE* perf_map_;
+  FILE* jitdump_;
+  void* jitdump_marker_;   // mmapped page of jitdump file for perf record
+  std::uint64_t code_index_;
+
+  LAVA_DISALLOW_COPY_AND_ASSIGN(PerfMap)
+};
+
+} // namespace lavascript
+
+#endif // PERF_MAP_H_
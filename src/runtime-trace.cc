@@ -47,6 +47,21 @@ void RuntimeTrace::Dump( DumpWriter* writer ) {
       writer->WriteL("%s",interpreter::GetBytecodeRepresentation(e.first).c_str());
     }
   }
+
+  {
+    DumpWriter::Section header(writer,"Call Trace");
+    for( auto &e : call_map_ ) {
+      writer->WriteL("%s:%u",interpreter::GetBytecodeRepresentation(e.first).c_str(),
+                             e.second.hit);
+    }
+  }
+
+  {
+    DumpWriter::Section header(writer,"Argument");
+    for( std::size_t i = 0 ; i < argument_.size() ; ++i ) {
+      writer->WriteL("%zu:%s",i,argument_[i].type_name());
+    }
+  }
 }
 
 } // namespace lavascript
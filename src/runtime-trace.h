@@ -5,6 +5,7 @@
 
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace lavascript {
 
@@ -38,11 +39,31 @@ struct TypeTracePoint {
   }
 };
 
+// Call target of a monomorphic call site , fed by the call site cache , see
+// CallSiteCache::FeedRuntimeTrace. The frame info is the one of the closure
+// that the interpreter checks the call against.
+struct CallTracePoint {
+  Value         callee;             // closure that is called
+  std::uint8_t  argument_size;
+  std::uint8_t  max_local_var_size;
+  std::uint32_t hit;                // how many times the callee is called
+
+  CallTracePoint(): callee() , argument_size() , max_local_var_size() , hit() {}
+
+  CallTracePoint( const Value& cls , std::uint8_t arg , std::uint8_t local ,
+                                     std::uint32_t h ):
+    callee(cls),
+    argument_size(arg),
+    max_local_var_size(local),
+    hit(h)
+  {}
+};
+
 class RuntimeTrace {
  public:
   typedef const std::uint32_t* BytecodeAddress;
 
-  RuntimeTrace() : forbidden_set_() , map_() {}
+  RuntimeTrace() : forbidden_set_() , map_() , call_map_() , argument_() {}
 
   // Add a new trace into the trace map. If such entry is existed, then
   // we compare t2o TypeTracePoint's value and make sure they are same
@@ -56,6 +77,25 @@ class RuntimeTrace {
 
   inline const TypeTracePoint* GetTrace( BytecodeAddress addr ) const;
 
+  // Record the call target of a call site , the latest one wins
+  void AddCallTrace( BytecodeAddress addr , const CallTracePoint& ctp ) {
+    call_map_[addr] = ctp;
+  }
+
+  // NULL if the call site is not traced
+  inline const CallTracePoint* GetCallTrace( BytecodeAddress addr ) const;
+
+  // Trace of the arguments the function is called with , recorded when the
+  // call triggers the JIT. The JIT guards the arguments' type at the entry
+  void AddArgumentTrace( const Value* arg , std::size_t size ) {
+    argument_.assign(arg,arg+size);
+  }
+
+  // NULL if the argument is not traced
+  const Value* GetArgumentTrace( std::size_t index ) const {
+    return index < argument_.size() ? &argument_[index] : NULL;
+  }
+
  public:
   // For debugging purpose
   void Dump( DumpWriter* );
@@ -63,9 +103,12 @@ class RuntimeTrace {
  private:
   typedef std::unordered_set<BytecodeAddress> ForbiddenSet;
   typedef std::unordered_map<BytecodeAddress,TypeTracePoint> RuntimeTraceMap;
+  typedef std::unordered_map<BytecodeAddress,CallTracePoint> CallTraceMap;
 
   ForbiddenSet forbidden_set_;
   RuntimeTraceMap map_;
+  CallTraceMap call_map_;
+  std::vector<Value> argument_;
 };
 
 inline const TypeTracePoint* RuntimeTrace::GetTrace( BytecodeAddress addr ) const {
@@ -74,6 +117,11 @@ inline const TypeTracePoint* RuntimeTrace::GetTrace( BytecodeAddress addr ) cons
   return &(itr->second);
 }
 
+inline const CallTracePoint* RuntimeTrace::GetCallTrace( BytecodeAddress addr ) const {
+  auto itr = call_map_.find(addr);
+  return itr == call_map_.end() ? NULL : &(itr->second);
+}
+
 } // namespace lavascript
 
 #endif // RUNTIME_TRACE_H_
@@ -0,0 +1,230 @@
+#include <unittest/cbase/schedule-check.h>
+#include <src/cbase/pass/loop-induction.h>
+#include <src/cbase/pass/gvn.h>
+#include <src/cbase/pass/bce.h>
+
+#define stringify(...) #__VA_ARGS__
+
+namespace lavascript {
+namespace cbase {
+namespace hir {
+
+using namespace ::lavascript::interpreter;
+using namespace ::lavascript::parser;
+using namespace ::lavascript;
+
+namespace {
+
+// collect the list index and split them by whether they are inside of a loop
+void CollectListIndex( const Schedule& sch , std::vector<ListIndex*>* loop ,
+                                             std::vector<ListIndex*>* other ) {
+  std::vector<Expr*> list;
+  CollectNode<ListIndex>(sch,&list);
+  for( auto n : list ) {
+    if(sch.GetLoopDepth(sch.GetBlock(n)))
+      loop->push_back(n->As<ListIndex>());
+    else
+      other->push_back(n->As<ListIndex>());
+  }
+}
+
+} // namespace
+
+TEST(BCE,ListLiteral) {
+  const char* source = stringify(
+    function f(a) {
+      var l = [1,2,3,4];
+      var s = 0;
+      for( var i = 0 ; 4 ; 1 ) {
+        s = s + l[i];
+      }
+      return s;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),BCE()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  // the index is in [0,4) which is always inside of the list , nothing is
+  // hoisted out of the loop
+  std::vector<ListIndex*> loop , other;
+  CollectListIndex(sch,&loop,&other);
+  ASSERT_EQ(1,loop.size());
+  ASSERT_FALSE(loop[0]->bound_check());
+  ASSERT_TRUE(other.empty());
+}
+
+TEST(BCE,OutOfBound) {
+  const char* source = stringify(
+    function f(a) {
+      var l = [1,2,3,4];
+      var s = 0;
+      for( var i = 0 ; 4 ; 1 ) {
+        s = s + l[i+1];
+      }
+      return s;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),BCE()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  // the last iteration is out of bound , the check of the largest index is
+  // hoisted in front of the loop
+  std::vector<ListIndex*> loop , other;
+  CollectListIndex(sch,&loop,&other);
+  ASSERT_EQ(1,loop.size());
+  ASSERT_FALSE(loop[0]->bound_check());
+  ASSERT_EQ(1,other.size());
+  ASSERT_TRUE(other[0]->bound_check());
+  ASSERT_TRUE(other[0]->index()->Is<Int64>());
+  ASSERT_EQ(4,other[0]->index()->As<Int64>()->value());
+}
+
+TEST(BCE,Hoist) {
+  const char* source = stringify(
+    function f(a) {
+      var l = [1,2,3,4];
+      var n = 3;
+      if(a) n = 4;
+      var s = 0;
+      for( var i = 1 ; n ; 1 ) {
+        s = s + l[i];
+        l[i] = s;
+      }
+      return s;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),BCE()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  // the bound is not a constant but the loop is always entered , the check is
+  // hoisted as one list index before the loop header
+  std::vector<ListIndex*> loop , other;
+  CollectListIndex(sch,&loop,&other);
+  ASSERT_EQ(2,loop.size());
+  for( auto n : loop ) ASSERT_FALSE(n->bound_check());
+  ASSERT_EQ(1,other.size());
+  ASSERT_TRUE(other[0]->bound_check());
+
+  for( auto cf : sch.block_list() ) {
+    if(cf->Is<LoopHeader>()) {
+      ASSERT_TRUE(Dominates(sch,sch.GetBlock(other[0]),cf));
+    }
+  }
+}
+
+TEST(BCE,NotEntered) {
+  const char* source = stringify(
+    function f(a) {
+      var l = [1,2,3,4];
+      var n = 0;
+      if(a) n = 8;
+      var s = 0;
+      for( var i = 0 ; n ; 1 ) {
+        s = s + l[i];
+      }
+      return s;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),BCE()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  // the loop may not be entered when n is 0 , a hoisted check would fail even if
+  // the loop never touches the list , so the check stays
+  std::vector<ListIndex*> loop , other;
+  CollectListIndex(sch,&loop,&other);
+  ASSERT_EQ(1,loop.size());
+  ASSERT_TRUE(loop[0]->bound_check());
+  ASSERT_TRUE(other.empty());
+}
+
+TEST(BCE,Break) {
+  const char* source = stringify(
+    function f(a) {
+      var l = [1,2,3,4];
+      var s = 0;
+      for( var i = 0 ; 8 ; 1 ) {
+        if(i == 2) break;
+        s = s + l[i];
+      }
+      return s;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),BCE()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  // the loop leaves before the index goes out of bound , so the check stays
+  std::vector<ListIndex*> loop , other;
+  CollectListIndex(sch,&loop,&other);
+  ASSERT_EQ(1,loop.size());
+  ASSERT_TRUE(loop[0]->bound_check());
+  ASSERT_TRUE(other.empty());
+}
+
+TEST(BCE,Pop) {
+  const char* source = stringify(
+    function f(a) {
+      var l = [1,2,3,4];
+      var s = 0;
+      for( var i = 0 ; 4 ; 1 ) {
+        s = s + l[i];
+        pop(l);
+      }
+      return s;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),BCE()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  // the list is shrinked inside of the loop , the check stays
+  std::vector<ListIndex*> loop , other;
+  CollectListIndex(sch,&loop,&other);
+  ASSERT_EQ(1,loop.size());
+  ASSERT_TRUE(loop[0]->bound_check());
+  ASSERT_TRUE(other.empty());
+}
+
+} // namespace hir
+} // namespace cbase
+} // namespace lavascript
+
+int main( int argc, char* argv[] ) {
+  ::lavascript::InitTrace("-");
+  testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
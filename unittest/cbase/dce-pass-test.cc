@@ -0,0 +1,143 @@
+#include <unittest/cbase/schedule-check.h>
+#include <src/cbase/pass/dce.h>
+
+#define stringify(...) #__VA_ARGS__
+
+namespace lavascript {
+namespace cbase {
+namespace hir {
+
+using namespace ::lavascript::interpreter;
+using namespace ::lavascript::parser;
+using namespace ::lavascript;
+
+TEST(DCE,FoldBranch) {
+  const char* source = stringify(
+    function f(a) {
+      var t = 1;
+      if(t) return a + 1;
+      return a * 2;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph));
+  ASSERT_TRUE(DCE().Perform(&graph,HIRPass::NORMAL));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  // the branch is gone and so is the arithmetic of the dead branch , which is
+  // part of the effect chain
+  ASSERT_EQ(0,CountBlock<If>(sch));
+  ASSERT_EQ(1,CountBlock<Return>(sch));
+
+  std::vector<Expr*> arith_list;
+  CollectNode<Arithmetic>(sch,&arith_list);
+  ASSERT_EQ(1,arith_list.size());
+  ASSERT_EQ(Binary::ADD,arith_list[0]->As<Arithmetic>()->op());
+}
+
+TEST(DCE,FoldPhi) {
+  const char* source = stringify(
+    function f(a) {
+      var x = 1.5;
+      var t = null;
+      if(t) x = 2.5; else x = 3.5;
+      return x + a;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph));
+  ASSERT_TRUE(DCE().Perform(&graph,HIRPass::NORMAL));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  // the merge only has one predecessor , the phi is just the false value
+  ASSERT_EQ(0,CountBlock<If>(sch));
+  ASSERT_EQ(0,CountPhi(sch));
+
+  std::vector<Expr*> const_list;
+  CollectNode<Float64>(sch,&const_list);
+  ASSERT_EQ(1,const_list.size());
+  ASSERT_EQ(3.5,const_list[0]->As<Float64>()->value());
+}
+
+TEST(DCE,UnusedPhi) {
+  const char* source = stringify(
+    function f(a) {
+      var u = 0;
+      if(a) u = 1;
+      return a;
+    }
+    return 0;
+  );
+  Context ctx;
+
+  {
+    Graph graph;
+    ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph));
+    zone::Zone zone;
+    Schedule sch(&zone,graph);
+    ASSERT_EQ(1,CountPhi(sch));
+  }
+
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph));
+  ASSERT_TRUE(DCE().Perform(&graph,HIRPass::NORMAL));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  // the branch stays but the phi of u is not used by anyone
+  ASSERT_EQ(1,CountBlock<If>(sch));
+  ASSERT_EQ(0,CountPhi(sch));
+
+  std::vector<Expr*> const_list;
+  CollectNode<Float64>(sch,&const_list);
+  ASSERT_TRUE(const_list.empty());
+}
+
+TEST(DCE,Loop) {
+  const char* source = stringify(
+    function f(a) {
+      var s = 0;
+      for( var i = 0 ; a ; 1 ) {
+        if(null) s = s + i;
+        s = s + 1;
+      }
+      return s;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph));
+  ASSERT_TRUE(DCE().Perform(&graph,HIRPass::NORMAL));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  // the branch inside of the loop is folded but the loop is untouched
+  ASSERT_EQ(0,CountBlock<If>(sch));
+  ASSERT_EQ(1,CountBlock<Loop>(sch));
+  ASSERT_EQ(1,CountBlock<LoopHeader>(sch));
+}
+
+} // namespace hir
+} // namespace cbase
+} // namespace lavascript
+
+int main( int argc, char* argv[] ) {
+  ::lavascript::InitTrace("-");
+  testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,194 @@
+#include <unittest/cbase/schedule-check.h>
+#include <src/cbase/pass/loop-induction.h>
+#include <src/cbase/pass/gvn.h>
+#include <src/cbase/pass/escape-analysis.h>
+
+#define stringify(...) #__VA_ARGS__
+
+namespace lavascript {
+namespace cbase {
+namespace hir {
+
+using namespace ::lavascript::interpreter;
+using namespace ::lavascript::parser;
+using namespace ::lavascript;
+
+namespace {
+
+// no allocation and memory access is left
+void CheckReplaced( const Schedule& sch ) {
+  ASSERT_EQ(0,CountNode<IRObject>    (sch));
+  ASSERT_EQ(0,CountNode<IRList>      (sch));
+  ASSERT_EQ(0,CountNode<StaticRef>   (sch));
+  ASSERT_EQ(0,CountNode<RefGet>      (sch));
+  ASSERT_EQ(0,CountNode<RefSet>      (sch));
+}
+
+} // namespace
+
+TEST(EscapeAnalysis,Basic) {
+  const char* source = stringify(
+    function f(x,y) {
+      var o = {"a":x,"b":2};
+      var l = [x,y];
+      var t = o.a + o.b;
+      return t + o.b + l[1];
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),EscapeAnalysis()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+  CheckReplaced(sch);
+}
+
+TEST(EscapeAnalysis,Checkpoint) {
+  const char* source = stringify(
+    function f(x,y) {
+      var o = {"a":x,"b":2};
+      var l = [x,y];
+      var t = o.a + o.b;
+      var z = y.k;
+      return t + o.b + l[1] + z;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),EscapeAnalysis()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+  // the loads after the hard barrier are replaced as well and the allocations
+  // are only kept for the checkpoint of the barrier
+  CheckReplaced(sch);
+  ASSERT_EQ(1,CountNode<PGet>(sch));
+}
+
+TEST(EscapeAnalysis,Branch) {
+  const char* source = stringify(
+    function f(x,y) {
+      var o = {"a":x,"b":2};
+      var l = [x,y,3];
+      if(y > 1) { o.a = y; l[0] = 5; } else { o.b = 3; }
+      l[2] = o.a;
+      return o.a + o.b + l[0] + l[2];
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),EscapeAnalysis()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+  CheckReplaced(sch);
+  // o.a , o.b and l[0] are different in each branch
+  ASSERT_EQ(3,CountPhi(sch));
+}
+
+TEST(EscapeAnalysis,Loop) {
+  const char* source = stringify(
+    function f(x,y) {
+      var o = {"a":x,"b":2};
+      var s = 0;
+      for( var i = 0 ; y ; 1 ) {
+        var p = [i,o.b];
+        p[1] = p[0] * o.a;
+        s = s + p[1] + p[0];
+      }
+      return s;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),EscapeAnalysis()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+  CheckReplaced(sch);
+}
+
+TEST(EscapeAnalysis,Escaped) {
+  const char* source = stringify(
+    function f(x,y) {
+      var o = {"a":x,"b":2};
+      var l = [o,y];
+      return l;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),EscapeAnalysis()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+  // the list is returned and the object is stored into the list
+  ASSERT_EQ(1,CountNode<IRObject>(sch));
+  ASSERT_EQ(1,CountNode<IRList>  (sch));
+}
+
+TEST(EscapeAnalysis,LoopCarried) {
+  const char* source = stringify(
+    function f(x,y) {
+      var o = {"a":x,"b":2};
+      for( var i = 0 ; y ; 1 ) {
+        o.a = o.a + i;
+      }
+      return o.a;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),EscapeAnalysis()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+  // the load inside of the loop needs a loop carried phi
+  ASSERT_EQ(1,CountNode<IRObject>(sch));
+  ASSERT_EQ(1,CountNode<ObjectRefSet>(sch));
+}
+
+TEST(EscapeAnalysis,MutatedCheckpoint) {
+  const char* source = stringify(
+    function f(x,y) {
+      var o = {"a":x,"b":2};
+      if(y > 1) { o.a = y; } else { o.b = 3; }
+      var z = y.k;
+      return o.a + o.b + z;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),EscapeAnalysis()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+  // the checkpoint cannot materialize the mutated object
+  ASSERT_EQ(1,CountNode<IRObject>(sch));
+  ASSERT_EQ(2,CountNode<ObjectRefGet>(sch));
+}
+
+} // namespace hir
+} // namespace cbase
+} // namespace lavascript
+
+int main( int argc, char* argv[] ) {
+  ::lavascript::InitTrace("-");
+  testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,54 @@
+#include <src/zone/zone.h>
+#include <src/trace.h>
+#include <src/cbase/hir.h>
+#include <src/cbase/fold/folder.h>
+
+#include <gtest/gtest.h>
+
+namespace lavascript {
+namespace cbase      {
+namespace hir        {
+
+namespace {
+
+// A boxed float64 value which is not a constant , so only the reassociation
+// rules of the arith folder can apply to it
+Expr* NewFloat64Value( Graph* graph ) {
+  auto a = Unbox::New(graph,Arg::New(graph,0),TPKIND_FLOAT64);
+  auto b = Unbox::New(graph,Arg::New(graph,1),TPKIND_FLOAT64);
+  return Box::New(graph,Float64Arithmetic::New(graph,a,b,Binary::ADD),TPKIND_FLOAT64);
+}
+
+bool IsFloat64Zero( Expr* node ) {
+  return node && node->Is<Float64>() && node->As<Float64>()->value() == 0;
+}
+
+} // namespace
+
+TEST(FoldArith,SelfSub) {
+  Graph graph;
+  zone::Zone zone;
+  FolderChain chain(&zone);
+  auto v = NewFloat64Value(&graph);
+  ASSERT_TRUE(IsFloat64Zero(chain.Fold(&graph,BinaryFolderData(Binary::SUB,v,v))));
+}
+
+TEST(FoldArith,SelfNotSub) {
+  Graph graph;
+  zone::Zone zone;
+  FolderChain chain(&zone);
+  auto v = NewFloat64Value(&graph);
+  ASSERT_FALSE(IsFloat64Zero(chain.Fold(&graph,BinaryFolderData(Binary::ADD,v,v))));
+  ASSERT_FALSE(IsFloat64Zero(chain.Fold(&graph,BinaryFolderData(Binary::MUL,v,v))));
+  ASSERT_FALSE(IsFloat64Zero(chain.Fold(&graph,BinaryFolderData(Binary::DIV,v,v))));
+}
+
+} // namespace hir
+} // namespace cbase
+} // namespace lavascript
+
+int main( int argc, char* argv[] ) {
+  ::lavascript::InitTrace("-");
+  testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
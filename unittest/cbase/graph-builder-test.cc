@@ -120,6 +120,24 @@ bool CheckGraphOSR( const char* source , std::size_t offset ) {
   return true;
 }
 
+// offset of the body of the first foreach loop in the main function , which is
+// where the OSR compilation starts
+std::size_t ForEachBodyOffset( const char* source ) {
+  Context ctx;
+  std::string error;
+  ScriptBuilder sb(":test",source);
+  if(!Compile(&ctx,source,&sb,&error)) return 0;
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+  auto itr = scp->main()->GetBytecodeIterator();
+  for( ; itr.HasNext() ; itr.Move() ) {
+    if(itr.opcode() == BC_FESTART) {
+      itr.Move();
+      return itr.pc() - scp->main()->code_buffer();
+    }
+  }
+  return 0;
+}
+
 } // namespace
 
 #define CASE(...)         ASSERT_TRUE(CheckGraph   (#__VA_ARGS__))
@@ -134,6 +152,22 @@ TEST(GraphBuilder,Basic) {
 
 }
 
+TEST(GraphBuilder,ForEach) {
+  // the foreach loop keeps its cursor in a second register which the graph
+  // doesn't model , so neither the function nor an OSR entry is compiled
+  const char* source = stringify(
+      var sum = 0;
+      for( var _ , v in [1,2,3] ) {
+        for( var i = 0 ; v ; 1 ) { sum = sum + i; }
+      }
+      return sum;
+  );
+  ASSERT_FALSE(CheckGraph(source));
+  std::size_t offset = ForEachBodyOffset(source);
+  ASSERT_TRUE(offset != 0);
+  ASSERT_FALSE(CheckGraphOSR(source,offset));
+}
+
 } // namespace hir
 } // namespace cbase
 } // namespace lavascript
@@ -0,0 +1,203 @@
+#include <unittest/cbase/schedule-check.h>
+#include <src/cbase/pass/loop-induction.h>
+#include <src/cbase/pass/gvn.h>
+
+#define stringify(...) #__VA_ARGS__
+
+namespace lavascript {
+namespace cbase {
+namespace hir {
+
+using namespace ::lavascript::interpreter;
+using namespace ::lavascript::parser;
+using namespace ::lavascript;
+
+TEST(GVN,LoopInvariantLoad) {
+  const char* source = stringify(
+    function f(a) {
+      var o = {"x":1,"y":2};
+      var l = [0,0];
+      for( var i = 0 ; 100 ; 1 ) {
+        l[0] = o.x;
+        o.y  = o.x;
+        l[1] = o.x;
+      }
+      return l;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  // the store into o.y doesn't change o.x , so all the o.x are one load and
+  // it is out of the loop
+  std::vector<Expr*> load_list;
+  CollectNode<ObjectRefGet>(sch,&load_list);
+  ASSERT_EQ(1,load_list.size());
+  ASSERT_EQ(0,sch.GetLoopDepth(sch.GetBlock(load_list[0])));
+
+  std::vector<Expr*> find_list;
+  CollectNode<ObjectFind>(sch,&find_list);
+  ASSERT_EQ(2,find_list.size());
+  for( auto f : find_list ) ASSERT_EQ(0,sch.GetLoopDepth(sch.GetBlock(f)));
+
+  // the store stays in the loop
+  std::vector<Expr*> store_list;
+  CollectNode<ObjectRefSet>(sch,&store_list);
+  ASSERT_EQ(1,store_list.size());
+  ASSERT_EQ(1,sch.GetLoopDepth(sch.GetBlock(store_list[0])));
+}
+
+TEST(GVN,LoopVariantLoad) {
+  const char* source = stringify(
+    function f(a) {
+      var o = {"x":1};
+      var l = [0];
+      for( var i = 0 ; 100 ; 1 ) {
+        l[0] = o.x;
+        o.x  = 2;
+      }
+      return l;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  // o.x is changed inside of the loop so the load cannot leave the loop ,
+  // but the lookup can since the store doesn't move the field
+  std::vector<Expr*> load_list;
+  CollectNode<ObjectRefGet>(sch,&load_list);
+  ASSERT_EQ(1,load_list.size());
+  ASSERT_EQ(1,sch.GetLoopDepth(sch.GetBlock(load_list[0])));
+
+  std::vector<Expr*> find_list;
+  CollectNode<ObjectFind>(sch,&find_list);
+  ASSERT_EQ(1,find_list.size());
+  ASSERT_EQ(0,sch.GetLoopDepth(sch.GetBlock(find_list[0])));
+}
+
+TEST(GVN,LoopPreHeader) {
+  const char* source = stringify(
+    function f(a) {
+      var o = {"x":1};
+      var l = [0];
+      var n = 0;
+      if(a) n = 100;
+      for( var i = 0 ; n ; 1 ) {
+        l[0] = o.x;
+      }
+      return l;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  ControlFlow* pre   = NULL;
+  ControlFlow* merge = NULL;
+  for( auto cf : sch.block_list() ) {
+    if(cf->Is<Loop>()) pre = cf->As<Loop>()->pre_header();
+    if(cf->Is<LoopMerge>()) merge = cf;
+  }
+  ASSERT_TRUE(pre && merge);
+  ASSERT_TRUE(pre->parent()->Is<LoopHeader>());
+  ASSERT_EQ(0,sch.GetLoopDepth(pre));
+  ASSERT_FALSE(Dominates(sch,pre,merge));
+
+  // the loop is not entered when the bound is 0 , so the lookups
+  // that can fail are hoisted into the pre-header which only runs when the
+  // loop header's condition is true ; so is the load using the lookup
+  std::vector<Expr*> list;
+  CollectNode<ObjectFind>  (sch,&list);
+  CollectNode<ListIndex>   (sch,&list);
+  CollectNode<ObjectRefGet>(sch,&list);
+  ASSERT_EQ(3,list.size());
+  for( auto n : list ) ASSERT_EQ(pre,sch.GetBlock(n)) << n->type_name();
+}
+
+TEST(GVN,Branch) {
+  const char* source = stringify(
+    function f(a) {
+      var o = {"x":1,"y":2};
+      var l = [0,0];
+      var u = 0;
+      if(a) { l[0] = o.y; u = o.x; } else { l[1] = o.y; u = o.x; }
+      return u;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  ControlFlow* branch = NULL;
+  for( auto cf : sch.block_list() ) if(cf->Is<If>()) branch = cf;
+  ASSERT_TRUE(branch);
+
+  // the loads done in both branches are moved before the branch , and then
+  // the phi of u has the same value from both branches
+  std::vector<Expr*> load_list;
+  CollectNode<ObjectRefGet>(sch,&load_list);
+  ASSERT_EQ(2,load_list.size());
+  for( auto l : load_list ) ASSERT_TRUE(Dominates(sch,sch.GetBlock(l),branch));
+  ASSERT_EQ(0,CountPhi(sch));
+}
+
+TEST(GVN,BranchStore) {
+  const char* source = stringify(
+    function f(a) {
+      var o = {"x":1};
+      var u = 0;
+      if(a) { o.x = 2; u = o.x; } else { u = o.x; }
+      return u;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  // the load after the store is forwarded when building the graph , the
+  // load of the false branch is not in the other branch so it stays there
+  std::vector<Expr*> load_list;
+  CollectNode<ObjectRefGet>(sch,&load_list);
+  ASSERT_EQ(1,load_list.size());
+  for( auto l : load_list ) {
+    auto b = sch.GetBlock(l);
+    ASSERT_TRUE(b->Is<IfFalse>()) << b->type_name();
+  }
+}
+
+} // namespace hir
+} // namespace cbase
+} // namespace lavascript
+
+int main( int argc, char* argv[] ) {
+  ::lavascript::InitTrace("-");
+  testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
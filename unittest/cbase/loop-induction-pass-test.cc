@@ -88,6 +88,39 @@ bool CheckGraph( const char* source ) {
   return true;
 }
 
+// Run the pass and count how many int64 typed loop induction variable is
+// in the graph
+int CountLoopIVInt64( const char* source ) {
+  Context ctx;
+  std::string error;
+  ScriptBuilder sb(":test",source);
+  if(!Compile(&ctx,source,&sb,&error)) {
+    std::cerr<<error<<std::endl;
+    return -1;
+  }
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+
+  RuntimeTrace tt;
+  Graph graph;
+  if(!BuildPrototype(scp,scp->main(),tt,&graph)) {
+    std::cerr<<"cannot build graph"<<std::endl;
+    return -1;
+  }
+
+  LoopInduction().Perform(&graph,HIRPass::NORMAL);
+
+  zone::Zone zone;
+  int count = 0;
+  lava_foreach( auto cf , ControlFlowBFSIterator(&zone,graph) ) {
+    if(!cf->Is<Loop>()) continue;
+    auto phi_list = cf->As<Loop>()->phi_list();
+    for( std::size_t i = 0 ; i < phi_list->size() ; ++i ) {
+      if(phi_list->Index(i)->Is<LoopIVInt64>()) ++count;
+    }
+  }
+  return count;
+}
+
 } // namesapce
 
 #define CASE(...)         ASSERT_TRUE(CheckGraph   (#__VA_ARGS__))
@@ -103,6 +136,47 @@ TEST(GraphBuilder,Basic) {
   );
 }
 
+TEST(LoopInduction,IntegralLoop) {
+  // integral start and step , fend2i
+  ASSERT_EQ(1,CountLoopIVInt64(stringify(
+      var sum = 0;
+      for( var i = 0 ; 100 ; 1 ) {
+        sum = sum + i;
+      }
+      return sum;
+  )));
+
+  // step is not integral
+  ASSERT_EQ(0,CountLoopIVInt64(stringify(
+      var sum = 0;
+      for( var i = 0 ; 100 ; 0.5 ) {
+        sum = sum + i;
+      }
+      return sum;
+  )));
+
+  // the bound is not a constant , fend2
+  ASSERT_EQ(0,CountLoopIVInt64(stringify(
+      var n = 100;
+      if(a) n = 0.5;
+      var sum = 0;
+      for( var i = 0 ; n ; 1 ) {
+        sum = sum + i;
+      }
+      return sum;
+  )));
+
+  // the loop doesn't count upward
+  ASSERT_EQ(0,CountLoopIVInt64(stringify(
+      var sum = 0;
+      for( var i = 0 ; 100 ; -1 ) {
+        sum = sum + i;
+        if(i < -10) break;
+      }
+      return sum;
+  )));
+}
+
 } // namespace hir
 } // namespace cbase
 } // namespace lavascript
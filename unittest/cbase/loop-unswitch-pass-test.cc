@@ -0,0 +1,262 @@
+#include <unittest/cbase/schedule-check.h>
+#include <src/cbase/pass/loop-induction.h>
+#include <src/cbase/pass/gvn.h>
+#include <src/cbase/pass/loop-unswitch.h>
+
+#define stringify(...) #__VA_ARGS__
+
+namespace lavascript {
+namespace cbase {
+namespace hir {
+
+using namespace ::lavascript::interpreter;
+using namespace ::lavascript::parser;
+using namespace ::lavascript;
+
+namespace {
+
+// count the branch placed inside of a loop
+std::size_t CountLoopBranch( const Schedule& sch ) {
+  std::size_t count = 0;
+  for( auto cf : sch.block_list() ) if(cf->Is<If>() && sch.GetLoopDepth(cf)) ++count;
+  return count;
+}
+
+} // namespace
+
+TEST(LoopUnswitch,Basic) {
+  const char* source = stringify(
+    function f(a,flag) {
+      var s = 0;
+      var c = flag > 1;
+      for( var i = 0 ; a ; 1 ) {
+        if(c) s = s + i; else s = s - i;
+      }
+      return s;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),LoopUnswitch()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  // the branch is hoisted in front of the loop and each loop only has one side
+  ASSERT_EQ(2,CountBlock<LoopHeader>(sch));
+  ASSERT_EQ(1,CountBlock<If>(sch));
+  ASSERT_EQ(0,CountLoopBranch(sch));
+
+  std::vector<Expr*> arith_list;
+  CollectNode<Arithmetic>(sch,&arith_list);
+  ASSERT_EQ(2,arith_list.size());
+  ASSERT_NE(arith_list[0]->As<Arithmetic>()->op(),arith_list[1]->As<Arithmetic>()->op());
+}
+
+TEST(LoopUnswitch,Multiple) {
+  const char* source = stringify(
+    function f(a,flag) {
+      var s = 0;
+      var c = flag > 1;
+      var d = flag < 5;
+      for( var i = 0 ; a ; 1 ) {
+        if(c) s = s + i;
+        if(d) s = s * 2;
+      }
+      return s;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),LoopUnswitch()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  // the loop is unswitched on c and then each copy is unswitched on d
+  ASSERT_EQ(4,CountBlock<LoopHeader>(sch));
+  ASSERT_EQ(0,CountLoopBranch(sch));
+}
+
+TEST(LoopUnswitch,Budget) {
+  const char* source = stringify(
+    function f(a,flag) {
+      var s = 0;
+      var c = flag > 1;
+      for( var i = 0 ; a ; 1 ) {
+        if(c) s = s + i; else s = s - i;
+      }
+      return s;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),LoopUnswitch(4)));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  // the loop is larger than the budget
+  ASSERT_EQ(1,CountBlock<LoopHeader>(sch));
+  ASSERT_EQ(1,CountLoopBranch(sch));
+}
+
+TEST(LoopUnswitch,Variant) {
+  const char* source = stringify(
+    function f(a,flag) {
+      var s = 0;
+      var c = flag > 1;
+      for( var i = 0 ; a ; 1 ) {
+        if(c) c = s; else s = s - i;
+      }
+      return s;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),LoopUnswitch()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  // c is modified inside of the loop
+  ASSERT_EQ(1,CountBlock<LoopHeader>(sch));
+  ASSERT_EQ(1,CountLoopBranch(sch));
+}
+
+TEST(LoopUnswitch,Return) {
+  const char* source = stringify(
+    function f(a,flag) {
+      var s = 0;
+      var c = flag > 1;
+      for( var i = 0 ; a ; 1 ) {
+        if(c) return s;
+        s = s + i;
+      }
+      return s;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),LoopUnswitch()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  // the return inside of the loop cannot be duplicated
+  ASSERT_EQ(1,CountBlock<LoopHeader>(sch));
+  ASSERT_EQ(1,CountLoopBranch(sch));
+}
+
+TEST(LoopUnswitch,PreHeader) {
+  const char* source = stringify(
+    function f(a,flag) {
+      var o = {"x":1};
+      var l = [0];
+      var s = 0;
+      var c = flag > 1;
+      var n = 0;
+      if(a) n = 100;
+      for( var i = 0 ; n ; 1 ) {
+        l[0] = o.x;
+        if(c) s = s + i; else s = s - i;
+      }
+      return s;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  // the pre-header holding the hoisted lookups is duplicated with the loop ,
+  // each loop has its own one
+  std::vector<ControlFlow*> pre_list;
+  for( auto cf : sch.block_list() ) {
+    if(!cf->Is<Loop>()) continue;
+    auto pre = cf->As<Loop>()->pre_header();
+    ASSERT_TRUE(pre) << cf->In(0)->type_name() << " " << cf->In(0)->parent()->type_name() << " " << CountBlock<LoopHeader>(sch) ;
+    ASSERT_EQ(0,sch.GetLoopDepth(pre));
+    pre_list.push_back(pre);
+  }
+  ASSERT_EQ(2,pre_list.size());
+  ASSERT_NE(pre_list[0],pre_list[1]);
+  ASSERT_EQ(0,CountLoopBranch(sch));
+
+  std::vector<Expr*> list;
+  CollectNode<ObjectFind>(sch,&list);
+  CollectNode<ListIndex> (sch,&list);
+  ASSERT_FALSE(list.empty());
+  for( auto n : list ) {
+    auto b = sch.GetBlock(n);
+    ASSERT_TRUE(b == pre_list[0] || b == pre_list[1]) << n->type_name();
+  }
+}
+
+TEST(LoopUnswitch,XPreHeader) {
+  const char* source = stringify(
+    function f(a) {
+      var o = {"x":1};
+      var l = [0];
+      var n = 0;
+      if(a) n = 100;
+      for( var i = 0 ; n ; 1 ) {
+        l[0] = o.x; if(a) n = 1; 
+      }
+      return l;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  ControlFlow* pre   = NULL;
+  ControlFlow* merge = NULL;
+  for( auto cf : sch.block_list() ) {
+    if(cf->Is<Loop>()) { pre = cf->As<Loop>()->pre_header(); std::cerr<<"LOOP "<<cf->id()<<" "<<cf->In(0)->type_name()<<"\n"; }
+    if(cf->Is<LoopMerge>()) merge = cf;
+  }
+  ASSERT_TRUE(pre && merge);
+  ASSERT_TRUE(pre->parent()->Is<LoopHeader>());
+  ASSERT_EQ(0,sch.GetLoopDepth(pre));
+  ASSERT_FALSE(Dominates(sch,pre,merge));
+
+  // the loop is not entered when the bound is 0 , so the lookups
+  // that can fail are hoisted into the pre-header which only runs when the
+  // loop header's condition is true ; so is the load using the lookup
+  std::vector<Expr*> list;
+  CollectNode<ObjectFind>  (sch,&list);
+  CollectNode<ListIndex>   (sch,&list);
+  CollectNode<ObjectRefGet>(sch,&list);
+  ASSERT_EQ(3,list.size());
+  for( auto n : list ) ASSERT_EQ(pre,sch.GetBlock(n)) << n->type_name();
+}
+
+} // namespace hir
+} // namespace cbase
+} // namespace lavascript
+
+int main( int argc, char* argv[] ) {
+  ::lavascript::InitTrace("-");
+  testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
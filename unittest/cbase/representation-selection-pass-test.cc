@@ -0,0 +1,212 @@
+#include <unittest/cbase/schedule-check.h>
+#include <src/cbase/pass/loop-induction.h>
+#include <src/cbase/pass/gvn.h>
+#include <src/cbase/pass/bce.h>
+#include <src/cbase/pass/representation-selection.h>
+
+#define stringify(...) #__VA_ARGS__
+
+namespace lavascript {
+namespace cbase {
+namespace hir {
+
+using namespace ::lavascript::interpreter;
+using namespace ::lavascript::parser;
+using namespace ::lavascript;
+
+namespace {
+
+template< typename T >
+std::size_t CountPhi( const Schedule& sch ) {
+  std::size_t count = 0;
+  for( auto cf : sch.block_list() ) {
+    if(!cf->Is<Merge>()) continue;
+    auto phi_list = cf->As<Merge>()->phi_list();
+    for( std::size_t i = 0 ; i < phi_list->size() ; ++i ) {
+      if(phi_list->Index(i)->Is<T>()) ++count;
+    }
+  }
+  return count;
+}
+
+// no phi is left boxed and no operand of a typed phi is boxed
+void CheckUnboxed( const Schedule& sch ) {
+  ASSERT_EQ(0,CountPhi<Phi>   (sch));
+  ASSERT_EQ(0,CountPhi<LoopIV>(sch));
+  for( auto cf : sch.block_list() ) {
+    if(!cf->Is<Merge>()) continue;
+    auto phi_list = cf->As<Merge>()->phi_list();
+    for( std::size_t i = 0 ; i < phi_list->size() ; ++i ) {
+      lava_foreach( auto o , phi_list->Index(i)->operand_list()->GetForwardIterator() ) {
+        ASSERT_FALSE(o->Is<Box>());
+      }
+    }
+  }
+}
+
+} // namespace
+
+TEST(RepresentationSelection,LoopCarried) {
+  const char* source = stringify(
+    function f(x,y) {
+      var s = 0.5;
+      var t = 1;
+      for( var i = 0 ; 10 ; 1 ) {
+        s = s * 1.5;
+        t = t * 2 + s;
+      }
+      return s + t;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),BCE(),RepresentationSelection()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+  CheckUnboxed(sch);
+  // s is typed by loop induction already , t is only known after s
+  ASSERT_EQ(1,CountPhi<LoopIVFloat64>(sch));
+  ASSERT_EQ(3,CountPhi<Float64Phi>(sch));
+  ASSERT_EQ(1,CountPhi<LoopIVInt64>(sch));
+  ASSERT_EQ(0,CountNode<Arithmetic>(sch));
+  ASSERT_EQ(0,CountNode<Box>(sch));
+}
+
+TEST(RepresentationSelection,Branch) {
+  const char* source = stringify(
+    function f(x,y) {
+      var s = 0.5;
+      for( var i = 0 ; 10 ; 1 ) {
+        if(i > 5) s = s * 1.5; else s = s + 2;
+      }
+      return s;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),BCE(),RepresentationSelection()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+  CheckUnboxed(sch);
+  // loop , if merge and loop merge
+  ASSERT_EQ(3,CountPhi<Float64Phi>(sch));
+  ASSERT_EQ(0,CountNode<Arithmetic>(sch));
+  ASSERT_EQ(0,CountNode<Box>(sch));
+
+  // branch on the unboxed comparison
+  for( auto cf : sch.block_list() ) {
+    if(cf->Is<If>()) {
+      ASSERT_TRUE(cf->operand_list()->First()->Is<Float64Compare>());
+    }
+  }
+}
+
+TEST(RepresentationSelection,Int64) {
+  const char* source = stringify(
+    function f(x,y) {
+      var s = 1;
+      for( var i = 0 ; 10 ; 1 ) {
+        s = s + i;
+      }
+      return s;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),BCE(),RepresentationSelection()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+  CheckUnboxed(sch);
+  // the int64 induction variable is converted for the float64 accumulator
+  ASSERT_EQ(1,CountPhi<LoopIVInt64>(sch));
+  ASSERT_EQ(0,CountNode<Arithmetic>(sch));
+  ASSERT_TRUE(CountNode<Int64ToFloat64>(sch));
+}
+
+TEST(RepresentationSelection,Unknown) {
+  const char* source = stringify(
+    function f(x,y) {
+      var s = 0.5;
+      for( var i = 0 ; 10 ; 1 ) {
+        s = s * 1.5 + x;
+      }
+      return s;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),BCE(),RepresentationSelection()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+  // the argument is not known to be a number , the whole cycle stays boxed
+  ASSERT_EQ(0,CountPhi<Float64Phi>(sch));
+  ASSERT_EQ(1,CountPhi<LoopIV>(sch));
+  ASSERT_EQ(2,CountNode<Arithmetic>(sch));
+}
+
+TEST(RepresentationSelection,BoxedUse) {
+  const char* source = stringify(
+    function f(x,y) {
+      var s = 0.5;
+      if(x) s = 1.5;
+      return s;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),BCE(),RepresentationSelection()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+  // the phi only merges constants and is only returned , so it stays boxed
+  // instead of boxing a float64 phi again
+  ASSERT_EQ(0,CountPhi<Float64Phi>(sch));
+  ASSERT_EQ(1,CountPhi<Phi>(sch));
+  ASSERT_EQ(0,CountNode<Box>(sch));
+}
+
+TEST(RepresentationSelection,NumberUse) {
+  const char* source = stringify(
+    function f(x,y) {
+      var s = 0.5;
+      if(x) s = 1.5;
+      return s * 2;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction(),GVN(),BCE(),RepresentationSelection()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+  // the same phi used by the arithmetic is selected along with it
+  ASSERT_EQ(1,CountPhi<Float64Phi>(sch));
+  ASSERT_EQ(0,CountPhi<Phi>(sch));
+  ASSERT_EQ(0,CountNode<Arithmetic>(sch));
+}
+
+} // namespace hir
+} // namespace cbase
+} // namespace lavascript
+
+int main( int argc, char* argv[] ) {
+  ::lavascript::InitTrace("-");
+  testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
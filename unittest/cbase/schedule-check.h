@@ -0,0 +1,124 @@
+#ifndef UNITTEST_CBASE_SCHEDULE_CHECK_H_
+#define UNITTEST_CBASE_SCHEDULE_CHECK_H_
+#include <src/interpreter/bytecode-generate.h>
+#include <src/script-builder.h>
+#include <src/context.h>
+#include <src/zone/zone.h>
+#include <src/parser/parser.h>
+#include <src/parser/ast/ast.h>
+#include <src/trace.h>
+#include <src/runtime-trace.h>
+
+#include <src/cbase/hir.h>
+#include <src/cbase/graph-builder.h>
+#include <src/cbase/hir-pass.h>
+#include <src/cbase/schedule.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+// Helpers shared by the schedule and hir pass tests , each test runs its own
+// passes on the graph and then checks the schedule of it
+
+namespace lavascript {
+namespace cbase {
+namespace hir {
+
+inline bool Compile( Context* context ,const char* source ,
+    ScriptBuilder* sb , std::string* error ) {
+  zone::Zone zone;
+  parser::Parser parser(source,&zone,error);
+  parser::ast::Root* result = parser.Parse();
+  if(!result) {
+    std::cerr<<"FAILED AT PARSE:"<<*error<<std::endl;
+    return false;
+  }
+  if(!interpreter::GenerateBytecode(context,*result,sb,error)) {
+    std::cerr<<"FAILED AT COMPILE:"<<*error<<std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Build graph for the function at index of the script , then run the passes on
+// it in order
+template< typename ... PASS >
+bool BuildTestGraph( Context* ctx , const char* source , std::size_t index ,
+                                                         Graph* graph ,
+                                                         PASS&& ... pass ) {
+  std::string error;
+  ScriptBuilder sb(":test",source);
+  if(!Compile(ctx,source,&sb,&error)) return false;
+  Handle<Script> scp( Script::New(ctx->gc(),ctx,sb) );
+  RuntimeTrace tt;
+  if(!BuildPrototype(scp,scp->GetFunction(index).prototype,tt,graph)) return false;
+  return (pass.Perform(graph,HIRPass::NORMAL) && ...);
+}
+
+inline bool Dominates( const Schedule& sch , ControlFlow* dom , ControlFlow* node ) {
+  for( ; node ; node = sch.GetImmDominator(node) ) {
+    if(node == dom) return true;
+  }
+  return false;
+}
+
+// every operand is available where the node is placed
+inline void CheckSchedule( const Schedule& sch ) {
+  for( auto cf : sch.block_list() ) {
+    auto& list = sch.GetNodeList(cf);
+    for( std::size_t i = 0 ; i < list.size() ; ++i ) {
+      auto node = list[i];
+      ASSERT_EQ(cf,sch.GetBlock(node));
+      if(node->Is<EffectMergeBase>()) continue;
+      lava_foreach( auto o , node->operand_list()->GetForwardIterator() ) {
+        if(o->Is<Checkpoint>() || o->Is<PhiBase>()) continue;
+        auto b = sch.GetBlock(o);
+        ASSERT_TRUE(b);
+        ASSERT_TRUE(Dominates(sch,b,cf)) << node->type_name() << " uses " << o->type_name();
+        if(b == cf) {
+          auto itr = std::find(list.begin(),list.begin()+i,o);
+          ASSERT_TRUE(itr != list.begin()+i);
+        }
+      }
+    }
+  }
+}
+
+template< typename T >
+void CollectNode( const Schedule& sch , std::vector<Expr*>* output ) {
+  for( auto cf : sch.block_list() ) {
+    for( auto n : sch.GetNodeList(cf) ) if(n->Is<T>()) output->push_back(n);
+  }
+}
+
+template< typename T >
+std::size_t CountNode( const Schedule& sch ) {
+  std::size_t count = 0;
+  for( auto cf : sch.block_list() ) {
+    for( auto n : sch.GetNodeList(cf) ) if(n->Is<T>()) ++count;
+  }
+  return count;
+}
+
+template< typename T >
+std::size_t CountBlock( const Schedule& sch ) {
+  std::size_t count = 0;
+  for( auto cf : sch.block_list() ) if(cf->Is<T>()) ++count;
+  return count;
+}
+
+inline std::size_t CountPhi( const Schedule& sch ) {
+  std::size_t count = 0;
+  for( auto cf : sch.block_list() ) {
+    if(cf->Is<Merge>()) count += cf->As<Merge>()->phi_list()->size();
+  }
+  return count;
+}
+
+} // namespace hir
+} // namespace cbase
+} // namespace lavascript
+
+#endif // UNITTEST_CBASE_SCHEDULE_CHECK_H_
@@ -0,0 +1,97 @@
+#include <unittest/cbase/schedule-check.h>
+#include <src/cbase/pass/loop-induction.h>
+
+#define stringify(...) #__VA_ARGS__
+
+namespace lavascript {
+namespace cbase {
+namespace hir {
+
+using namespace ::lavascript::interpreter;
+using namespace ::lavascript::parser;
+using namespace ::lavascript;
+
+TEST(Schedule,Sink) {
+  const char* source = stringify(
+    function f(a) {
+      if(a) return 1.5;
+      return 2.5;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  ControlFlow* branch = NULL;
+  for( auto cf : sch.block_list() ) if(cf->Is<If>()) branch = cf;
+  ASSERT_TRUE(branch);
+
+  // the constant used by one return only is sunk below the branch
+  std::vector<Expr*> const_list;
+  CollectNode<Float64>(sch,&const_list);
+  ASSERT_EQ(2,const_list.size());
+  for( auto c : const_list ) {
+    auto b = sch.GetBlock(c);
+    ASSERT_TRUE(b != branch);
+    ASSERT_TRUE(Dominates(sch,branch,b));
+  }
+}
+
+TEST(Schedule,Hoist) {
+  const char* source = stringify(
+    function g(a) {
+      var s = 0;
+      for( var i = 0 ; a ; 1 ) {
+        s = s + i * 2.5 + 7.5;
+      }
+      return s;
+    }
+    return 0;
+  );
+  Context ctx;
+  Graph graph;
+  ASSERT_TRUE(BuildTestGraph(&ctx,source,0,&graph,LoopInduction()));
+
+  zone::Zone zone;
+  Schedule sch(&zone,graph);
+  CheckSchedule(sch);
+
+  ControlFlow* body = NULL;
+  for( auto cf : sch.block_list() ) if(cf->Is<Loop>()) body = cf;
+  ASSERT_TRUE(body);
+  ASSERT_EQ(1,sch.GetLoopDepth(body));
+
+  // the loop invariant constants are out of the loop , and placed right
+  // before the loop instead of at the start
+  std::vector<Expr*> const_list;
+  CollectNode<Float64>(sch,&const_list);
+  ASSERT_FALSE(const_list.empty());
+  bool before_loop = false;
+  for( auto c : const_list ) {
+    auto b = sch.GetBlock(c);
+    ASSERT_EQ(0,sch.GetLoopDepth(b));
+    if(b->Is<LoopHeader>()) before_loop = true;
+  }
+  ASSERT_TRUE(before_loop);
+
+  // the computation on induction variable stays in the loop
+  std::vector<Expr*> arith_list;
+  CollectNode<Float64Arithmetic>(sch,&arith_list);
+  ASSERT_FALSE(arith_list.empty());
+  for( auto a : arith_list ) ASSERT_EQ(1,sch.GetLoopDepth(sch.GetBlock(a)));
+}
+
+} // namespace hir
+} // namespace cbase
+} // namespace lavascript
+
+int main( int argc, char* argv[] ) {
+  ::lavascript::InitTrace("-");
+  testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,78 @@
+#include <src/cbase/x64/assembler.h>
+#include <src/trace.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <initializer_list>
+
+namespace lavascript {
+namespace cbase {
+namespace x64 {
+
+// Check the code emitted by the function against the expected bytes
+template< typename T >
+bool CheckCode( T func , std::initializer_list<std::uint8_t> expect ) {
+  Assembler masm;
+  func(&masm);
+  std::vector<std::uint8_t> code(expect);
+  if(masm.buffer() == code) return true;
+  for( auto b : masm.buffer() ) fprintf(stderr,"%02x ",b);
+  fprintf(stderr,"\n");
+  return false;
+}
+
+TEST(Assembler,GeneralPurpose) {
+  ASSERT_TRUE(CheckCode([](Assembler* a) { a->mov(RAX,RBX); } , {0x48,0x89,0xd8}));
+  ASSERT_TRUE(CheckCode([](Assembler* a) { a->mov(R12,RDI); } , {0x49,0x89,0xfc}));
+  ASSERT_TRUE(CheckCode([](Assembler* a) { a->mov(RAX,Address(RSP,8)); } ,
+                        {0x48,0x8b,0x44,0x24,0x08}));
+  ASSERT_TRUE(CheckCode([](Assembler* a) { a->mov(Address(R13),RAX); } ,
+                        {0x49,0x89,0x45,0x00}));
+  ASSERT_TRUE(CheckCode([](Assembler* a) { a->mov(Address(RBX,2040),R11); } ,
+                        {0x4c,0x89,0x9b,0xf8,0x07,0x00,0x00}));
+  ASSERT_TRUE(CheckCode([](Assembler* a) { a->movi(RAX,1); } ,
+                        {0xb8,0x01,0x00,0x00,0x00}));
+  ASSERT_TRUE(CheckCode([](Assembler* a) { a->movi(RCX,static_cast<std::uint64_t>(-1)); } ,
+                        {0x48,0xc7,0xc1,0xff,0xff,0xff,0xff}));
+  ASSERT_TRUE(CheckCode([](Assembler* a) { a->movi(R10,0xfff8000000000000); } ,
+                        {0x49,0xba,0x00,0x00,0x00,0x00,0x00,0x00,0xf8,0xff}));
+  ASSERT_TRUE(CheckCode([](Assembler* a) { a->add(RSP,8); } , {0x48,0x83,0xc4,0x08}));
+  ASSERT_TRUE(CheckCode([](Assembler* a) { a->cmp(R10,R11); } , {0x4d,0x39,0xda}));
+  ASSERT_TRUE(CheckCode([](Assembler* a) { a->setcc(CC_E,RSI); } , {0x40,0x0f,0x94,0xc6}));
+  ASSERT_TRUE(CheckCode([](Assembler* a) { a->push(R12); a->pop(RBX); a->ret(); } ,
+                        {0x41,0x54,0x5b,0xc3}));
+}
+
+TEST(Assembler,SSE) {
+  ASSERT_TRUE(CheckCode([](Assembler* a) { a->addsd(XMM1,XMM14); } ,
+                        {0xf2,0x41,0x0f,0x58,0xce}));
+  ASSERT_TRUE(CheckCode([](Assembler* a) { a->movq(XMM0,RAX); } ,
+                        {0x66,0x48,0x0f,0x6e,0xc0}));
+  ASSERT_TRUE(CheckCode([](Assembler* a) { a->movsd(XMM15,Address(RSP,16)); } ,
+                        {0xf2,0x44,0x0f,0x10,0x7c,0x24,0x10}));
+  ASSERT_TRUE(CheckCode([](Assembler* a) { a->cvttsd2si(RAX,XMM1); } ,
+                        {0xf2,0x48,0x0f,0x2c,0xc1}));
+}
+
+TEST(Assembler,Label) {
+  // forward jump is patched when the label is bound , backward jump is
+  // resolved right away
+  ASSERT_TRUE(CheckCode([](Assembler* a) {
+    Label l;
+    a->jmp(&l);
+    a->int3();
+    a->Bind(&l);
+    a->jcc(CC_NE,&l);
+  } , {0xe9,0x01,0x00,0x00,0x00,0xcc,0x0f,0x85,0xfa,0xff,0xff,0xff}));
+}
+
+} // namespace x64
+} // namespace cbase
+} // namespace lavascript
+
+int main( int argc, char* argv[] ) {
+  ::lavascript::InitTrace("-");
+  testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,73 @@
+#include <src/zone/zone.h>
+#include <src/trace.h>
+#include <src/cbase/hir.h>
+#include <src/cbase/hir-kit.h>
+#include <src/cbase/schedule.h>
+#include <src/cbase/x64/lir.h>
+#include <src/cbase/x64/lower.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace lavascript {
+namespace cbase {
+namespace x64 {
+
+using namespace ::lavascript::cbase::hir;
+
+namespace {
+
+// Build a function returning its first argument guarded to be float64 , the
+// checkpoint of the guard belongs to the frame of the method
+void BuildGuardGraph( Graph* graph , std::uint32_t method ) {
+  kit::ControlFlowKit kit(graph);
+  auto arg = Arg::New(graph,0);
+  auto cp  = Checkpoint::New(graph,graph->zone()->New<IRInfo>(method,
+                                                interpreter::BytecodeLocation()));
+  cp->AddStackSlot(arg,0);
+  auto guard = Guard::New(graph,TestType::New(graph,TPKIND_FLOAT64,arg),cp);
+
+  kit.DoStart();
+  kit.DoReturn(guard);
+  kit.DoEnd();
+}
+
+} // namespace
+
+TEST(Lower,Guard) {
+  Graph graph;
+  BuildGuardGraph(&graph,1);
+
+  zone::Zone zone;
+  Schedule schedule(&zone,graph);
+  Function func(&zone);
+  std::string error;
+  ASSERT_TRUE(Lower(graph,schedule,&func,&error)) << error;
+  ASSERT_EQ(1,func.deopt_list().size());
+}
+
+TEST(Lower,InlinedFrameGuard) {
+  // the interpreter frame of an inlined method is not materialized on deopt ,
+  // so the graph must be rejected instead of resuming in the wrong frame
+  Graph graph;
+  BuildGuardGraph(&graph,2);
+
+  zone::Zone zone;
+  Schedule schedule(&zone,graph);
+  Function func(&zone);
+  std::string error;
+  ASSERT_FALSE(Lower(graph,schedule,&func,&error));
+  ASSERT_NE(std::string::npos,error.find("deoptimization of inlined frame is not supported"))
+    << error;
+}
+
+} // namespace x64
+} // namespace cbase
+} // namespace lavascript
+
+int main( int argc, char* argv[] ) {
+  ::lavascript::InitTrace("-");
+  testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
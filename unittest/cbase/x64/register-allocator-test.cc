@@ -0,0 +1,228 @@
+#include <src/zone/zone.h>
+#include <src/trace.h>
+#include <src/cbase/hir.h>
+#include <src/cbase/x64/lir.h>
+#include <src/cbase/x64/register-allocator.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace lavascript {
+namespace cbase {
+namespace x64 {
+
+namespace {
+
+// a copy , gtest takes the operands by reference
+const std::uint32_t kReservedSlot = RegisterAllocator::kReservedSlot;
+
+struct LocationLess {
+  bool operator () ( const Location& l , const Location& r ) const {
+    return l.kind != r.kind ? l.kind < r.kind : l.index < r.index;
+  }
+};
+
+typedef std::set<Location,LocationLess> LocationSet;
+
+const InstructionList& InstrList( const Function& func ) {
+  const Block* blk = func.block_list().front();
+  return blk->instr_list();
+}
+
+VReg EmitConst( Function* func , Block* blk , std::int64_t v ) {
+  auto instr = func->NewInstruction(LIR_CONST);
+  instr->def = func->NewVReg(VK_INT64);
+  instr->imm = static_cast<std::uint64_t>(v);
+  blk->instr_list()->push_back(instr);
+  return instr->def;
+}
+
+VReg EmitAdd( Function* func , Block* blk , VReg lhs , VReg rhs ) {
+  auto instr = func->NewInstruction(LIR_I64_ARITH);
+  instr->def = func->NewVReg(VK_INT64);
+  instr->imm = hir::Binary::ADD;
+  instr->AddUse(lhs);
+  instr->AddUse(rhs);
+  blk->instr_list()->push_back(instr);
+  return instr->def;
+}
+
+// Define size constants , 1 .. size , which are all live at the same time and
+// add them up in the order they are defined , base is added first
+VReg EmitSum( Function* func , Block* blk , VReg base , std::size_t size ) {
+  std::vector<VReg> list;
+  for( std::size_t i = 0 ; i < size ; ++i )
+    list.push_back(EmitConst(func,blk,static_cast<std::int64_t>(i+1)));
+  VReg sum = base;
+  for( auto v : list ) sum = (sum == kNoVReg ? v : EmitAdd(func,blk,sum,v));
+  return sum;
+}
+
+void EmitReturn( Function* func , Block* blk , VReg v ) {
+  auto instr = func->NewInstruction(LIR_RETURN);
+  instr->AddUse(v);
+  blk->instr_list()->push_back(instr);
+}
+
+// Run the straight line function in the locations assigned by the allocator ,
+// a value in a wrong location or a move clobbering a live value shows up in
+// the result
+std::int64_t Execute( const Function& func , const RegisterAllocator& ra ) {
+  std::map<Location,std::int64_t,LocationLess> machine;
+  std::uint32_t index = 0;
+  for( auto instr : InstrList(func) ) {
+    if(auto moves = ra.gap_move(index)) {
+      std::vector<std::int64_t> src;
+      for( auto &m : *moves ) src.push_back(machine[m.src]);
+      for( std::size_t i = 0 ; i < moves->size() ; ++i ) machine[(*moves)[i].dst] = src[i];
+    }
+
+    std::vector<std::int64_t> use;
+    LocationSet use_loc;
+    for( std::size_t i = 0 ; i < instr->use_size ; ++i ) {
+      auto loc = ra.location(instr->use[i],RegisterAllocator::UsePosition(index));
+      EXPECT_FALSE(loc.IsNone());
+      EXPECT_TRUE(use_loc.insert(loc).second);
+      use.push_back(machine[loc]);
+    }
+
+    switch(instr->op) {
+      case LIR_CONST:
+        machine[ra.location(instr->def,RegisterAllocator::DefPosition(index))] =
+          static_cast<std::int64_t>(instr->imm);
+        break;
+      case LIR_I64_ARITH:
+        machine[ra.location(instr->def,RegisterAllocator::DefPosition(index))] =
+          use[0] + use[1];
+        break;
+      case LIR_RETURN:
+        return use[0];
+      default:
+        ADD_FAILURE();
+        break;
+    }
+    ++index;
+  }
+  ADD_FAILURE();
+  return 0;
+}
+
+// Virtual registers having a stack location at any position between the
+// definition and the last use , the slots used are put into the set
+std::set<VReg> SpilledVReg( const Function& func , const RegisterAllocator& ra ,
+                                                   LocationSet* slot ) {
+  auto& instr_list = InstrList(func);
+  std::map<VReg,std::uint32_t> from , to;
+  for( std::uint32_t i = 0 ; i < instr_list.size() ; ++i ) {
+    auto instr = instr_list[i];
+    if(instr->def != kNoVReg) from[instr->def] = RegisterAllocator::DefPosition(i);
+    for( std::size_t j = 0 ; j < instr->use_size ; ++j )
+      to[instr->use[j]] = RegisterAllocator::UsePosition(i);
+  }
+
+  std::set<VReg> ret;
+  for( auto &e : to ) {
+    for( auto pos = from[e.first] ; pos <= e.second ; ++pos ) {
+      auto loc = ra.location(e.first,pos);
+      if(loc.IsStack()) { ret.insert(e.first); slot->insert(loc); }
+    }
+  }
+  return ret;
+}
+
+} // namespace
+
+TEST(RegisterAllocator,NoSpill) {
+  zone::Zone zone;
+  Function func(&zone);
+  auto blk = func.NewBlock();
+  func.PlaceBlock(blk);
+  EmitReturn(&func,blk,EmitSum(&func,blk,kNoVReg,4));
+
+  RegisterAllocator ra(&zone,func);
+  ra.Allocate();
+  ASSERT_EQ(10,Execute(func,ra));
+  ASSERT_EQ(kReservedSlot,ra.stack_slot_size());
+  for( std::uint32_t i = 0 ; i < InstrList(func).size() ; ++i )
+    ASSERT_TRUE(ra.gap_move(i) == NULL);
+}
+
+TEST(RegisterAllocator,SplitAndSpill) {
+  // more constants alive at the same time than general purpose registers
+  zone::Zone zone;
+  Function func(&zone);
+  auto blk = func.NewBlock();
+  func.PlaceBlock(blk);
+  EmitReturn(&func,blk,EmitSum(&func,blk,kNoVReg,20));
+
+  RegisterAllocator ra(&zone,func);
+  ra.Allocate();
+  ASSERT_EQ(210,Execute(func,ra));
+
+  LocationSet slot;
+  auto spilled = SpilledVReg(func,ra,&slot);
+  ASSERT_FALSE(spilled.empty());
+  ASSERT_GT(ra.stack_slot_size(),kReservedSlot);
+  for( auto &loc : slot ) ASSERT_GE(loc.index,kReservedSlot);
+
+  // a virtual register split inside of the block lives in 2 locations and
+  // the gap move in front of the instruction connects them
+  bool split = false;
+  for( std::uint32_t i = 0 ; i < InstrList(func).size() ; ++i ) {
+    auto moves = ra.gap_move(i);
+    if(!moves) continue;
+    for( auto &m : *moves ) {
+      ASSERT_TRUE(m.dst != m.src);
+      split = true;
+    }
+  }
+  ASSERT_TRUE(split);
+
+  for( auto v : spilled ) {
+    LocationSet loc;
+    for( std::uint32_t i = 0 ; i < InstrList(func).size() ; ++i ) {
+      auto instr = InstrList(func)[i];
+      if(instr->def == v) loc.insert(ra.location(v,RegisterAllocator::DefPosition(i)));
+      for( std::size_t j = 0 ; j < instr->use_size ; ++j ) {
+        if(instr->use[j] == v) loc.insert(ra.location(v,RegisterAllocator::UsePosition(i)));
+      }
+    }
+    // all spilled parts of a virtual register share one slot
+    std::size_t stack = 0;
+    for( auto &l : loc ) if(l.IsStack()) ++stack;
+    ASSERT_EQ(1,stack);
+  }
+}
+
+TEST(RegisterAllocator,SpillSlotReuse) {
+  // the constants of the second sum are defined after the ones of the first
+  // sum are dead , so their spill slots are reused
+  zone::Zone zone;
+  Function func(&zone);
+  auto blk = func.NewBlock();
+  func.PlaceBlock(blk);
+  auto first = EmitSum(&func,blk,kNoVReg,20);
+  EmitReturn(&func,blk,EmitSum(&func,blk,first,20));
+
+  RegisterAllocator ra(&zone,func);
+  ra.Allocate();
+  ASSERT_EQ(420,Execute(func,ra));
+
+  LocationSet slot;
+  auto spilled = SpilledVReg(func,ra,&slot);
+  ASSERT_LT(slot.size(),spilled.size());
+  ASSERT_EQ(kReservedSlot + slot.size(),ra.stack_slot_size());
+}
+
+} // namespace x64
+} // namespace cbase
+} // namespace lavascript
+
+int main( int argc, char* argv[] ) {
+  ::lavascript::InitTrace("-");
+  testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,147 @@
+#include <src/interpreter/bytecode-generate.h>
+#include <src/script-builder.h>
+#include <src/context.h>
+#include <src/config.h>
+#include <src/zone/zone.h>
+#include <src/parser/parser.h>
+#include <src/parser/ast/ast.h>
+#include <src/trace.h>
+#include <src/interpreter/x64-interpreter.h>
+#include <src/interpreter/coroutine.h>
+
+#include <gtest/gtest.h>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+
+#define stringify(...) #__VA_ARGS__
+
+using namespace lavascript;
+using namespace lavascript::parser;
+
+namespace {
+
+// SIGSEGV handler installed before the interpreter's one , it must see the
+// SIGSEGV that is not raised by the stack probe
+int forwarded_sigsegv = 0;
+
+void ForwardedSigSegvHandler( int , siginfo_t* , void* ) { ++forwarded_sigsegv; }
+
+bool Compile( Context* context , const char* source , ScriptBuilder* sb ,
+                                                      std::string* error ) {
+  zone::Zone zone;
+  Parser parser(source,&zone,error);
+  ast::Root* result = parser.Parse();
+  if(!result) {
+    std::cerr<<"FAILED AT PARSE:"<<*error<<std::endl;
+    return false;
+  }
+  if(!interpreter::GenerateBytecode(context,*result,sb,error)) {
+    std::cerr<<"FAILED AT COMPILE:"<<*error<<std::endl;
+    return false;
+  }
+  return true;
+}
+
+const char* kDeepRecursion = stringify(
+    var foo = function(a,b) {
+      if(a < 1) return a;
+      var c = b(a-1,b);
+      return c;
+    };
+    return foo(1000000,foo);
+);
+
+} // namespace
+
+namespace lavascript {
+namespace interpreter {
+
+TEST(StackOverflowHandler,Recover) {
+  AssemblerInterpreter ins;
+  Context ctx;
+  std::string error;
+  std::string script(kDeepRecursion);
+  ScriptBuilder sb("a",script);
+  ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+
+  // the interpreter's handler is installed in front of the previous one
+  struct sigaction act;
+  ASSERT_EQ(0,sigaction(SIGSEGV,NULL,&act));
+  ASSERT_TRUE(act.sa_flags & SA_SIGINFO);
+  ASSERT_TRUE(act.sa_sigaction != ForwardedSigSegvHandler);
+
+  // the guard area stays armed after the first overflow , so every run hits it
+  for( int i = 0 ; i < 3 ; ++i ) {
+    Handle<Object> obj( Object::New(ctx.gc()) );
+    Value ret;
+    error.clear();
+    ASSERT_FALSE(ins.Run(&ctx,scp,obj,&ret,&error));
+    ASSERT_NE(std::string::npos,error.find("interpreter stack overflow")) << error;
+    ASSERT_TRUE(ctx.runtime() == NULL);
+  }
+
+  // the interpreter stack is still usable after the overflow
+  {
+    std::string script2("var foo = function(a,b) { if(a < 1) return a; "
+                        "var c = b(a-1,b); return c; }; return foo(5000,foo);");
+    ScriptBuilder sb2("b",script2);
+    ASSERT_TRUE(Compile(&ctx,script2.c_str(),&sb2,&error));
+    Handle<Script> scp2( Script::New(ctx.gc(),&ctx,sb2) );
+    Handle<Object> obj( Object::New(ctx.gc()) );
+    Value ret;
+    ASSERT_TRUE(ins.Run(&ctx,scp2,obj,&ret,&error)) << error;
+    ASSERT_EQ(0,ret.GetReal());
+  }
+}
+
+TEST(StackOverflowHandler,Coroutine) {
+  // the probe touches the guard area of the coroutine's own stack
+  AssemblerInterpreter ins;
+  Context ctx;
+  std::string error;
+  std::string script(kDeepRecursion);
+  ScriptBuilder sb("a",script);
+  ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+  Handle<Object> obj( Object::New(ctx.gc()) );
+
+  Coroutine co(&ctx,scp,obj);
+  Value out;
+  ASSERT_FALSE(ins.Resume(&co,Value(),&out,&error));
+  ASSERT_EQ(COROUTINE_FAILED,co.status());
+  ASSERT_NE(std::string::npos,error.find("interpreter stack overflow")) << error;
+}
+
+TEST(StackOverflowHandler,Forward) {
+  // a SIGSEGV that is not raised by the probe goes to the previous handler
+  AssemblerInterpreter ins;
+  forwarded_sigsegv = 0;
+  raise(SIGSEGV);
+  ASSERT_EQ(1,forwarded_sigsegv);
+}
+
+} // namespace interpreter
+} // namespace lavascript
+
+int main( int argc, char* argv[] ) {
+  ::lavascript::InitTrace("-");
+
+  // the handler is chosen once when the interpreter stub is created
+  char name[] = "stack-overflow-handler-test";
+  char flag[] = "--Interpreter.stack_overflow_handler";
+  char* parg[] = { name , flag };
+  std::string error;
+  lava_verify(::lavascript::DConfigInit(2,parg,&error));
+
+  struct sigaction act;
+  memset(&act,0,sizeof(act));
+  act.sa_sigaction = ForwardedSigSegvHandler;
+  act.sa_flags     = SA_SIGINFO;
+  sigemptyset(&act.sa_mask);
+  lava_verify(sigaction(SIGSEGV,&act,NULL) == 0);
+
+  testing::InitGoogleTest(&argc,argv);
+  return RUN_ALL_TESTS();
+}
@@ -9,10 +9,21 @@
 #include <src/os.h>
 #include <src/trace.h>
 #include <src/interpreter/x64-interpreter.h>
+#include <src/interpreter/coroutine.h>
+#include <src/interpreter/bytecode-counter.h>
+#include <src/interpreter/handler-layout.h>
+#include <src/interpreter/profiler.h>
+#include <src/native-function.h>
+#include <src/perf-map.h>
+#include <src/runtime-trace.h>
 
 #include <gtest/gtest.h>
 #include <cassert>
 #include <iostream>
+#include <fstream>
+#include <cstring>
+#include <unistd.h>
+#include <csignal>
 #include <gtest/gtest.h>
 #include <cmath>
 
@@ -84,6 +95,76 @@ class PrintFn : public ::lavascript::Extension {
   virtual ~PrintFn() {}
 };
 
+// returns how many tail call has been done so far by the interpreter
+class TailCallCountFn : public ::lavascript::Extension {
+ public:
+  virtual const char* name() const { return "tcall_count"; }
+  virtual bool Call( ::lavascript::CallFrame* cf , std::string* error ) {
+    (void)error;
+    const interpreter::TailCallTrace& trace = cf->interp_runtime()->tcall_trace;
+    lava_verify(trace.count <= interpreter::TailCallTrace::kSize ||
+                trace.size() == interpreter::TailCallTrace::kSize);
+    cf->SetReturn(Value(static_cast<double>(trace.count)));
+    return true;
+  }
+  virtual ~TailCallCountFn() {}
+};
+
+// yield the argument to the host
+class YieldFn : public ::lavascript::Extension {
+ public:
+  virtual const char* name() const { return "yield"; }
+  virtual bool Call( ::lavascript::CallFrame* cf , std::string* error ) {
+    lava_verify(cf->GetArgumentSize() == 1);
+    return interpreter::Coroutine::Yield(cf,cf->GetArgument(0),error);
+  }
+  virtual ~YieldFn() {}
+};
+
+// yield the argument to the host and then fail the call
+class YieldFailFn : public ::lavascript::Extension {
+ public:
+  virtual const char* name() const { return "yield_fail"; }
+  virtual bool Call( ::lavascript::CallFrame* cf , std::string* error ) {
+    lava_verify(cf->GetArgumentSize() == 1);
+    if(!interpreter::Coroutine::Yield(cf,cf->GetArgument(0),error)) return false;
+    *error = "yield_fail failed";
+    return false;
+  }
+  virtual ~YieldFailFn() {}
+};
+
+// calls the global function add of the script with its arguments
+class AddFn : public ::lavascript::Extension {
+ public:
+  virtual const char* name() const { return "host_add"; }
+  virtual bool Call( ::lavascript::CallFrame* cf , std::string* error ) {
+    interpreter::Runtime* rt = cf->interp_runtime();
+    Handle<Object> globals(rt->global);
+    Value add;
+    lava_verify(globals->Get("add",&add));
+    Value args[2] = { cf->GetArgument(0) , cf->GetArgument(1) };
+    Value ret;
+    if(!static_cast<interpreter::AssemblerInterpreter*>(rt->interp)->Call(
+          rt->context,Handle<Script>(rt->script),globals,
+          Handle<Closure>(add.GetClosure()),args,2,&ret,error))
+      return false;
+    cf->SetReturn(ret);
+    return true;
+  }
+  virtual ~AddFn() {}
+};
+
+// typed native functions
+double NativeHypot( double a , double b ) { return std::sqrt(a*a+b*b); }
+bool   NativeNot  ( bool v ) { return !v; }
+Handle<String> NativeLonger( Handle<String> a , Handle<String> b ) {
+  return a->size() >= b->size() ? a : b;
+}
+
+int native_counter = 0;
+void NativeCount() { ++native_counter; }
+
 bool Bench( const char* source ) {
   lavascript::interpreter::AssemblerInterpreter ins;
 
@@ -153,6 +234,8 @@ bool PrimitiveComp( const char* source , const Value& primitive , int op ) {
     obj->Put(ctx.gc(),NewString(ctx.gc(),kGlobalLongString.c_str()),Value(1000));
     Value fn(ctx.gc()->NewExtension<PrintFn>());
     obj->Put(ctx.gc(),NewString(ctx.gc(),"print"),fn);
+    Value tc(ctx.gc()->NewExtension<TailCallCountFn>());
+    obj->Put(ctx.gc(),NewString(ctx.gc(),"tcall_count"),tc);
   }
 
   Value ret;
@@ -201,6 +284,44 @@ bool PrimitiveComp( const char* source , const Value& primitive , int op ) {
 #define BENCHMARK(...) \
   ASSERT_TRUE(Bench(#__VA_ARGS__))
 
+// run the source with the instruction budget , resume it every time it is
+// suspended and count how many times it has been suspended
+bool BudgetRun( const char* source , std::uint64_t budget , double expect ,
+                                                            int* suspend ) {
+  lavascript::interpreter::AssemblerInterpreter ins;
+
+  Context ctx;
+  std::string error;
+  std::string script(source);
+  ScriptBuilder sb("a",script);
+  lava_verify(Compile(&ctx,script.c_str(),&sb,&error));
+
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+  Handle<Object> obj( Object::New(ctx.gc()) );
+  Value ret;
+
+  ins.set_budget(budget);
+  *suspend = 0;
+  bool r = ins.Run(&ctx,scp,obj,&ret,&error);
+  while(!r && ins.suspended()) {
+    lava_verify(error.find("instruction budget exhausted") != std::string::npos);
+    ++*suspend;
+    r = ins.Resume(&ret,&error);
+  }
+  if(!r) {
+    std::cerr<<"Interpreter failed:"<<error<<std::endl;
+    return false;
+  }
+  return ret.IsReal() && ret.GetReal() == expect;
+}
+
+#define BUDGET_EQ(BUDGET,VALUE,SUSPEND,...)                                \
+  do {                                                                     \
+    int suspend;                                                           \
+    ASSERT_TRUE(BudgetRun(#__VA_ARGS__,BUDGET,VALUE,&suspend));            \
+    ASSERT_EQ(SUSPEND,suspend);                                            \
+  } while(false)
+
 
 } // namespace
 
@@ -547,6 +668,232 @@ TEST(Interpreter,FuncCall) {
      );
 }
 
+TEST(Interpreter,StackOverflow) {
+  // recursion that is not a tail call runs out of the interpreter stack
+  NEGATIVE(
+      var foo = function(a,b) {
+        if(a < 1) return a;
+        var c = b(a-1,b);
+        return c;
+      };
+      return foo(1000000,foo);
+      );
+  // extension call also probes the stack
+  NEGATIVE(
+      var foo = function(a,b) {
+        if(a < 1) return print(a);
+        var c = b(a-1,b);
+        return c;
+      };
+      return foo(1000000,foo);
+      );
+  // deep recursion within the stack limit is fine
+  PRIMITIVE_EQ(0,
+      var foo = function(a,b) {
+        if(a < 1) return a;
+        var c = b(a-1,b);
+        return c;
+      };
+      return foo(5000,foo);
+      );
+
+  // the stack is checked against its limit , no process wide SIGSEGV handler
+  // is installed unless Interpreter.stack_overflow_handler asks for it
+  struct sigaction act;
+  ASSERT_EQ(0,sigaction(SIGSEGV,NULL,&act));
+  ASSERT_FALSE(act.sa_flags & SA_SIGINFO);
+  ASSERT_TRUE(act.sa_handler == SIG_DFL);
+}
+
+TEST(Interpreter,TailCall) {
+  // deep tail recursion must run in constant stack space
+  PRIMITIVE_EQ(0,
+      var foo = function(a,b) {
+        if(a < 1) return a;
+        return b(a-1,b);
+      };
+      return foo(1000000,foo);
+      );
+  // mutual tail recursion
+  PRIMITIVE_EQ(true,
+      var even = function(a,e,o) {
+        if(a == 0) return true;
+        return o(a-1,e,o);
+      };
+      var odd = function(a,e,o) {
+        if(a == 0) return false;
+        return e(a-1,e,o);
+      };
+      return even(100000,even,odd);
+      );
+  // elided frames are recorded , the top level return is also a tail call
+  PRIMITIVE_EQ(10001,
+      var foo = function(a,b) {
+        if(a < 1) return tcall_count();
+        return b(a-1,b);
+      };
+      return foo(10000,foo);
+      );
+  // tail call inside of a normal call returns to the right frame
+  PRIMITIVE_EQ(11,
+      var foo = function(a,b) {
+        if(a < 1) return a;
+        return b(a-1,b);
+      };
+      var c = foo(1000,foo);
+      return c + 11;
+      );
+  // tail intrinsic call
+  PRIMITIVE_EQ(3,
+      var foo = function(a) { return min(a,2); };
+      var c = foo(10);
+      return c + 1;
+      );
+}
+
+TEST(Interpreter,TailCallErrorTrace) {
+  std::string script(stringify(
+      function bar(a) { return a + true; }
+      function foo(a) { return bar(a); }
+      function baz(a) { return foo(a); }
+      var r = baz(1);
+      return r;
+  ));
+  AssemblerInterpreter ins;
+  Context ctx;
+  std::string error;
+  ScriptBuilder sb("a",script);
+  ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+  Handle<Object> obj( Object::New(ctx.gc()) );
+  Value ret;
+  error.clear();
+  ASSERT_FALSE(ins.Run(&ctx,scp,obj,&ret,&error));
+
+  // foo and baz are gone from the stack , the error still names them with
+  // the most recent elided frame first
+  std::size_t foo = error.find("after tail call at foo:1");
+  std::size_t baz = error.find("after tail call at baz:1");
+  ASSERT_NE(std::string::npos,foo) << error;
+  ASSERT_NE(std::string::npos,baz) << error;
+  ASSERT_LT(foo,baz) << error;
+  ASSERT_EQ(std::string::npos,error.find("after tail call at main")) << error;
+}
+
+TEST(Interpreter,ErrorAfterReturn) {
+  // the return doesn't record the stack of the frame it returns to , the
+  // error helper does , so the error is traced from the frame of foo
+  std::string script(stringify(
+      function bar(a) { return a; }
+      function foo(a) { var b = bar(a); return b + true; }
+      function baz(a) { return foo(a); }
+      var r = baz(1);
+      return r;
+  ));
+  AssemblerInterpreter ins;
+  Context ctx;
+  std::string error;
+  ScriptBuilder sb("a",script);
+  ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+  Handle<Object> obj( Object::New(ctx.gc()) );
+  Value ret;
+  error.clear();
+  ASSERT_FALSE(ins.Run(&ctx,scp,obj,&ret,&error));
+  ASSERT_NE(std::string::npos,error.find("after tail call at baz:1")) << error;
+}
+
+TEST(Interpreter,CallSiteCache) {
+  // monomorphic call site
+  PRIMITIVE_EQ(100,
+      var foo = function(a) { return a + 1; };
+      var c = 0;
+      for( var i = 0 ; 100 ; 1 ) { c = foo(c); }
+      return c;
+      );
+  // call site rebound to different callee
+  PRIMITIVE_EQ(30,
+      var a = function(x) { return x + 1; };
+      var b = function(x) { return x + 2; };
+      var call = function(f,x) { var r = f(x); return r; };
+      var c = 0;
+      for( var i = 0 ; 10 ; 1 ) { c = call(a,c); c = call(b,c); }
+      return c;
+      );
+  // polymorphic tail call site
+  PRIMITIVE_EQ(30,
+      var a = function(x) { return x + 1; };
+      var b = function(x) { return x + 2; };
+      var call = function(f,x) { return f(x); };
+      var c = 0;
+      for( var i = 0 ; 10 ; 1 ) { c = call(a,c); c = call(b,c); }
+      return c;
+      );
+  // cached callee doesn't skip argument check for a new callee
+  NEGATIVE(
+      var a = function(x) { return x; };
+      var b = function(x,y) { return x; };
+      var call = function(f) { var r = f(1); return r; };
+      call(a);
+      return call(b);
+      );
+}
+
+TEST(Interpreter,CallSiteCacheFeedback) {
+  AssemblerInterpreter ins;
+  Context ctx;
+  std::string error;
+  std::string script(stringify(
+      var foo = function(a) { return a + 1; };
+      var c = 0;
+      for( var i = 0 ; 10 ; 1 ) { c = foo(c); }
+      return c;
+      ));
+  ScriptBuilder sb("a",script);
+  ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+  Handle<Object> obj( Object::New(ctx.gc()) );
+  Value ret;
+  ASSERT_TRUE(ins.Run(&ctx,scp,obj,&ret,&error));
+  ASSERT_TRUE(ret.IsReal());
+  ASSERT_EQ(10,ret.GetReal());
+
+  // find the only call site inside of the main function
+  Handle<Prototype> main(scp->main());
+  const std::uint32_t* call_pc = NULL;
+  for( auto itr = main->GetBytecodeIterator(); itr.HasNext(); itr.Move() ) {
+    if(itr.opcode() == BC_CALL) call_pc = itr.pc();
+  }
+  ASSERT_TRUE(call_pc);
+
+  const CallSiteCacheEntry* e = ctx.call_site_cache()->Find(call_pc);
+  ASSERT_TRUE(e);
+  ASSERT_EQ(9u,e->hit); // first call fills the cache
+  ASSERT_EQ(0u,e->miss);
+  ASSERT_EQ(e,ctx.call_site_cache()->GetCallTarget(call_pc));
+
+  // the callee and its frame info are fed to the JIT
+  RuntimeTrace trace;
+  ctx.call_site_cache()->FeedRuntimeTrace(main,&trace);
+  ASSERT_FALSE(trace.GetTrace(call_pc));
+  const CallTracePoint* ctp = trace.GetCallTrace(call_pc);
+  ASSERT_TRUE(ctp);
+  ASSERT_TRUE(ctp->callee.IsClosure());
+  Handle<Prototype> callee(ctp->callee.GetClosure()->prototype());
+  ASSERT_EQ(1u,ctp->argument_size);
+  ASSERT_EQ(callee->argument_size(),e->argument_size);
+  ASSERT_EQ(callee->max_local_var_size(),ctp->max_local_var_size);
+  ASSERT_EQ(callee->max_local_var_size(),e->max_local_var_size);
+  ASSERT_EQ(9u,ctp->hit);
+
+  // GC cycle drops the cached closure since it may be moved or released
+  ctx.gc()->ForceGC();
+  ASSERT_FALSE(ctx.call_site_cache()->Find(call_pc));
+}
+
 TEST(Interpreter,ArrayIndexI) {
   PRIMITIVE_EQ(4,
       var bar = [1,2,3,4,5];
@@ -740,6 +1087,87 @@ TEST(Interpreter,GSetSSO) {
         COMP_EQ));
 }
 
+TEST(Interpreter,IntegralLoop) {
+  PRIMITIVE_EQ(4950,
+      var sum = 0;
+      for( var i = 0 ; 100 ; 1 ) { sum = sum + i; }
+      return sum;
+      );
+  // negative step , loop is never entered since fend2i still uses "<"
+  PRIMITIVE_EQ(0,
+      var sum = 0;
+      for( var i = 10 ; 0 ; -1 ) { sum = sum + i; }
+      return sum;
+      );
+  // induction variable is assigned with non integral value in loop body
+  PRIMITIVE_EQ(8,
+      var r = 0;
+      for( var i = 0 ; 10 ; 2 ) { i = i + 0.5; r = i; }
+      return r;
+      );
+  // induction variable is assigned with non number in loop body
+  NEGATIVE(
+      for( var i = 0 ; 10 ; 1 ) { i = "a"; }
+      );
+}
+
+TEST(Interpreter,GlobalCache) {
+  // same instruction hits the cached cell
+  PRIMITIVE_EQ(200,
+      var c = 0;
+      for( var i = 0 ; 100 ; 1 ) { c = c + (a_global / 100); }
+      for( var i = 0 ; 100 ; 1 ) { c = c + (a_global / 100); }
+      return c;
+      );
+  // writes through the cached cell are visible to other instructions
+  PRIMITIVE_EQ(110,
+      for( var i = 0 ; 10 ; 1 ) { a_global = a_global + 1; }
+      return a_global;
+      );
+  ASSERT_TRUE(
+      PrimitiveComp(
+        Format(stringify(for( var i = 0 ; 10 ; 1 ) { %s = %s + 1; } return %s;),
+               kGlobalLongString.c_str(),
+               kGlobalLongString.c_str(),
+               kGlobalLongString.c_str()).c_str(),
+        Value(1010),
+        COMP_EQ));
+}
+
+TEST(Interpreter,GlobalCacheGC) {
+  AssemblerInterpreter ins;
+  Context ctx;
+  std::string error;
+  std::string script(stringify(
+      var c = 0;
+      for( var i = 0 ; 10 ; 1 ) { c = c + a_global; }
+      return c;
+      ));
+  ScriptBuilder sb("a",script);
+  ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+  Handle<Object> obj( Object::New(ctx.gc()) );
+  obj->Put(ctx.gc(),NewString(ctx.gc(),kGlobalSSO.c_str()),Value(1));
+  Value ret;
+  ASSERT_TRUE(ins.Run(&ctx,scp,obj,&ret,&error));
+  ASSERT_TRUE(ret.IsReal());
+  ASSERT_EQ(10,ret.GetReal());
+
+  // find the only global access inside of the main function
+  Handle<Prototype> main(scp->main());
+  const std::uint32_t* gget_pc = NULL;
+  for( auto itr = main->GetBytecodeIterator(); itr.HasNext(); itr.Move() ) {
+    if(itr.opcode() == BC_GGETSSO) gget_pc = itr.pc();
+  }
+  ASSERT_TRUE(gget_pc);
+  ASSERT_TRUE(ctx.global_cache()->Find(gget_pc,obj->map().ptr()));
+
+  // GC cycle drops the cached cell since the Map may be moved or released
+  ctx.gc()->ForceGC();
+  ASSERT_FALSE(ctx.global_cache()->Find(gget_pc,obj->map().ptr()));
+}
+
 TEST(Interpreter,GFail) {
   NEGATIVE(return a == 10;);
   NEGATIVE(return _1234567890123456789012345678901234567890(); );
@@ -765,6 +1193,51 @@ TEST(Interpreter,ForEach) {
       }
       return sum;
   );
+
+  // empty container
+  PRIMITIVE_EQ(0,
+      var sum = 0;
+      for( var _ , v in [] ) { sum = sum + 1; }
+      for( var _ , v in {} ) { sum = sum + 1; }
+      return sum;
+  );
+
+  // key of list
+  PRIMITIVE_EQ(6,
+      var sum = 0;
+      for( var k , _ in [5,5,5,5] ) { sum = sum + k; }
+      return sum;
+  );
+
+  // key of map
+  PRIMITIVE_EQ(true,
+      var r = "";
+      for( var k , _ in { "a" : 1 } ) { r = k; }
+      return r == "a";
+  );
+
+  // nested loop
+  PRIMITIVE_EQ(60,
+      var sum = 0;
+      var obj = { "a" : [1,2,3] , "b" : [1,2,3] , "c" : [1,2,3,4] };
+      for( var _ , l in obj ) {
+        for( var _ , v in l ) {
+          for( var _ , x in [v,v] ) { sum = sum + x; }
+        }
+      }
+      return sum + 20 - 4;
+  );
+
+  // break and continue
+  PRIMITIVE_EQ(4,
+      var sum = 0;
+      for( var _ , v in [1,2,3,4,5] ) {
+        if(v == 2) continue;
+        if(v == 4) break;
+        sum = sum + v;
+      }
+      return sum;
+  );
 }
 
 TEST(Interpreter,ExtCall) {
@@ -824,6 +1297,935 @@ TEST(Interpreter,UpValue) {
   );
 }
 
+TEST(Interpreter,Budget) {
+  // unlimited
+  BUDGET_EQ(0,4950,0,
+      var c = 0;
+      for( var i = 0 ; 100 ; 1 ) { c = c + i; }
+      return c;
+      );
+  // 100 back edges
+  BUDGET_EQ(10,4950,10,
+      var c = 0;
+      for( var i = 0 ; 100 ; 1 ) { c = c + i; }
+      return c;
+      );
+  // forever loop is suspended instead of running away
+  BUDGET_EQ(64,1000,15,
+      var c = 0;
+      for(;;) { c = c + 1; if(c == 1000) break; }
+      return c;
+      );
+  // suspended in the middle of recursive calls , fib(15) does 1973 calls
+  BUDGET_EQ(7,610,281,
+      var fib = function(a) {
+        if(a < 2) return a;
+        return fib(a-1) + fib(a-2);
+      };
+      return fib(15);
+      );
+  // foreach
+  BUDGET_EQ(2,10,2,
+      var sum = 0;
+      for( var _ , v in [1,2,3,4] ) { sum = sum + v; }
+      return sum;
+      );
+}
+
+TEST(Interpreter,BudgetAbort) {
+  lavascript::interpreter::AssemblerInterpreter ins;
+  Context ctx;
+  std::string error;
+  std::string script("var c = 0; for(;;) { c = c + 1; } return c;");
+  ScriptBuilder sb("a",script);
+  ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+  Handle<Object> obj( Object::New(ctx.gc()) );
+  Value ret;
+
+  ins.set_budget(1000);
+  ASSERT_FALSE(ins.Run(&ctx,scp,obj,&ret,&error));
+  ASSERT_TRUE(ins.suspended());
+  ASSERT_FALSE(ins.Resume(&ret,&error));
+  ASSERT_TRUE(ins.suspended());
+  ins.Abort();
+  ASSERT_FALSE(ins.suspended());
+  ASSERT_TRUE(ctx.runtime() == NULL);
+
+  // the context can be used by a new run after the abort
+  std::string script2("return 10;");
+  ScriptBuilder sb2("b",script2);
+  ASSERT_TRUE(Compile(&ctx,script2.c_str(),&sb2,&error));
+  Handle<Script> scp2( Script::New(ctx.gc(),&ctx,sb2) );
+  ASSERT_TRUE(ins.Run(&ctx,scp2,obj,&ret,&error));
+  ASSERT_EQ(10,ret.GetReal());
+}
+
+TEST(Interpreter,BudgetJIT) {
+  std::string script(stringify(
+      function sum(n) {
+        var s = 0;
+        for( var i = 0 ; n ; 1 ) { s = s + i; }
+        return s;
+      }
+      var r = 0;
+      for( var i = 0 ; 300 ; 1 ) { r = r + sum(10); }
+      return r;
+  ));
+  AssemblerInterpreter ins;
+  ins.set_jit_enable(true);
+  Context ctx;
+  std::string error;
+  ScriptBuilder sb("a",script);
+  ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+  Handle<Object> obj( Object::New(ctx.gc()) );
+  Value ret , sum;
+
+  // the machine code doesn't consume the budget , a run with budget never
+  // compiles the hot function
+  ins.set_budget(100000);
+  ASSERT_TRUE(ins.Run(&ctx,scp,obj,&ret,&error)) << error;
+  ASSERT_EQ(300*45,ret.GetReal());
+  ASSERT_TRUE(obj->Get("sum",&sum));
+  ASSERT_TRUE(sum.GetClosure()->prototype()->native_code() == NULL);
+
+  // the function is compiled once the budget is lifted
+  Handle<Object> obj2( Object::New(ctx.gc()) );
+  ins.set_budget(0);
+  ASSERT_TRUE(ins.Run(&ctx,scp,obj2,&ret,&error)) << error;
+  ASSERT_TRUE(obj2->Get("sum",&sum));
+  ASSERT_TRUE(sum.GetClosure()->prototype()->native_code() != NULL);
+
+  // and the code , which is kept by the prototype , is not entered by a run
+  // with budget , which still runs out of it
+  Handle<Object> obj3( Object::New(ctx.gc()) );
+  ins.set_budget(1000);
+  ASSERT_FALSE(ins.Run(&ctx,scp,obj3,&ret,&error));
+  ASSERT_TRUE(ins.suspended());
+  ins.Abort();
+}
+
+TEST(Interpreter,Coroutine) {
+  AssemblerInterpreter ins;
+  Context ctx;
+  std::string error;
+  std::string script(stringify(
+      var sum = 0;
+      for( var i = 0 ; 5 ; 1 ) { sum = sum + yield(i); }
+      return sum;
+  ));
+  ScriptBuilder sb("a",script);
+  ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+  Handle<Object> obj( Object::New(ctx.gc()) );
+  obj->Put(ctx.gc(),NewString(ctx.gc(),"yield"),Value(ctx.gc()->NewExtension<YieldFn>()));
+
+  // 2 coroutines of the same script interleaved on one context
+  Coroutine co1(&ctx,scp,obj);
+  Coroutine co2(&ctx,scp,obj);
+  ASSERT_EQ(COROUTINE_READY,co1.status());
+
+  Value out;
+  for( int i = 0 ; i < 5 ; ++i ) {
+    ASSERT_TRUE(ins.Resume(&co1,Value(10),&out,&error));
+    ASSERT_EQ(COROUTINE_SUSPENDED,co1.status());
+    ASSERT_TRUE(co1.yielded());
+    ASSERT_EQ(i,out.GetReal());
+    ASSERT_TRUE(ctx.runtime() == NULL);
+
+    ASSERT_TRUE(ins.Resume(&co2,Value(i),&out,&error));
+    ASSERT_EQ(COROUTINE_SUSPENDED,co2.status());
+    ASSERT_EQ(i,out.GetReal());
+  }
+
+  ASSERT_TRUE(ins.Resume(&co1,Value(10),&out,&error));
+  ASSERT_EQ(COROUTINE_DONE,co1.status());
+  ASSERT_EQ(50,out.GetReal());
+
+  ASSERT_TRUE(ins.Resume(&co2,Value(4),&out,&error));
+  ASSERT_EQ(COROUTINE_DONE,co2.status());
+  ASSERT_EQ(14,out.GetReal()); // 1 + 2 + 3 + 4 + 4
+
+  // yield outside of coroutine fails
+  ASSERT_FALSE(ins.Run(&ctx,scp,obj,&out,&error));
+  ASSERT_FALSE(ins.suspended());
+}
+
+TEST(Interpreter,CoroutineYieldFail) {
+  AssemblerInterpreter ins;
+  Context ctx;
+  std::string error;
+  std::string script(stringify(
+      var a = yield(1);
+      var b = yield_fail(2);
+      return a + b;
+  ));
+  ScriptBuilder sb("a",script);
+  ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+  Handle<Object> obj( Object::New(ctx.gc()) );
+  obj->Put(ctx.gc(),NewString(ctx.gc(),"yield"),Value(ctx.gc()->NewExtension<YieldFn>()));
+  obj->Put(ctx.gc(),NewString(ctx.gc(),"yield_fail"),
+                    Value(ctx.gc()->NewExtension<YieldFailFn>()));
+
+  Coroutine co(&ctx,scp,obj);
+  Value out;
+  ASSERT_TRUE(ins.Resume(&co,Value(),&out,&error));
+  ASSERT_EQ(COROUTINE_SUSPENDED,co.status());
+  ASSERT_EQ(1,out.GetReal());
+
+  // the extension fails after it yields , which is an error and not a suspend
+  error.clear();
+  ASSERT_FALSE(ins.Resume(&co,Value(10),&out,&error));
+  ASSERT_EQ(COROUTINE_FAILED,co.status());
+  ASSERT_FALSE(co.yielded());
+  ASSERT_NE(std::string::npos,error.find("yield_fail failed")) << error;
+  ASSERT_FALSE(co.IsAlive());
+}
+
+TEST(Interpreter,CoroutineCallbackStackOverflow) {
+  // the callback runs on the coroutine's stack , so it is checked against
+  // the end of that stack
+  AssemblerInterpreter ins;
+  Context ctx;
+  std::string error;
+  std::string script(stringify(
+      function add(a,b) {
+        if(a < 1) return b;
+        var c = add(a-1,b);
+        return c;
+      }
+      return host_add(1000000,0);
+  ));
+  ScriptBuilder sb("a",script);
+  ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+  Handle<Object> obj( Object::New(ctx.gc()) );
+  obj->Put(ctx.gc(),NewString(ctx.gc(),"host_add"),Value(ctx.gc()->NewExtension<AddFn>()));
+
+  Coroutine co(&ctx,scp,obj);
+  Value out;
+  error.clear();
+  ASSERT_FALSE(ins.Resume(&co,Value(),&out,&error));
+  ASSERT_EQ(COROUTINE_FAILED,co.status());
+  ASSERT_NE(std::string::npos,error.find("interpreter stack overflow")) << error;
+}
+
+TEST(Interpreter,CoroutineBudget) {
+  AssemblerInterpreter ins;
+  Context ctx;
+  std::string error;
+  std::string script(stringify(
+      var fib = function(a) {
+        if(a < 2) return a;
+        return fib(a-1) + fib(a-2);
+      };
+      return fib(yield(null));
+  ));
+  ScriptBuilder sb("a",script);
+  ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+  Handle<Object> obj( Object::New(ctx.gc()) );
+  obj->Put(ctx.gc(),NewString(ctx.gc(),"yield"),Value(ctx.gc()->NewExtension<YieldFn>()));
+
+  Coroutine co(&ctx,scp,obj);
+  Value out;
+  ASSERT_TRUE(ins.Resume(&co,Value(),&out,&error));
+  ASSERT_TRUE(co.yielded());
+
+  // runs out of budget in the middle of recursive calls and gets resumed
+  ins.set_budget(100);
+  int suspend = 0;
+  bool r = ins.Resume(&co,Value(15),&out,&error);
+  while(!r && co.status() == COROUTINE_SUSPENDED) {
+    ASSERT_FALSE(co.yielded());
+    ++suspend;
+    r = ins.Resume(&co,Value(),&out,&error);
+  }
+  ASSERT_TRUE(r);
+  ASSERT_EQ(COROUTINE_DONE,co.status());
+  ASSERT_EQ(610,out.GetReal());
+  ASSERT_EQ(19,suspend);
+}
+
+TEST(Interpreter,Call) {
+  AssemblerInterpreter ins;
+  Context ctx;
+  std::string error;
+  std::string script(stringify(
+      function add(a,b) { return a + b; }
+      function fib(n) {
+        if(n < 2) return n;
+        return fib(n-1) + fib(n-2);
+      }
+      function twice(a,b) { return host_add(a,b) * 2; }
+      return 0;
+  ));
+  ScriptBuilder sb("a",script);
+  ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+  Handle<Object> obj( Object::New(ctx.gc()) );
+  obj->Put(ctx.gc(),NewString(ctx.gc(),"host_add"),Value(ctx.gc()->NewExtension<AddFn>()));
+
+  Value ret;
+  ASSERT_TRUE(ins.Run(&ctx,scp,obj,&ret,&error));
+
+  Value add , fib , twice;
+  ASSERT_TRUE(obj->Get("add",&add));
+  ASSERT_TRUE(obj->Get("fib",&fib));
+  ASSERT_TRUE(obj->Get("twice",&twice));
+
+  // same callback called repeatedly reuses the runtime
+  for( int i = 0 ; i < 1000 ; ++i ) {
+    Value args[2] = { Value(i) , Value(1) };
+    ASSERT_TRUE(ins.Call(&ctx,scp,obj,Handle<Closure>(add.GetClosure()),args,2,&ret,&error));
+    ASSERT_EQ(i+1,ret.GetReal());
+    ASSERT_TRUE(ctx.runtime() == NULL);
+  }
+  {
+    Value args[1] = { Value(20) };
+    ASSERT_TRUE(ins.Call(&ctx,scp,obj,Handle<Closure>(fib.GetClosure()),args,1,&ret,&error));
+    ASSERT_EQ(6765,ret.GetReal());
+  }
+  // script calls host calls script
+  {
+    Value args[2] = { Value(3) , Value(4) };
+    ASSERT_TRUE(ins.Call(&ctx,scp,obj,Handle<Closure>(twice.GetClosure()),args,2,&ret,&error));
+    ASSERT_EQ(14,ret.GetReal());
+  }
+  // wrong argument number
+  {
+    Value args[1] = { Value(3) };
+    ASSERT_FALSE(ins.Call(&ctx,scp,obj,Handle<Closure>(add.GetClosure()),args,1,&ret,&error));
+  }
+}
+
+TEST(Interpreter,BudgetCallback) {
+  // the script does its work in the callbacks of host_add , which share the
+  // budget of the script
+  std::string script(stringify(
+      function add(a,b) {
+        var s = 0;
+        for( var i = 0 ; 1000 ; 1 ) { s = s + 1; }
+        return a + b;
+      }
+      var c = 0;
+      for( var i = 0 ; 10 ; 1 ) { c = host_add(c,i); }
+      return c;
+  ));
+  AssemblerInterpreter ins;
+  Context ctx;
+  std::string error;
+  ScriptBuilder sb("a",script);
+  ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+  Value ret;
+
+  {
+    Handle<Object> obj( Object::New(ctx.gc()) );
+    obj->Put(ctx.gc(),NewString(ctx.gc(),"host_add"),Value(ctx.gc()->NewExtension<AddFn>()));
+    ins.set_budget(100000);
+    ASSERT_TRUE(ins.Run(&ctx,scp,obj,&ret,&error)) << error;
+    ASSERT_EQ(45,ret.GetReal());
+  }
+
+  // the budget runs out inside of a callback , the host frame cannot be
+  // suspended so the run fails
+  {
+    Handle<Object> obj( Object::New(ctx.gc()) );
+    obj->Put(ctx.gc(),NewString(ctx.gc(),"host_add"),Value(ctx.gc()->NewExtension<AddFn>()));
+    ins.set_budget(5000);
+    error.clear();
+    ASSERT_FALSE(ins.Run(&ctx,scp,obj,&ret,&error));
+    ASSERT_FALSE(ins.suspended());
+    ASSERT_NE(std::string::npos,error.find("instruction budget exhausted")) << error;
+    ASSERT_TRUE(ctx.runtime() == NULL);
+  }
+}
+
+TEST(Interpreter,CallBatch) {
+  AssemblerInterpreter ins;
+  Context ctx;
+  std::string error;
+  std::string script(stringify(
+      function add(a,b) { return a + b; }
+      function tail(a,b) { return add(a,b); }
+      function fib(n) {
+        if(n < 2) return n;
+        return fib(n-1) + fib(n-2);
+      }
+      return 0;
+  ));
+  ScriptBuilder sb("a",script);
+  ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+  Handle<Object> obj( Object::New(ctx.gc()) );
+
+  Value ret;
+  ASSERT_TRUE(ins.Run(&ctx,scp,obj,&ret,&error));
+
+  Value add , tail , fib;
+  ASSERT_TRUE(obj->Get("add",&add));
+  ASSERT_TRUE(obj->Get("tail",&tail));
+  ASSERT_TRUE(obj->Get("fib",&fib));
+
+  static const std::size_t kCount = 1000;
+  std::vector<Value> args , output(kCount);
+  for( std::size_t i = 0 ; i < kCount ; ++i ) {
+    args.push_back(Value(static_cast<double>(i)));
+    args.push_back(Value(static_cast<double>(i)));
+  }
+
+  ASSERT_TRUE(ins.CallBatch(&ctx,scp,obj,Handle<Closure>(add.GetClosure()),
+                            args.data(),kCount,output.data(),&error));
+  for( std::size_t i = 0 ; i < kCount ; ++i ) ASSERT_EQ(i*2,output[i].GetReal());
+
+  // tail call replaces the closure of the bottom frame
+  ASSERT_TRUE(ins.CallBatch(&ctx,scp,obj,Handle<Closure>(tail.GetClosure()),
+                            args.data(),kCount,output.data(),&error));
+  for( std::size_t i = 0 ; i < kCount ; ++i ) ASSERT_EQ(i*2,output[i].GetReal());
+
+  {
+    Value n[5] = { Value(1) , Value(5) , Value(10) , Value(15) , Value(20) };
+    Value r[5];
+    ASSERT_TRUE(ins.CallBatch(&ctx,scp,obj,Handle<Closure>(fib.GetClosure()),n,5,r,&error));
+    ASSERT_EQ(1   ,r[0].GetReal());
+    ASSERT_EQ(5   ,r[1].GetReal());
+    ASSERT_EQ(55  ,r[2].GetReal());
+    ASSERT_EQ(610 ,r[3].GetReal());
+    ASSERT_EQ(6765,r[4].GetReal());
+  }
+
+  // stops at the failed record
+  {
+    Value n[4] = { Value(1) , Value(2) , Value(3) , Value() };
+    Value r[2];
+    ASSERT_FALSE(ins.CallBatch(&ctx,scp,obj,Handle<Closure>(add.GetClosure()),n,2,r,&error));
+    ASSERT_EQ(3,r[0].GetReal());
+    ASSERT_TRUE(ctx.runtime() == NULL);
+  }
+}
+
+TEST(Interpreter,NativeFunction) {
+  AssemblerInterpreter ins;
+  Context ctx;
+  std::string error;
+  std::string script(stringify(
+      var sum = 0;
+      for( var i = 0 ; 100 ; 1 ) {
+        sum = sum + hypot(3,4);
+        count();
+      }
+      var s = longer("ab","abcdef");
+      if(negate(false)) { if(s == "abcdef") return sum; }
+      return -1;
+  ));
+  ScriptBuilder sb("a",script);
+  ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+  Handle<Object> obj( Object::New(ctx.gc()) );
+  Handle<Extension> hypot(NativeFunction::New(ctx.gc(),&NativeHypot,"hypot"));
+  obj->Put(ctx.gc(),NewString(ctx.gc(),"hypot"),Value(hypot));
+  obj->Put(ctx.gc(),NewString(ctx.gc(),"negate"),
+                    Value(NativeFunction::New(ctx.gc(),&NativeNot,"negate")));
+  obj->Put(ctx.gc(),NewString(ctx.gc(),"longer"),
+                    Value(NativeFunction::New(ctx.gc(),&NativeLonger,"longer")));
+  obj->Put(ctx.gc(),NewString(ctx.gc(),"count"),
+                    Value(NativeFunction::New(ctx.gc(),&NativeCount,"count")));
+
+  ASSERT_TRUE(hypot->IsNativeFunction());
+
+  native_counter = 0;
+  Value ret;
+  ASSERT_TRUE(ins.Run(&ctx,scp,obj,&ret,&error));
+  ASSERT_EQ(500,ret.GetReal());
+  ASSERT_EQ(100,native_counter);
+
+  // argument type and number mismatch are reported as error
+  {
+    std::string s(stringify( return hypot(1,"a"); ));
+    ScriptBuilder sb("b",s);
+    ASSERT_TRUE(Compile(&ctx,s.c_str(),&sb,&error));
+    Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+    error.clear();
+    ASSERT_FALSE(ins.Run(&ctx,scp,obj,&ret,&error));
+    ASSERT_TRUE(error.find("expects type real") != std::string::npos);
+  }
+  {
+    std::string s(stringify( return hypot(1); ));
+    ScriptBuilder sb("c",s);
+    ASSERT_TRUE(Compile(&ctx,s.c_str(),&sb,&error));
+    Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+    error.clear();
+    ASSERT_FALSE(ins.Run(&ctx,scp,obj,&ret,&error));
+    ASSERT_TRUE(error.find("expects 2 arguments") != std::string::npos);
+  }
+}
+
+TEST(Interpreter,BytecodeCounter) {
+  AssemblerInterpreter ins;
+  Context ctx;
+  std::string error;
+  std::string script(stringify(
+      function add(a,b) { return a + b; }
+      var sum = 0;
+      for( var i = 0 ; 100 ; 1 ) {
+        sum = add(sum,i);
+      }
+      return sum;
+  ));
+  ScriptBuilder sb("a",script);
+  ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+  Handle<Object> obj( Object::New(ctx.gc()) );
+
+  BytecodeCounter counter;
+  ins.set_bytecode_counter(&counter);
+
+  Value ret;
+  ASSERT_TRUE(ins.Run(&ctx,scp,obj,&ret,&error));
+  ASSERT_EQ(4950,ret.GetReal());
+
+  // each iteration calls add once
+  ASSERT_EQ(100,counter.opcode_count(BC_ADDVV));
+  ASSERT_EQ(100,counter.opcode_count(BC_CALL));
+  ASSERT_TRUE(counter.total() > 400);
+
+  std::vector<BytecodeCounter::HotBytecode> hot;
+  counter.GetHotBytecode(3,&hot);
+  ASSERT_EQ(3,hot.size());
+  ASSERT_TRUE(hot[0].count >= 100);
+  ASSERT_EQ(hot[0].count,counter.count(hot[0].pc));
+  ASSERT_TRUE(hot[0].count >= hot[1].count && hot[1].count >= hot[2].count);
+
+  {
+    DumpWriter dw;
+    counter.Dump(scp,5,&dw);
+  }
+
+  // switch back to the normal dispatch table
+  ins.set_bytecode_counter(NULL);
+  counter.Clear();
+  ASSERT_TRUE(ins.Run(&ctx,scp,Handle<Object>(Object::New(ctx.gc())),&ret,&error));
+  ASSERT_EQ(4950,ret.GetReal());
+  ASSERT_EQ(0,counter.total());
+}
+
+TEST(Interpreter,Profiler) {
+  AssemblerInterpreter ins;
+  Context ctx;
+  std::string error;
+  std::string script(stringify(
+      function fib(n) {
+        if(n < 2) return n;
+        return fib(n-1) + fib(n-2);
+      }
+      var r = fib(24);
+      return r;
+  ));
+  ScriptBuilder sb("a",script);
+  ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+
+  Profiler profiler(&ctx);
+  ASSERT_TRUE(profiler.Start(10000));
+
+  // only one profiler can run at a time
+  {
+    Profiler other(&ctx);
+    ASSERT_FALSE(other.Start());
+  }
+
+  Value ret;
+  for( int i = 0 ; i < 100 && profiler.sample_size() < 10 ; ++i ) {
+    ASSERT_TRUE(ins.Run(&ctx,scp,Handle<Object>(Object::New(ctx.gc())),&ret,&error));
+    ASSERT_EQ(46368,ret.GetReal());
+  }
+  profiler.Stop();
+  ASSERT_FALSE(profiler.running());
+  ASSERT_TRUE(profiler.sample_size() > 0);
+
+  std::string folded;
+  profiler.GetFoldedStack(scp,&folded);
+
+  // every stack starts at the main function and the samples are in fib
+  ASSERT_EQ(0,folded.find("main:"));
+  ASSERT_TRUE(folded.find(";fib:") != std::string::npos);
+
+  profiler.Clear();
+  ASSERT_EQ(0,profiler.sample_size());
+}
+
+TEST(Interpreter,HandlerLayout) {
+  AssemblerInterpreter ins;
+  Context ctx;
+  std::string error;
+  std::string script(stringify(
+      function add(a,b) { return a + b; }
+      var sum = 0;
+      for( var i = 0 ; 100 ; 1 ) {
+        sum = add(sum,i);
+      }
+      return sum;
+  ));
+  ScriptBuilder sb("a",script);
+  ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+
+  Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+  BytecodeCounter counter;
+  ins.set_bytecode_counter(&counter);
+  Value ret;
+  ASSERT_TRUE(ins.Run(&ctx,scp,Handle<Object>(Object::New(ctx.gc())),&ret,&error));
+  ASSERT_EQ(4950,ret.GetReal());
+
+  // the callee's addvv is always followed by its return
+  ASSERT_EQ(100,counter.opcode_pair_count(BC_ADDVV,BC_RET));
+
+  // default layout is the bytecode list order
+  HandlerLayout layout;
+  for( int i = 0 ; i < SIZE_OF_BYTECODE ; ++i ) {
+    ASSERT_EQ(i,layout.order(i));
+    ASSERT_FALSE(layout.IsHot(static_cast<Bytecode>(i)));
+  }
+
+  layout.Load(counter);
+  std::string profile;
+  counter.WriteOpcodeProfile(&profile);
+  HandlerLayout text;
+  ASSERT_TRUE(text.Load(profile,&error));
+
+  // hot handlers come first , then the cold ones in bytecode list order
+  int hot = 0;
+  for( int i = 0 ; i < SIZE_OF_BYTECODE ; ++i ) {
+    Bytecode bc = layout.order(i);
+    ASSERT_EQ(bc,text.order(i));
+    if(layout.IsHot(bc)) {
+      ASSERT_EQ(hot,i);
+      ++hot;
+    } else if(i > hot) {
+      ASSERT_TRUE(layout.order(i-1) < bc);
+    }
+  }
+  ASSERT_TRUE(hot > 0);
+  ASSERT_TRUE(layout.IsHot(BC_ADDVV));
+  ASSERT_FALSE(layout.IsHot(BC_MODVV));
+
+  // addvv's most frequent successor is chained right after it
+  for( int i = 0 ; i < hot ; ++i ) {
+    if(layout.order(i) == BC_ADDVV) {
+      ASSERT_EQ(BC_RET,layout.order(i+1));
+    }
+  }
+
+  // a bad profile leaves the layout untouched
+  ASSERT_FALSE(text.Load("addvv 1\nnot-a-bytecode 2\n",&error));
+  ASSERT_EQ(layout.order(0),text.order(0));
+}
+
+TEST(Interpreter,JIT) {
+  std::string script(stringify(
+      function poly(a,b) { return a * a + b * 2 - 1; }
+      function pick(a,b) {
+        if(a < b) return b - a;
+        return a - b;
+      }
+      function sum(n) {
+        var s = 0;
+        for( var i = 0 ; n ; 1 ) {
+          s = s + i;
+        }
+        return s;
+      }
+      function list(a) { return [a,a]; }
+      var r = 0;
+      for( var i = 0 ; 300 ; 1 ) {
+        r = r + poly(i,1) + pick(i,150) + sum(i) + list(i)[1];
+      }
+      return r;
+  ));
+
+  Value expect;
+  for( int jit = 0 ; jit < 2 ; ++jit ) {
+    AssemblerInterpreter ins;
+    ins.set_jit_enable(jit != 0);
+    Context ctx;
+    std::string error;
+    ScriptBuilder sb("a",script);
+    ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+
+    Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+    Handle<Object> obj( Object::New(ctx.gc()) );
+    Value ret;
+    ASSERT_TRUE(ins.Run(&ctx,scp,obj,&ret,&error)) << error;
+
+    Value poly , pick , sum , list;
+    ASSERT_TRUE(obj->Get("poly",&poly));
+    ASSERT_TRUE(obj->Get("pick",&pick));
+    ASSERT_TRUE(obj->Get("sum" ,&sum ));
+    ASSERT_TRUE(obj->Get("list",&list));
+
+    if(!jit) {
+      expect = ret;
+      ASSERT_TRUE(poly.GetClosure()->prototype()->native_code() == NULL);
+      continue;
+    }
+    ASSERT_EQ(expect.GetReal(),ret.GetReal());
+
+    // the numeric functions are compiled , the one builds a list is not
+    // supported by the backend and stays interpreted
+    ASSERT_TRUE(poly.GetClosure()->prototype()->native_code() != NULL);
+    ASSERT_TRUE(pick.GetClosure()->prototype()->native_code() != NULL);
+    ASSERT_TRUE(sum .GetClosure()->prototype()->native_code() != NULL);
+    ASSERT_TRUE(list.GetClosure()->prototype()->native_code() == NULL);
+    ASSERT_TRUE(list.GetClosure()->prototype()->jit_failed());
+
+    // the compiled code is entered by calls from script , including the
+    // boxed slow path
+    std::string script2(stringify(
+        return poly(1.5,2) + pick(3,1) + sum(10);
+    ));
+    ScriptBuilder sb2("b",script2);
+    ASSERT_TRUE(Compile(&ctx,script2.c_str(),&sb2,&error));
+    Handle<Script> scp2( Script::New(ctx.gc(),&ctx,sb2) );
+    ASSERT_TRUE(ins.Run(&ctx,scp2,obj,&ret,&error)) << error;
+    ASSERT_EQ(1.5*1.5 + 2*2 - 1 + 2 + 45,ret.GetReal());
+
+    // generic arithmetic on bad operand fails with the interpreter's error
+    std::string script3(stringify(
+        return poly("a",1);
+    ));
+    ScriptBuilder sb3("c",script3);
+    ASSERT_TRUE(Compile(&ctx,script3.c_str(),&sb3,&error));
+    Handle<Script> scp3( Script::New(ctx.gc(),&ctx,sb3) );
+    ASSERT_FALSE(ins.Run(&ctx,scp3,obj,&ret,&error));
+  }
+}
+
+TEST(Interpreter,JITCallFeedback) {
+  // the callee of a hot function is known from the call site cache , a call
+  // the graph builder cannot inline keeps the caller interpreted
+  std::string script(stringify(
+      function inc(a) { return a + 1; }
+      function twice(a) { return inc(inc(a)); }
+      var r = 0;
+      for( var i = 0 ; 300 ; 1 ) {
+        r = r + twice(i);
+      }
+      return r;
+  ));
+
+  for( int jit = 0 ; jit < 2 ; ++jit ) {
+    AssemblerInterpreter ins;
+    ins.set_jit_enable(jit != 0);
+    Context ctx;
+    std::string error;
+    ScriptBuilder sb("a",script);
+    ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+
+    Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+    Handle<Object> obj( Object::New(ctx.gc()) );
+    Value ret;
+    ASSERT_TRUE(ins.Run(&ctx,scp,obj,&ret,&error)) << error;
+    ASSERT_EQ(299*300/2 + 2*300,ret.GetReal());
+    if(!jit) continue;
+
+    // the leaf is compiled , the caller loads its callee from the global
+    // which the backend doesn't support yet , so it stays interpreted
+    Value inc , twice;
+    ASSERT_TRUE(obj->Get("inc",&inc));
+    ASSERT_TRUE(obj->Get("twice",&twice));
+    ASSERT_TRUE(inc.GetClosure()->prototype()->native_code() != NULL);
+    ASSERT_TRUE(twice.GetClosure()->prototype()->jit_failed());
+  }
+}
+
+TEST(Interpreter,JITRegisterPressure) {
+  // more live values than registers , float64 values carried by loop and
+  // registers live across the runtime helper calls
+  std::string script(stringify(
+      function many(a,b) {
+        var c = a + b; var d = a - b; var e = a * b; var f = c + d;
+        var g = e - f; var h = g * c; var i = h + d; var j = i - e;
+        var k = j + a; var l = k * b; var m = l - c; var n = m + d;
+        var o = n + e; var p = o - f; var q = p + g; var r = q * 2;
+        var s = r + h + i + j + k + l + m + n + o + p + q;
+        return s + a + b + c + d + e + f + g;
+      }
+      function loopy(n) {
+        var s = 0; var t = 1; var u = 2; var w = 3;
+        for( var i = 0 ; n ; 1 ) {
+          s = s + i; t = t + s; u = u + t * 7; w = w + u ^ 0.5;
+        }
+        return s + t + u + w;
+      }
+      function cmp(a,b,c) {
+        var v = c + 1; var w = c * 2; var x = c - 3; var y = c * c; var z = c + 5;
+        if(a < b) return v + w + x + y + z;
+        return v - w - x - y - z;
+      }
+      var r = 0;
+      for( var i = 0 ; 300 ; 1 ) {
+        r = r + many(i,2) + loopy(i % 20) + cmp("a","b",i) + cmp("b","a",i);
+      }
+      return r;
+  ));
+
+  Value expect;
+  for( int jit = 0 ; jit < 2 ; ++jit ) {
+    AssemblerInterpreter ins;
+    ins.set_jit_enable(jit != 0);
+    Context ctx;
+    std::string error;
+    ScriptBuilder sb("a",script);
+    ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+
+    Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+    Handle<Object> obj( Object::New(ctx.gc()) );
+    Value ret;
+    ASSERT_TRUE(ins.Run(&ctx,scp,obj,&ret,&error)) << error;
+
+    if(!jit) {
+      expect = ret;
+      continue;
+    }
+    ASSERT_EQ(expect.GetReal(),ret.GetReal());
+
+    Value many , loopy , cmp;
+    ASSERT_TRUE(obj->Get("many" ,&many ));
+    ASSERT_TRUE(obj->Get("loopy",&loopy));
+    ASSERT_TRUE(obj->Get("cmp"  ,&cmp  ));
+    ASSERT_TRUE(many .GetClosure()->prototype()->native_code() != NULL);
+    ASSERT_TRUE(loopy.GetClosure()->prototype()->native_code() != NULL);
+    ASSERT_TRUE(cmp  .GetClosure()->prototype()->native_code() != NULL);
+  }
+}
+
+TEST(Interpreter,JITDeopt) {
+  // the arguments are speculated to be real numbers while the function is hot ,
+  // other arguments deopt back into the interpreter
+  std::string script(stringify(
+      function pick(a,b) {
+        if(a < b) return 1;
+        return 2;
+      }
+      var r = 0;
+      for( var i = 0 ; 300 ; 1 ) {
+        r = r + pick(i,150);
+      }
+      return r;
+  ));
+
+  std::string script2(stringify(
+      return pick("a","b") * 10 + pick("b","a") + pick(1,2) * 100;
+  ));
+
+  std::string script3(stringify(
+      var r = 0;
+      for( var i = 0 ; 20 ; 1 ) {
+        r = r + pick("a","b");
+      }
+      for( var i = 0 ; 300 ; 1 ) {
+        r = r + pick(i,150);
+      }
+      return r + pick("b","a");
+  ));
+
+  Value expect , expect2 , expect3;
+  for( int jit = 0 ; jit < 2 ; ++jit ) {
+    AssemblerInterpreter ins;
+    ins.set_jit_enable(jit != 0);
+    Context ctx;
+    std::string error;
+    ScriptBuilder sb("a",script);
+    ASSERT_TRUE(Compile(&ctx,script.c_str(),&sb,&error));
+
+    Handle<Script> scp( Script::New(ctx.gc(),&ctx,sb) );
+    Handle<Object> obj( Object::New(ctx.gc()) );
+    Value ret , ret2 , ret3;
+    ASSERT_TRUE(ins.Run(&ctx,scp,obj,&ret,&error)) << error;
+
+    Value pick;
+    ASSERT_TRUE(obj->Get("pick",&pick));
+    Prototype* proto = pick.GetClosure()->prototype().ptr();
+    if(jit) {
+      ASSERT_TRUE(proto->native_code() != NULL);
+      ASSERT_EQ(0,proto->deopt_count());
+    }
+
+    ScriptBuilder sb2("b",script2);
+    ASSERT_TRUE(Compile(&ctx,script2.c_str(),&sb2,&error));
+    Handle<Script> scp2( Script::New(ctx.gc(),&ctx,sb2) );
+    ASSERT_TRUE(ins.Run(&ctx,scp2,obj,&ret2,&error)) << error;
+
+    // deopts too often , the code is compiled again without speculation
+    ScriptBuilder sb3("c",script3);
+    ASSERT_TRUE(Compile(&ctx,script3.c_str(),&sb3,&error));
+    Handle<Script> scp3( Script::New(ctx.gc(),&ctx,sb3) );
+    ASSERT_TRUE(ins.Run(&ctx,scp3,obj,&ret3,&error)) << error;
+
+    if(!jit) {
+      expect = ret; expect2 = ret2; expect3 = ret3;
+      ASSERT_EQ(0,proto->deopt_count());
+      continue;
+    }
+    ASSERT_EQ(expect.GetReal() ,ret.GetReal());
+    ASSERT_EQ(expect2.GetReal(),ret2.GetReal());
+    ASSERT_EQ(expect3.GetReal(),ret3.GetReal());
+    ASSERT_EQ(112,ret2.GetReal());
+
+    ASSERT_EQ(compiler::kJITDeoptTrigger,proto->deopt_count());
+    ASSERT_FALSE(proto->jit_speculation());
+    ASSERT_TRUE (proto->native_code() != NULL);
+  }
+}
+
+bool ReadFile( const std::string& path , std::string* output ) {
+  std::ifstream file(path,std::ios::binary);
+  if(!file) return false;
+  output->assign(std::istreambuf_iterator<char>(file),std::istreambuf_iterator<char>());
+  return true;
+}
+
+TEST(Interpreter,PerfMap) {
+  AssemblerInterpreter ins;
+  std::string map_path (Format("/tmp/lavascript-test-%d.map" ,static_cast<int>(OS::GetPid())));
+  std::string dump_path(Format("/tmp/lavascript-test-%d.dump",static_cast<int>(OS::GetPid())));
+  {
+    PerfMap pm;
+    ASSERT_TRUE(pm.OpenPerfMap(map_path.c_str()));
+    ASSERT_TRUE(pm.OpenJITDump(dump_path.c_str()));
+    AssemblerInterpreterStub::GetInstance()->WritePerfMap(&pm);
+  }
+
+  std::string map;
+  ASSERT_TRUE(ReadFile(map_path,&map));
+  ASSERT_TRUE(map.find(" lavascript::interp::bc::addvv\n") != std::string::npos);
+  ASSERT_TRUE(map.find(" lavascript::interp::helper::") != std::string::npos);
+  ASSERT_TRUE(map.find(" lavascript::interp::profile::") != std::string::npos);
+
+  std::string dump;
+  ASSERT_TRUE(ReadFile(dump_path,&dump));
+  ASSERT_TRUE(dump.size() > 40);
+  std::uint32_t magic;
+  memcpy(&magic,dump.data(),sizeof(magic));
+  ASSERT_EQ(0x4A695444u,magic);
+
+  unlink(map_path.c_str());
+  unlink(dump_path.c_str());
+}
+
 } // namespace lavascript
 } // namespace interpreter
 